@@ -0,0 +1,386 @@
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "RCP_Host/RCP_Cobs.h"
+#include "RCP_Host/RCP_Host.h"
+#include "RCP_Host/RCP_Limits.h"
+#include "benchmark/benchmark.h"
+
+// Throughput benchmarks for packet decoding and encoding. All IO goes through in memory readData/sendData stubs, so
+// the numbers are for the library alone. Every benchmark reports packets/s and time/packet.
+
+// Bytes served to readData. The stream loops back to the start once exhausted, so it should hold whole packets
+struct Stream {
+    std::vector<uint8_t> bytes;
+    size_t pos = 0;
+};
+
+static size_t sendData(void*, const void* data, size_t length) {
+    benchmark::DoNotOptimize(data);
+    return length;
+}
+
+static size_t readData(void* user, void* data, size_t length) {
+    auto* stream = static_cast<Stream*>(user);
+    memcpy(data, stream->bytes.data() + stream->pos, length);
+    stream->pos += length;
+    if(stream->pos >= stream->bytes.size()) stream->pos = 0;
+    return length;
+}
+
+// Sinks for the decoded data. DoNotOptimize keeps the decoding from being optimized out
+static RCP_Error testUpdate(void*, RCP_TestData data) {
+    benchmark::DoNotOptimize(data);
+    return RCP_ERR_SUCCESS;
+}
+
+static RCP_Error boolUpdate(void*, RCP_BoolData data) {
+    benchmark::DoNotOptimize(data);
+    return RCP_ERR_SUCCESS;
+}
+
+static RCP_Error sactUpdate(void*, RCP_SimpleActuatorData data) {
+    benchmark::DoNotOptimize(data);
+    return RCP_ERR_SUCCESS;
+}
+
+static RCP_Error promptRequest(void*, RCP_PromptInputRequest request) {
+    benchmark::DoNotOptimize(request);
+    return RCP_ERR_SUCCESS;
+}
+
+static RCP_Error logUpdate(void*, RCP_TargetLogData data) {
+    benchmark::DoNotOptimize(data);
+    return RCP_ERR_SUCCESS;
+}
+
+static RCP_Error F1(void*, RCP_1F data) {
+    benchmark::DoNotOptimize(data);
+    return RCP_ERR_SUCCESS;
+}
+
+static RCP_Error F2(void*, RCP_2F data) {
+    benchmark::DoNotOptimize(data);
+    return RCP_ERR_SUCCESS;
+}
+
+static RCP_Error F3(void*, RCP_3F data) {
+    benchmark::DoNotOptimize(data);
+    return RCP_ERR_SUCCESS;
+}
+
+static RCP_Error F4(void*, RCP_4F data) {
+    benchmark::DoNotOptimize(data);
+    return RCP_ERR_SUCCESS;
+}
+
+static const RCP_CtxCallbacks BENCH_CALLBACKS = {.sendData = sendData,
+                                                 .readData = readData,
+                                                 .processTestUpdate = testUpdate,
+                                                 .processBoolData = boolUpdate,
+                                                 .processSimpleActuatorData = sactUpdate,
+                                                 .processPromptInput = promptRequest,
+                                                 .processTargetLog = logUpdate,
+                                                 .processOneFloat = F1,
+                                                 .processTwoFloat = F2,
+                                                 .processThreeFloat = F3,
+                                                 .processFourFloat = F4};
+
+static void setCounters(benchmark::State& state, int64_t packets, int64_t bytes) {
+    state.counters["packets/s"] = benchmark::Counter(static_cast<double>(packets), benchmark::Counter::kIsRate);
+
+    // An inverted rate is seconds per packet, which is printed with an SI prefix, so typically as ns
+    state.counters["time/packet"] =
+        benchmark::Counter(static_cast<double>(packets), benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.SetBytesProcessed(bytes);
+}
+
+// Packet builders. Timestamps and float values do not affect decoding speed, so fixed values are used
+static const uint8_t TS[] = {0x12, 0x34, 0x56, 0x78};
+static const uint8_t FLOAT[] = {0x00, 0x00, 0x80, 0x3F};
+
+static std::vector<uint8_t> compact(RCP_DeviceClass devclass, const std::vector<uint8_t>& params) {
+    std::vector<uint8_t> pkt = {static_cast<uint8_t>(params.size()), static_cast<uint8_t>(devclass)};
+    pkt.insert(pkt.end(), params.begin(), params.end());
+    return pkt;
+}
+
+static std::vector<uint8_t> extended(RCP_DeviceClass devclass, const std::vector<uint8_t>& params) {
+    // The extended length field holds one less than the number of parameter bytes
+    size_t len = params.size() - 1;
+    std::vector<uint8_t> pkt = {RCP_EXTENDED_MASK, static_cast<uint8_t>(len >> 8), static_cast<uint8_t>(len),
+                                static_cast<uint8_t>(devclass)};
+    pkt.insert(pkt.end(), params.begin(), params.end());
+    return pkt;
+}
+
+// Parameters of a timestamped reading from device 1 with some number of floats
+static std::vector<uint8_t> floatReading(int floats) {
+    std::vector<uint8_t> params(TS, TS + sizeof(TS));
+    params.push_back(1);
+    for(int i = 0; i < floats; i++) params.insert(params.end(), FLOAT, FLOAT + sizeof(FLOAT));
+    return params;
+}
+
+static std::vector<uint8_t> withTS(std::vector<uint8_t> rest) {
+    rest.insert(rest.begin(), TS, TS + sizeof(TS));
+    return rest;
+}
+
+// Poll the same packet repeatedly. packets is how many packets the stream holds, normally one, and limits are checked
+// against every reading if given
+static void pollLoop(benchmark::State& state, std::vector<uint8_t> bytes, int64_t packets = 1,
+                     RCP_Limits* limits = nullptr) {
+    Stream stream{.bytes = std::move(bytes)};
+    RCP_Context* ctx = nullptr;
+    if(RCP_ctx_create(BENCH_CALLBACKS, &stream, &ctx) != RCP_ERR_SUCCESS) {
+        state.SkipWithError("Could not create context");
+        return;
+    }
+
+    RCP_ctx_setLimits(ctx, limits);
+
+    for(auto _ : state) {
+        for(int64_t i = 0; i < packets; i++) {
+            RCP_Error rerrno = RCP_ctx_poll(ctx);
+            if(rerrno != RCP_ERR_SUCCESS) {
+                state.SkipWithError(RCP_errstr(rerrno));
+                break;
+            }
+        }
+    }
+
+    setCounters(state, state.iterations() * packets, state.iterations() * static_cast<int64_t>(stream.bytes.size()));
+    RCP_ctx_destroy(ctx);
+}
+
+// ------------ Decoding ------------ //
+
+// The same temperature reading in each packet format
+static void BM_PollCompact(benchmark::State& state) {
+    pollLoop(state, compact(RCP_DEVCLASS_TEMPERATURE, floatReading(1)));
+}
+BENCHMARK(BM_PollCompact);
+
+static void BM_PollExtended(benchmark::State& state) {
+    pollLoop(state, extended(RCP_DEVCLASS_TEMPERATURE, floatReading(1)));
+}
+BENCHMARK(BM_PollExtended);
+
+// One benchmark per device class the host receives, registered as BM_PollDevclass/<class>. Test states carry two more
+// bytes while a test is running, so both sizes are covered
+static const std::vector<std::pair<std::string, std::vector<uint8_t>>> DEVCLASS_PACKETS = {
+    {"TEST_STATE", compact(RCP_DEVCLASS_TEST_STATE, withTS({RCP_DATA_STREAM_MASK | RCP_TEST_STOPPED, 0x00}))},
+    {"TEST_STATE_RUNNING",
+     compact(RCP_DEVCLASS_TEST_STATE, withTS({RCP_DATA_STREAM_MASK | RCP_TEST_RUNNING, 0x00, 0x01, 50}))},
+    {"SIMPLE_ACTUATOR", compact(RCP_DEVCLASS_SIMPLE_ACTUATOR, withTS({0x01, RCP_SIMPLE_ACTUATOR_ON}))},
+    {"STEPPER", compact(RCP_DEVCLASS_STEPPER, floatReading(2))},
+    {"PROMPT", compact(RCP_DEVCLASS_PROMPT, {RCP_PromptDataType_GONOGO, 'G', 'O', '?'})},
+    {"ANGLED_ACTUATOR", compact(RCP_DEVCLASS_ANGLED_ACTUATOR, floatReading(1))},
+    {"MOTOR", compact(RCP_DEVCLASS_MOTOR, floatReading(1))},
+    {"TARGET_LOG", compact(RCP_DEVCLASS_TARGET_LOG, withTS({'t', 'a', 'r', 'g', 'e', 't', ' ', 'l', 'o', 'g'}))},
+    {"AM_PRESSURE", compact(RCP_DEVCLASS_AM_PRESSURE, floatReading(1))},
+    {"TEMPERATURE", compact(RCP_DEVCLASS_TEMPERATURE, floatReading(1))},
+    {"PRESSURE_TRANSDUCER", compact(RCP_DEVCLASS_PRESSURE_TRANSDUCER, floatReading(1))},
+    {"RELATIVE_HYGROMETER", compact(RCP_DEVCLASS_RELATIVE_HYGROMETER, floatReading(1))},
+    {"LOAD_CELL", compact(RCP_DEVCLASS_LOAD_CELL, floatReading(1))},
+    {"BOOL_SENSOR", compact(RCP_DEVCLASS_BOOL_SENSOR, withTS({0x01, 0x01}))},
+    {"FLOW_METER", compact(RCP_DEVCLASS_FLOW_METER, floatReading(1))},
+    {"POWERMON", compact(RCP_DEVCLASS_POWERMON, floatReading(2))},
+    {"ACCELEROMETER", compact(RCP_DEVCLASS_ACCELEROMETER, floatReading(3))},
+    {"GYROSCOPE", compact(RCP_DEVCLASS_GYROSCOPE, floatReading(3))},
+    {"MAGNETOMETER", compact(RCP_DEVCLASS_MAGNETOMETER, floatReading(3))},
+    {"GPS", compact(RCP_DEVCLASS_GPS, floatReading(4))},
+};
+
+static const int DEVCLASS_REGISTRAR = [] {
+    for(const auto& [name, pkt] : DEVCLASS_PACKETS) {
+        benchmark::RegisterBenchmark(("BM_PollDevclass/" + name).c_str(),
+                                     [&pkt](benchmark::State& state) { pollLoop(state, pkt); });
+    }
+    return 0;
+}();
+
+// A prompt followed by many target logs, as seen during a long running sequence step
+static void BM_PollPromptAndLogs(benchmark::State& state) {
+    std::vector<uint8_t> bytes = DEVCLASS_PACKETS[4].second;
+    for(int i = 0; i < 15; i++) {
+        const auto& log = DEVCLASS_PACKETS[7].second;
+        bytes.insert(bytes.end(), log.begin(), log.end());
+    }
+
+    pollLoop(state, std::move(bytes), 16);
+}
+BENCHMARK(BM_PollPromptAndLogs);
+
+// Amalgamation units of temperature readings. The argument is the number of subunits
+static std::vector<uint8_t> amalgamation(int64_t subunits) {
+    std::vector<uint8_t> params(TS, TS + sizeof(TS));
+    for(int64_t i = 0; i < subunits; i++) {
+        params.push_back(RCP_DEVCLASS_TEMPERATURE);
+        params.push_back(static_cast<uint8_t>(i));
+        params.insert(params.end(), FLOAT, FLOAT + sizeof(FLOAT));
+    }
+
+    return extended(RCP_DEVCLASS_AMALGAMATE, params);
+}
+
+static void BM_PollAmalgamation(benchmark::State& state) {
+    pollLoop(state, amalgamation(state.range(0)));
+    state.counters["readings/s"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * state.range(0)), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_PollAmalgamation)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+// The same units with redlines on every device in them: an upper and lower limit and a rate of rise each, none of which
+// trip. The argument is the number of subunits, with three rules for each
+static void BM_PollAmalgamationLimits(benchmark::State& state) {
+    std::vector<RCP_LimitRule> rules;
+    for(int64_t i = 0; i < state.range(0); i++) {
+        auto ID = static_cast<uint8_t>(i);
+        rules.push_back({.devclass = RCP_DEVCLASS_TEMPERATURE, .ID = ID, .channel = 0, .kind = RCP_LIMIT_ABOVE,
+                         .threshold = 100, .consecutive = 1, .action = RCP_LIMIT_ESTOP});
+        rules.push_back({.devclass = RCP_DEVCLASS_TEMPERATURE, .ID = ID, .channel = 0, .kind = RCP_LIMIT_BELOW,
+                         .threshold = -100, .consecutive = 1, .action = RCP_LIMIT_ESTOP});
+        rules.push_back({.devclass = RCP_DEVCLASS_TEMPERATURE, .ID = ID, .channel = 0, .kind = RCP_LIMIT_RATE_ABOVE,
+                         .threshold = 100, .consecutive = 1, .action = RCP_LIMIT_ESTOP});
+    }
+
+    RCP_Limits* limits = nullptr;
+    if(RCP_limits_compile(rules.data(), rules.size(), nullptr, nullptr, &limits) != RCP_ERR_SUCCESS) {
+        state.SkipWithError("Could not compile limits");
+        return;
+    }
+
+    pollLoop(state, amalgamation(state.range(0)), 1, limits);
+    state.counters["readings/s"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * state.range(0)), benchmark::Counter::kIsRate);
+    state.counters["rules"] = static_cast<double>(rules.size());
+    RCP_limits_destroy(limits);
+}
+BENCHMARK(BM_PollAmalgamationLimits)->Arg(10)->Arg(100)->Arg(250);
+
+// ------------ Encoding ------------ //
+
+// Call a send function repeatedly. setup is run once on the context before timing
+template<typename Send>
+static void sendLoop(benchmark::State& state, size_t pktLen, Send send,
+                     const std::vector<uint8_t>& setup = std::vector<uint8_t>()) {
+    Stream stream;
+    RCP_Context* ctx = nullptr;
+    if(RCP_ctx_create(BENCH_CALLBACKS, &stream, &ctx) != RCP_ERR_SUCCESS) {
+        state.SkipWithError("Could not create context");
+        return;
+    }
+
+    if(!setup.empty()) RCP_ctx_feed(ctx, setup.data(), setup.size());
+
+    for(auto _ : state) {
+        RCP_Error rerrno = send(ctx);
+        if(rerrno != RCP_ERR_SUCCESS) {
+            state.SkipWithError(RCP_errstr(rerrno));
+            break;
+        }
+    }
+
+    setCounters(state, state.iterations(), state.iterations() * static_cast<int64_t>(pktLen));
+    RCP_ctx_destroy(ctx);
+}
+
+#define BENCH_SEND(name, pktLen, call, ...)                                                                           \
+    static void BM_##name(benchmark::State& state) {                                                                   \
+        sendLoop(state, pktLen, [](RCP_Context* ctx) { return call; } __VA_OPT__(, ) __VA_ARGS__);                     \
+    }                                                                                                                  \
+    BENCHMARK(BM_##name)
+
+BENCH_SEND(SendEStop, 1, RCP_ctx_sendEStop(ctx));
+BENCH_SEND(SendHeartbeat, 3, RCP_ctx_sendHeartbeat(ctx));
+BENCH_SEND(StartTest, 4, RCP_ctx_startTest(ctx, 1));
+BENCH_SEND(StopTest, 3, RCP_ctx_stopTest(ctx));
+BENCH_SEND(PauseUnpauseTest, 3, RCP_ctx_pauseUnpauseTest(ctx));
+BENCH_SEND(DeviceReset, 3, RCP_ctx_deviceReset(ctx));
+BENCH_SEND(DeviceTimeReset, 3, RCP_ctx_deviceTimeReset(ctx));
+BENCH_SEND(SetDataStreaming, 4, RCP_ctx_setDataStreaming(ctx, 1));
+BENCH_SEND(SetHeartbeatTime, 4, RCP_ctx_setHeartbeatTime(ctx, 5));
+BENCH_SEND(RequestTestState, 3, RCP_ctx_requestTestState(ctx));
+BENCH_SEND(SendSimpleActuatorWrite, 4, RCP_ctx_sendSimpleActuatorWrite(ctx, 1, RCP_SIMPLE_ACTUATOR_ON));
+BENCH_SEND(SendStepperWrite, 8, RCP_ctx_sendStepperWrite(ctx, 1, RCP_STEPPER_SPEED_CONTROL, 1.0f));
+BENCH_SEND(SendAngledActuatorWrite, 7, RCP_ctx_sendAngledActuatorWrite(ctx, 1, 1.0f));
+BENCH_SEND(SendMotorWrite, 7, RCP_ctx_sendMotorWrite(ctx, 1, 1.0f));
+BENCH_SEND(RequestGeneralRead, 3, RCP_ctx_requestGeneralRead(ctx, RCP_DEVCLASS_TEMPERATURE, 1));
+BENCH_SEND(RequestTareConfiguration, 8, RCP_ctx_requestTareConfiguration(ctx, RCP_DEVCLASS_LOAD_CELL, 1, 0, 1.0f));
+
+// Prompt responses need an active prompt of the right type, which is received once before timing
+BENCH_SEND(PromptRespondGONOGO, 3, RCP_ctx_promptRespondGONOGO(ctx, RCP_GONOGO_GO),
+           compact(RCP_DEVCLASS_PROMPT, {RCP_PromptDataType_GONOGO, 'G', 'O', '?'}));
+BENCH_SEND(PromptRespondFloat, 6, RCP_ctx_promptRespondFloat(ctx, 1.0f),
+           compact(RCP_DEVCLASS_PROMPT, {RCP_PromptDataType_Float, 'V', 'A', 'L'}));
+
+// Twelve actuator writes for one sequence step, sent individually and as one transmit batch
+static void BM_SequenceStep(benchmark::State& state) {
+    sendLoop(state, 48, [batch = state.range(0)](RCP_Context* ctx) {
+        if(batch) RCP_ctx_beginBatch(ctx, 0, 0);
+        for(uint8_t i = 0; i < 12; i++) RCP_ctx_sendSimpleActuatorWrite(ctx, i, RCP_SIMPLE_ACTUATOR_ON);
+        return batch ? RCP_ctx_flush(ctx) : RCP_ERR_SUCCESS;
+    });
+
+    setCounters(state, state.iterations() * 12, state.iterations() * 48);
+}
+BENCHMARK(BM_SequenceStep)->ArgName("batched")->Arg(0)->Arg(1);
+
+// ------------ Framing ------------ //
+
+// 64 KiB of framed temperature readings handed to RCP_ctx_feed in one call, with and without CRCs
+static void BM_FeedFramed(benchmark::State& state) {
+    RCP_Framing framing = state.range(0) ? RCP_FRAMING_COBS_CRC16 : RCP_FRAMING_COBS;
+    std::vector<uint8_t> pkt = compact(RCP_DEVCLASS_TEMPERATURE, floatReading(1));
+    if(framing == RCP_FRAMING_COBS_CRC16) {
+        uint16_t crc = RCP_crc16(pkt.data(), pkt.size());
+        pkt.push_back(static_cast<uint8_t>(crc >> 8));
+        pkt.push_back(static_cast<uint8_t>(crc));
+    }
+
+    std::vector<uint8_t> frame(RCP_COBS_MAX_ENCODED(pkt.size()) + 1);
+    frame.resize(RCP_cobs_encode(pkt.data(), pkt.size(), frame.data()));
+    frame.push_back(0);
+
+    std::vector<uint8_t> bytes;
+    int64_t packets = 0;
+    for(; bytes.size() + frame.size() <= 65536; packets++) bytes.insert(bytes.end(), frame.begin(), frame.end());
+
+    Stream stream;
+    RCP_Context* ctx = nullptr;
+    if(RCP_ctx_create(BENCH_CALLBACKS, &stream, &ctx) != RCP_ERR_SUCCESS ||
+       RCP_ctx_setFraming(ctx, framing) != RCP_ERR_SUCCESS) {
+        state.SkipWithError("Could not create context");
+        return;
+    }
+
+    for(auto _ : state) {
+        RCP_Error rerrno = RCP_ctx_feed(ctx, bytes.data(), bytes.size());
+        if(rerrno != RCP_ERR_SUCCESS) {
+            state.SkipWithError(RCP_errstr(rerrno));
+            break;
+        }
+    }
+
+    setCounters(state, state.iterations() * packets, state.iterations() * static_cast<int64_t>(bytes.size()));
+    RCP_ctx_destroy(ctx);
+}
+BENCHMARK(BM_FeedFramed)->ArgName("crc")->Arg(0)->Arg(1);
+
+// The delimiter search alone, over a 64 KiB frame
+static void BM_FindDelimiter(benchmark::State& state) {
+    std::vector<uint8_t> bytes(65536, 0x55);
+    bytes.back() = 0;
+
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(bytes.data());
+        benchmark::DoNotOptimize(RCP_cobs_findDelimiter(bytes.data(), bytes.size()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(bytes.size()));
+}
+BENCHMARK(BM_FindDelimiter);
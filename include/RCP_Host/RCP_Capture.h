@@ -0,0 +1,65 @@
+#ifndef RCP_CAPTURE_H
+#define RCP_CAPTURE_H
+
+#include "RCP_Host/RCP_Host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Capture files archive the raw packets received on a link so a test campaign can be replayed later. The file starts
+// with a file header, then every packet is stored as a record header followed by the packet bytes exactly as they
+// were received. All multi-byte fields are little endian.
+//
+// File header, RCP_CAPTURE_FILE_HEADER_BYTES long:
+//   offset 0, 8 bytes: RCP_CAPTURE_MAGIC
+//   offset 8, 4 bytes: format version, RCP_CAPTURE_VERSION
+//   offset 12, 4 bytes: reserved, zero
+//
+// Record header, RCP_CAPTURE_RECORD_HEADER_BYTES long:
+//   offset 0, 8 bytes: host monotonic receive time in nanoseconds
+//   offset 8, 4 bytes: packet length
+//   offset 12, 1 byte: channel the packet was sent on, as an RCP_Channel
+//   offset 13, 3 bytes: reserved, zero
+#define RCP_CAPTURE_MAGIC "RCPCAP\r\n"
+#define RCP_CAPTURE_VERSION 1
+#define RCP_CAPTURE_FILE_HEADER_BYTES 16
+#define RCP_CAPTURE_RECORD_HEADER_BYTES 16
+
+// Default size of the buffer between the recording thread and the writer thread
+#define RCP_CAPTURE_DEFAULT_BUFFER (8 * 1024 * 1024)
+
+// Recorder that writes packets to a capture file from a background thread. Recording a packet only copies it into a
+// lock-free buffer, so the receive path never waits on the file system. The writer thread also builds the capture's
+// time index as it drains the buffer. Only available on POSIX systems.
+typedef struct RCP_Capture RCP_Capture;
+
+struct RCP_CaptureStats {
+    uint64_t packets;
+
+    // Bytes recorded, including record headers
+    uint64_t bytes;
+
+    // Packets not recorded because the writer thread had fallen behind and there was no room for them in the buffer
+    uint64_t dropped;
+};
+
+// Create or truncate the file at path and start the writer thread. A bufferSize of 0 uses RCP_CAPTURE_DEFAULT_BUFFER
+RCP_Error RCP_capture_open(const char* path, size_t bufferSize, RCP_Capture** cap);
+
+// Write out everything recorded, stop the writer thread and close the file. Returns RCP_ERR_IO_FILE if any write
+// failed. Recording must have stopped before this is called.
+RCP_Error RCP_capture_close(RCP_Capture* cap);
+
+// Record a packet. This is an RCP_PacketTap, so a recorder is attached to a link with
+// RCP_setPacketTap(RCP_capture_tap, cap). Only one thread at a time may record into a capture. The caller never waits;
+// if the writer falls far enough behind to fill the buffer, packets are dropped and counted until there is room.
+void RCP_capture_tap(void* cap, const uint8_t* pkt, size_t length);
+
+RCP_Error RCP_capture_getStats(const RCP_Capture* cap, struct RCP_CaptureStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RCP_CAPTURE_H
@@ -0,0 +1,37 @@
+#ifndef RCP_COBS_H
+#define RCP_COBS_H
+
+#include "RCP_Host/RCP_Host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// COBS (Consistent Overhead Byte Stuffing) and CRC-16 primitives behind the optional framing set by RCP_setFraming.
+// COBS rewrites a frame so it contains no zero bytes, letting a single zero mark where each frame ends. The encoding
+// costs one byte per 254 bytes of data, plus one.
+//
+// On the wire, a frame is the COBS encoding of one packet followed by its CRC when enabled, then a zero delimiter. The
+// CRC is CRC-16/CCITT-FALSE over the packet bytes, appended most significant byte first.
+
+// Most bytes n bytes can encode to, without the delimiter
+#define RCP_COBS_MAX_ENCODED(n) ((n) + (n) / 254 + 1)
+
+// Encode n bytes from src into dst, which must hold RCP_COBS_MAX_ENCODED(n) bytes. No delimiter is added. Returns the
+// encoded length
+size_t RCP_cobs_encode(const uint8_t* src, size_t n, uint8_t* dst);
+
+// Decode the n encoded bytes of one frame, without its delimiter, into dst, which must hold n bytes and may be src
+// itself. Returns RCP_ERR_BAD_FRAME if the encoding is cut short
+RCP_Error RCP_cobs_decode(const uint8_t* src, size_t n, uint8_t* dst, size_t* decoded);
+
+// Offset of the first zero among the n bytes at p, or n if there is none. Uses AVX2 or SSE2 where available
+size_t RCP_cobs_findDelimiter(const uint8_t* p, size_t n);
+
+uint16_t RCP_crc16(const uint8_t* data, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RCP_COBS_H
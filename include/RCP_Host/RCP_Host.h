@@ -1,6 +1,7 @@
 #ifndef RCP_HOST_H
 #define RCP_HOST_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -14,6 +15,13 @@ extern const char* const RCP_VERSION_END;
 #define RCP_MAX_NON_PARAM 4
 #define RCP_MAX_EXTENDED_BYTES 65536
 
+// Most readings handed to a batch callback in one call. Larger amalgamation units are delivered in several batches
+#define RCP_MAX_BATCH 64
+
+// Size of the buffer outgoing packets are queued in while transmit batching. A batch is sent early rather than exceed
+// it
+#define RCP_MAX_TX_BATCH 256
+
 typedef enum {
     RCP_ERR_SUCCESS = 0,
     RCP_ERR_INIT = 1,
@@ -24,6 +32,13 @@ typedef enum {
     RCP_ERR_IO_RCV = 6,
     RCP_ERR_AMALG_NESTING = 7,
     RCP_ERR_AMALG_SUBUNIT = 8,
+    RCP_ERR_IO_FILE = 9,
+    RCP_ERR_BAD_CAPTURE = 10,
+    RCP_ERR_BAD_FRAME = 11,
+    RCP_ERR_IO_OPEN = 12,
+    RCP_ERR_WOULD_BLOCK = 13,
+    RCP_ERR_NO_READING = 14,
+    RCP_ERR_MALFORMED_PACKET = 15,
 } RCP_Error;
 
 #define RCP_EXTENDED_MASK 0x40
@@ -185,6 +200,19 @@ struct RCP_LibInitData {
     RCP_Error (*processTwoFloat)(struct RCP_2F data);
     RCP_Error (*processThreeFloat)(struct RCP_3F data);
     RCP_Error (*processFourFloat)(struct RCP_4F data);
+
+    // Optional batch callbacks. If set, the xF readings in an amalgamation unit are collected by arity into contiguous
+    // arrays and handed over together once the unit is processed, instead of going through the callbacks above one by
+    // one. Order is kept within an arity. Readings outside amalgamation units always use the single callbacks.
+    RCP_Error (*processOneFloatBatch)(const struct RCP_1F* items, size_t n, uint32_t timestamp);
+    RCP_Error (*processTwoFloatBatch)(const struct RCP_2F* items, size_t n, uint32_t timestamp);
+    RCP_Error (*processThreeFloatBatch)(const struct RCP_3F* items, size_t n, uint32_t timestamp);
+    RCP_Error (*processFourFloatBatch)(const struct RCP_4F* items, size_t n, uint32_t timestamp);
+
+    // Optional. Discards the next length received bytes without handing them over, returning how many were skipped.
+    // Used by RCP_poll to drop packets that were filtered out, see RCP_subscribe. Without it they are read through
+    // readData and thrown away
+    size_t (*skipData)(size_t length);
 };
 
 // Provide library with callbacks to needed functions
@@ -197,9 +225,68 @@ const char* RCP_errstr(RCP_Error rerrno);
 void RCP_setChannel(RCP_Channel ch);
 RCP_Channel RCP_getChannel(void);
 
+// Packets received on the other channel are normally dropped. With a peer context set to that channel, they are
+// processed by the peer instead, through its callbacks and user pointer, so one link and one read of it serve both
+// channels. See RCP_ctx_setChannelPeer.
+typedef struct RCP_Context RCP_Context;
+RCP_Error RCP_setChannelPeer(RCP_Context* peer);
+
 // Function to call periodically to poll for data
 RCP_Error RCP_poll(void);
 
+// Alternative to RCP_poll for when the bytes are already in hand. Processes every complete packet in the chunk and
+// keeps any trailing partial packet until the next call. readData is not used. Packets too short for their device
+// class, or amalgamation units with a subunit running past the end, are dropped with RCP_ERR_MALFORMED_PACKET.
+RCP_Error RCP_feed(const uint8_t* bytes, size_t n);
+
+// Raw packet tap. Called with every complete packet RCP_poll or RCP_feed receives, before it is processed and
+// whatever its channel. Passing NULL removes the tap. The capture recorder in RCP_Capture.h is one such tap.
+typedef void (*RCP_PacketTap)(void* user, const uint8_t* pkt, size_t length);
+RCP_Error RCP_setPacketTap(RCP_PacketTap tap, void* user);
+
+// Resync mode, off by default. Without framing, a single byte lost or garbled on the link leaves the parser reading
+// packet boundaries in the wrong place from then on. In resync mode every packet is checked before it is processed: the
+// class must be known, the length must match the class, and an amalgamation unit's subunits must exactly fill it. A
+// packet that fails is not processed, and the parser moves forward a byte at a time until one passes, counting the
+// bytes it skips. Checks are made as soon as the bytes they need arrive, so a bad length is caught from the class byte
+// alone rather than after waiting for the whole packet. Switching mode drops any partial packet.
+RCP_Error RCP_setResync(int enabled);
+uint64_t RCP_getDiscarded(void);
+
+// Optional framing, for links where both ends agree to it. Each packet travels COBS encoded and ends with a zero byte,
+// optionally with a CRC-16 inside the frame, as described in RCP_Cobs.h. Outgoing packets are framed on their way to
+// sendData, and incoming frames are found and decoded before their packets are processed. A frame that does not decode
+// to exactly one packet, or fails its CRC, is dropped with RCP_ERR_BAD_FRAME and its bytes are counted by
+// RCP_getDiscarded. Frames carry their own boundaries, so resync mode has no effect while framing is on. RCP_poll
+// has to read frames a byte at a time, so RCP_feed is the better fit for framed links. Switching drops any partial
+// frame or packet.
+typedef enum {
+    RCP_FRAMING_NONE = 0,
+    RCP_FRAMING_COBS = 1,
+    RCP_FRAMING_COBS_CRC16 = 2,
+} RCP_Framing;
+
+RCP_Error RCP_setFraming(RCP_Framing framing);
+
+// Subscription filter. By default every packet is processed. The first RCP_subscribe starts from nothing subscribed,
+// and the first RCP_unsubscribe from everything, after which each adds or removes a device class, or a single device
+// when ID is not RCP_ANY_ID. Classes without device IDs, such as test state and prompts, are always taken whole.
+// Packets that are filtered out, or are on a channel nothing listens to, are not decoded, and unless a packet tap is
+// set RCP_poll skips them as soon as the header and class byte say so, through the skipData callback where there is
+// one. Amalgamation units are taken while any class that can be in one is subscribed, and their readings filtered one
+// by one. RCP_subscribeAll goes back to processing everything.
+#define RCP_ANY_ID (-1)
+RCP_Error RCP_subscribe(RCP_DeviceClass devclass, int ID);
+RCP_Error RCP_unsubscribe(RCP_DeviceClass devclass, int ID);
+RCP_Error RCP_subscribeAll(void);
+
+// Transmit batching. After RCP_beginBatch, outgoing packets are queued back to back and handed to sendData in a single
+// call by RCP_flush, which also ends the batch. The queue is sent early once it holds flushSize bytes, or once the
+// oldest queued packet is deadlineUs microseconds old when checked by a send, RCP_poll or RCP_feed. Either threshold
+// can be 0 to disable it. An EStop is always sent straight away, after anything already queued.
+RCP_Error RCP_beginBatch(size_t flushSize, uint32_t deadlineUs);
+RCP_Error RCP_flush(void);
+
 // Functions to send controller packets
 RCP_Error RCP_sendEStop(void);
 RCP_Error RCP_sendHeartbeat(void);
@@ -225,6 +312,85 @@ RCP_Error RCP_promptRespondGONOGO(RCP_GONOGO gonogo);
 RCP_Error RCP_promptRespondFloat(float value);
 RCP_PromptDataType RCP_getActivePromptType(void);
 
+// Context API. All state for one target link lives in an RCP_Context, so a process can hold any number of links, and
+// independent contexts can be used from different threads without any locking. Each callback receives the user
+// pointer the context was created with. The global functions above operate on a single library owned context.
+
+struct RCP_CtxCallbacks {
+    size_t (*sendData)(void* user, const void* data, size_t length);
+    size_t (*readData)(void* user, void* data, size_t length);
+    RCP_Error (*processTestUpdate)(void* user, struct RCP_TestData data);
+    RCP_Error (*processBoolData)(void* user, struct RCP_BoolData data);
+    RCP_Error (*processSimpleActuatorData)(void* user, struct RCP_SimpleActuatorData data);
+    RCP_Error (*processPromptInput)(void* user, struct RCP_PromptInputRequest request);
+    RCP_Error (*processTargetLog)(void* user, struct RCP_TargetLogData data);
+    RCP_Error (*processOneFloat)(void* user, struct RCP_1F data);
+    RCP_Error (*processTwoFloat)(void* user, struct RCP_2F data);
+    RCP_Error (*processThreeFloat)(void* user, struct RCP_3F data);
+    RCP_Error (*processFourFloat)(void* user, struct RCP_4F data);
+
+    // Optional, see RCP_LibInitData
+    RCP_Error (*processOneFloatBatch)(void* user, const struct RCP_1F* items, size_t n, uint32_t timestamp);
+    RCP_Error (*processTwoFloatBatch)(void* user, const struct RCP_2F* items, size_t n, uint32_t timestamp);
+    RCP_Error (*processThreeFloatBatch)(void* user, const struct RCP_3F* items, size_t n, uint32_t timestamp);
+    RCP_Error (*processFourFloatBatch)(void* user, const struct RCP_4F* items, size_t n, uint32_t timestamp);
+
+    // Optional, see RCP_LibInitData
+    size_t (*skipData)(void* user, size_t length);
+};
+
+RCP_Error RCP_ctx_create(struct RCP_CtxCallbacks callbacks, void* user, RCP_Context** ctx);
+RCP_Error RCP_ctx_destroy(RCP_Context* ctx);
+void* RCP_ctx_getUser(const RCP_Context* ctx);
+
+void RCP_ctx_setChannel(RCP_Context* ctx, RCP_Channel ch);
+RCP_Channel RCP_ctx_getChannel(const RCP_Context* ctx);
+
+// Route packets ctx receives on peer's channel, other than its own, to peer. Only peer's callbacks, channel and
+// decoding state are used. It is never polled or fed, its own resync and framing settings do not apply, and its tap
+// and counters do not see the packets, which belong to ctx. Sends from peer's callbacks go through peer's own sendData
+// or transport, which would normally be the same link. peer must stay alive until it is detached by passing NULL
+RCP_Error RCP_ctx_setChannelPeer(RCP_Context* ctx, RCP_Context* peer);
+RCP_Context* RCP_ctx_getChannelPeer(const RCP_Context* ctx);
+
+RCP_Error RCP_ctx_poll(RCP_Context* ctx);
+RCP_Error RCP_ctx_feed(RCP_Context* ctx, const uint8_t* bytes, size_t n);
+RCP_Error RCP_ctx_setPacketTap(RCP_Context* ctx, RCP_PacketTap tap, void* user);
+RCP_Error RCP_ctx_setResync(RCP_Context* ctx, int enabled);
+uint64_t RCP_ctx_getDiscarded(const RCP_Context* ctx);
+RCP_Error RCP_ctx_setFraming(RCP_Context* ctx, RCP_Framing framing);
+RCP_Error RCP_ctx_subscribe(RCP_Context* ctx, RCP_DeviceClass devclass, int ID);
+RCP_Error RCP_ctx_unsubscribe(RCP_Context* ctx, RCP_DeviceClass devclass, int ID);
+RCP_Error RCP_ctx_subscribeAll(RCP_Context* ctx);
+
+RCP_Error RCP_ctx_beginBatch(RCP_Context* ctx, size_t flushSize, uint32_t deadlineUs);
+RCP_Error RCP_ctx_flush(RCP_Context* ctx);
+
+RCP_Error RCP_ctx_sendEStop(RCP_Context* ctx);
+RCP_Error RCP_ctx_sendHeartbeat(RCP_Context* ctx);
+
+RCP_Error RCP_ctx_startTest(RCP_Context* ctx, uint8_t testnum);
+RCP_Error RCP_ctx_stopTest(RCP_Context* ctx);
+RCP_Error RCP_ctx_pauseUnpauseTest(RCP_Context* ctx);
+RCP_Error RCP_ctx_deviceReset(RCP_Context* ctx);
+RCP_Error RCP_ctx_deviceTimeReset(RCP_Context* ctx);
+RCP_Error RCP_ctx_setDataStreaming(RCP_Context* ctx, int datastreaming);
+RCP_Error RCP_ctx_setHeartbeatTime(RCP_Context* ctx, uint8_t heartbeatTime);
+RCP_Error RCP_ctx_requestTestState(RCP_Context* ctx);
+
+RCP_Error RCP_ctx_sendSimpleActuatorWrite(RCP_Context* ctx, uint8_t ID, RCP_SimpleActuatorState state);
+RCP_Error RCP_ctx_sendStepperWrite(RCP_Context* ctx, uint8_t ID, RCP_StepperControlMode mode, float value);
+RCP_Error RCP_ctx_sendAngledActuatorWrite(RCP_Context* ctx, uint8_t ID, float value);
+RCP_Error RCP_ctx_sendMotorWrite(RCP_Context* ctx, uint8_t ID, float value);
+
+RCP_Error RCP_ctx_requestGeneralRead(RCP_Context* ctx, RCP_DeviceClass device, uint8_t ID);
+RCP_Error RCP_ctx_requestTareConfiguration(RCP_Context* ctx, RCP_DeviceClass device, uint8_t ID, uint8_t dataChannel,
+                                           float offset);
+
+RCP_Error RCP_ctx_promptRespondGONOGO(RCP_Context* ctx, RCP_GONOGO gonogo);
+RCP_Error RCP_ctx_promptRespondFloat(RCP_Context* ctx, float value);
+RCP_PromptDataType RCP_ctx_getActivePromptType(const RCP_Context* ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,77 @@
+#ifndef RCP_INDEX_H
+#define RCP_INDEX_H
+
+#include "RCP_Host/RCP_Host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Time index over a capture file, so a replay can start at any point without scanning from the beginning. The index is
+// kept in a sidecar file next to the capture, named by appending RCP_INDEX_SUFFIX. The recorder writes it when the
+// capture is closed, and RCP_index_open builds it from the capture if it is missing or out of date. Only available on
+// POSIX systems.
+//
+// The index is sparse: for each channel it holds an entry for a record with a target timestamp about every
+// RCP_INDEX_STRIDE bytes of capture, and for the first such record after every target restart. A lookup finds the
+// nearest entry at or before the requested time, and the replay skips forward from there with RCP_replay_next.
+//
+// Target timestamps are a 32 bit millisecond counter, which can wrap and is set back to zero by RCP_deviceTimeReset.
+// Each channel can carry a different target, so each keeps a timeline of its own. A timestamp up to a second behind
+// the last is a reading that arrived out of order and changes nothing, as long as it is no closer to zero than it is
+// behind or the counter has wrapped, as otherwise the target may have just restarted. When a timestamp goes back
+// further, it is taken as a wrap if by more than half the counter range, and counting continues past 2^32, and
+// otherwise as a restart, which begins a new epoch with its own timeline. Target times are therefore looked up within
+// a channel and epoch, while host receive times cover the whole capture.
+//
+// Sidecar layout, all little endian:
+//   offset 0, 8 bytes: RCP_INDEX_MAGIC
+//   offset 8, 4 bytes: format version, RCP_INDEX_VERSION
+//   offset 12, 4 bytes: reserved, zero
+//   offset 16, 8 bytes: size of the capture file the index was built from
+//   offset 24: entries of RCP_INDEX_ENTRY_BYTES each, in file order, holding offset, hostTimeNs, targetMs, epoch and
+//   channel as 8, 8, 8, 4 and 1 bytes, then 3 reserved bytes
+#define RCP_INDEX_MAGIC "RCPIDX\r\n"
+#define RCP_INDEX_VERSION 2
+#define RCP_INDEX_HEADER_BYTES 24
+#define RCP_INDEX_ENTRY_BYTES 32
+#define RCP_INDEX_SUFFIX ".idx"
+#define RCP_INDEX_STRIDE 65536
+
+struct RCP_IndexEntry {
+    // Offset of the record in the capture file, for RCP_replay_seek
+    uint64_t offset;
+
+    uint64_t hostTimeNs;
+
+    // Target timestamp of the record, continued past wraps of the counter
+    uint64_t targetMs;
+
+    // Epoch of the channel's target the record is in
+    uint32_t epoch;
+    RCP_Channel channel;
+};
+
+typedef struct RCP_Index RCP_Index;
+
+// Load the index of the capture at capturePath, building it from the capture and saving the sidecar if needed. Failing
+// to save the sidecar is not an error, the index is still usable
+RCP_Error RCP_index_open(const char* capturePath, RCP_Index** index);
+RCP_Error RCP_index_close(RCP_Index* index);
+
+// Entries of every channel in file order, and the number of target epochs the entries of a channel span
+size_t RCP_index_size(const RCP_Index* index);
+const struct RCP_IndexEntry* RCP_index_entries(const RCP_Index* index);
+uint32_t RCP_index_epochs(const RCP_Index* index, RCP_Channel channel);
+
+// Offset of the last indexed record at or before a time, in logarithmic time. Earlier times give the first record of
+// the capture, or of the epoch. An epoch the index does not have for the channel gives RCP_ERR_INIT.
+RCP_Error RCP_index_findHostTime(const RCP_Index* index, uint64_t hostTimeNs, uint64_t* offset);
+RCP_Error RCP_index_findTargetTime(const RCP_Index* index, RCP_Channel channel, uint32_t epoch, uint64_t targetMs,
+                                   uint64_t* offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RCP_INDEX_H
@@ -0,0 +1,57 @@
+#ifndef RCP_LATENCY_H
+#define RCP_LATENCY_H
+
+#include "RCP_Host/RCP_Host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Round trip latency of actuator writes. The target answers every write with a reading of the device written, so each
+// write sent through a context is timestamped by device, and the next reading decoded from that device ends the round
+// trip. Latencies go into a histogram per device class, HDR style: buckets are exact below 128ns and otherwise within
+// 1/64 of the value, from 1ns up to about half an hour, so percentiles are accurate to two significant figures however
+// wide the spread. The receiving thread records with relaxed atomics, and any thread can query at any time.
+//
+// Writes made again before the device answers are timed from the first of them. Writes queued in a transmit batch are
+// timed from when the batch is handed to sendData, not from when they were queued. With data streaming on, the next
+// streamed reading of the device counts as its answer.
+
+// Device classes below this are tracked, which covers every actuator
+#define RCP_LATENCY_CLASSES 8
+
+struct RCP_LatencySummary {
+    // Round trips measured
+    uint64_t count;
+
+    // In nanoseconds. Percentiles are the highest value their bucket holds, never less than the true value
+    uint64_t minNs;
+    uint64_t maxNs;
+    uint64_t meanNs;
+    uint64_t p50Ns;
+    uint64_t p90Ns;
+    uint64_t p99Ns;
+    uint64_t p999Ns;
+};
+
+// Start measuring for ctx. This has to be done before other threads look at the histograms, and it lasts until the
+// context is destroyed. Calling it again does nothing
+RCP_Error RCP_ctx_trackLatency(RCP_Context* ctx);
+
+// Summary of the round trips to devices of devclass. Every field is 0 if none have been measured. Returns RCP_ERR_INIT
+// if latency is not being measured, and RCP_ERR_INVALID_DEVCLASS for classes that can not be written to
+RCP_Error RCP_ctx_getLatency(const RCP_Context* ctx, RCP_DeviceClass devclass, struct RCP_LatencySummary* summary);
+
+// The latency in nanoseconds that percent of the round trips to devices of devclass took no longer than, or 0 if
+// there are none or the class is not measured
+uint64_t RCP_ctx_latencyPercentile(const RCP_Context* ctx, RCP_DeviceClass devclass, double percent);
+
+RCP_Error RCP_trackLatency(void);
+RCP_Error RCP_getLatency(RCP_DeviceClass devclass, struct RCP_LatencySummary* summary);
+uint64_t RCP_latencyPercentile(RCP_DeviceClass devclass, double percent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RCP_LATENCY_H
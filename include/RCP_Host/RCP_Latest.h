@@ -0,0 +1,57 @@
+#ifndef RCP_LATEST_H
+#define RCP_LATEST_H
+
+#include "RCP_Host/RCP_Host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Table of the latest reading from every device a context has heard from, kept up to date as packets are decoded.
+// Devices are keyed by their fully qualified device name, the class byte followed by the ID. Each device's entry is
+// guarded by its own sequence counter, so any number of other threads can read it at any time without a lock and
+// without ever holding up the thread receiving, and always see a reading whole. Covers every class with device IDs,
+// which are the sensors and actuators. Readings are recorded whether or not they are also passed to callbacks, but
+// not ones the subscription filter dropped.
+
+// Fully qualified device name, as used by RCP_Latest
+#define RCP_FQDN(devclass, ID) ((uint16_t) (((uint16_t) (uint8_t) (devclass) << 8) | (uint8_t) (ID)))
+
+struct RCP_Latest {
+    RCP_DeviceClass devclass;
+    uint8_t ID;
+
+    // Target timestamp of the reading, and the monotonic host time in nanoseconds when it was decoded
+    uint32_t timestamp;
+    uint64_t hostTimeNs;
+
+    // Readings received from the device so far
+    uint64_t updates;
+
+    // The reading's floats, as many as the class has. Bool sensors and simple actuators put their state in data[0], as
+    // 0 or 1
+    float data[4];
+};
+
+// Start keeping the table for ctx. This has to be done before other threads look at it, and it lasts until the context
+// is destroyed. Calling it again does nothing
+RCP_Error RCP_ctx_trackLatest(RCP_Context* ctx);
+
+// The latest reading from a device, consistent even while the receiving thread is updating it. Returns
+// RCP_ERR_NO_READING if there has not been one, and RCP_ERR_INIT if the table is not being kept
+RCP_Error RCP_ctx_getLatest(const RCP_Context* ctx, RCP_DeviceClass devclass, uint8_t ID, struct RCP_Latest* latest);
+
+// Copy the latest reading of every device heard from into latest, up to capacity of them, in the order the devices
+// were first heard from. Returns how many devices there are, which may be more than were copied. Each entry is
+// consistent on its own. Returns 0 if the table is not being kept
+size_t RCP_ctx_snapshotLatest(const RCP_Context* ctx, struct RCP_Latest* latest, size_t capacity);
+
+RCP_Error RCP_trackLatest(void);
+RCP_Error RCP_getLatest(RCP_DeviceClass devclass, uint8_t ID, struct RCP_Latest* latest);
+size_t RCP_snapshotLatest(struct RCP_Latest* latest, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RCP_LATEST_H
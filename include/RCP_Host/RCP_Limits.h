@@ -0,0 +1,90 @@
+#ifndef RCP_LIMITS_H
+#define RCP_LIMITS_H
+
+#include "RCP_Host/RCP_Host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Redlines checked as readings are decoded, so an abort goes out as soon as the packet showing the violation is read,
+// rather than after the reading has made its way up to the application. Rules are compiled into a table indexed by
+// device, and each reading is checked only against the rules for its own device, so a reading from a device without
+// rules costs one lookup. Each rule watches one value of one device: a float of a sensor reading, or the state of a
+// bool sensor or simple actuator as 0 or 1.
+//
+// A rule trips once its condition has held for its number of consecutive readings, and then takes its action straight
+// away, from inside RCP_ctx_poll or RCP_ctx_feed. Tripped rules stay tripped, and are not checked again until they are
+// rearmed. Readings the subscription filter dropped are not checked.
+//
+// A NaN or infinite value, as a failed sensor may report, breaks every rule on it whatever its kind, so a redline
+// trips rather than going quiet when its sensor fails.
+typedef struct RCP_Limits RCP_Limits;
+
+typedef enum {
+    // The value is above or below the threshold
+    RCP_LIMIT_ABOVE = 0,
+    RCP_LIMIT_BELOW = 1,
+
+    // The value's rate of change since the device's previous reading, in units per second of target time, is above or
+    // below the threshold. A rate of rise is RCP_LIMIT_RATE_ABOVE, and a rate of fall RCP_LIMIT_RATE_BELOW with a
+    // negative threshold
+    RCP_LIMIT_RATE_ABOVE = 2,
+    RCP_LIMIT_RATE_BELOW = 3,
+} RCP_LimitKind;
+
+typedef enum {
+    // Send an EStop, then call the trip callback if there is one
+    RCP_LIMIT_ESTOP = 0,
+
+    // Only call the trip callback, which can send whatever command should answer the violation
+    RCP_LIMIT_CALLBACK = 1,
+} RCP_LimitAction;
+
+struct RCP_LimitRule {
+    RCP_DeviceClass devclass;
+    uint8_t ID;
+
+    // Which of the reading's floats to watch. Always 0 for bool sensors and simple actuators
+    uint8_t channel;
+
+    RCP_LimitKind kind;
+    float threshold;
+
+    // Readings in a row that have to break the rule before it trips. 0 is taken as 1
+    uint8_t consecutive;
+
+    RCP_LimitAction action;
+};
+
+// Called when a rule trips, with the context that decoded the reading, the index of the rule as it was given to
+// RCP_limits_compile, and the value that tripped it, which for rate rules is the rate. An error returned is passed
+// back from RCP_ctx_poll or RCP_ctx_feed, once the reading has still been delivered and the rest of its packet decoded
+typedef RCP_Error (*RCP_LimitTrip)(RCP_Context* ctx, void* user, size_t rule, float value);
+
+// Compile n rules into a table. onTrip may be NULL if every rule sends an EStop. Returns RCP_ERR_INVALID_DEVCLASS for a
+// rule on a class without device IDs, and RCP_ERR_INIT for a channel the class does not have, an unknown kind or
+// action, or a RCP_LIMIT_CALLBACK rule without onTrip
+RCP_Error RCP_limits_compile(const struct RCP_LimitRule* rules, size_t n, RCP_LimitTrip onTrip, void* user,
+                             RCP_Limits** limits);
+RCP_Error RCP_limits_destroy(RCP_Limits* limits);
+
+// Whether a rule has tripped since it was last armed, and how many times rules have tripped altogether. Any thread can
+// ask
+int RCP_limits_isTripped(const RCP_Limits* limits, size_t rule);
+uint64_t RCP_limits_trips(const RCP_Limits* limits);
+
+// Arm every tripped rule again. Each starts over from the next reading, as though it had not seen one before. Any
+// thread can rearm
+RCP_Error RCP_limits_rearm(RCP_Limits* limits);
+
+// Check every reading ctx decodes against limits, or stop if limits is NULL. The table must outlive its attachment, and
+// can only be attached to one context at a time
+RCP_Error RCP_ctx_setLimits(RCP_Context* ctx, RCP_Limits* limits);
+RCP_Error RCP_setLimits(RCP_Limits* limits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RCP_LIMITS_H
@@ -0,0 +1,58 @@
+#ifndef RCP_PARALLEL_H
+#define RCP_PARALLEL_H
+
+#include "RCP_Host/RCP_Host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Offline decode of a whole capture across several threads, for post test analysis. The capture is split into chunks
+// at the records its index points to, see RCP_Index.h, and each chunk is decoded on a pool of threads through a
+// context of its own. The readings of every device are then merged back into one series per device. Only available
+// on POSIX systems.
+//
+// Sensor readings, bool data and simple actuator states are collected. Test state updates, prompts and target logs
+// are not, as they only make sense replayed in order through RCP_replay_run.
+
+// One reading of a device. Bool data and simple actuator states are kept in data[0] as 1 for true or on and 0
+// otherwise, and unused values are zero
+struct RCP_DecodedReading {
+    // Target time of the reading, as in struct RCP_IndexEntry
+    uint64_t targetMs;
+    uint32_t epoch;
+    float data[4];
+};
+
+// Every reading of one device, in target time order, apart from readings that reached the host late, which keep their
+// place in the capture, see RCP_Index.h. Readings with the same time keep their capture order
+struct RCP_DecodedSeries {
+    RCP_DeviceClass devclass;
+    uint8_t ID;
+
+    // Number of values in each reading
+    uint8_t arity;
+
+    size_t len;
+    struct RCP_DecodedReading* readings;
+};
+
+// Every device seen, ordered by device class and then ID
+struct RCP_DecodeResult {
+    size_t len;
+    struct RCP_DecodedSeries* series;
+};
+
+// Decode the packets for channel in the capture at capturePath with threads threads, or one per online processor if
+// threads is 0. The index is loaded, or built and saved, as by RCP_index_open. Like RCP_replay_run, every record is
+// decoded even if one fails to process, in which case the first error is returned along with the result. Other errors
+// leave result NULL. The result is released with RCP_decode_free.
+RCP_Error RCP_decode_parallel(const char* capturePath, RCP_Channel channel, unsigned threads,
+                              struct RCP_DecodeResult** result);
+void RCP_decode_free(struct RCP_DecodeResult* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RCP_PARALLEL_H
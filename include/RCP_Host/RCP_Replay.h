@@ -0,0 +1,49 @@
+#ifndef RCP_REPLAY_H
+#define RCP_REPLAY_H
+
+#include "RCP_Host/RCP_Host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Reader for capture files written by RCP_Capture. The file is memory mapped and packets are handed out and decoded
+// straight from the mapping, without copying. Only available on POSIX systems.
+typedef struct RCP_Replay RCP_Replay;
+
+// One packet from a capture. pkt points into the mapping and stays valid until the replay is closed
+struct RCP_CaptureRecord {
+    uint64_t timeNs;
+    RCP_Channel channel;
+    size_t length;
+    const uint8_t* pkt;
+};
+
+// Map a capture file. Returns RCP_ERR_IO_FILE if it cannot be opened or mapped, and RCP_ERR_BAD_CAPTURE if it does not
+// start with a capture header of a supported version
+RCP_Error RCP_replay_open(const char* path, RCP_Replay** replay);
+RCP_Error RCP_replay_close(RCP_Replay* replay);
+
+// Step through the records in file order. Returns 1 and fills record while there are records left, and 0 at the end.
+// A final record cut short, as left by a recording that was interrupted, is treated as the end.
+int RCP_replay_next(RCP_Replay* replay, struct RCP_CaptureRecord* record);
+
+// Go back to the first record
+void RCP_replay_rewind(RCP_Replay* replay);
+
+// Offset in the file of the next record, and moving to a record at a known offset, such as one from RCP_Index.h
+uint64_t RCP_replay_tell(const RCP_Replay* replay);
+RCP_Error RCP_replay_seek(RCP_Replay* replay, uint64_t offset);
+
+// Decode every remaining record through ctx, as if received by RCP_ctx_feed. A speed of 0 replays as fast as possible,
+// 1 paces packets as they were originally received, and other values replay that many times faster than real time.
+// Every record is replayed even if one fails to process; the first error encountered is returned. A record that does
+// not hold exactly one packet is skipped with RCP_ERR_MALFORMED_PACKET. Records are unframed packets, so a context
+// with framing or resync mode on is refused with RCP_ERR_INIT.
+RCP_Error RCP_replay_run(RCP_Replay* replay, RCP_Context* ctx, double speed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RCP_REPLAY_H
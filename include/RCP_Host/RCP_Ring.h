@@ -0,0 +1,40 @@
+#ifndef RCP_RING_H
+#define RCP_RING_H
+
+#include "RCP_Host/RCP_Host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lock-free single producer, single consumer byte ring. Meant for handing received bytes from a dedicated reader thread
+// to the thread that decodes them, without a mutex: one thread may only write, and one other thread may only read.
+// Capacity is rounded up to a power of two.
+typedef struct RCP_Ring RCP_Ring;
+
+RCP_Error RCP_ring_create(size_t capacity, RCP_Ring** ring);
+RCP_Error RCP_ring_destroy(RCP_Ring* ring);
+
+size_t RCP_ring_capacity(const RCP_Ring* ring);
+
+// Number of bytes waiting to be read. Only a snapshot if the other side is active at the same time
+size_t RCP_ring_size(const RCP_Ring* ring);
+
+// Producer side. Copies as many bytes as fit and returns how many that was
+size_t RCP_ring_write(RCP_Ring* ring, const void* data, size_t length);
+
+// Consumer side. RCP_ring_read copies out up to length bytes and returns how many that was. RCP_ring_peek instead
+// points data at the readable bytes in place and returns how many are contiguous there; once done with them they are
+// released with RCP_ring_consume.
+size_t RCP_ring_read(RCP_Ring* ring, void* data, size_t length);
+size_t RCP_ring_peek(RCP_Ring* ring, const uint8_t** data);
+void RCP_ring_consume(RCP_Ring* ring, size_t length);
+
+// Consumer side. Passes everything currently in the ring to RCP_ctx_feed straight out of the ring's memory
+RCP_Error RCP_ring_feed(RCP_Ring* ring, RCP_Context* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RCP_RING_H
@@ -0,0 +1,92 @@
+#ifndef RCP_STATS_H
+#define RCP_STATS_H
+
+#include "RCP_Host/RCP_Host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Counters of what a context has received, for diagnosing a link: how many packets and bytes came in and in which
+// format, what was dropped and why, errors, and how often each device class and device was heard from. The receiving
+// thread keeps them with relaxed atomics, so any other thread can read them at any time without holding it up. Each
+// counter is current on its own, but a set of them read together may be from slightly different moments.
+//
+// Packet, byte, drop and error counts go to the context whose link received the packet. Class and device counts go to
+// the context that decoded it, which is the channel peer for packets on its channel.
+
+// Errors with codes below this are counted
+#define RCP_STATS_ERRORS 32
+
+struct RCP_Stats {
+    // Complete packets received and their bytes, whether or not they were decoded, in total and by format
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t compactPackets;
+    uint64_t compactBytes;
+    uint64_t extendedPackets;
+    uint64_t extendedBytes;
+
+    // Packets dropped because no context listens on their channel, and because the subscription filter did not want
+    // their device class
+    uint64_t wrongChannel;
+    uint64_t filtered;
+
+    // Bytes of dropped packets that were skipped without being read in, and bytes dropped by resync or framing while
+    // looking for packets
+    uint64_t skippedBytes;
+    uint64_t discardedBytes;
+
+    // Errors raised by received packets, by code. Bad amalgamate subunits are errors[RCP_ERR_AMALG_SUBUNIT], and frames
+    // that failed to decode errors[RCP_ERR_BAD_FRAME]
+    uint64_t errors[RCP_STATS_ERRORS];
+};
+
+struct RCP_ClassStats {
+    // Packets of the class decoded, and their bytes. Amalgamated packets count under RCP_DEVCLASS_AMALGAMATE
+    uint64_t packets;
+    uint64_t bytes;
+
+    // Information units of the class decoded, whether in a packet of their own or amalgamated
+    uint64_t units;
+};
+
+struct RCP_DeviceStats {
+    RCP_DeviceClass devclass;
+    uint8_t ID;
+
+    // Readings decoded from the device, and the target timestamps of the first and latest of them. The device's sample
+    // rate is (samples - 1) * 1000 / (lastTimestamp - firstTimestamp) per second
+    uint64_t samples;
+    uint32_t firstTimestamp;
+    uint32_t lastTimestamp;
+};
+
+// Start counting for ctx. Nothing is counted until this is called, so contexts that do not want statistics do not pay
+// for them. This has to be done before other threads look at them, and counting lasts until the context is destroyed.
+// Calling it again does nothing
+RCP_Error RCP_ctx_trackStats(RCP_Context* ctx);
+
+// These return RCP_ERR_INIT if statistics are not being kept
+RCP_Error RCP_ctx_getStats(const RCP_Context* ctx, struct RCP_Stats* stats);
+RCP_Error RCP_ctx_getClassStats(const RCP_Context* ctx, RCP_DeviceClass devclass, struct RCP_ClassStats* stats);
+
+// Returns RCP_ERR_NO_READING if nothing has been decoded from the device
+RCP_Error RCP_ctx_getDeviceStats(const RCP_Context* ctx, RCP_DeviceClass devclass, uint8_t ID,
+                                 struct RCP_DeviceStats* stats);
+
+// Statistics of every device heard from, up to capacity of them, in the order they were first heard from. Returns how
+// many devices there are, which may be more than were copied, or 0 if statistics are not being kept
+size_t RCP_ctx_snapshotDeviceStats(const RCP_Context* ctx, struct RCP_DeviceStats* stats, size_t capacity);
+
+RCP_Error RCP_trackStats(void);
+RCP_Error RCP_getStats(struct RCP_Stats* stats);
+RCP_Error RCP_getClassStats(RCP_DeviceClass devclass, struct RCP_ClassStats* stats);
+RCP_Error RCP_getDeviceStats(RCP_DeviceClass devclass, uint8_t ID, struct RCP_DeviceStats* stats);
+size_t RCP_snapshotDeviceStats(struct RCP_DeviceStats* stats, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RCP_STATS_H
@@ -0,0 +1,69 @@
+#ifndef RCP_STORE_H
+#define RCP_STORE_H
+
+#include "RCP_Host/RCP_Host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// In memory time series of every device's readings, kept column by column. Attached to a context, the store appends
+// each decoded sensor reading, bool and simple actuator state to its device's series, as a timestamp column and one
+// float column per value, so a one float reading takes 8 bytes rather than the 16 of an RCP_1F. Series are kept in
+// chunks of a fixed number of samples, each column contiguous and cache line aligned within its chunk, which suits
+// plotting and statistics that scan a column with SIMD. The store never holds more than its memory budget of chunks:
+// when a new chunk would go over, the oldest chunk in the whole store is dropped to make room.
+//
+// A store is not synchronized. It should only be read from the thread that receives for the context it is attached
+// to, or while that thread is not receiving.
+typedef struct RCP_Store RCP_Store;
+
+struct RCP_StoreSeries {
+    // Number of values in each reading. Bool data and simple actuator states have one, 0 or 1
+    uint8_t arity;
+
+    // Samples held, and how many chunks they are in
+    size_t len;
+    size_t chunks;
+
+    // Samples dropped to stay within the budget, or because memory for them could not be allocated
+    uint64_t dropped;
+};
+
+// One chunk of a series. columns has arity entries, the rest are NULL. Valid until the next reading is stored
+struct RCP_StoreChunk {
+    size_t len;
+    const uint32_t* timestamps;
+    const float* columns[4];
+};
+
+// chunkSamples is how many samples go in each chunk, and budgetBytes how much memory chunks can take up altogether,
+// which has to be enough for at least one chunk
+RCP_Error RCP_store_create(size_t chunkSamples, size_t budgetBytes, RCP_Store** store);
+RCP_Error RCP_store_destroy(RCP_Store* store);
+
+// Bytes of chunks currently held
+size_t RCP_store_memory(const RCP_Store* store);
+
+// Fully qualified names, as by RCP_FQDN in RCP_Latest.h, of the devices the store has seen, in the order they were
+// first seen, up to capacity of them. Returns how many devices there are, which may be more than were copied
+size_t RCP_store_devices(const RCP_Store* store, uint16_t* fqdns, size_t capacity);
+
+// Returns RCP_ERR_NO_READING for a device the store has not seen
+RCP_Error RCP_store_getSeries(const RCP_Store* store, RCP_DeviceClass devclass, uint8_t ID,
+                              struct RCP_StoreSeries* series);
+
+// Chunk index of a device's series, oldest first
+RCP_Error RCP_store_getChunk(const RCP_Store* store, RCP_DeviceClass devclass, uint8_t ID, size_t index,
+                             struct RCP_StoreChunk* chunk);
+
+// Append every reading ctx decodes to store, or stop if store is NULL. The store must outlive its attachment, and
+// readings the subscription filter dropped are not stored
+RCP_Error RCP_ctx_setStore(RCP_Context* ctx, RCP_Store* store);
+RCP_Error RCP_setStore(RCP_Store* store);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RCP_STORE_H
@@ -0,0 +1,105 @@
+#ifndef RCP_TRANSPORT_H
+#define RCP_TRANSPORT_H
+
+#include "RCP_Host/RCP_Host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Ready made links to a target over a serial port, a TCP connection or UDP datagrams, for use in place of the sendData
+// and readData callbacks. Received bytes are read ahead into a buffer, taking everything the link has ready in one
+// system call, so the small reads RCP_poll makes for each packet header are served from memory. Only available on
+// POSIX systems.
+//
+// A read waits for the whole of what was asked for. If the link times out or fails first, nothing is returned and the
+// bytes that did arrive stay buffered for the next read, so a timeout never loses data.
+typedef struct RCP_Transport RCP_Transport;
+
+// Size of the read ahead buffer. Always enough for the largest packet, or the largest UDP datagram
+#define RCP_TRANSPORT_BUFFER (128 * 1024)
+
+// How long RCP_transport_openTcp waits for the connection to be accepted
+#define RCP_TRANSPORT_CONNECT_MS 5000
+
+struct RCP_SerialConfig {
+    // Line rate, one of the standard rates termios knows, or 0 to keep the port's current rate
+    uint32_t baud;
+
+    // Raw mode VMIN and VTIME. With both 0, the default, the port is non-blocking and reads wait for the transport
+    // timeout. Otherwise reads are left to the terminal driver: a read returns once vmin bytes have arrived, or vtime
+    // tenths of a second pass between bytes, and the transport timeout only applies to sends
+    uint8_t vmin;
+    uint8_t vtime;
+
+    // Ask the driver to pass received bytes on straight away instead of on its next scheduled flush. Linux only, and
+    // quietly ignored by drivers that do not support it
+    int lowLatency;
+};
+
+struct RCP_TransportStats {
+    // System calls made to read, and the bytes they returned
+    uint64_t reads;
+    uint64_t bytesRead;
+
+    // System calls made to send, and the bytes they took
+    uint64_t writes;
+    uint64_t bytesSent;
+};
+
+// Open the serial port at path in raw 8N1 mode. config may be NULL for a non-blocking port at its current rate.
+// Returns RCP_ERR_INIT for a rate termios does not have, and RCP_ERR_IO_OPEN if the port cannot be opened or set up
+RCP_Error RCP_transport_openSerial(const char* path, const struct RCP_SerialConfig* config, RCP_Transport** transport);
+
+// Connect to port on host, a name or address, with Nagle's algorithm off so commands go out as soon as they are sent.
+// Returns RCP_ERR_IO_OPEN if no address for host accepts the connection
+RCP_Error RCP_transport_openTcp(const char* host, uint16_t port, RCP_Transport** transport);
+
+// Exchange datagrams with port on host, receiving on localPort, or a port picked by the system if 0. Each send goes out
+// as one datagram, and only datagrams from host and port are received
+RCP_Error RCP_transport_openUdp(const char* host, uint16_t port, uint16_t localPort, RCP_Transport** transport);
+
+RCP_Error RCP_transport_close(RCP_Transport* transport);
+
+// How long reads and sends wait for the link, in milliseconds. 0 does not wait at all, and a negative timeout, the
+// default, waits as long as it takes
+void RCP_transport_setTimeout(RCP_Transport* transport, int timeoutMs);
+
+// The file descriptor underneath, or -1
+int RCP_transport_fd(const RCP_Transport* transport);
+
+// Read, skip and send with the signatures of the readData, skipData and sendData callbacks, taking the transport as the
+// user pointer. A send returns how many bytes went out, which is less than length only if the link failed or timed out.
+// Skipped bytes that were already read ahead are dropped without being copied
+size_t RCP_transport_read(void* transport, void* data, size_t length);
+size_t RCP_transport_skip(void* transport, size_t length);
+size_t RCP_transport_send(void* transport, const void* data, size_t length);
+
+RCP_Error RCP_transport_getStats(const RCP_Transport* transport, struct RCP_TransportStats* stats);
+
+// Have a context send and receive through transport instead of its sendData, readData and skipData callbacks, which
+// are then not called. The user pointer passed to the other callbacks is unchanged. NULL goes back to the callbacks.
+// The transport must stay open for as long as it is attached
+RCP_Error RCP_ctx_setTransport(RCP_Context* ctx, RCP_Transport* transport);
+RCP_Error RCP_setTransport(RCP_Transport* transport);
+
+// Non-blocking receive, for running links from an event loop such as epoll alongside other I/O. Once the descriptor
+// from RCP_ctx_getFd is readable, RCP_ctx_pollNonBlocking takes in everything the link has ready without waiting, and
+// processes every complete packet in it the way RCP_ctx_feed does, keeping a partial packet until the rest arrives.
+// It reads until the link has nothing more, so it also suits edge-triggered readiness. Returns RCP_ERR_WOULD_BLOCK if
+// no packet was completed, and RCP_ERR_IO_RCV once the link has closed or failed, after processing whatever arrived
+// before then. Otherwise returns the first error a packet raised. Requires an attached transport, and a context should
+// be received from with either this or RCP_ctx_poll, not both. Sends still wait for the link as set by
+// RCP_transport_setTimeout
+RCP_Error RCP_ctx_pollNonBlocking(RCP_Context* ctx);
+RCP_Error RCP_pollNonBlocking(void);
+
+// Descriptor to wait on for RCP_ctx_pollNonBlocking, which is that of the attached transport, or -1 without one
+int RCP_ctx_getFd(const RCP_Context* ctx);
+int RCP_getFd(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RCP_TRANSPORT_H
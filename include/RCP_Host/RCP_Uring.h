@@ -0,0 +1,94 @@
+#ifndef RCP_URING_H
+#define RCP_URING_H
+
+#include "RCP_Host/RCP_Host.h"
+#include "RCP_Host/RCP_Transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Runs the receive and send sides of many links from one thread through a single io_uring. Each link is a context with
+// a transport from RCP_Transport.h, and an ID of the caller's choosing. Links keep their own channel and other
+// settings on their context. Receives stay in flight the whole time, multishot on sockets, landing in a pool of
+// buffers registered with the kernel, and packets are decoded straight out of those buffers. Sends made while the ring
+// is being polled, such as from a callback, are queued and go to the kernel together at the end of the pass, with the
+// receives it re-arms, rather than one system call per command. Each link has one send with the kernel at a time so
+// they stay in order, and sends made meanwhile are combined into the next. Only available on POSIX systems.
+//
+// On systems without io_uring, or kernels too old for what this needs (5.19 or newer), the ring falls back to poll(2)
+// and a non-blocking read of each ready link. The interface and results are the same either way.
+//
+// Links are serviced fairly. With io_uring, completions are processed in the order they arrive, and each carries at
+// most one receive buffer. In the fallback, each ready link gets one read per poll.
+typedef struct RCP_Uring RCP_Uring;
+
+// Size of each receive buffer, and how many there are. The pool is shared by all links on the ring
+#define RCP_URING_BUFFER 16384
+#define RCP_URING_BUFFERS 64
+
+// Bytes a link can have waiting to be sent on top of a send already with the kernel. A send that does not fit fails
+#define RCP_URING_SEND_QUEUE 4096
+
+// Flags for RCP_uring_create. RCP_URING_FALLBACK always uses poll(2), even where io_uring is available
+#define RCP_URING_FALLBACK 0x01
+
+struct RCP_UringLinkStats {
+    // Complete packets, received bytes, and bytes skipped by resync or framing, since the link joined the ring
+    uint64_t packets;
+    uint64_t bytesReceived;
+    uint64_t discarded;
+
+    // Bytes the link has sent since it joined
+    uint64_t bytesSent;
+
+    // Monotonic time in nanoseconds when the link last received anything, or 0 if it has not
+    uint64_t lastReceiveNs;
+
+    // Whether the link has not closed or failed
+    int open;
+};
+
+// entries is the submission queue size, and bounds how many operations go to the kernel in one system call
+RCP_Error RCP_uring_create(unsigned entries, unsigned flags, RCP_Uring** ring);
+
+// Remove every link and release the ring. Sends still queued are dropped
+RCP_Error RCP_uring_destroy(RCP_Uring* ring);
+
+// Whether the ring is using io_uring rather than the fallback
+int RCP_uring_isNative(const RCP_Uring* ring);
+
+// Have the ring receive and send for ctx through transport, in place of whatever was attached before, as link linkId.
+// Neither ctx nor linkId may already be on the ring. Bytes the transport had already buffered are processed first. From
+// then on ctx must only be received from by RCP_uring_poll, and sent from on the thread that polls the ring. While it
+// is on the ring a serial port is switched to blocking reads that return as soon as any byte arrives, unless it was
+// opened with VMIN or VTIME set
+RCP_Error RCP_uring_add(RCP_Uring* ring, uint32_t linkId, RCP_Context* ctx, RCP_Transport* transport);
+
+// Take ctx off the ring and attach its transport to it directly again. Sends the kernel has not finished may be lost
+RCP_Error RCP_uring_remove(RCP_Uring* ring, RCP_Context* ctx);
+
+// Whether ctx is on the ring and its link has not closed or failed
+int RCP_uring_isOpen(const RCP_Uring* ring, const RCP_Context* ctx);
+
+// The context of a link, or NULL if there is no such link on the ring
+RCP_Context* RCP_uring_getLink(const RCP_Uring* ring, uint32_t linkId);
+
+// From a callback run by RCP_uring_poll, the link whose packet is being processed. Returns 1 and sets linkId, which may
+// be NULL, inside such a callback, and 0 anywhere else. Lets callbacks shared by many links tell them apart
+int RCP_uring_currentLink(const RCP_Uring* ring, uint32_t* linkId);
+
+// What a link has done since it was added. Links that closed keep their statistics until they are removed
+RCP_Error RCP_uring_getStats(const RCP_Uring* ring, uint32_t linkId, struct RCP_UringLinkStats* stats);
+
+// Wait up to timeoutMs for any link to receive, negative waiting as long as it takes, and process every complete packet
+// that has arrived on every link. Returns RCP_ERR_WOULD_BLOCK if no packet was completed, and RCP_ERR_IO_RCV if a link
+// closed or failed, after which it stays on the ring but is no longer received from. Otherwise returns the first error
+// a packet raised
+RCP_Error RCP_uring_poll(RCP_Uring* ring, int timeoutMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RCP_URING_H
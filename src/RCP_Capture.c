@@ -0,0 +1,257 @@
+#include "RCP_Host/RCP_Capture.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "RCP_Host/RCP_Ring.h"
+#include "RCP_Internal.h"
+
+// How long the writer sleeps when it finds nothing to write. Whatever arrives in the meantime goes out in one write
+#define WRITER_IDLE_NS 500000
+
+// How much of a packet the index looks at: the longest preamble, the class byte and the timestamp
+#define INDEX_PREFIX 8
+
+struct RCP_Capture {
+    // Recorded bytes waiting for the writer. The recording thread is the producer and the writer thread the consumer
+    RCP_Ring* ring;
+
+    int fd;
+    pthread_t writer;
+    atomic_int stop;
+    atomic_int failed;
+
+    // Written by the recording thread only, but atomic so stats can be read from anywhere
+    atomic_uint_least64_t packets;
+    atomic_uint_least64_t bytes;
+    atomic_uint_least64_t dropped;
+
+    // Index built by the writer thread from the records it drains, and saved next to the capture on close. Not saved if
+    // it ran out of memory
+    char* path;
+    struct RCP__IndexBuilder index;
+    int indexFailed;
+
+    // Where the writer is in the record stream. offset is the file offset of the next byte drained, record holds the
+    // header and start of the packet of the record being drained, and packetLeft is what is left of the packet after it
+    uint64_t offset;
+    uint8_t record[RCP_CAPTURE_RECORD_HEADER_BYTES + INDEX_PREFIX];
+    size_t recordHave;
+    size_t packetLeft;
+};
+
+// Write the whole of data, continuing after partial writes and interruptions. Returns 0 on success
+static int writeAll(int fd, const uint8_t* data, size_t length) {
+    while(length > 0) {
+        ssize_t n = write(fd, data, length);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            return -1;
+        }
+
+        data += n;
+        length -= (size_t) n;
+    }
+
+    return 0;
+}
+
+// Bytes of the record being drained that the index needs: its header, then as much of the packet as it looks at
+static size_t recordWant(const RCP_Capture* cap) {
+    if(cap->recordHave < RCP_CAPTURE_RECORD_HEADER_BYTES) return RCP_CAPTURE_RECORD_HEADER_BYTES;
+
+    size_t length = RCP__loadLE(cap->record + 8, 4);
+    return RCP_CAPTURE_RECORD_HEADER_BYTES + (length < INDEX_PREFIX ? length : INDEX_PREFIX);
+}
+
+// Follow the records through n drained bytes, adding each to the index once enough of it has been seen. Records can
+// be split anywhere between one drain and the next
+static void indexRecords(RCP_Capture* cap, const uint8_t* data, size_t n) {
+    while(n > 0) {
+        size_t take;
+        if(cap->packetLeft != 0) {
+            take = n < cap->packetLeft ? n : cap->packetLeft;
+            cap->packetLeft -= take;
+        }
+
+        else {
+            take = recordWant(cap) - cap->recordHave;
+            if(take > n) take = n;
+
+            memcpy(cap->record + cap->recordHave, data, take);
+            cap->recordHave += take;
+
+            // Packets are never empty, so a record is only complete once some of its packet has been seen
+            if(cap->recordHave > RCP_CAPTURE_RECORD_HEADER_BYTES && cap->recordHave == recordWant(cap)) {
+                size_t length = RCP__loadLE(cap->record + 8, 4);
+                uint64_t start = cap->offset + take - cap->recordHave;
+                if(!cap->indexFailed && RCP__indexAdd(&cap->index, start, RCP__loadLE(cap->record, 8), cap->record[12],
+                                                      cap->record + RCP_CAPTURE_RECORD_HEADER_BYTES,
+                                                      length) != RCP_ERR_SUCCESS)
+                    cap->indexFailed = 1;
+
+                cap->packetLeft = length - (cap->recordHave - RCP_CAPTURE_RECORD_HEADER_BYTES);
+                cap->recordHave = 0;
+            }
+        }
+
+        cap->offset += take;
+        data += take;
+        n -= take;
+    }
+}
+
+// Writer thread. Writes the buffer out straight from the ring's memory until close, then drains what is left. After a
+// write fails, bytes are still consumed so the recording thread is never blocked by a dead file
+static void* writerMain(void* arg) {
+    RCP_Capture* cap = arg;
+
+    for(;;) {
+        // Checked before looking at the ring, so that everything recorded before close was called gets written
+        int stopping = atomic_load_explicit(&cap->stop, memory_order_acquire);
+
+        const uint8_t* data;
+        size_t n = RCP_ring_peek(cap->ring, &data);
+        if(n != 0) {
+            if(!atomic_load_explicit(&cap->failed, memory_order_relaxed) && writeAll(cap->fd, data, n) != 0)
+                atomic_store_explicit(&cap->failed, 1, memory_order_relaxed);
+
+            indexRecords(cap, data, n);
+            RCP_ring_consume(cap->ring, n);
+            continue;
+        }
+
+        if(stopping) break;
+
+        struct timespec idle = {.tv_sec = 0, .tv_nsec = WRITER_IDLE_NS};
+        nanosleep(&idle, NULL);
+    }
+
+    return NULL;
+}
+
+RCP_Error RCP_capture_open(const char* path, size_t bufferSize, RCP_Capture** cap) {
+    if(cap == NULL || path == NULL) return RCP_ERR_INIT;
+    *cap = NULL;
+
+    RCP_Capture* c = malloc(sizeof(RCP_Capture));
+    if(c == NULL) return RCP_ERR_MEMALLOC;
+
+    c->path = strdup(path);
+    if(c->path == NULL) {
+        free(c);
+        return RCP_ERR_MEMALLOC;
+    }
+
+    RCP_Error rerrno = RCP_ring_create(bufferSize == 0 ? RCP_CAPTURE_DEFAULT_BUFFER : bufferSize, &c->ring);
+    if(rerrno != RCP_ERR_SUCCESS) {
+        free(c->path);
+        free(c);
+        return rerrno;
+    }
+
+    c->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(c->fd < 0) {
+        RCP_ring_destroy(c->ring);
+        free(c->path);
+        free(c);
+        return RCP_ERR_IO_FILE;
+    }
+
+    // An index left from an earlier capture at this path no longer matches it
+    char* indexPath = RCP__indexPath(path);
+    if(indexPath != NULL) unlink(indexPath);
+    free(indexPath);
+
+    uint8_t header[RCP_CAPTURE_FILE_HEADER_BYTES] = {0};
+    memcpy(header, RCP_CAPTURE_MAGIC, 8);
+    RCP__storeLE(header + 8, RCP_CAPTURE_VERSION, 4);
+
+    if(writeAll(c->fd, header, sizeof(header)) != 0) {
+        close(c->fd);
+        RCP_ring_destroy(c->ring);
+        free(c->path);
+        free(c);
+        return RCP_ERR_IO_FILE;
+    }
+
+    atomic_init(&c->stop, 0);
+    atomic_init(&c->failed, 0);
+    atomic_init(&c->packets, 0);
+    atomic_init(&c->bytes, 0);
+    atomic_init(&c->dropped, 0);
+    RCP__indexInit(&c->index);
+    c->indexFailed = 0;
+    c->offset = RCP_CAPTURE_FILE_HEADER_BYTES;
+    c->recordHave = 0;
+    c->packetLeft = 0;
+
+    if(pthread_create(&c->writer, NULL, writerMain, c) != 0) {
+        close(c->fd);
+        RCP_ring_destroy(c->ring);
+        free(c->path);
+        free(c);
+        return RCP_ERR_MEMALLOC;
+    }
+
+    *cap = c;
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_capture_close(RCP_Capture* cap) {
+    if(cap == NULL) return RCP_ERR_INIT;
+
+    atomic_store_explicit(&cap->stop, 1, memory_order_release);
+    pthread_join(cap->writer, NULL);
+
+    RCP_Error rerrno = atomic_load_explicit(&cap->failed, memory_order_relaxed) ? RCP_ERR_IO_FILE : RCP_ERR_SUCCESS;
+    if(close(cap->fd) != 0) rerrno = RCP_ERR_IO_FILE;
+
+    // Failing to save the index is not an error, it is rebuilt from the capture when next opened
+    if(rerrno == RCP_ERR_SUCCESS && !cap->indexFailed) RCP__indexSave(&cap->index, cap->path, cap->offset);
+
+    RCP__indexFree(&cap->index);
+    RCP_ring_destroy(cap->ring);
+    free(cap->path);
+    free(cap);
+    return rerrno;
+}
+
+void RCP_capture_tap(void* capture, const uint8_t* pkt, size_t length) {
+    RCP_Capture* cap = capture;
+    if(cap == NULL || pkt == NULL || length == 0) return;
+
+    // A record goes in whole or not at all. Only this thread adds to the ring, so the room seen can only grow
+    if(RCP_ring_capacity(cap->ring) - RCP_ring_size(cap->ring) < RCP_CAPTURE_RECORD_HEADER_BYTES + length) {
+        RCP__BUMP(cap->dropped, 1);
+        return;
+    }
+
+    uint8_t header[RCP_CAPTURE_RECORD_HEADER_BYTES] = {0};
+    RCP__storeLE(header, RCP__monotonicNs(), 8);
+    RCP__storeLE(header + 8, length, 4);
+    header[12] = pkt[0] & RCP_CHANNEL_MASK;
+
+    RCP_ring_write(cap->ring, header, sizeof(header));
+    RCP_ring_write(cap->ring, pkt, length);
+
+    RCP__BUMP(cap->packets, 1);
+    RCP__BUMP(cap->bytes, sizeof(header) + length);
+}
+
+RCP_Error RCP_capture_getStats(const RCP_Capture* cap, struct RCP_CaptureStats* stats) {
+    if(cap == NULL || stats == NULL) return RCP_ERR_INIT;
+
+    // The loads need a non-const object, but do not change it
+    RCP_Capture* c = (RCP_Capture*) cap;
+    stats->packets = atomic_load_explicit(&c->packets, memory_order_relaxed);
+    stats->bytes = atomic_load_explicit(&c->bytes, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&c->dropped, memory_order_relaxed);
+    return RCP_ERR_SUCCESS;
+}
@@ -0,0 +1,163 @@
+#include "RCP_Host/RCP_Cobs.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RCP_COBS_SSE2
+#include <emmintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// AVX2 is compiled in with a target attribute and chosen at run time, so the library still runs on older processors
+#if defined(RCP_COBS_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RCP_COBS_AVX2
+#include <immintrin.h>
+#include <stdatomic.h>
+#endif
+
+size_t RCP_cobs_encode(const uint8_t* src, size_t n, uint8_t* dst) {
+    // Each block starts with a code byte, one more than the number of nonzero bytes that follow it
+    uint8_t* code = dst;
+    uint8_t* out = dst + 1;
+    uint8_t run = 1;
+
+    for(size_t i = 0; i < n; i++) {
+        if(src[i] != 0) {
+            *out++ = src[i];
+            if(++run != 0xFF) continue;
+        }
+
+        // A zero, or a run as long as a code can describe, ends the block
+        *code = run;
+        code = out++;
+        run = 1;
+    }
+
+    *code = run;
+    return (size_t) (out - dst);
+}
+
+RCP_Error RCP_cobs_decode(const uint8_t* src, size_t n, uint8_t* dst, size_t* decoded) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while(in < n) {
+        size_t run = src[in++];
+        if(run == 0 || run - 1 > n - in) return RCP_ERR_BAD_FRAME;
+
+        // The output never gets ahead of the input, so decoding in place only ever moves bytes back
+        memmove(dst + out, src + in, run - 1);
+        in += run - 1;
+        out += run - 1;
+
+        // Every block but a full length one stands for a zero after it, except at the end of the frame
+        if(run != 0xFF && in < n) dst[out++] = 0;
+    }
+
+    *decoded = out;
+    return RCP_ERR_SUCCESS;
+}
+
+#ifdef RCP_COBS_SSE2
+static unsigned lowestBit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned) index;
+#else
+    return (unsigned) __builtin_ctz(mask);
+#endif
+}
+
+static size_t findSSE2(const uint8_t* p, size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        unsigned mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (p + i)), zero));
+        if(mask != 0) return i + lowestBit(mask);
+    }
+
+    const uint8_t* z = memchr(p + i, 0, n - i);
+    return z == NULL ? n : (size_t) (z - p);
+}
+#endif
+
+#ifdef RCP_COBS_AVX2
+// Two vectors per step, so a frame of a few hundred bytes is only a handful of iterations
+__attribute__((target("avx2"))) static size_t findAVX2(const uint8_t* p, size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for(; i + 64 <= n; i += 64) {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (p + i)), zero);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (p + i + 32)), zero);
+        if(_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b))) continue;
+
+        unsigned lo = (unsigned) _mm256_movemask_epi8(a);
+        if(lo != 0) return i + lowestBit(lo);
+        return i + 32 + lowestBit((unsigned) _mm256_movemask_epi8(b));
+    }
+
+    return i + findSSE2(p + i, n - i);
+}
+
+// Contexts on different threads can get here first together. They all find the same answer, so whichever store lands
+// last does no harm, and relaxed is enough
+static int haveAVX2(void) {
+    static atomic_int cached = -1;
+    int have = atomic_load_explicit(&cached, memory_order_relaxed);
+    if(have < 0) {
+        __builtin_cpu_init();
+        have = __builtin_cpu_supports("avx2") != 0;
+        atomic_store_explicit(&cached, have, memory_order_relaxed);
+    }
+
+    return have;
+}
+#endif
+
+size_t RCP_cobs_findDelimiter(const uint8_t* p, size_t n) {
+#if defined(RCP_COBS_AVX2)
+    if(n >= 64 && haveAVX2()) return findAVX2(p, n);
+#endif
+
+#if defined(RCP_COBS_SSE2)
+    return findSSE2(p, n);
+#else
+    // The C library's memchr is already the fastest scalar search there is
+    const uint8_t* z = memchr(p, 0, n);
+    return z == NULL ? n : (size_t) (z - p);
+#endif
+}
+
+// CRC-16/CCITT-FALSE: polynomial 0x1021, initial value 0xFFFF, no reflection or final XOR
+static const uint16_t CRC16_TABLE[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7, 0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD,
+    0xE1CE, 0xF1EF, 0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6, 0x9339, 0x8318, 0xB37B, 0xA35A,
+    0xD3BD, 0xC39C, 0xF3FF, 0xE3DE, 0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485, 0xA56A, 0xB54B,
+    0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D, 0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC, 0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861,
+    0x2802, 0x3823, 0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B, 0x5AF5, 0x4AD4, 0x7AB7, 0x6A96,
+    0x1A71, 0x0A50, 0x3A33, 0x2A12, 0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A, 0x6CA6, 0x7C87,
+    0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41, 0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70, 0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A,
+    0x9F59, 0x8F78, 0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F, 0x1080, 0x00A1, 0x30C2, 0x20E3,
+    0x5004, 0x4025, 0x7046, 0x6067, 0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E, 0x02B1, 0x1290,
+    0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256, 0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405, 0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E,
+    0xC71D, 0xD73C, 0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634, 0xD94C, 0xC96D, 0xF90E, 0xE92F,
+    0x99C8, 0x89E9, 0xB98A, 0xA9AB, 0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3, 0xCB7D, 0xDB5C,
+    0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A, 0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9, 0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83,
+    0x1CE0, 0x0CC1, 0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8, 0x6E17, 0x7E36, 0x4E55, 0x5E74,
+    0x2E93, 0x3EB2, 0x0ED1, 0x1EF0};
+
+uint16_t RCP_crc16(const uint8_t* data, size_t n) {
+    uint16_t crc = 0xFFFF;
+    for(size_t i = 0; i < n; i++) crc = (uint16_t) ((crc << 8) ^ CRC16_TABLE[(uint8_t) (crc >> 8) ^ data[i]]);
+    return crc;
+}
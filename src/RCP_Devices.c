@@ -0,0 +1,68 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "RCP_Internal.h"
+
+struct RCP__Devices {
+    size_t size;
+    void (*init)(void* table);
+    _Atomic(void*) classes[256];
+
+    // Devices in the order they were first heard from. Entries below count are never written again
+    atomic_size_t count;
+    uint16_t order[256 * 256];
+};
+
+struct RCP__Devices* RCP__devicesCreate(size_t size, void (*init)(void* table)) {
+    struct RCP__Devices* d = malloc(sizeof(struct RCP__Devices));
+    if(d == NULL) return NULL;
+
+    d->size = size;
+    d->init = init;
+    for(size_t i = 0; i < 256; i++) atomic_init(&d->classes[i], NULL);
+    atomic_init(&d->count, 0);
+    return d;
+}
+
+void RCP__devicesFree(struct RCP__Devices* devices, void (*release)(void* table)) {
+    if(devices == NULL) return;
+
+    for(size_t i = 0; i < 256; i++) {
+        void* table = atomic_load_explicit(&devices->classes[i], memory_order_relaxed);
+        if(table != NULL && release != NULL) release(table);
+        RCP__alignedFree(table);
+    }
+
+    free(devices);
+}
+
+void* RCP__devicesClass(struct RCP__Devices* devices, RCP_DeviceClass devclass) {
+    // Only the receiving thread adds classes, so it can look without synchronizing
+    void* table = atomic_load_explicit(&devices->classes[(uint8_t) devclass], memory_order_relaxed);
+    if(table != NULL) return table;
+
+    table = RCP__alignedAlloc(devices->size);
+    if(table == NULL) return NULL;
+
+    if(devices->init != NULL) devices->init(table);
+    else memset(table, 0, devices->size);
+
+    atomic_store_explicit(&devices->classes[(uint8_t) devclass], table, memory_order_release);
+    return table;
+}
+
+const void* RCP__devicesFind(const struct RCP__Devices* devices, RCP_DeviceClass devclass) {
+    return atomic_load_explicit(&devices->classes[(uint8_t) devclass], memory_order_acquire);
+}
+
+void RCP__devicesAdd(struct RCP__Devices* devices, uint16_t fqdn) {
+    size_t count = atomic_load_explicit(&devices->count, memory_order_relaxed);
+    devices->order[count] = fqdn;
+    atomic_store_explicit(&devices->count, count + 1, memory_order_release);
+}
+
+size_t RCP__devicesList(const struct RCP__Devices* devices, const uint16_t** fqdns) {
+    *fqdns = devices->order;
+    return atomic_load_explicit(&devices->count, memory_order_acquire);
+}
@@ -0,0 +1,272 @@
+// The original single link API. Each of these forwards to the RCP_ctx_ function of the same name on one library owned
+// context, whose callbacks translate back to the RCP_LibInitData callbacks that do not take a user pointer.
+
+#include "RCP_Host/RCP_Host.h"
+#include "RCP_Host/RCP_Latency.h"
+#include "RCP_Host/RCP_Latest.h"
+#include "RCP_Host/RCP_Limits.h"
+#include "RCP_Host/RCP_Stats.h"
+#include "RCP_Host/RCP_Store.h"
+
+#ifndef _WIN32
+#include "RCP_Host/RCP_Transport.h"
+#endif
+
+#include "RCP_Internal.h"
+
+// The context behind the global API, and the callbacks it was initialized with
+STATIC RCP_Context* globalCtx = NULL;
+STATIC struct RCP_LibInitData globalCallbacks;
+
+// Channel is kept outside of the context so that it can be set and read even when the library is not open
+STATIC RCP_Channel channel = RCP_CH_ZERO;
+
+// Trampolines from the context callbacks to the global ones. The user pointer is unused since there is only ever one
+// set of global callbacks
+static size_t globalSendData(void* user, const void* data, size_t length) {
+    (void) user;
+    return globalCallbacks.sendData(data, length);
+}
+
+static size_t globalReadData(void* user, void* data, size_t length) {
+    (void) user;
+    return globalCallbacks.readData(data, length);
+}
+
+static size_t globalSkipData(void* user, size_t length) {
+    (void) user;
+    return globalCallbacks.skipData(length);
+}
+
+static RCP_Error globalTestUpdate(void* user, struct RCP_TestData data) {
+    (void) user;
+    return globalCallbacks.processTestUpdate(data);
+}
+
+static RCP_Error globalBoolData(void* user, struct RCP_BoolData data) {
+    (void) user;
+    return globalCallbacks.processBoolData(data);
+}
+
+static RCP_Error globalSimpleActuatorData(void* user, struct RCP_SimpleActuatorData data) {
+    (void) user;
+    return globalCallbacks.processSimpleActuatorData(data);
+}
+
+static RCP_Error globalPromptInput(void* user, struct RCP_PromptInputRequest request) {
+    (void) user;
+    return globalCallbacks.processPromptInput(request);
+}
+
+static RCP_Error globalTargetLog(void* user, struct RCP_TargetLogData data) {
+    (void) user;
+    return globalCallbacks.processTargetLog(data);
+}
+
+static RCP_Error globalOneFloat(void* user, struct RCP_1F data) {
+    (void) user;
+    return globalCallbacks.processOneFloat(data);
+}
+
+static RCP_Error globalTwoFloat(void* user, struct RCP_2F data) {
+    (void) user;
+    return globalCallbacks.processTwoFloat(data);
+}
+
+static RCP_Error globalThreeFloat(void* user, struct RCP_3F data) {
+    (void) user;
+    return globalCallbacks.processThreeFloat(data);
+}
+
+static RCP_Error globalFourFloat(void* user, struct RCP_4F data) {
+    (void) user;
+    return globalCallbacks.processFourFloat(data);
+}
+
+static RCP_Error globalOneFloatBatch(void* user, const struct RCP_1F* items, size_t n, uint32_t timestamp) {
+    (void) user;
+    return globalCallbacks.processOneFloatBatch(items, n, timestamp);
+}
+
+static RCP_Error globalTwoFloatBatch(void* user, const struct RCP_2F* items, size_t n, uint32_t timestamp) {
+    (void) user;
+    return globalCallbacks.processTwoFloatBatch(items, n, timestamp);
+}
+
+static RCP_Error globalThreeFloatBatch(void* user, const struct RCP_3F* items, size_t n, uint32_t timestamp) {
+    (void) user;
+    return globalCallbacks.processThreeFloatBatch(items, n, timestamp);
+}
+
+static RCP_Error globalFourFloatBatch(void* user, const struct RCP_4F* items, size_t n, uint32_t timestamp) {
+    (void) user;
+    return globalCallbacks.processFourFloatBatch(items, n, timestamp);
+}
+
+RCP_Error RCP_init(const struct RCP_LibInitData callbacks) {
+    if(globalCtx != NULL) return RCP_ERR_INIT;
+
+    globalCallbacks = callbacks;
+    struct RCP_CtxCallbacks trampolines = {.sendData = globalSendData,
+                                           .readData = globalReadData,
+                                           .processTestUpdate = globalTestUpdate,
+                                           .processBoolData = globalBoolData,
+                                           .processSimpleActuatorData = globalSimpleActuatorData,
+                                           .processPromptInput = globalPromptInput,
+                                           .processTargetLog = globalTargetLog,
+                                           .processOneFloat = globalOneFloat,
+                                           .processTwoFloat = globalTwoFloat,
+                                           .processThreeFloat = globalThreeFloat,
+                                           .processFourFloat = globalFourFloat};
+
+    // The batch and skip callbacks are optional, so only point the context at a trampoline when there is something
+    // behind it
+    if(callbacks.processOneFloatBatch != NULL) trampolines.processOneFloatBatch = globalOneFloatBatch;
+    if(callbacks.processTwoFloatBatch != NULL) trampolines.processTwoFloatBatch = globalTwoFloatBatch;
+    if(callbacks.processThreeFloatBatch != NULL) trampolines.processThreeFloatBatch = globalThreeFloatBatch;
+    if(callbacks.processFourFloatBatch != NULL) trampolines.processFourFloatBatch = globalFourFloatBatch;
+    if(callbacks.skipData != NULL) trampolines.skipData = globalSkipData;
+
+    RCP_Error rerrno = RCP_ctx_create(trampolines, NULL, &globalCtx);
+    if(rerrno != RCP_ERR_SUCCESS) return rerrno;
+
+    channel = RCP_CH_ZERO;
+    return RCP_ERR_SUCCESS;
+}
+
+int RCP_isOpen(void) { return globalCtx != NULL; }
+
+RCP_Error RCP_shutdown(void) {
+    RCP_Error rerrno = RCP_ctx_destroy(globalCtx);
+    globalCtx = NULL;
+    return rerrno;
+}
+
+void RCP_setChannel(RCP_Channel ch) {
+    channel = ch;
+    RCP_ctx_setChannel(globalCtx, ch);
+}
+
+RCP_Channel RCP_getChannel(void) { return channel; }
+
+RCP_Error RCP_setChannelPeer(RCP_Context* peer) { return RCP_ctx_setChannelPeer(globalCtx, peer); }
+
+RCP_Error RCP_poll(void) { return RCP_ctx_poll(globalCtx); }
+
+RCP_Error RCP_feed(const uint8_t* bytes, size_t n) { return RCP_ctx_feed(globalCtx, bytes, n); }
+
+RCP_Error RCP_setPacketTap(RCP_PacketTap tap, void* user) { return RCP_ctx_setPacketTap(globalCtx, tap, user); }
+
+RCP_Error RCP_setResync(int enabled) { return RCP_ctx_setResync(globalCtx, enabled); }
+
+uint64_t RCP_getDiscarded(void) { return RCP_ctx_getDiscarded(globalCtx); }
+
+RCP_Error RCP_setFraming(RCP_Framing framing) { return RCP_ctx_setFraming(globalCtx, framing); }
+
+RCP_Error RCP_subscribe(RCP_DeviceClass devclass, int ID) { return RCP_ctx_subscribe(globalCtx, devclass, ID); }
+
+RCP_Error RCP_unsubscribe(RCP_DeviceClass devclass, int ID) { return RCP_ctx_unsubscribe(globalCtx, devclass, ID); }
+
+RCP_Error RCP_subscribeAll(void) { return RCP_ctx_subscribeAll(globalCtx); }
+
+RCP_Error RCP_trackLatest(void) { return RCP_ctx_trackLatest(globalCtx); }
+
+RCP_Error RCP_getLatest(RCP_DeviceClass devclass, uint8_t ID, struct RCP_Latest* latest) {
+    return RCP_ctx_getLatest(globalCtx, devclass, ID, latest);
+}
+
+size_t RCP_snapshotLatest(struct RCP_Latest* latest, size_t capacity) {
+    return RCP_ctx_snapshotLatest(globalCtx, latest, capacity);
+}
+
+RCP_Error RCP_setStore(RCP_Store* store) { return RCP_ctx_setStore(globalCtx, store); }
+
+RCP_Error RCP_trackStats(void) { return RCP_ctx_trackStats(globalCtx); }
+
+RCP_Error RCP_getStats(struct RCP_Stats* stats) { return RCP_ctx_getStats(globalCtx, stats); }
+
+RCP_Error RCP_getClassStats(RCP_DeviceClass devclass, struct RCP_ClassStats* stats) {
+    return RCP_ctx_getClassStats(globalCtx, devclass, stats);
+}
+
+RCP_Error RCP_getDeviceStats(RCP_DeviceClass devclass, uint8_t ID, struct RCP_DeviceStats* stats) {
+    return RCP_ctx_getDeviceStats(globalCtx, devclass, ID, stats);
+}
+
+size_t RCP_snapshotDeviceStats(struct RCP_DeviceStats* stats, size_t capacity) {
+    return RCP_ctx_snapshotDeviceStats(globalCtx, stats, capacity);
+}
+
+RCP_Error RCP_trackLatency(void) { return RCP_ctx_trackLatency(globalCtx); }
+
+RCP_Error RCP_getLatency(RCP_DeviceClass devclass, struct RCP_LatencySummary* summary) {
+    return RCP_ctx_getLatency(globalCtx, devclass, summary);
+}
+
+uint64_t RCP_latencyPercentile(RCP_DeviceClass devclass, double percent) {
+    return RCP_ctx_latencyPercentile(globalCtx, devclass, percent);
+}
+
+RCP_Error RCP_setLimits(RCP_Limits* limits) { return RCP_ctx_setLimits(globalCtx, limits); }
+
+#ifndef _WIN32
+RCP_Error RCP_setTransport(RCP_Transport* transport) { return RCP_ctx_setTransport(globalCtx, transport); }
+
+RCP_Error RCP_pollNonBlocking(void) { return RCP_ctx_pollNonBlocking(globalCtx); }
+
+int RCP_getFd(void) { return RCP_ctx_getFd(globalCtx); }
+#endif
+
+RCP_Error RCP_beginBatch(size_t flushSize, uint32_t deadlineUs) {
+    return RCP_ctx_beginBatch(globalCtx, flushSize, deadlineUs);
+}
+
+RCP_Error RCP_flush(void) { return RCP_ctx_flush(globalCtx); }
+
+RCP_Error RCP_sendEStop(void) { return RCP_ctx_sendEStop(globalCtx); }
+
+RCP_Error RCP_sendHeartbeat(void) { return RCP_ctx_sendHeartbeat(globalCtx); }
+
+RCP_Error RCP_startTest(uint8_t testnum) { return RCP_ctx_startTest(globalCtx, testnum); }
+
+RCP_Error RCP_stopTest(void) { return RCP_ctx_stopTest(globalCtx); }
+
+RCP_Error RCP_pauseUnpauseTest(void) { return RCP_ctx_pauseUnpauseTest(globalCtx); }
+
+RCP_Error RCP_deviceReset(void) { return RCP_ctx_deviceReset(globalCtx); }
+
+RCP_Error RCP_deviceTimeReset(void) { return RCP_ctx_deviceTimeReset(globalCtx); }
+
+RCP_Error RCP_setDataStreaming(int datastreaming) { return RCP_ctx_setDataStreaming(globalCtx, datastreaming); }
+
+RCP_Error RCP_setHeartbeatTime(uint8_t heartbeatTime) { return RCP_ctx_setHeartbeatTime(globalCtx, heartbeatTime); }
+
+RCP_Error RCP_requestTestState(void) { return RCP_ctx_requestTestState(globalCtx); }
+
+RCP_Error RCP_sendSimpleActuatorWrite(uint8_t ID, RCP_SimpleActuatorState state) {
+    return RCP_ctx_sendSimpleActuatorWrite(globalCtx, ID, state);
+}
+
+RCP_Error RCP_sendStepperWrite(uint8_t ID, RCP_StepperControlMode mode, float value) {
+    return RCP_ctx_sendStepperWrite(globalCtx, ID, mode, value);
+}
+
+RCP_Error RCP_sendAngledActuatorWrite(uint8_t ID, float value) {
+    return RCP_ctx_sendAngledActuatorWrite(globalCtx, ID, value);
+}
+
+RCP_Error RCP_sendMotorWrite(uint8_t ID, float value) { return RCP_ctx_sendMotorWrite(globalCtx, ID, value); }
+
+RCP_Error RCP_requestGeneralRead(RCP_DeviceClass device, uint8_t ID) {
+    return RCP_ctx_requestGeneralRead(globalCtx, device, ID);
+}
+
+RCP_Error RCP_requestTareConfiguration(RCP_DeviceClass device, uint8_t ID, uint8_t dataChannel, float offset) {
+    return RCP_ctx_requestTareConfiguration(globalCtx, device, ID, dataChannel, offset);
+}
+
+RCP_Error RCP_promptRespondGONOGO(RCP_GONOGO gonogo) { return RCP_ctx_promptRespondGONOGO(globalCtx, gonogo); }
+
+RCP_Error RCP_promptRespondFloat(float value) { return RCP_ctx_promptRespondFloat(globalCtx, value); }
+
+RCP_PromptDataType RCP_getActivePromptType(void) { return RCP_ctx_getActivePromptType(globalCtx); }
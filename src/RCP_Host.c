@@ -1,22 +1,9 @@
-// Macroing the staticness of the internals allows for unit testing
-#ifdef RCPH_TEST_MODE
-#define STATIC
-#else
-#define STATIC static
-#endif
-
 #include "RCP_Host/RCP_Host.h"
 
 #include <stdlib.h>
 #include <string.h>
 
-// Stores some basic state
-STATIC RCP_Channel channel = RCP_CH_ZERO;
-STATIC RCP_PromptDataType activePromptType = RCP_PromptDataType_RESET;
-
-// Callback struct and buffer for storing packet
-STATIC struct RCP_LibInitData* callbacks = NULL;
-STATIC uint8_t* buffer = NULL;
+#include "RCP_Internal.h"
 
 // String representations of the valid error messages
 STATIC char const* const err_msgs[] = {"Success",
@@ -27,42 +14,93 @@ STATIC char const* const err_msgs[] = {"Success",
                                        "No active prompt",
                                        "IO Receive Error",
                                        "Amalgamation unit nested in another amalgamation unit",
-                                       "Invalid amalgamation subunit"};
-
-// Initialize the library by allocated and setting the callbacks struct, allocating the packet buffer, and resetting
-// state
-RCP_Error RCP_init(const struct RCP_LibInitData _callbacks) {
-    if(callbacks != NULL || buffer != NULL) return RCP_ERR_INIT;
-
-    callbacks = malloc(sizeof(struct RCP_LibInitData));
-    if(callbacks == NULL) return RCP_ERR_MEMALLOC;
-    *callbacks = _callbacks;
-
-    buffer = malloc(RCP_MAX_EXTENDED_BYTES + RCP_MAX_NON_PARAM);
-    if(buffer == NULL) return RCP_ERR_MEMALLOC;
-
-    channel = RCP_CH_ZERO;
-    activePromptType = RCP_PromptDataType_RESET;
+                                       "Invalid amalgamation subunit",
+                                       "File IO Error",
+                                       "Not a valid capture file",
+                                       "Malformed frame",
+                                       "Could not open link",
+                                       "No complete packet available",
+                                       "No reading from that device",
+                                       "Malformed packet"};
+
+// Create a context by allocating it and its receive and transmit buffers, and setting the callbacks and default state
+RCP_Error RCP_ctx_create(const struct RCP_CtxCallbacks callbacks, void* user, RCP_Context** ctx) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+    *ctx = NULL;
+
+    RCP_Context* c = malloc(sizeof(RCP_Context));
+    if(c == NULL) return RCP_ERR_MEMALLOC;
+
+    c->rxBuffer = malloc(RCP_MAX_RX_BYTES);
+    c->txQueue = malloc(RCP_MAX_TX_BATCH);
+    if(c->rxBuffer == NULL || c->txQueue == NULL) {
+        free(c->rxBuffer);
+        free(c->txQueue);
+        free(c);
+        return RCP_ERR_MEMALLOC;
+    }
 
+    c->callbacks = callbacks;
+    c->user = user;
+    c->sendBytes = callbacks.sendData;
+    c->readBytes = callbacks.readData;
+    c->ioUser = user;
+    c->skipBytes = callbacks.skipData;
+    c->channel = RCP_CH_ZERO;
+    c->channelPeer = NULL;
+    c->activePromptType = RCP_PromptDataType_RESET;
+    c->txBatching = 0;
+    c->txLen = 0;
+    c->txFlushSize = 0;
+    c->txDeadlineUs = 0;
+    c->txFirstUs = 0;
+    c->txWriteLen = 0;
+    c->tap = NULL;
+    c->tapUser = NULL;
+    c->received = 0;
+    c->feedHave = 0;
+    c->feedNeed = 0;
+    c->resync = 0;
+    c->rxStart = 0;
+    c->discarded = 0;
+    c->framing = RCP_FRAMING_NONE;
+    c->frameBuffer = NULL;
+    c->frameHave = 0;
+    c->frameHunting = 0;
+    c->filter = NULL;
+    c->latest = NULL;
+    c->store = NULL;
+    c->stats = NULL;
+    c->latency = NULL;
+    c->limits = NULL;
+    c->inAmalg = 0;
+    c->batch1FLen = 0;
+    c->batch2FLen = 0;
+    c->batch3FLen = 0;
+    c->batch4FLen = 0;
+
+    *ctx = c;
     return RCP_ERR_SUCCESS;
 }
 
-// RCP readiness is determined only on whether the callbacks and buffer are initialized
-int RCP_isOpen(void) { return callbacks != NULL && buffer != NULL; }
-
-// Deallocate the buffer and callbacks
-RCP_Error RCP_shutdown(void) {
-    if(callbacks == NULL || buffer == NULL)
-        return RCP_ERR_INIT;
+// Deallocate the buffers and the context itself. Packets still queued in a transmit batch are dropped
+RCP_Error RCP_ctx_destroy(RCP_Context* ctx) {
+    if(ctx == NULL) return RCP_ERR_INIT;
 
-    free(callbacks);
-    callbacks = NULL;
-    free(buffer);
-    buffer = NULL;
+    free(ctx->rxBuffer);
+    free(ctx->txQueue);
+    free(ctx->frameBuffer);
+    free(ctx->filter);
+    RCP__latestFree(ctx->latest);
+    RCP__statsFree(ctx->stats);
+    RCP__latencyFree(ctx->latency);
+    free(ctx);
 
     return RCP_ERR_SUCCESS;
 }
 
+void* RCP_ctx_getUser(const RCP_Context* ctx) { return ctx == NULL ? NULL : ctx->user; }
+
 // Return the string representation of an errno
 const char* RCP_errstr(RCP_Error rerrno) {
     if(rerrno < 0 || rerrno >= (sizeof(err_msgs) / sizeof(char*))) return NULL;
@@ -70,389 +108,1183 @@ const char* RCP_errstr(RCP_Error rerrno) {
 }
 
 // Set the channel
-void RCP_setChannel(RCP_Channel ch) { channel = ch; }
+void RCP_ctx_setChannel(RCP_Context* ctx, RCP_Channel ch) {
+    if(ctx != NULL) ctx->channel = ch;
+}
 
 // Get the currently set channel
-RCP_Channel RCP_getChannel(void) { return channel; }
+RCP_Channel RCP_ctx_getChannel(const RCP_Context* ctx) { return ctx == NULL ? RCP_CH_ZERO : ctx->channel; }
 
-// Helper for processing an individual information unit. The parameters are a little funky since this also is used to
-// process IUs in an amalgamated IU.
-// - devclasss: The device class for this IU
-// - timestamp: The extracted timestamp from the packet, if relevant. If the timestamp is not used due to the devclass,
-//   the value does not matter as it will be ignored
-// - params: The number of parameter bytes. Should be set to zero when called from an amalgamated packet to prevent
-//   invalid amalgamate subunits
-// - postTS: A pointer to the buffer location at the start of the parameter bytes for this IU, but after the timestamp,
-//   if there is one
-// - inc: A pointer to a size_t that indicates how many parameter bytes were parsed, so that when processing an
-//   amalgamated IU, the caller knows how many bytes to move forward
-STATIC RCP_Error processIU(RCP_DeviceClass devclass, uint32_t timestamp, uint16_t params, const uint8_t* postTS,
-                           size_t* inc) {
-    // The value to be assigned to inc, if it is not null at the very end
-    size_t incval = 0;
+RCP_Error RCP_ctx_setChannelPeer(RCP_Context* ctx, RCP_Context* peer) {
+    if(ctx == NULL || ctx == peer) return RCP_ERR_INIT;
 
-    // Return value
-    RCP_Error rerrno;
+    ctx->channelPeer = peer;
+    return RCP_ERR_SUCCESS;
+}
 
-    switch(devclass) {
-    case RCP_DEVCLASS_TEST_STATE: {
-        struct RCP_TestData d = {.timestamp = timestamp,
-                                 .dataStreaming = postTS[0] & RCP_DATA_STREAM_MASK,
-                                 .state = postTS[0] & RCP_TEST_STATE_MASK,
-                                 .isInited = postTS[0] & RCP_DEVICE_INITED_MASK,
-                                 .heartbeatTime = postTS[1],
-                                 .runningTest = 0,
-                                 .testProgress = 0};
-
-        // Under most circumstances, incval can be 2 since state will not be RCP_TEST_RUNNING
-        incval = 2;
-
-        // If there is a running test, set the correct values
-        if(d.state == RCP_TEST_RUNNING) {
-            incval = 4;
-            d.runningTest = postTS[2];
-            d.testProgress = postTS[3];
-        }
+RCP_Context* RCP_ctx_getChannelPeer(const RCP_Context* ctx) { return ctx == NULL ? NULL : ctx->channelPeer; }
 
-        rerrno = callbacks->processTestUpdate(d);
-        break;
+// Add or remove a subscription, starting the filter from the opposite if it is not in use yet
+static RCP_Error setSubscription(RCP_Context* ctx, RCP_DeviceClass devclass, int ID, int subscribed) {
+    if(ctx == NULL || ID < RCP_ANY_ID || ID > 0xFF) return RCP_ERR_INIT;
+    if((unsigned) devclass > 0xFF || RCP__devclasses[devclass].decode == NULL) return RCP_ERR_INVALID_DEVCLASS;
+
+    if(ctx->filter == NULL) {
+        ctx->filter = malloc(sizeof(struct RCP__Filter));
+        if(ctx->filter == NULL) return RCP_ERR_MEMALLOC;
+        ctx->filter->filtering = 0;
     }
 
-    case RCP_DEVCLASS_SIMPLE_ACTUATOR: {
-        struct RCP_SimpleActuatorData d = {.timestamp = timestamp,
-                                           .state = postTS[1] ? RCP_SIMPLE_ACTUATOR_ON : RCP_SIMPLE_ACTUATOR_OFF,
-                                           .ID = postTS[0]};
+    struct RCP__Filter* f = ctx->filter;
+    if(!f->filtering) {
+        memset(f->ids, subscribed ? 0x00 : 0xFF, sizeof(f->ids));
+        for(size_t i = 0; i < 256; i++) f->accepted[i] = subscribed ? 0 : 256;
+        f->filtering = 1;
+    }
 
-        incval = 2;
-        rerrno = callbacks->processSimpleActuatorData(d);
-        break;
+    if(ID == RCP_ANY_ID || !(RCP__devclasses[devclass].flags & RCP_DC_IDENTIFIED)) {
+        memset(f->ids[devclass], subscribed ? 0xFF : 0x00, sizeof(f->ids[devclass]));
+        f->accepted[devclass] = subscribed ? 256 : 0;
     }
 
-    case RCP_DEVCLASS_PROMPT: {
-        // Params will only be zero when this function is called when processing amalgamated subunits. If that is the
-        // case and a prompt IU is detected, exit since it is ill-formed
-        if(params == 0) return RCP_ERR_AMALG_SUBUNIT;
+    else {
+        uint8_t* byte = &f->ids[devclass][ID >> 3];
+        uint8_t bit = (uint8_t) (1 << (ID & 7));
+        if(subscribed && !(*byte & bit)) f->accepted[devclass]++;
+        if(!subscribed && (*byte & bit)) f->accepted[devclass]--;
+        *byte = subscribed ? *byte | bit : *byte & ~bit;
+    }
 
-        if(postTS[0] == RCP_PromptDataType_RESET) {
-            struct RCP_PromptInputRequest req = {.type = RCP_PromptDataType_RESET, .prompt = NULL, .length = 0};
-            return callbacks->processPromptInput(req);
-        }
+    f->accepted[RCP_DEVCLASS_AMALGAMATE] = 0;
+    for(size_t i = 0; i < 256; i++)
+        if((RCP__devclasses[i].flags & RCP_DC_AMALGAMABLE) && f->accepted[i] != 0)
+            f->accepted[RCP_DEVCLASS_AMALGAMATE] = 1;
 
-        // It is up to the callback function to appropriately parse out the number of chars
-        struct RCP_PromptInputRequest req = {.type = postTS[0], .prompt = (char*) (postTS + 1), .length = params - 1};
-        activePromptType = req.type;
+    return RCP_ERR_SUCCESS;
+}
 
-        incval = 0;
-        rerrno = callbacks->processPromptInput(req);
-        break;
-    }
+RCP_Error RCP_ctx_subscribe(RCP_Context* ctx, RCP_DeviceClass devclass, int ID) {
+    return setSubscription(ctx, devclass, ID, 1);
+}
 
-    case RCP_DEVCLASS_TARGET_LOG: {
-        // See Prompt IU section
-        if(params == 0) return RCP_ERR_AMALG_SUBUNIT;
+RCP_Error RCP_ctx_unsubscribe(RCP_Context* ctx, RCP_DeviceClass devclass, int ID) {
+    return setSubscription(ctx, devclass, ID, 0);
+}
 
-        struct RCP_TargetLogData d = {.timestamp = timestamp, .data = (char*) postTS, .length = params - 4};
+RCP_Error RCP_ctx_subscribeAll(RCP_Context* ctx) {
+    if(ctx == NULL) return RCP_ERR_INIT;
 
-        incval = 0;
-        rerrno = callbacks->processTargetLog(d);
-        break;
-    }
+    if(ctx->filter != NULL) ctx->filter->filtering = 0;
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_ctx_setPacketTap(RCP_Context* ctx, RCP_PacketTap tap, void* user) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+
+    ctx->tap = tap;
+    ctx->tapUser = user;
+    return RCP_ERR_SUCCESS;
+}
 
-    case RCP_DEVCLASS_ANGLED_ACTUATOR:
-    case RCP_DEVCLASS_MOTOR:
-    case RCP_DEVCLASS_AM_PRESSURE:
-    case RCP_DEVCLASS_TEMPERATURE:
-    case RCP_DEVCLASS_PRESSURE_TRANSDUCER:
-    case RCP_DEVCLASS_RELATIVE_HYGROMETER:
-    case RCP_DEVCLASS_LOAD_CELL:
-    case RCP_DEVCLASS_FLOW_METER: {
-        // All the 1F devices
-        struct RCP_1F d = {.devclass = devclass, .timestamp = timestamp, .ID = postTS[0]};
+RCP_Error RCP_ctx_setResync(RCP_Context* ctx, int enabled) {
+    if(ctx == NULL) return RCP_ERR_INIT;
 
-        memcpy(&d.data, postTS + 1, 4);
+    // The two modes keep a partial packet differently, so it can not carry over
+    ctx->resync = enabled != 0;
+    ctx->feedHave = 0;
+    ctx->feedNeed = 0;
+    ctx->rxStart = 0;
+    return RCP_ERR_SUCCESS;
+}
 
-        incval = 5;
-        rerrno = callbacks->processOneFloat(d);
-        break;
+uint64_t RCP_ctx_getDiscarded(const RCP_Context* ctx) { return ctx == NULL ? 0 : ctx->discarded; }
+
+RCP_Error RCP_ctx_setFraming(RCP_Context* ctx, RCP_Framing framing) {
+    if(ctx == NULL || (unsigned) framing > RCP_FRAMING_COBS_CRC16) return RCP_ERR_INIT;
+
+    // Only links that use framing pay for the frame buffer
+    if(framing != RCP_FRAMING_NONE && ctx->frameBuffer == NULL) {
+        ctx->frameBuffer = malloc(RCP_MAX_RX_FRAME);
+        if(ctx->frameBuffer == NULL) return RCP_ERR_MEMALLOC;
     }
 
-    case RCP_DEVCLASS_BOOL_SENSOR: {
-        struct RCP_BoolData d = {.timestamp = timestamp, .ID = postTS[0], .data = postTS[1]};
+    ctx->framing = framing;
+    ctx->frameHave = 0;
+    ctx->frameHunting = 0;
+    ctx->feedHave = 0;
+    ctx->feedNeed = 0;
+    ctx->rxStart = 0;
+    return RCP_ERR_SUCCESS;
+}
 
-        incval = 2;
-        rerrno = callbacks->processBoolData(d);
-        break;
+// Hand any readings collected for the batch callbacks over, one call per arity. The first error is returned, but every
+// batch is still delivered and emptied.
+STATIC RCP_Error flushBatches(RCP_Context* ctx, uint32_t timestamp) {
+    RCP_Error rerrno = RCP_ERR_SUCCESS;
+    RCP_Error e;
+
+    if(ctx->batch1FLen != 0) {
+        e = ctx->callbacks.processOneFloatBatch(ctx->user, ctx->batch1F, ctx->batch1FLen, timestamp);
+        if(rerrno == RCP_ERR_SUCCESS) rerrno = e;
+        ctx->batch1FLen = 0;
     }
 
-    case RCP_DEVCLASS_STEPPER:
-    case RCP_DEVCLASS_POWERMON: {
-        // All the 2F devices
-        struct RCP_2F d = {.devclass = devclass, .timestamp = timestamp, .ID = postTS[0]};
+    if(ctx->batch2FLen != 0) {
+        e = ctx->callbacks.processTwoFloatBatch(ctx->user, ctx->batch2F, ctx->batch2FLen, timestamp);
+        if(rerrno == RCP_ERR_SUCCESS) rerrno = e;
+        ctx->batch2FLen = 0;
+    }
 
-        memcpy(d.data, postTS + 1, 8);
+    if(ctx->batch3FLen != 0) {
+        e = ctx->callbacks.processThreeFloatBatch(ctx->user, ctx->batch3F, ctx->batch3FLen, timestamp);
+        if(rerrno == RCP_ERR_SUCCESS) rerrno = e;
+        ctx->batch3FLen = 0;
+    }
 
-        incval = 9;
-        rerrno = callbacks->processTwoFloat(d);
-        break;
+    if(ctx->batch4FLen != 0) {
+        e = ctx->callbacks.processFourFloatBatch(ctx->user, ctx->batch4F, ctx->batch4FLen, timestamp);
+        if(rerrno == RCP_ERR_SUCCESS) rerrno = e;
+        ctx->batch4FLen = 0;
     }
 
-    case RCP_DEVCLASS_ACCELEROMETER:
-    case RCP_DEVCLASS_GYROSCOPE:
-    case RCP_DEVCLASS_MAGNETOMETER: {
-        // All the 3F devices
-        struct RCP_3F d = {.devclass = devclass, .timestamp = timestamp, .ID = postTS[0]};
+    return rerrno;
+}
 
-        memcpy(d.data, postTS + 1, 12);
+// Check a reading against the redlines, then keep the latest reading table, the columnar store, device statistics and
+// write latency up to date, where the context has them. Returns an error raised by a tripped redline's action, which
+// the decoders pass back only after the reading has been delivered as usual
+static inline RCP_Error recordReading(RCP_Context* ctx, RCP_DeviceClass devclass, uint32_t timestamp, uint8_t ID,
+                                      const float* data, size_t n) {
+    RCP_Error rerrno = RCP_ERR_SUCCESS;
+    if(ctx->limits != NULL) rerrno = RCP__limitsCheck(ctx, ctx->limits, devclass, timestamp, ID, data, n);
+
+    if(ctx->stats != NULL) RCP__statsSample(ctx->stats, devclass, timestamp, ID);
+    if(ctx->latency != NULL) RCP__latencyResponse(ctx->latency, devclass, ID);
+    if(ctx->latest != NULL) RCP__latestRecord(ctx->latest, devclass, timestamp, ID, data, n);
+    if(ctx->store != NULL) RCP__storeAppend(ctx->store, devclass, timestamp, ID, data, n);
+    return rerrno;
+}
 
-        incval = 13;
-        rerrno = callbacks->processThreeFloat(d);
-        break;
+// Decoders for each kind of IU, called through the device class table below. Each gets the same arguments as
+// processIU, minus inc since the table already knows how long each IU is.
+STATIC RCP_Error decodeTestState(RCP_Context* ctx, RCP_DeviceClass devclass, uint32_t timestamp, size_t params,
+                                 const uint8_t* postTS) {
+    (void) devclass;
+    (void) params;
+
+    struct RCP_TestData d = {.timestamp = timestamp,
+                             .dataStreaming = postTS[0] & RCP_DATA_STREAM_MASK,
+                             .state = postTS[0] & RCP_TEST_STATE_MASK,
+                             .isInited = postTS[0] & RCP_DEVICE_INITED_MASK,
+                             .heartbeatTime = postTS[1],
+                             .runningTest = 0,
+                             .testProgress = 0};
+
+    // If there is a running test, set the correct values
+    if(d.state == RCP_TEST_RUNNING) {
+        d.runningTest = postTS[2];
+        d.testProgress = postTS[3];
     }
 
-    case RCP_DEVCLASS_GPS: {
-        // All the 4F devices
-        struct RCP_4F d = {.devclass = devclass, .timestamp = timestamp, .ID = postTS[0]};
+    return ctx->callbacks.processTestUpdate(ctx->user, d);
+}
+
+STATIC RCP_Error decodeSimpleActuator(RCP_Context* ctx, RCP_DeviceClass devclass, uint32_t timestamp, size_t params,
+                                      const uint8_t* postTS) {
+    (void) devclass;
+    (void) params;
 
-        memcpy(d.data, postTS + 1, 16);
+    struct RCP_SimpleActuatorData d = {.timestamp = timestamp,
+                                       .state = postTS[1] ? RCP_SIMPLE_ACTUATOR_ON : RCP_SIMPLE_ACTUATOR_OFF,
+                                       .ID = postTS[0]};
 
-        incval = 17;
-        rerrno = callbacks->processFourFloat(d);
-        break;
+    float state = postTS[1] ? 1.0f : 0.0f;
+    RCP_Error rerrno = recordReading(ctx, devclass, timestamp, d.ID, &state, 1);
+    RCP_Error e = ctx->callbacks.processSimpleActuatorData(ctx->user, d);
+    return rerrno != RCP_ERR_SUCCESS ? rerrno : e;
+}
+
+STATIC RCP_Error decodePrompt(RCP_Context* ctx, RCP_DeviceClass devclass, uint32_t timestamp, size_t params,
+                              const uint8_t* postTS) {
+    (void) devclass;
+    (void) timestamp;
+
+    if(postTS[0] == RCP_PromptDataType_RESET) {
+        struct RCP_PromptInputRequest req = {.type = RCP_PromptDataType_RESET, .prompt = NULL, .length = 0};
+        return ctx->callbacks.processPromptInput(ctx->user, req);
     }
 
+    // It is up to the callback function to appropriately parse out the number of chars
+    struct RCP_PromptInputRequest req = {.type = postTS[0], .prompt = (char*) (postTS + 1), .length = params - 1};
+    ctx->activePromptType = req.type;
+
+    return ctx->callbacks.processPromptInput(ctx->user, req);
+}
+
+STATIC RCP_Error decodeTargetLog(RCP_Context* ctx, RCP_DeviceClass devclass, uint32_t timestamp, size_t params,
+                                 const uint8_t* postTS) {
+    (void) devclass;
+
+    struct RCP_TargetLogData d = {.timestamp = timestamp, .data = (char*) postTS, .length = params - 4};
+    return ctx->callbacks.processTargetLog(ctx->user, d);
+}
+
+STATIC RCP_Error decodeBool(RCP_Context* ctx, RCP_DeviceClass devclass, uint32_t timestamp, size_t params,
+                            const uint8_t* postTS) {
+    (void) devclass;
+    (void) params;
+
+    struct RCP_BoolData d = {.timestamp = timestamp, .ID = postTS[0], .data = postTS[1]};
+    float state = postTS[1] ? 1.0f : 0.0f;
+    RCP_Error rerrno = recordReading(ctx, devclass, timestamp, d.ID, &state, 1);
+    RCP_Error e = ctx->callbacks.processBoolData(ctx->user, d);
+    return rerrno != RCP_ERR_SUCCESS ? rerrno : e;
+}
+
+// Inside an amalgamation unit with a batch callback set, the reading is built in place in the batch rather than passed
+// on by itself
+STATIC RCP_Error decodeOneFloat(RCP_Context* ctx, RCP_DeviceClass devclass, uint32_t timestamp, size_t params,
+                                const uint8_t* postTS) {
+    (void) params;
+
+    int batched = ctx->inAmalg && ctx->callbacks.processOneFloatBatch != NULL;
+    struct RCP_1F single;
+    struct RCP_1F* d = batched ? &ctx->batch1F[ctx->batch1FLen] : &single;
+
+    d->devclass = devclass;
+    d->timestamp = timestamp;
+    d->ID = postTS[0];
+    memcpy(&d->data, postTS + 1, 4);
+    RCP_Error rerrno = recordReading(ctx, devclass, timestamp, d->ID, &d->data, 1);
+
+    RCP_Error e = RCP_ERR_SUCCESS;
+    if(!batched) e = ctx->callbacks.processOneFloat(ctx->user, single);
+    else if(++ctx->batch1FLen == RCP_MAX_BATCH) e = flushBatches(ctx, timestamp);
+    return rerrno != RCP_ERR_SUCCESS ? rerrno : e;
+}
+
+STATIC RCP_Error decodeTwoFloat(RCP_Context* ctx, RCP_DeviceClass devclass, uint32_t timestamp, size_t params,
+                                const uint8_t* postTS) {
+    (void) params;
+
+    int batched = ctx->inAmalg && ctx->callbacks.processTwoFloatBatch != NULL;
+    struct RCP_2F single;
+    struct RCP_2F* d = batched ? &ctx->batch2F[ctx->batch2FLen] : &single;
+
+    d->devclass = devclass;
+    d->timestamp = timestamp;
+    d->ID = postTS[0];
+    memcpy(d->data, postTS + 1, 8);
+    RCP_Error rerrno = recordReading(ctx, devclass, timestamp, d->ID, d->data, 2);
+
+    RCP_Error e = RCP_ERR_SUCCESS;
+    if(!batched) e = ctx->callbacks.processTwoFloat(ctx->user, single);
+    else if(++ctx->batch2FLen == RCP_MAX_BATCH) e = flushBatches(ctx, timestamp);
+    return rerrno != RCP_ERR_SUCCESS ? rerrno : e;
+}
+
+STATIC RCP_Error decodeThreeFloat(RCP_Context* ctx, RCP_DeviceClass devclass, uint32_t timestamp, size_t params,
+                                  const uint8_t* postTS) {
+    (void) params;
+
+    int batched = ctx->inAmalg && ctx->callbacks.processThreeFloatBatch != NULL;
+    struct RCP_3F single;
+    struct RCP_3F* d = batched ? &ctx->batch3F[ctx->batch3FLen] : &single;
+
+    d->devclass = devclass;
+    d->timestamp = timestamp;
+    d->ID = postTS[0];
+    memcpy(d->data, postTS + 1, 12);
+    RCP_Error rerrno = recordReading(ctx, devclass, timestamp, d->ID, d->data, 3);
+
+    RCP_Error e = RCP_ERR_SUCCESS;
+    if(!batched) e = ctx->callbacks.processThreeFloat(ctx->user, single);
+    else if(++ctx->batch3FLen == RCP_MAX_BATCH) e = flushBatches(ctx, timestamp);
+    return rerrno != RCP_ERR_SUCCESS ? rerrno : e;
+}
+
+STATIC RCP_Error decodeFourFloat(RCP_Context* ctx, RCP_DeviceClass devclass, uint32_t timestamp, size_t params,
+                                 const uint8_t* postTS) {
+    (void) params;
+
+    int batched = ctx->inAmalg && ctx->callbacks.processFourFloatBatch != NULL;
+    struct RCP_4F single;
+    struct RCP_4F* d = batched ? &ctx->batch4F[ctx->batch4FLen] : &single;
+
+    d->devclass = devclass;
+    d->timestamp = timestamp;
+    d->ID = postTS[0];
+    memcpy(d->data, postTS + 1, 16);
+    RCP_Error rerrno = recordReading(ctx, devclass, timestamp, d->ID, d->data, 4);
+
+    RCP_Error e = RCP_ERR_SUCCESS;
+    if(!batched) e = ctx->callbacks.processFourFloat(ctx->user, single);
+    else if(++ctx->batch4FLen == RCP_MAX_BATCH) e = flushBatches(ctx, timestamp);
+    return rerrno != RCP_ERR_SUCCESS ? rerrno : e;
+}
+
+#define TS RCP_DC_TIMESTAMPED
+#define AM RCP_DC_AMALGAMABLE
+#define TR RCP_DC_TAREABLE
+#define QY RCP_DC_QUERYABLE
+#define IDN RCP_DC_IDENTIFIED
+
+// Everything the library knows about each device class. Adding a class to the library only takes a row here (and a
+// decoder, if none of the existing ones fit). Classes without a row are invalid.
+const struct RCP_DevclassInfo RCP__devclasses[256] = {
+    // Size is 2 but grows to 4 while a test is running, see RCP__subunitSize
+    [RCP_DEVCLASS_TEST_STATE] = {decodeTestState, 0, 2, TS | AM | QY},
+    [RCP_DEVCLASS_SIMPLE_ACTUATOR] = {decodeSimpleActuator, 0, 2, TS | AM | QY | IDN},
+    [RCP_DEVCLASS_STEPPER] = {decodeTwoFloat, 2, 9, TS | AM | QY | IDN},
+    [RCP_DEVCLASS_PROMPT] = {decodePrompt, 0, 0, 0},
+    [RCP_DEVCLASS_ANGLED_ACTUATOR] = {decodeOneFloat, 1, 5, TS | AM | QY | IDN},
+    [RCP_DEVCLASS_MOTOR] = {decodeOneFloat, 1, 5, TS | AM | QY | IDN},
+    [RCP_DEVCLASS_TARGET_LOG] = {decodeTargetLog, 0, 0, TS},
+
+    [RCP_DEVCLASS_AM_PRESSURE] = {decodeOneFloat, 1, 5, TS | AM | TR | QY | IDN},
+    [RCP_DEVCLASS_TEMPERATURE] = {decodeOneFloat, 1, 5, TS | AM | TR | QY | IDN},
+    [RCP_DEVCLASS_PRESSURE_TRANSDUCER] = {decodeOneFloat, 1, 5, TS | AM | TR | QY | IDN},
+    [RCP_DEVCLASS_RELATIVE_HYGROMETER] = {decodeOneFloat, 1, 5, TS | AM | TR | QY | IDN},
+    [RCP_DEVCLASS_LOAD_CELL] = {decodeOneFloat, 1, 5, TS | AM | TR | QY | IDN},
+    [RCP_DEVCLASS_BOOL_SENSOR] = {decodeBool, 0, 2, TS | AM | QY | IDN},
+    [RCP_DEVCLASS_FLOW_METER] = {decodeOneFloat, 1, 5, TS | AM | TR | QY | IDN},
+
+    [RCP_DEVCLASS_POWERMON] = {decodeTwoFloat, 2, 9, TS | AM | TR | QY | IDN},
+
+    [RCP_DEVCLASS_ACCELEROMETER] = {decodeThreeFloat, 3, 13, TS | AM | TR | QY | IDN},
+    [RCP_DEVCLASS_GYROSCOPE] = {decodeThreeFloat, 3, 13, TS | AM | TR | QY | IDN},
+    [RCP_DEVCLASS_MAGNETOMETER] = {decodeThreeFloat, 3, 13, TS | AM | TR | QY | IDN},
+
+    [RCP_DEVCLASS_GPS] = {decodeFourFloat, 4, 17, TS | AM | TR | QY | IDN},
+
+    // Handled by the caller of processIU, so there is no decoder
+    [RCP_DEVCLASS_AMALGAMATE] = {NULL, 0, 0, TS},
+};
+
+#undef TS
+#undef AM
+#undef TR
+#undef QY
+#undef IDN
+
+// Whether ctx wants packets of devclass at all, going by the class byte alone
+static int classWanted(const RCP_Context* ctx, RCP_DeviceClass devclass) {
+    return ctx->filter == NULL || !ctx->filter->filtering || ctx->filter->accepted[(uint8_t) devclass] != 0;
+}
+
+// Whether ctx wants an IU of devclass, whose parameters after the timestamp start at postTS
+static int unitWanted(const RCP_Context* ctx, RCP_DeviceClass devclass, const uint8_t* postTS) {
+    if(ctx->filter == NULL || !ctx->filter->filtering) return 1;
+    if(!(RCP__devclasses[(uint8_t) devclass].flags & RCP_DC_IDENTIFIED)) return classWanted(ctx, devclass);
+    return (ctx->filter->ids[(uint8_t) devclass][postTS[0] >> 3] >> (postTS[0] & 7)) & 1;
+}
+
+// The context that decodes packets starting with header on ctx's link, which is ctx or its channel peer, or NULL if
+// neither listens to that channel
+static RCP_Context* receiver(RCP_Context* ctx, uint8_t header) {
+    if((header & RCP_CHANNEL_MASK) == ctx->channel) return ctx;
+    if(ctx->channelPeer != NULL && (header & RCP_CHANNEL_MASK) == ctx->channelPeer->channel) return ctx->channelPeer;
+    return NULL;
+}
+
+// Helper for processing an individual information unit. The parameters are a little funky since this also is used to
+// process IUs in an amalgamated IU.
+// - devclasss: The device class for this IU
+// - timestamp: The extracted timestamp from the packet, if relevant. If the timestamp is not used due to the devclass,
+//   the value does not matter as it will be ignored
+// - params: The number of parameter bytes. Should be set to zero when called from an amalgamated packet to prevent
+//   invalid amalgamate subunits
+// - postTS: A pointer to the buffer location at the start of the parameter bytes for this IU, but after the timestamp,
+//   if there is one
+// - inc: A pointer to a size_t that indicates how many parameter bytes were parsed, so that when processing an
+//   amalgamated IU, the caller knows how many bytes to move forward
+STATIC RCP_Error processIU(RCP_Context* ctx, RCP_DeviceClass devclass, uint32_t timestamp, size_t params,
+                           const uint8_t* postTS, size_t* inc) {
+    const struct RCP_DevclassInfo* info = &RCP__devclasses[(uint8_t) devclass];
+
     // This function does not process amalgamate IUs. That is up to the caller of this function
-    case RCP_DEVCLASS_AMALGAMATE:
-        return RCP_ERR_AMALG_NESTING;
+    if(devclass == RCP_DEVCLASS_AMALGAMATE) return RCP_ERR_AMALG_NESTING;
+    if(info->decode == NULL || (unsigned) devclass > 0xFF) return RCP_ERR_INVALID_DEVCLASS;
 
-    default:
-        return RCP_ERR_INVALID_DEVCLASS;
-    }
+    // Params will only be zero when this function is called when processing amalgamated subunits. If that is the case
+    // and an IU that cannot be amalgamated is detected, exit since it is ill-formed
+    if(params == 0 && !(info->flags & RCP_DC_AMALGAMABLE)) return RCP_ERR_AMALG_SUBUNIT;
 
     // Only assign to inc if it is non-null
-    if(inc != NULL) *inc = incval;
-    return rerrno;
+    if(inc != NULL) *inc = RCP__subunitSize(devclass, postTS);
+    if(!unitWanted(ctx, devclass, postTS)) return RCP_ERR_SUCCESS;
+    if(ctx->stats != NULL) RCP__statsUnit(ctx->stats, devclass);
+    return info->decode(ctx, devclass, timestamp, params, postTS);
 }
 
-RCP_Error RCP_poll(void) {
-    // Check init
-    if(callbacks == NULL) return RCP_ERR_INIT;
+// Returns the total length of the packet starting at pkt (header, class byte and parameters), or 0 if the avail bytes
+// received so far are not enough to know the length. Compact packets need only the header byte, extended packets need
+// the header and both length bytes.
+STATIC size_t packetLength(const uint8_t* pkt, size_t avail) {
+    if(avail < 1) return 0;
 
-    // Read first byte of packet to determine format
-    size_t bread = callbacks->readData(buffer, 1);
-    if(bread != 1) return RCP_ERR_IO_RCV;
+    if(!(pkt[0] & RCP_EXTENDED_MASK)) {
+        size_t params = pkt[0] & RCP_COMPACT_LENGTH_MASK;
 
-    // Total parameter bytes (including timestamp)
-    uint16_t params = 0;
+        // Zero length compact packets are only the header byte
+        return params == 0 ? 1 : params + 2;
+    }
 
-    // Length of header
-    uint8_t preambleLen = 1;
+    if(avail < 3) return 0;
+    return (((size_t) pkt[1] << 8) | pkt[2]) + 5;
+}
 
-    // Pointer to current location in buffer. Used for amalgamate IUs
-    uint8_t* head = NULL;
+// Check of the candidate packet starting at pkt against the class table, of which have bytes have arrived. Resync mode
+// uses it to find packet boundaries, and decodePacket to turn away malformed packets. Returns 0 if the bytes so far
+// rule it out, and otherwise how many bytes are needed to check it further. Once that is no more than have, the whole
+// packet has arrived and passed every check. Bytes past the returned count are never looked at.
+STATIC size_t plausibleLength(const uint8_t* pkt, size_t have) {
+    if(have < 1) return 1;
 
-    // If extended format...
-    if(buffer[0] & RCP_EXTENDED_MASK) {
-        preambleLen = 3;
+    size_t preambleLen = pkt[0] & RCP_EXTENDED_MASK ? 3 : 1;
+    if(have < preambleLen) return preambleLen;
 
-        // Read length bytes
-        bread = callbacks->readData(buffer + 1, 2);
-        if(bread != 2) return RCP_ERR_IO_RCV;
+    // Zero length compact packets are only the header byte, and are always fine
+    size_t len = packetLength(pkt, have);
+    if(len == 1) return 1;
+    if(have < preambleLen + 1) return preambleLen + 1;
 
-        // Assign length
-        params = buffer[1] << 8;
-        params |= buffer[2];
-        params++;
+    RCP_DeviceClass devclass = pkt[preambleLen];
+    const struct RCP_DevclassInfo* info = &RCP__devclasses[devclass];
+    if(info->decode == NULL && devclass != RCP_DEVCLASS_AMALGAMATE) return 0;
 
-        // Read rest of the bytes
-        bread = callbacks->readData(buffer + 3, params + 1);
-        if(bread != (size_t) (params + 1)) return RCP_ERR_IO_RCV;
+    size_t params = len - preambleLen - 1;
+    size_t tsLen = info->flags & RCP_DC_TIMESTAMPED ? 4 : 0;
+    size_t postTS = preambleLen + 1 + tsLen;
+    if(params < tsLen) return 0;
 
-        // Exit early if wrong channel
-        if((buffer[0] & RCP_CHANNEL_MASK) != channel) return RCP_ERR_SUCCESS;
+    switch(devclass) {
+    case RCP_DEVCLASS_TEST_STATE:
+        // Either size is possible until the state byte says which
+        if(params != tsLen + 2 && params != tsLen + 4) return 0;
+        if(have < postTS + 1) return postTS + 1;
+        if(params != tsLen + RCP__subunitSize(devclass, pkt + postTS)) return 0;
+        break;
+
+    case RCP_DEVCLASS_PROMPT:
+        if(params < 1) return 0;
+        if(have < postTS + 1) return postTS + 1;
+        if(pkt[postTS] != RCP_PromptDataType_GONOGO && pkt[postTS] != RCP_PromptDataType_Float &&
+           pkt[postTS] != RCP_PromptDataType_RESET)
+            return 0;
+        break;
+
+    case RCP_DEVCLASS_TARGET_LOG:
+        break;
+
+    case RCP_DEVCLASS_AMALGAMATE: {
+        // Walk the subunits as far as they have arrived. They have to fill the packet exactly
+        size_t pos = postTS;
+        while(pos < len) {
+            if(have < pos + 1) return pos + 1;
+
+            RCP_DeviceClass sub = pkt[pos];
+            const struct RCP_DevclassInfo* subInfo = &RCP__devclasses[sub];
+            if(subInfo->decode == NULL || !(subInfo->flags & RCP_DC_AMALGAMABLE)) return 0;
+            if(pos + 1 + subInfo->size > len) return 0;
+
+            if(sub == RCP_DEVCLASS_TEST_STATE && have < pos + 2) return pos + 2;
+            pos += 1 + RCP__subunitSize(sub, pkt + pos + 1);
+        }
 
-        // Set head to correct location
-        head = buffer + 3;
+        if(pos != len) return 0;
+        break;
+    }
+
+    default:
+        if(params != tsLen + info->size) return 0;
+    }
+
+    return len;
+}
+
+// Decode a complete packet received on ctx's link, starting at the header byte
+static RCP_Error decodePacket(RCP_Context* ctx, const uint8_t* pkt) {
+    // Total parameter bytes (including timestamp)
+    size_t params = 0;
+
+    // Length of header
+    size_t preambleLen = 1;
+
+    // If extended format...
+    if(pkt[0] & RCP_EXTENDED_MASK) {
+        preambleLen = 3;
+        params = (((size_t) pkt[1] << 8) | pkt[2]) + 1;
     }
 
     // If compact...
     else {
-        // Determine parameter bytes
-        params = buffer[0] & RCP_COMPACT_LENGTH_MASK;
+        params = pkt[0] & RCP_COMPACT_LENGTH_MASK;
 
         // Do nothing on zero length packets
         if(params == 0) return RCP_ERR_SUCCESS;
+    }
 
-        // Read rest of the bytes
-        bread = callbacks->readData(buffer + 1, params + 1);
-        if(bread != (size_t) (params + 1)) return RCP_ERR_IO_RCV;
-
-        // Exit early if wrong channel
-        if((buffer[0] & RCP_CHANNEL_MASK) != channel) return RCP_ERR_SUCCESS;
-
-        // Set head to correct location
-        head = buffer + 1;
+    // Packets on the other channel go to the peer if there is one listening on it, and are dropped otherwise. Only
+    // decoding moves over, the packet was received and counted here
+    RCP_Context* link = ctx;
+    ctx = receiver(ctx, pkt[0]);
+    if(ctx == NULL) {
+        if(link->stats != NULL) RCP__statsDropped(link->stats, 1);
+        return RCP_ERR_SUCCESS;
     }
 
+    // Pointer to current location in packet. Used for amalgamate IUs
+    const uint8_t* head = pkt + preambleLen;
+    const uint8_t* end = head + params + 1;
+
     // Extract the device classs
     RCP_DeviceClass devclass = *head;
     head++;
+    if(!classWanted(ctx, devclass)) {
+        if(link->stats != NULL) RCP__statsDropped(link->stats, 0);
+        return RCP_ERR_SUCCESS;
+    }
 
-    // Extract the timestamp. If the packet doesn't have a timestamp (at the time, only the prompt class), do not assign timestamp and don't increment head
+    if(ctx->stats != NULL) RCP__statsClass(ctx->stats, devclass, preambleLen + params + 1);
+
+    // Packets are decoded where they were received, so nothing past the class byte is read until the class table says
+    // the packet is long enough. Amalgamation units are checked a subunit at a time below
+    if(devclass == RCP_DEVCLASS_AMALGAMATE) {
+        if(params < 4) return RCP_ERR_MALFORMED_PACKET;
+    }
+
+    else if(RCP__devclasses[devclass].decode == NULL) return RCP_ERR_INVALID_DEVCLASS;
+    else if(plausibleLength(pkt, preambleLen + params + 1) != preambleLen + params + 1) return RCP_ERR_MALFORMED_PACKET;
+
+    // Extract the timestamp. If the packet doesn't have a timestamp (at the time, only the prompt class), do not assign
+    // timestamp and don't increment head
     uint32_t timestamp = 0;
-    if(devclass != RCP_DEVCLASS_PROMPT) {
+    if(RCP__devclasses[devclass].flags & RCP_DC_TIMESTAMPED) {
         timestamp = (head[0] << 24) | (head[1] << 16) | head[2] << 8 | head[3];
         head += 4;
     }
 
     // If not an amalgamate IU, process the IU directly
-    if(devclass != RCP_DEVCLASS_AMALGAMATE) return processIU(devclass, timestamp, params, head, NULL);
+    if(devclass != RCP_DEVCLASS_AMALGAMATE) return processIU(ctx, devclass, timestamp, params, head, NULL);
+
+    // Otherwise, continue looping over subunits until we've gone through all of them. Readings bound for batch
+    // callbacks are delivered once the unit is done, or when it fails on a bad subunit
+    RCP_Error rerrno = RCP_ERR_SUCCESS;
+    ctx->inAmalg = 1;
 
-    // Otherwise, continue looping over subunits until we've gone through all of them
-    while(head < buffer + preambleLen + params + 1) {
+    while(head < end) {
         size_t inc = 0;
         devclass = head[0];
         head++;
 
-        RCP_Error rerrno = processIU(devclass, timestamp, 0, head, &inc);
-        if(rerrno != RCP_ERR_SUCCESS) return rerrno;
+        // A subunit cut off by the end of the packet is malformed. Classes that processIU turns away are left to it
+        const struct RCP_DevclassInfo* info = &RCP__devclasses[devclass];
+        size_t left = (size_t) (end - head);
+        if((info->flags & RCP_DC_AMALGAMABLE) && (left < info->size || left < RCP__subunitSize(devclass, head))) {
+            rerrno = RCP_ERR_MALFORMED_PACKET;
+            break;
+        }
+
+        // A subunit that failed once its size was known still leaves the rest of the unit to decode, and the first
+        // error is returned once it is done. One that could not be read at all ends the unit
+        RCP_Error e = processIU(ctx, devclass, timestamp, 0, head, &inc);
+        if(rerrno == RCP_ERR_SUCCESS) rerrno = e;
+        if(inc == 0) break;
         head += inc;
     }
 
+    ctx->inAmalg = 0;
+    RCP_Error ferr = flushBatches(ctx, timestamp);
+    return rerrno != RCP_ERR_SUCCESS ? rerrno : ferr;
+}
+
+// Process a complete packet, starting at the header byte. Used by both RCP_ctx_poll, which assembles the packet in the
+// library buffer, and RCP_ctx_feed, which may dispatch packets directly out of the caller's memory.
+STATIC RCP_Error dispatchPacket(RCP_Context* ctx, const uint8_t* pkt) {
+    ctx->received++;
+
+    // The tap sees every packet as received, before anything else looks at it
+    if(ctx->tap != NULL) ctx->tap(ctx->tapUser, pkt, packetLength(pkt, 3));
+    if(ctx->stats == NULL) return decodePacket(ctx, pkt);
+
+    RCP__statsPacket(ctx->stats, pkt[0], packetLength(pkt, 3));
+    RCP_Error rerrno = decodePacket(ctx, pkt);
+    if(rerrno != RCP_ERR_SUCCESS) RCP__statsError(ctx->stats, rerrno);
+    return rerrno;
+}
+
+// Hand everything queued in the transmit batch to sendData in one call, then start timing the writes in it. The queue
+// is emptied even if the send fails
+STATIC RCP_Error flushTx(RCP_Context* ctx) {
+    if(ctx->txLen == 0) return RCP_ERR_SUCCESS;
+
+    size_t len = ctx->txLen;
+    size_t writes = ctx->txWriteLen;
+    ctx->txLen = 0;
+    ctx->txWriteLen = 0;
+    if(ctx->sendBytes(ctx->ioUser, ctx->txQueue, len) != len) return RCP_ERR_IO_SEND;
+
+    for(size_t i = 0; i < writes; i++)
+        RCP__latencyWrite(ctx->latency, (RCP_DeviceClass) (ctx->txWrites[i] >> 8), (uint8_t) ctx->txWrites[i]);
+
+    return RCP_ERR_SUCCESS;
+}
+
+// Flush the transmit batch if its oldest packet has been waiting longer than the deadline
+STATIC RCP_Error flushIfDue(RCP_Context* ctx) {
+    if(ctx->txLen == 0 || ctx->txDeadlineUs == 0) return RCP_ERR_SUCCESS;
+    if(RCP__monotonicUs() - ctx->txFirstUs < ctx->txDeadlineUs) return RCP_ERR_SUCCESS;
+    return flushTx(ctx);
+}
+
+// Frame the packet of len bytes in ctx->txBuffer into ctx->txFrame, returning the length of the frame
+STATIC size_t frameTx(RCP_Context* ctx, size_t len) {
+    uint8_t raw[RCP_MAX_TX_PACKET + 2];
+    memcpy(raw, ctx->txBuffer, len);
+
+    if(ctx->framing == RCP_FRAMING_COBS_CRC16) {
+        uint16_t crc = RCP_crc16(raw, len);
+        raw[len++] = (uint8_t) (crc >> 8);
+        raw[len++] = (uint8_t) crc;
+    }
+
+    size_t framed = RCP_cobs_encode(raw, len, ctx->txFrame);
+    ctx->txFrame[framed++] = 0;
+    return framed;
+}
+
+// Send the packet of len bytes at the start of ctx->txBuffer, framed if framing is on. Outside a batch it goes straight
+// to sendData, otherwise it is appended to the batch, which is flushed first if the packet would not fit and afterwards
+// if a threshold is hit
+STATIC RCP_Error sendPacket(RCP_Context* ctx, size_t len) {
+    const uint8_t* out = ctx->txBuffer;
+    if(ctx->framing != RCP_FRAMING_NONE) {
+        len = frameTx(ctx, len);
+        out = ctx->txFrame;
+    }
+
+    if(!ctx->txBatching) return ctx->sendBytes(ctx->ioUser, out, len) == len ? RCP_ERR_SUCCESS : RCP_ERR_IO_SEND;
+
+    RCP_Error rerrno = RCP_ERR_SUCCESS;
+    if(ctx->txLen + len > RCP_MAX_TX_BATCH) rerrno = flushTx(ctx);
+
+    if(ctx->txLen == 0) ctx->txFirstUs = RCP__monotonicUs();
+    memcpy(ctx->txQueue + ctx->txLen, out, len);
+    ctx->txLen += len;
+
+    RCP_Error e = ctx->txFlushSize != 0 && ctx->txLen >= ctx->txFlushSize ? flushTx(ctx) : flushIfDue(ctx);
+
+    return rerrno != RCP_ERR_SUCCESS ? rerrno : e;
+}
+
+RCP_Error RCP_ctx_beginBatch(RCP_Context* ctx, size_t flushSize, uint32_t deadlineUs) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+
+    ctx->txBatching = 1;
+    ctx->txFlushSize = flushSize;
+    ctx->txDeadlineUs = deadlineUs;
+    return RCP_ERR_SUCCESS;
+}
+
+// Send whatever is queued and go back to sending each packet as it is made
+RCP_Error RCP_ctx_flush(RCP_Context* ctx) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+
+    ctx->txBatching = 0;
+    return flushTx(ctx);
+}
+
+// Drop the next n received bytes, through skipBytes if the link has it, and otherwise by reading them into rxBuffer
+STATIC RCP_Error skipRx(RCP_Context* ctx, size_t n) {
+    if(ctx->skipBytes != NULL) return ctx->skipBytes(ctx->ioUser, n) == n ? RCP_ERR_SUCCESS : RCP_ERR_IO_RCV;
+
+    while(n > 0) {
+        size_t take = n < RCP_MAX_RX_BYTES ? n : RCP_MAX_RX_BYTES;
+        if(ctx->readBytes(ctx->ioUser, ctx->rxBuffer, take) != take) return RCP_ERR_IO_RCV;
+        n -= take;
+    }
+
     return RCP_ERR_SUCCESS;
 }
 
-RCP_Error RCP_sendEStop(void) {
-    if(callbacks == NULL) return RCP_ERR_INIT;
-    buffer[0] = channel | 0x00;
-    return callbacks->sendData(buffer, 1) == 1 ? RCP_ERR_SUCCESS : RCP_ERR_IO_SEND;
+// Count n received bytes dropped while looking for a packet
+static void discard(RCP_Context* ctx, size_t n) {
+    ctx->discarded += n;
+    if(ctx->stats != NULL) RCP__statsDiscarded(ctx->stats, n);
+}
+
+RCP_Error RCP__dispatchWhole(RCP_Context* ctx, const uint8_t* pkt, size_t length) {
+    if(packetLength(pkt, length) == length) return dispatchPacket(ctx, pkt);
+
+    discard(ctx, length);
+    if(ctx->stats != NULL) RCP__statsError(ctx->stats, RCP_ERR_MALFORMED_PACKET);
+    return RCP_ERR_MALFORMED_PACKET;
+}
+
+// Resync mode helpers. The candidate packet is held in rxBuffer from rxStart, so skipping a byte does not move the rest
+
+// Give up on the candidate packet, and try again from its next byte
+static void skipByte(RCP_Context* ctx) {
+    ctx->rxStart++;
+    ctx->feedHave--;
+    discard(ctx, 1);
+    if(ctx->feedHave == 0) ctx->rxStart = 0;
+}
+
+// Process the candidate packet, which has arrived in full and is len bytes long
+static RCP_Error takeCandidate(RCP_Context* ctx, size_t len) {
+    RCP_Error rerrno = dispatchPacket(ctx, ctx->rxBuffer + ctx->rxStart);
+    ctx->rxStart += len;
+    ctx->feedHave -= len;
+    if(ctx->feedHave == 0) ctx->rxStart = 0;
+    return rerrno;
+}
+
+// Move the candidate to the start of rxBuffer if need bytes of it would not fit where it is
+static void makeRoom(RCP_Context* ctx, size_t need) {
+    if(ctx->rxStart + need <= RCP_MAX_RX_BYTES) return;
+
+    memmove(ctx->rxBuffer, ctx->rxBuffer + ctx->rxStart, ctx->feedHave);
+    ctx->rxStart = 0;
+}
+
+// RCP_ctx_poll in resync mode. Reads only as many bytes as the next check needs, and keeps what it has read when a
+// read comes up short, so that the next call carries on where this one stopped
+STATIC RCP_Error pollResync(RCP_Context* ctx) {
+    for(;;) {
+        size_t need = plausibleLength(ctx->rxBuffer + ctx->rxStart, ctx->feedHave);
+        if(need == 0) {
+            skipByte(ctx);
+            continue;
+        }
+
+        if(need <= ctx->feedHave) return takeCandidate(ctx, need);
+
+        makeRoom(ctx, need);
+        size_t want = need - ctx->feedHave;
+        size_t bread = ctx->readBytes(ctx->ioUser, ctx->rxBuffer + ctx->rxStart + ctx->feedHave, want);
+        if(bread > want) bread = want;
+        ctx->feedHave += bread;
+        if(bread != want) return RCP_ERR_IO_RCV;
+    }
+}
+
+// RCP_ctx_feed in resync mode. Like the normal path, packets wholly inside the chunk are checked and dispatched in
+// place, and only a packet split across calls is copied
+STATIC RCP_Error feedResync(RCP_Context* ctx, const uint8_t* bytes, size_t n) {
+    RCP_Error first = RCP_ERR_SUCCESS;
+
+    for(;;) {
+        // Bytes kept from earlier calls are worked through first, taking in only as much input as the checks need
+        if(ctx->feedHave != 0) {
+            size_t need = plausibleLength(ctx->rxBuffer + ctx->rxStart, ctx->feedHave);
+            if(need == 0) skipByte(ctx);
+
+            else if(need <= ctx->feedHave) {
+                RCP_Error rerrno = takeCandidate(ctx, need);
+                if(first == RCP_ERR_SUCCESS) first = rerrno;
+            }
+
+            else if(n == 0) break;
+
+            else {
+                size_t take = need - ctx->feedHave;
+                if(take > n) take = n;
+
+                makeRoom(ctx, need);
+                memcpy(ctx->rxBuffer + ctx->rxStart + ctx->feedHave, bytes, take);
+                ctx->feedHave += take;
+                bytes += take;
+                n -= take;
+            }
+
+            continue;
+        }
+
+        if(n == 0) break;
+
+        size_t need = plausibleLength(bytes, n);
+        if(need == 0) {
+            discard(ctx, 1);
+            bytes++;
+            n--;
+        }
+
+        else if(need <= n) {
+            RCP_Error rerrno = dispatchPacket(ctx, bytes);
+            if(first == RCP_ERR_SUCCESS) first = rerrno;
+            bytes += need;
+            n -= need;
+        }
+
+        // The rest of the chunk is the start of a packet. It is less than a packet, so it fits
+        else {
+            memcpy(ctx->rxBuffer, bytes, n);
+            ctx->rxStart = 0;
+            ctx->feedHave = n;
+            n = 0;
+        }
+    }
+
+    return first;
+}
+
+// Framing helpers. A frame that arrives whole in one chunk is decoded straight out of the caller's memory, and only one
+// split across calls is collected in frameBuffer first
+
+// Decode the n encoded bytes of a frame, without its delimiter, and process the packet in it
+STATIC RCP_Error processFrame(RCP_Context* ctx, const uint8_t* frame, size_t n) {
+    // Back to back delimiters are allowed, and carry nothing
+    if(n == 0) return RCP_ERR_SUCCESS;
+
+    size_t crcLen = ctx->framing == RCP_FRAMING_COBS_CRC16 ? 2 : 0;
+    size_t len = 0;
+    if(n > RCP_MAX_RX_FRAME || RCP_cobs_decode(frame, n, ctx->frameBuffer, &len) != RCP_ERR_SUCCESS || len <= crcLen)
+        goto bad;
+
+    const uint8_t* pkt = ctx->frameBuffer;
+    len -= crcLen;
+    if(crcLen != 0 && RCP_crc16(pkt, len) != (((uint16_t) pkt[len] << 8) | pkt[len + 1])) goto bad;
+    if(packetLength(pkt, len) != len) goto bad;
+
+    return dispatchPacket(ctx, pkt);
+
+bad:
+    discard(ctx, n + 1);
+    if(ctx->stats != NULL) RCP__statsError(ctx->stats, RCP_ERR_BAD_FRAME);
+    return RCP_ERR_BAD_FRAME;
+}
+
+// Keep n encoded bytes of a frame that has not ended yet. A frame too long to be valid is dropped, along with the rest
+// of it up to its delimiter
+static void keepFrameBytes(RCP_Context* ctx, const uint8_t* bytes, size_t n) {
+    if(!ctx->frameHunting && ctx->frameHave + n <= RCP_MAX_RX_FRAME) {
+        memcpy(ctx->frameBuffer + ctx->frameHave, bytes, n);
+        ctx->frameHave += n;
+        return;
+    }
+
+    discard(ctx, ctx->frameHave + n);
+    ctx->frameHave = 0;
+    ctx->frameHunting = 1;
+}
+
+// A delimiter arrived, after the last n encoded bytes of the frame
+static RCP_Error endFrame(RCP_Context* ctx, const uint8_t* bytes, size_t n) {
+    if(ctx->frameHave == 0 && !ctx->frameHunting) return processFrame(ctx, bytes, n);
+
+    keepFrameBytes(ctx, bytes, n);
+    if(ctx->frameHunting) {
+        ctx->frameHunting = 0;
+        discard(ctx, 1);
+        if(ctx->stats != NULL) RCP__statsError(ctx->stats, RCP_ERR_BAD_FRAME);
+        return RCP_ERR_BAD_FRAME;
+    }
+
+    // Decoding in place is fine, the decoded bytes never overtake the encoded ones
+    size_t have = ctx->frameHave;
+    ctx->frameHave = 0;
+    return processFrame(ctx, ctx->frameBuffer, have);
+}
+
+// RCP_ctx_poll with framing. Frames do not say how long they are, so they are read a byte at a time up to the delimiter
+STATIC RCP_Error pollFramed(RCP_Context* ctx) {
+    for(;;) {
+        uint8_t byte;
+        if(ctx->readBytes(ctx->ioUser, &byte, 1) != 1) return RCP_ERR_IO_RCV;
+
+        if(byte != 0) keepFrameBytes(ctx, &byte, 1);
+
+        // Empty frames are skipped rather than counted as the packet this call reads
+        else if(ctx->frameHave != 0 || ctx->frameHunting) return endFrame(ctx, &byte, 0);
+    }
+}
+
+// RCP_ctx_feed with framing
+STATIC RCP_Error feedFramed(RCP_Context* ctx, const uint8_t* bytes, size_t n) {
+    RCP_Error first = RCP_ERR_SUCCESS;
+
+    while(n > 0) {
+        size_t end = RCP_cobs_findDelimiter(bytes, n);
+        if(end == n) {
+            keepFrameBytes(ctx, bytes, n);
+            break;
+        }
+
+        RCP_Error rerrno = endFrame(ctx, bytes, end);
+        if(first == RCP_ERR_SUCCESS) first = rerrno;
+        bytes += end + 1;
+        n -= end + 1;
+    }
+
+    return first;
+}
+
+RCP_Error RCP_ctx_poll(RCP_Context* ctx) {
+    // Check init
+    if(ctx == NULL) return RCP_ERR_INIT;
+
+    RCP_Error txerr = flushIfDue(ctx);
+    if(txerr != RCP_ERR_SUCCESS) return txerr;
+    if(ctx->framing != RCP_FRAMING_NONE) return pollFramed(ctx);
+    if(ctx->resync) return pollResync(ctx);
+
+    // Read first byte of packet to determine format
+    size_t bread = ctx->readBytes(ctx->ioUser, ctx->rxBuffer, 1);
+    if(bread != 1) return RCP_ERR_IO_RCV;
+
+    // If extended format, read length bytes
+    if(ctx->rxBuffer[0] & RCP_EXTENDED_MASK) {
+        bread = ctx->readBytes(ctx->ioUser, ctx->rxBuffer + 1, 2);
+        if(bread != 2) return RCP_ERR_IO_RCV;
+    }
+
+    // The header is 1 or 3 bytes depending on format
+    size_t len = packetLength(ctx->rxBuffer, 3);
+    size_t have = ctx->rxBuffer[0] & RCP_EXTENDED_MASK ? 3 : 1;
+
+    // A packet that nothing will decode is skipped rather than read in, unless the tap wants to see it. The class
+    // byte is read on its own only when there is a filter to check it against
+    if(len > have && ctx->tap == NULL) {
+        const RCP_Context* to = receiver(ctx, ctx->rxBuffer[0]);
+        if(to != NULL && to->filter != NULL && to->filter->filtering) {
+            if(ctx->readBytes(ctx->ioUser, ctx->rxBuffer + have, 1) != 1) return RCP_ERR_IO_RCV;
+            if(!classWanted(to, ctx->rxBuffer[have])) to = NULL;
+            have++;
+        }
+
+        if(to == NULL) {
+            ctx->received++;
+            if(ctx->stats != NULL) {
+                RCP__statsPacket(ctx->stats, ctx->rxBuffer[0], len);
+                RCP__statsDropped(ctx->stats, receiver(ctx, ctx->rxBuffer[0]) == NULL);
+                RCP__statsSkipped(ctx->stats, len - have);
+            }
+
+            return skipRx(ctx, len - have);
+        }
+    }
+
+    // Read rest of the bytes, if any
+    if(len > have) {
+        bread = ctx->readBytes(ctx->ioUser, ctx->rxBuffer + have, len - have);
+        if(bread != len - have) return RCP_ERR_IO_RCV;
+    }
+
+    return dispatchPacket(ctx, ctx->rxBuffer);
+}
+
+// Push mode counterpart to RCP_ctx_poll. Whole packets contained in the chunk are dispatched in place without copying.
+// A packet that is split across calls is assembled in the receive buffer until the rest of it arrives. Every byte is
+// consumed even if a packet fails to process; the first error encountered is returned.
+RCP_Error RCP_ctx_feed(RCP_Context* ctx, const uint8_t* bytes, size_t n) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+
+    RCP_Error first = flushIfDue(ctx);
+    if(ctx->framing != RCP_FRAMING_NONE || ctx->resync) {
+        RCP_Error rerrno = ctx->framing != RCP_FRAMING_NONE ? feedFramed(ctx, bytes, n) : feedResync(ctx, bytes, n);
+        return first != RCP_ERR_SUCCESS ? first : rerrno;
+    }
+
+    while(n > 0) {
+        // Fast path: nothing partial is pending, so if the next packet is entirely in the chunk process it directly
+        if(ctx->feedHave == 0) {
+            size_t len = packetLength(bytes, n);
+            if(len != 0 && len <= n) {
+                RCP_Error rerrno = dispatchPacket(ctx, bytes);
+                if(first == RCP_ERR_SUCCESS) first = rerrno;
+                bytes += len;
+                n -= len;
+                continue;
+            }
+        }
+
+        // Slow path: the header is copied a byte at a time until the length is known, then the rest in one go
+        if(ctx->feedNeed == 0) {
+            ctx->rxBuffer[ctx->feedHave++] = *bytes++;
+            n--;
+            ctx->feedNeed = packetLength(ctx->rxBuffer, ctx->feedHave);
+        }
+
+        else {
+            size_t take = ctx->feedNeed - ctx->feedHave;
+            if(take > n) take = n;
+
+            memcpy(ctx->rxBuffer + ctx->feedHave, bytes, take);
+            ctx->feedHave += take;
+            bytes += take;
+            n -= take;
+        }
+
+        if(ctx->feedNeed != 0 && ctx->feedHave == ctx->feedNeed) {
+            ctx->feedHave = 0;
+            ctx->feedNeed = 0;
+
+            RCP_Error rerrno = dispatchPacket(ctx, ctx->rxBuffer);
+            if(first == RCP_ERR_SUCCESS) first = rerrno;
+        }
+    }
+
+    return first;
+}
+
+RCP_Error RCP_ctx_sendEStop(RCP_Context* ctx) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+    ctx->txBuffer[0] = ctx->channel | 0x00;
+
+    // Never left waiting in a batch. It is queued behind anything already there so the order on the link is kept
+    RCP_Error rerrno = sendPacket(ctx, 1);
+    RCP_Error ferr = flushTx(ctx);
+    return rerrno != RCP_ERR_SUCCESS ? rerrno : ferr;
 }
 
 // Most of the testing command packets follow the same format, so they have been moved to a common function
-STATIC RCP_Error RCP__sendTestUpdate(RCP_TestStateControlMode mode, uint8_t param) {
-    if(callbacks == NULL) return RCP_ERR_INIT;
+STATIC RCP_Error RCP__sendTestUpdate(RCP_Context* ctx, RCP_TestStateControlMode mode, uint8_t param) {
+    if(ctx == NULL) return RCP_ERR_INIT;
     uint8_t len = 3;
 
     if(mode == RCP_TEST_START || mode == RCP_HEARTBEATS_CONTROL) {
         len = 4;
-        buffer[0] = channel | 0x02;
-        buffer[1] = RCP_DEVCLASS_TEST_STATE;
-        buffer[2] = mode;
-        buffer[3] = param;
+        ctx->txBuffer[0] = ctx->channel | 0x02;
+        ctx->txBuffer[1] = RCP_DEVCLASS_TEST_STATE;
+        ctx->txBuffer[2] = mode;
+        ctx->txBuffer[3] = param;
     }
 
     else {
-        buffer[0] = channel | 0x01;
-        buffer[1] = RCP_DEVCLASS_TEST_STATE;
-        buffer[2] = mode;
+        ctx->txBuffer[0] = ctx->channel | 0x01;
+        ctx->txBuffer[1] = RCP_DEVCLASS_TEST_STATE;
+        ctx->txBuffer[2] = mode;
     }
 
-    return callbacks->sendData(buffer, len) == len ? RCP_ERR_SUCCESS : RCP_ERR_IO_SEND;
+    return sendPacket(ctx, len);
 }
 
-RCP_Error RCP_sendHeartbeat(void) { return RCP__sendTestUpdate(RCP_HEARTBEAT, 0); }
+RCP_Error RCP_ctx_sendHeartbeat(RCP_Context* ctx) { return RCP__sendTestUpdate(ctx, RCP_HEARTBEAT, 0); }
 
-RCP_Error RCP_startTest(uint8_t testnum) { return RCP__sendTestUpdate(RCP_TEST_START, testnum); }
+RCP_Error RCP_ctx_startTest(RCP_Context* ctx, uint8_t testnum) {
+    return RCP__sendTestUpdate(ctx, RCP_TEST_START, testnum);
+}
 
-RCP_Error RCP_stopTest(void) { return RCP__sendTestUpdate(RCP_TEST_STOP, 0); }
+RCP_Error RCP_ctx_stopTest(RCP_Context* ctx) { return RCP__sendTestUpdate(ctx, RCP_TEST_STOP, 0); }
 
-RCP_Error RCP_pauseUnpauseTest(void) { return RCP__sendTestUpdate(RCP_TEST_PAUSE, 0); }
+RCP_Error RCP_ctx_pauseUnpauseTest(RCP_Context* ctx) { return RCP__sendTestUpdate(ctx, RCP_TEST_PAUSE, 0); }
 
-RCP_Error RCP_deviceReset(void) { return RCP__sendTestUpdate(RCP_DEVICE_RESET, 0); }
+RCP_Error RCP_ctx_deviceReset(RCP_Context* ctx) { return RCP__sendTestUpdate(ctx, RCP_DEVICE_RESET, 0); }
 
-RCP_Error RCP_deviceTimeReset(void) { return RCP__sendTestUpdate(RCP_DEVICE_RESET_TIME, 0); }
+RCP_Error RCP_ctx_deviceTimeReset(RCP_Context* ctx) { return RCP__sendTestUpdate(ctx, RCP_DEVICE_RESET_TIME, 0); }
 
-RCP_Error RCP_setDataStreaming(int datastreaming) {
-    return RCP__sendTestUpdate(datastreaming ? RCP_DATA_STREAM_START : RCP_DATA_STREAM_STOP, 0);
+RCP_Error RCP_ctx_setDataStreaming(RCP_Context* ctx, int datastreaming) {
+    return RCP__sendTestUpdate(ctx, datastreaming ? RCP_DATA_STREAM_START : RCP_DATA_STREAM_STOP, 0);
 }
 
-RCP_Error RCP_setHeartbeatTime(uint8_t heartbeatTime) {
-    return RCP__sendTestUpdate(RCP_HEARTBEATS_CONTROL, heartbeatTime);
+RCP_Error RCP_ctx_setHeartbeatTime(RCP_Context* ctx, uint8_t heartbeatTime) {
+    return RCP__sendTestUpdate(ctx, RCP_HEARTBEATS_CONTROL, heartbeatTime);
 }
 
-RCP_Error RCP_requestTestState(void) { return RCP__sendTestUpdate(RCP_TEST_QUERY, 0); }
+RCP_Error RCP_ctx_requestTestState(RCP_Context* ctx) { return RCP__sendTestUpdate(ctx, RCP_TEST_QUERY, 0); }
+
+// Time a write to a device, if the context is measuring round trips. One that went out is timed from now, and one left
+// in the transmit batch from when the batch is flushed
+static inline RCP_Error sentWrite(RCP_Context* ctx, RCP_DeviceClass devclass, uint8_t ID, RCP_Error rerrno) {
+    if(ctx->latency == NULL) return rerrno;
+
+    // Anything still queued ends with this write, even if flushing what was queued before it failed
+    if(ctx->txLen != 0) {
+        if(ctx->txWriteLen < sizeof(ctx->txWrites) / sizeof(ctx->txWrites[0]))
+            ctx->txWrites[ctx->txWriteLen++] = (uint16_t) (devclass << 8 | ID);
+    }
 
-RCP_Error RCP_sendSimpleActuatorWrite(uint8_t ID, RCP_SimpleActuatorState state) {
-    if(callbacks == NULL) return RCP_ERR_INIT;
-    buffer[0] = channel | 0x02;
-    buffer[1] = RCP_DEVCLASS_SIMPLE_ACTUATOR;
-    buffer[2] = ID;
-    buffer[3] = state;
-    return callbacks->sendData(buffer, 4) == 4 ? RCP_ERR_SUCCESS : RCP_ERR_IO_SEND;
+    else if(rerrno == RCP_ERR_SUCCESS) RCP__latencyWrite(ctx->latency, devclass, ID);
+    return rerrno;
+}
+
+RCP_Error RCP_ctx_sendSimpleActuatorWrite(RCP_Context* ctx, uint8_t ID, RCP_SimpleActuatorState state) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+    ctx->txBuffer[0] = ctx->channel | 0x02;
+    ctx->txBuffer[1] = RCP_DEVCLASS_SIMPLE_ACTUATOR;
+    ctx->txBuffer[2] = ID;
+    ctx->txBuffer[3] = state;
+    return sentWrite(ctx, RCP_DEVCLASS_SIMPLE_ACTUATOR, ID, sendPacket(ctx, 4));
 }
 
-RCP_Error RCP_sendStepperWrite(uint8_t ID, RCP_StepperControlMode mode, float value) {
-    if(callbacks == NULL) return RCP_ERR_INIT;
-    buffer[0] = channel | 6;
-    buffer[1] = RCP_DEVCLASS_STEPPER;
-    buffer[2] = ID;
-    buffer[3] = mode;
-    memcpy(buffer + 4, &value, 4);
-    return callbacks->sendData(buffer, 8) == 8 ? RCP_ERR_SUCCESS : RCP_ERR_IO_SEND;
+RCP_Error RCP_ctx_sendStepperWrite(RCP_Context* ctx, uint8_t ID, RCP_StepperControlMode mode, float value) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+    ctx->txBuffer[0] = ctx->channel | 6;
+    ctx->txBuffer[1] = RCP_DEVCLASS_STEPPER;
+    ctx->txBuffer[2] = ID;
+    ctx->txBuffer[3] = mode;
+    memcpy(ctx->txBuffer + 4, &value, 4);
+    return sentWrite(ctx, RCP_DEVCLASS_STEPPER, ID, sendPacket(ctx, 8));
 }
 
-RCP_Error RCP_sendAngledActuatorWrite(uint8_t ID, float value) {
-    if(callbacks == NULL) return RCP_ERR_INIT;
-    buffer[0] = channel | 0x05;
-    buffer[1] = RCP_DEVCLASS_ANGLED_ACTUATOR;
-    buffer[2] = ID;
-    memcpy(buffer + 3, &value, 4);
-    return callbacks->sendData(buffer, 7) == 7 ? RCP_ERR_SUCCESS : RCP_ERR_IO_SEND;
+RCP_Error RCP_ctx_sendAngledActuatorWrite(RCP_Context* ctx, uint8_t ID, float value) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+    ctx->txBuffer[0] = ctx->channel | 0x05;
+    ctx->txBuffer[1] = RCP_DEVCLASS_ANGLED_ACTUATOR;
+    ctx->txBuffer[2] = ID;
+    memcpy(ctx->txBuffer + 3, &value, 4);
+    return sentWrite(ctx, RCP_DEVCLASS_ANGLED_ACTUATOR, ID, sendPacket(ctx, 7));
 }
 
-RCP_Error RCP_sendMotorWrite(uint8_t ID, float value) {
-    if(callbacks == NULL) return RCP_ERR_INIT;
-    buffer[0] = channel | 5;
-    buffer[1] = RCP_DEVCLASS_MOTOR;
-    buffer[2] = ID;
-    memcpy(buffer + 3, &value, 4);
-    return callbacks->sendData(buffer, 7) == 7 ? RCP_ERR_SUCCESS : RCP_ERR_IO_SEND;
+RCP_Error RCP_ctx_sendMotorWrite(RCP_Context* ctx, uint8_t ID, float value) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+    ctx->txBuffer[0] = ctx->channel | 5;
+    ctx->txBuffer[1] = RCP_DEVCLASS_MOTOR;
+    ctx->txBuffer[2] = ID;
+    memcpy(ctx->txBuffer + 3, &value, 4);
+    return sentWrite(ctx, RCP_DEVCLASS_MOTOR, ID, sendPacket(ctx, 7));
 }
 
 // One shot read request to a device with an ID
-RCP_Error RCP_requestGeneralRead(RCP_DeviceClass device, uint8_t ID) {
-    if(callbacks == NULL) return RCP_ERR_INIT;
+RCP_Error RCP_ctx_requestGeneralRead(RCP_Context* ctx, RCP_DeviceClass device, uint8_t ID) {
+    if(ctx == NULL) return RCP_ERR_INIT;
 
-    if(device == RCP_DEVCLASS_PROMPT || device == RCP_DEVCLASS_TARGET_LOG || device == RCP_DEVCLASS_AMALGAMATE)
+    if((unsigned) device > 0xFF || !(RCP__devclasses[device].flags & RCP_DC_QUERYABLE))
         return RCP_ERR_INVALID_DEVCLASS;
-    if(device == RCP_DEVCLASS_TEST_STATE) return RCP_requestTestState();
+    if(device == RCP_DEVCLASS_TEST_STATE) return RCP_ctx_requestTestState(ctx);
 
-    buffer[0] = channel | 0x01;
-    buffer[1] = device;
-    buffer[2] = ID;
-    return callbacks->sendData(buffer, 3) == 3 ? RCP_ERR_SUCCESS : RCP_ERR_IO_SEND;
+    ctx->txBuffer[0] = ctx->channel | 0x01;
+    ctx->txBuffer[1] = device;
+    ctx->txBuffer[2] = ID;
+    return sendPacket(ctx, 3);
 }
 
-RCP_Error RCP_requestTareConfiguration(RCP_DeviceClass device, uint8_t ID, uint8_t dataChannel, float offset) {
-    if(callbacks == NULL) return RCP_ERR_INIT;
-    if(device <= 0x80 || device == RCP_DEVCLASS_BOOL_SENSOR || device == RCP_DEVCLASS_AMALGAMATE)
+RCP_Error RCP_ctx_requestTareConfiguration(RCP_Context* ctx, RCP_DeviceClass device, uint8_t ID, uint8_t dataChannel,
+                                           float offset) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+    if((unsigned) device > 0xFF || !(RCP__devclasses[device].flags & RCP_DC_TAREABLE))
         return RCP_ERR_INVALID_DEVCLASS;
 
-    buffer[0] = channel | 6;
-    buffer[1] = device;
-    buffer[2] = ID;
-    buffer[3] = dataChannel;
-    memcpy(buffer + 4, &offset, 4);
-    return callbacks->sendData(buffer, 8) == 8 ? RCP_ERR_SUCCESS : RCP_ERR_IO_SEND;
+    ctx->txBuffer[0] = ctx->channel | 6;
+    ctx->txBuffer[1] = device;
+    ctx->txBuffer[2] = ID;
+    ctx->txBuffer[3] = dataChannel;
+    memcpy(ctx->txBuffer + 4, &offset, 4);
+    return sendPacket(ctx, 8);
 }
 
-RCP_Error RCP_promptRespondGONOGO(RCP_GONOGO gonogo) {
-    if(callbacks == NULL) return RCP_ERR_INIT;
-    if(activePromptType != RCP_PromptDataType_GONOGO) return RCP_ERR_NO_ACTIVE_PROMPT;
+RCP_Error RCP_ctx_promptRespondGONOGO(RCP_Context* ctx, RCP_GONOGO gonogo) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+    if(ctx->activePromptType != RCP_PromptDataType_GONOGO) return RCP_ERR_NO_ACTIVE_PROMPT;
 
-    buffer[0] = channel | 0x01;
-    buffer[1] = RCP_DEVCLASS_PROMPT;
-    buffer[2] = gonogo;
-    return callbacks->sendData(buffer, 3) == 3 ? RCP_ERR_SUCCESS : RCP_ERR_IO_SEND;
+    ctx->txBuffer[0] = ctx->channel | 0x01;
+    ctx->txBuffer[1] = RCP_DEVCLASS_PROMPT;
+    ctx->txBuffer[2] = gonogo;
+    return sendPacket(ctx, 3);
 }
 
-RCP_Error RCP_promptRespondFloat(float value) {
-    if(callbacks == NULL) return RCP_ERR_INIT;
-    if(activePromptType != RCP_PromptDataType_Float) return RCP_ERR_NO_ACTIVE_PROMPT;
+RCP_Error RCP_ctx_promptRespondFloat(RCP_Context* ctx, float value) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+    if(ctx->activePromptType != RCP_PromptDataType_Float) return RCP_ERR_NO_ACTIVE_PROMPT;
 
-    buffer[0] = channel | 0x04;
-    buffer[1] = RCP_DEVCLASS_PROMPT;
-    memcpy(buffer + 2, &value, 4);
-    return callbacks->sendData(buffer, 6) == 6 ? RCP_ERR_SUCCESS : RCP_ERR_IO_SEND;
+    ctx->txBuffer[0] = ctx->channel | 0x04;
+    ctx->txBuffer[1] = RCP_DEVCLASS_PROMPT;
+    memcpy(ctx->txBuffer + 2, &value, 4);
+    return sendPacket(ctx, 6);
 }
 
-RCP_PromptDataType RCP_getActivePromptType(void) { return activePromptType; }
+RCP_PromptDataType RCP_ctx_getActivePromptType(const RCP_Context* ctx) {
+    return ctx == NULL ? RCP_PromptDataType_RESET : ctx->activePromptType;
+}
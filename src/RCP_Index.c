@@ -0,0 +1,296 @@
+#include "RCP_Host/RCP_Index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "RCP_Host/RCP_Capture.h"
+#include "RCP_Host/RCP_Replay.h"
+#include "RCP_Internal.h"
+
+struct RCP_Index {
+    struct RCP_IndexEntry* entries;
+    size_t len;
+
+    // Positions in entries of each channel's own entries, by channel slot, for lookups by target time
+    size_t* channels[2];
+    size_t channelLen[2];
+};
+
+void RCP__indexInit(struct RCP__IndexBuilder* builder) {
+    builder->entries = NULL;
+    builder->len = 0;
+    builder->cap = 0;
+    for(size_t c = 0; c < 2; c++) {
+        RCP__timelineInit(&builder->timelines[c]);
+        builder->lastEntry[c] = 0;
+    }
+}
+
+void RCP__indexFree(struct RCP__IndexBuilder* builder) {
+    free(builder->entries);
+    RCP__indexInit(builder);
+}
+
+RCP_Error RCP__indexAdd(struct RCP__IndexBuilder* builder, uint64_t offset, uint64_t hostTimeNs, RCP_Channel channel,
+                        const uint8_t* pkt, size_t length) {
+    uint32_t ts;
+    if(!RCP__packetTimestamp(pkt, length, &ts)) return RCP_ERR_SUCCESS;
+
+    size_t slot = RCP__channelSlot(channel);
+    struct RCP__Timeline* timeline = &builder->timelines[slot];
+    int restarted = RCP__timelineAdvance(timeline, ts);
+
+    // A late reading is not where its target time says, so it makes a poor place to start from
+    if(timeline->lastTs != ts) return RCP_ERR_SUCCESS;
+    if(builder->lastEntry[slot] != 0 && !restarted && offset - builder->lastEntry[slot] < RCP_INDEX_STRIDE)
+        return RCP_ERR_SUCCESS;
+
+    if(builder->len == builder->cap) {
+        size_t cap = builder->cap == 0 ? 64 : builder->cap * 2;
+        struct RCP_IndexEntry* entries = realloc(builder->entries, cap * sizeof(struct RCP_IndexEntry));
+        if(entries == NULL) return RCP_ERR_MEMALLOC;
+
+        builder->entries = entries;
+        builder->cap = cap;
+    }
+
+    builder->entries[builder->len++] = (struct RCP_IndexEntry) {.offset = offset,
+                                                                .hostTimeNs = hostTimeNs,
+                                                                .targetMs = RCP__timelineMs(timeline),
+                                                                .epoch = timeline->epoch,
+                                                                .channel = channel & RCP_CHANNEL_MASK};
+    builder->lastEntry[slot] = offset;
+    return RCP_ERR_SUCCESS;
+}
+
+char* RCP__indexPath(const char* capturePath) {
+    size_t len = strlen(capturePath);
+    char* path = malloc(len + sizeof(RCP_INDEX_SUFFIX));
+    if(path == NULL) return NULL;
+
+    memcpy(path, capturePath, len);
+    memcpy(path + len, RCP_INDEX_SUFFIX, sizeof(RCP_INDEX_SUFFIX));
+    return path;
+}
+
+RCP_Error RCP__indexSave(const struct RCP__IndexBuilder* builder, const char* capturePath, uint64_t captureBytes) {
+    char* path = RCP__indexPath(capturePath);
+    if(path == NULL) return RCP_ERR_MEMALLOC;
+
+    FILE* file = fopen(path, "wb");
+    free(path);
+    if(file == NULL) return RCP_ERR_IO_FILE;
+
+    uint8_t header[RCP_INDEX_HEADER_BYTES] = {0};
+    memcpy(header, RCP_INDEX_MAGIC, 8);
+    RCP__storeLE(header + 8, RCP_INDEX_VERSION, 4);
+    RCP__storeLE(header + 16, captureBytes, 8);
+    int ok = fwrite(header, sizeof(header), 1, file) == 1;
+
+    for(size_t i = 0; ok && i < builder->len; i++) {
+        const struct RCP_IndexEntry* e = builder->entries + i;
+        uint8_t entry[RCP_INDEX_ENTRY_BYTES] = {0};
+        RCP__storeLE(entry, e->offset, 8);
+        RCP__storeLE(entry + 8, e->hostTimeNs, 8);
+        RCP__storeLE(entry + 16, e->targetMs, 8);
+        RCP__storeLE(entry + 24, e->epoch, 4);
+        entry[28] = (uint8_t) e->channel;
+        ok = fwrite(entry, sizeof(entry), 1, file) == 1;
+    }
+
+    if(fclose(file) != 0) ok = 0;
+    return ok ? RCP_ERR_SUCCESS : RCP_ERR_IO_FILE;
+}
+
+// Read the sidecar of a capture, if there is one and it was built from a capture of the same size
+static RCP_Error loadSidecar(const char* capturePath, uint64_t captureBytes, RCP_Index* index) {
+    char* path = RCP__indexPath(capturePath);
+    if(path == NULL) return RCP_ERR_MEMALLOC;
+
+    FILE* file = fopen(path, "rb");
+    free(path);
+    if(file == NULL) return RCP_ERR_IO_FILE;
+
+    uint8_t header[RCP_INDEX_HEADER_BYTES];
+    struct stat st;
+    if(fread(header, sizeof(header), 1, file) != 1 || fstat(fileno(file), &st) != 0 ||
+       memcmp(header, RCP_INDEX_MAGIC, 8) != 0 || RCP__loadLE(header + 8, 4) != RCP_INDEX_VERSION ||
+       RCP__loadLE(header + 16, 8) != captureBytes ||
+       ((size_t) st.st_size - RCP_INDEX_HEADER_BYTES) % RCP_INDEX_ENTRY_BYTES != 0) {
+        fclose(file);
+        return RCP_ERR_BAD_CAPTURE;
+    }
+
+    size_t len = ((size_t) st.st_size - RCP_INDEX_HEADER_BYTES) / RCP_INDEX_ENTRY_BYTES;
+    struct RCP_IndexEntry* entries = malloc((len == 0 ? 1 : len) * sizeof(struct RCP_IndexEntry));
+    if(entries == NULL) {
+        fclose(file);
+        return RCP_ERR_MEMALLOC;
+    }
+
+    for(size_t i = 0; i < len; i++) {
+        uint8_t entry[RCP_INDEX_ENTRY_BYTES];
+        if(fread(entry, sizeof(entry), 1, file) != 1) {
+            free(entries);
+            fclose(file);
+            return RCP_ERR_IO_FILE;
+        }
+
+        entries[i] = (struct RCP_IndexEntry) {.offset = RCP__loadLE(entry, 8),
+                                              .hostTimeNs = RCP__loadLE(entry + 8, 8),
+                                              .targetMs = RCP__loadLE(entry + 16, 8),
+                                              .epoch = (uint32_t) RCP__loadLE(entry + 24, 4),
+                                              .channel = entry[28] & RCP_CHANNEL_MASK};
+    }
+
+    fclose(file);
+    index->entries = entries;
+    index->len = len;
+    return RCP_ERR_SUCCESS;
+}
+
+// Scan the whole capture to build its index, then try to save it for next time
+static RCP_Error buildIndex(const char* capturePath, uint64_t captureBytes, RCP_Index* index) {
+    RCP_Replay* replay = NULL;
+    RCP_Error rerrno = RCP_replay_open(capturePath, &replay);
+    if(rerrno != RCP_ERR_SUCCESS) return rerrno;
+
+    struct RCP__IndexBuilder builder;
+    RCP__indexInit(&builder);
+
+    uint64_t offset = RCP_replay_tell(replay);
+    struct RCP_CaptureRecord record;
+    while(rerrno == RCP_ERR_SUCCESS && RCP_replay_next(replay, &record)) {
+        rerrno = RCP__indexAdd(&builder, offset, record.timeNs, record.channel, record.pkt, record.length);
+        offset = RCP_replay_tell(replay);
+    }
+
+    RCP_replay_close(replay);
+    if(rerrno != RCP_ERR_SUCCESS) {
+        RCP__indexFree(&builder);
+        return rerrno;
+    }
+
+    RCP__indexSave(&builder, capturePath, captureBytes);
+
+    // Ownership of the entries moves to the index
+    index->entries = builder.entries;
+    index->len = builder.len;
+    return RCP_ERR_SUCCESS;
+}
+
+// Find the entries of each channel
+static RCP_Error splitChannels(RCP_Index* index) {
+    for(size_t c = 0; c < 2; c++) {
+        index->channels[c] = malloc((index->len == 0 ? 1 : index->len) * sizeof(size_t));
+        index->channelLen[c] = 0;
+    }
+
+    if(index->channels[0] == NULL || index->channels[1] == NULL) return RCP_ERR_MEMALLOC;
+
+    for(size_t i = 0; i < index->len; i++) {
+        size_t slot = RCP__channelSlot(index->entries[i].channel);
+        index->channels[slot][index->channelLen[slot]++] = i;
+    }
+
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_index_open(const char* capturePath, RCP_Index** index) {
+    if(capturePath == NULL || index == NULL) return RCP_ERR_INIT;
+    *index = NULL;
+
+    struct stat st;
+    if(stat(capturePath, &st) != 0) return RCP_ERR_IO_FILE;
+
+    RCP_Index* idx = malloc(sizeof(RCP_Index));
+    if(idx == NULL) return RCP_ERR_MEMALLOC;
+
+    RCP_Error rerrno = loadSidecar(capturePath, (uint64_t) st.st_size, idx);
+    if(rerrno != RCP_ERR_SUCCESS) rerrno = buildIndex(capturePath, (uint64_t) st.st_size, idx);
+    if(rerrno != RCP_ERR_SUCCESS) {
+        free(idx);
+        return rerrno;
+    }
+
+    if(splitChannels(idx) != RCP_ERR_SUCCESS) {
+        RCP_index_close(idx);
+        return RCP_ERR_MEMALLOC;
+    }
+
+    *index = idx;
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_index_close(RCP_Index* index) {
+    if(index == NULL) return RCP_ERR_INIT;
+
+    free(index->entries);
+    free(index->channels[0]);
+    free(index->channels[1]);
+    free(index);
+    return RCP_ERR_SUCCESS;
+}
+
+size_t RCP_index_size(const RCP_Index* index) { return index == NULL ? 0 : index->len; }
+
+const struct RCP_IndexEntry* RCP_index_entries(const RCP_Index* index) {
+    return index == NULL ? NULL : index->entries;
+}
+
+uint32_t RCP_index_epochs(const RCP_Index* index, RCP_Channel channel) {
+    if(index == NULL) return 0;
+
+    size_t slot = RCP__channelSlot(channel);
+    size_t len = index->channelLen[slot];
+    return len == 0 ? 0 : index->entries[index->channels[slot][len - 1]].epoch + 1;
+}
+
+RCP_Error RCP_index_findHostTime(const RCP_Index* index, uint64_t hostTimeNs, uint64_t* offset) {
+    if(index == NULL || offset == NULL) return RCP_ERR_INIT;
+
+    // Find the first entry after the time, the one before it is the answer
+    size_t lo = 0;
+    size_t hi = index->len;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(index->entries[mid].hostTimeNs <= hostTimeNs) lo = mid + 1;
+        else hi = mid;
+    }
+
+    *offset = lo == 0 ? RCP_CAPTURE_FILE_HEADER_BYTES : index->entries[lo - 1].offset;
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_index_findTargetTime(const RCP_Index* index, RCP_Channel channel, uint32_t epoch, uint64_t targetMs,
+                                   uint64_t* offset) {
+    if(index == NULL || offset == NULL || epoch >= RCP_index_epochs(index, channel)) return RCP_ERR_INIT;
+
+    const size_t* at = index->channels[RCP__channelSlot(channel)];
+    size_t len = index->channelLen[RCP__channelSlot(channel)];
+    const struct RCP_IndexEntry* e = index->entries;
+
+    // Epochs only increase through the channel's entries, so first find where this one starts
+    size_t lo = 0;
+    size_t hi = len;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(e[at[mid]].epoch < epoch) lo = mid + 1;
+        else hi = mid;
+    }
+
+    size_t start = lo;
+
+    // Then the first entry in the epoch after the time
+    hi = len;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(e[at[mid]].epoch == epoch && e[at[mid]].targetMs <= targetMs) lo = mid + 1;
+        else hi = mid;
+    }
+
+    *offset = e[at[lo == start ? start : lo - 1]].offset;
+    return RCP_ERR_SUCCESS;
+}
@@ -0,0 +1,438 @@
+#ifndef RCP_INTERNAL_H
+#define RCP_INTERNAL_H
+
+// Definitions shared between the library's translation units. Not part of the public interface.
+
+#include "RCP_Host/RCP_Cobs.h"
+#include "RCP_Host/RCP_Host.h"
+#include "RCP_Host/RCP_Index.h"
+#include "RCP_Host/RCP_Limits.h"
+#include "RCP_Host/RCP_Store.h"
+#include "RCP_Host/RCP_Transport.h"
+
+#include <stdlib.h>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Macroing the staticness of the internals allows for unit testing
+#ifdef RCPH_TEST_MODE
+#define STATIC
+#else
+#define STATIC static
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Alignment used to keep data written by different threads on separate cache lines
+#define RCP_CACHE_LINE 64
+
+// Cache line aligned allocation, for structures laid out with RCP_CACHE_LINE in mind
+static inline void* RCP__alignedAlloc(size_t size) {
+#ifdef _MSC_VER
+    return _aligned_malloc(size, RCP_CACHE_LINE);
+#else
+    // aligned_alloc requires the size to be a multiple of the alignment
+    return aligned_alloc(RCP_CACHE_LINE, (size + RCP_CACHE_LINE - 1) & ~(size_t) (RCP_CACHE_LINE - 1));
+#endif
+}
+
+static inline void RCP__alignedFree(void* ptr) {
+#ifdef _MSC_VER
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+// Nanoseconds from an arbitrary fixed point that never jumps, for measuring deadlines and stamping received data
+static inline uint64_t RCP__monotonicNs(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t) (now.QuadPart / freq.QuadPart) * 1000000000 +
+           (uint64_t) (now.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+static inline uint64_t RCP__monotonicUs(void) { return RCP__monotonicNs() / 1000; }
+
+// Little endian fields of n bytes, as used by the capture file format
+static inline uint64_t RCP__loadLE(const uint8_t* bytes, int n) {
+    uint64_t value = 0;
+    for(int i = n - 1; i >= 0; i--) value = (value << 8) | bytes[i];
+    return value;
+}
+
+static inline void RCP__storeLE(uint8_t* bytes, uint64_t value, int n) {
+    for(int i = 0; i < n; i++) bytes[i] = (uint8_t) (value >> (i * 8));
+}
+
+// Atomic counters that only one thread writes. It bumps them with a plain load and store rather than a locked
+// read-modify-write, and the atomics are so that other threads can read them at any time
+#define RCP__LOAD(counter) atomic_load_explicit(&(counter), memory_order_relaxed)
+#define RCP__BUMP(counter, n) atomic_store_explicit(&(counter), RCP__LOAD(counter) + (n), memory_order_relaxed)
+
+// Largest packet the host receives, and the largest one it sends, which is a stepper write or tare request
+#define RCP_MAX_RX_BYTES (RCP_MAX_EXTENDED_BYTES + RCP_MAX_NON_PARAM)
+#define RCP_MAX_TX_PACKET 8
+
+// Largest frame, without its delimiter, that can hold a packet the host receives, and largest frame the host sends
+// including the delimiter. Both leave room for a CRC
+#define RCP_MAX_RX_FRAME RCP_COBS_MAX_ENCODED(RCP_MAX_RX_BYTES + 2)
+#define RCP_MAX_TX_FRAME (RCP_COBS_MAX_ENCODED(RCP_MAX_TX_PACKET + 2) + 1)
+
+// Flags for what each device class supports
+#define RCP_DC_TIMESTAMPED 0x01
+#define RCP_DC_AMALGAMABLE 0x02
+#define RCP_DC_TAREABLE 0x04
+#define RCP_DC_QUERYABLE 0x08
+#define RCP_DC_IDENTIFIED 0x10
+
+// Decodes one IU of a device class and passes it to the right callback. Arguments are the same as processIU.
+typedef RCP_Error (*RCP_IUDecoder)(RCP_Context* ctx, RCP_DeviceClass devclass, uint32_t timestamp, size_t params,
+                                   const uint8_t* postTS);
+
+// Description of a device class. Indexed by class byte in RCP__devclasses, where classes the library does not know
+// are left zeroed.
+struct RCP_DevclassInfo {
+    // NULL for unknown classes, and for amalgamate IUs which are not decoded on their own
+    RCP_IUDecoder decode;
+
+    // Number of floats in a reading for the xF classes, 0 otherwise
+    uint8_t arity;
+
+    // Parameter bytes after the timestamp, including the ID, or 0 for the variable length classes
+    uint8_t size;
+
+    uint8_t flags;
+};
+
+extern const struct RCP_DevclassInfo RCP__devclasses[256];
+
+// Size of an amalgamation subunit's parameters, after its class byte. Test state is the only class whose size depends
+// on its contents, since the running test and progress bytes are only there while a test is running.
+static inline size_t RCP__subunitSize(RCP_DeviceClass devclass, const uint8_t* postTS) {
+    size_t size = RCP__devclasses[devclass].size;
+    if(devclass == RCP_DEVCLASS_TEST_STATE && (postTS[0] & RCP_TEST_STATE_MASK) == RCP_TEST_RUNNING) size += 2;
+    return size;
+}
+
+// Get the target timestamp of a complete packet, if its class has one. Returns whether it did
+static inline int RCP__packetTimestamp(const uint8_t* pkt, size_t length, uint32_t* ts) {
+    size_t preambleLen = pkt[0] & RCP_EXTENDED_MASK ? 3 : 1;
+
+    // Too short for a class byte and timestamp, which includes zero length packets
+    if(length < preambleLen + 5) return 0;
+    if(!(RCP__devclasses[pkt[preambleLen]].flags & RCP_DC_TIMESTAMPED)) return 0;
+
+    const uint8_t* t = pkt + preambleLen + 1;
+    *ts = ((uint32_t) t[0] << 24) | ((uint32_t) t[1] << 16) | ((uint32_t) t[2] << 8) | t[3];
+    return 1;
+}
+
+// Progress of a target's 32 bit millisecond clock through a capture, across wraps and restarts as described in
+// RCP_Index.h
+struct RCP__Timeline {
+    int haveTs;
+    uint32_t lastTs;
+    uint64_t wraps;
+    uint32_t epoch;
+};
+
+static inline void RCP__timelineInit(struct RCP__Timeline* timeline) {
+    timeline->haveTs = 0;
+    timeline->lastTs = 0;
+    timeline->wraps = 0;
+    timeline->epoch = 0;
+}
+
+// How far behind the last timestamp one can be and still be taken as a reading that arrived out of order
+#define RCP__TIMELINE_JITTER_MS 1000
+
+// Move the timeline on to the next timestamp. Returns whether the target restarted its clock
+static inline int RCP__timelineAdvance(struct RCP__Timeline* timeline, uint32_t ts) {
+    if(!timeline->haveTs) {
+        timeline->haveTs = 1;
+        timeline->lastTs = ts;
+        return 0;
+    }
+
+    // A little behind is a late reading, and leaves the timeline where it was. Unless the clock has wrapped, it also
+    // has to be no nearer zero than it is behind, or the target could have restarted since. The difference is taken
+    // modulo 2^32, so a late reading from before a wrap counts too
+    uint32_t behind = timeline->lastTs - ts;
+    if(behind <= RCP__TIMELINE_JITTER_MS && (behind <= ts || timeline->wraps != 0)) return 0;
+
+    // Any other timestamp that went backwards either wrapped, or the target restarted its clock
+    int restarted = 0;
+    if(ts < timeline->lastTs) {
+        if(timeline->lastTs - ts > UINT32_C(0x80000000)) timeline->wraps++;
+
+        else {
+            timeline->epoch++;
+            timeline->wraps = 0;
+            restarted = 1;
+        }
+    }
+
+    timeline->lastTs = ts;
+    return restarted;
+}
+
+// Target time of ts, a timestamp the timeline has just been advanced with, continued past wraps
+static inline uint64_t RCP__timelineAt(const struct RCP__Timeline* timeline, uint32_t ts) {
+    // Late from before the last wrap
+    if(ts > timeline->lastTs && ts - timeline->lastTs > UINT32_C(0x80000000) && timeline->wraps != 0)
+        return ((timeline->wraps - 1) << 32) | ts;
+
+    return (timeline->wraps << 32) | ts;
+}
+
+// Target time of the last timestamp, continued past wraps
+static inline uint64_t RCP__timelineMs(const struct RCP__Timeline* timeline) {
+    return (timeline->wraps << 32) | timeline->lastTs;
+}
+
+// Position of a channel in tables kept per channel
+static inline size_t RCP__channelSlot(RCP_Channel channel) { return (channel & RCP_CHANNEL_MASK) ? 1 : 0; }
+
+// Incremental construction of a capture index, shared by the recorder and RCP_index_open. Records are added in file
+// order, and entries are kept as described in RCP_Index.h
+struct RCP__IndexBuilder {
+    struct RCP_IndexEntry* entries;
+    size_t len;
+    size_t cap;
+
+    // By channel slot, as each channel can carry a different target: where its clock stands, and the offset of its
+    // last entry, or 0 before its first
+    struct RCP__Timeline timelines[2];
+    uint64_t lastEntry[2];
+};
+
+void RCP__indexInit(struct RCP__IndexBuilder* builder);
+RCP_Error RCP__indexAdd(struct RCP__IndexBuilder* builder, uint64_t offset, uint64_t hostTimeNs, RCP_Channel channel,
+                        const uint8_t* pkt, size_t length);
+RCP_Error RCP__indexSave(const struct RCP__IndexBuilder* builder, const char* capturePath, uint64_t captureBytes);
+void RCP__indexFree(struct RCP__IndexBuilder* builder);
+
+// Path of the sidecar index for a capture. The returned string must be freed
+char* RCP__indexPath(const char* capturePath);
+
+typedef enum {
+    RCP__TRANSPORT_SERIAL,
+    RCP__TRANSPORT_TCP,
+    RCP__TRANSPORT_UDP,
+} RCP__TransportKind;
+
+// See RCP_Transport.h. Only implemented on POSIX systems
+struct RCP_Transport {
+    int fd;
+    RCP__TransportKind kind;
+
+    // Set for a serial port whose reads are timed by VMIN and VTIME. Its descriptor is left blocking
+    int termiosTimed;
+    int timeoutMs;
+
+    // Read ahead. Bytes from start up to end have arrived and not been read yet
+    uint8_t* buffer;
+    size_t start;
+    size_t end;
+
+    struct RCP_TransportStats stats;
+};
+
+// Subscriptions of a context. ids has a bit per ID of each class, and accepted counts the bits set, so a class nobody
+// subscribed to is found from its class byte alone. Classes without IDs have all their bits set or none. An
+// amalgamation unit is accepted while any class that can be in one is, and its subunits are filtered one by one
+struct RCP__Filter {
+    int filtering;
+    uint8_t ids[256][32];
+    uint16_t accepted[256];
+};
+
+// Per-class tables of the trackers that keep something for every device, and the devices in the order they were first
+// heard from. Only the receiving thread adds tables and devices, and any thread can look them up at any time
+struct RCP__Devices;
+
+// A class's table is size bytes, cache line aligned, and filled in by init before anyone else can see it, or zeroed
+// if init is NULL. RCP__devicesFree calls release, if not NULL, on each table before freeing it
+struct RCP__Devices* RCP__devicesCreate(size_t size, void (*init)(void* table));
+void RCP__devicesFree(struct RCP__Devices* devices, void (*release)(void* table));
+
+// Table of a class for the receiving thread, allocated the first time it is asked for. NULL if there was no memory
+void* RCP__devicesClass(struct RCP__Devices* devices, RCP_DeviceClass devclass);
+
+// Table of a class for any thread, NULL until the receiving thread has allocated it
+const void* RCP__devicesFind(const struct RCP__Devices* devices, RCP_DeviceClass devclass);
+
+// Lists a device, once what readers will look at for it is filled in. RCP__devicesList points fqdns at the list and
+// returns how many are in it. Entries already listed are never written again
+void RCP__devicesAdd(struct RCP__Devices* devices, uint16_t fqdn);
+size_t RCP__devicesList(const struct RCP__Devices* devices, const uint16_t** fqdns);
+
+// Latest reading table, see RCP_Latest.h. Records are made by the receiving thread only
+struct RCP__Latest;
+struct RCP__Latest* RCP__latestCreate(void);
+void RCP__latestFree(struct RCP__Latest* table);
+void RCP__latestRecord(struct RCP__Latest* table, RCP_DeviceClass devclass, uint32_t timestamp, uint8_t ID,
+                       const float* data, size_t n);
+
+// Statistics, see RCP_Stats.h. Counted by the receiving thread only
+struct RCP__Stats;
+struct RCP__Stats* RCP__statsCreate(void);
+void RCP__statsFree(struct RCP__Stats* stats);
+void RCP__statsPacket(struct RCP__Stats* stats, uint8_t header, size_t len);
+void RCP__statsDropped(struct RCP__Stats* stats, int wrongChannel);
+void RCP__statsSkipped(struct RCP__Stats* stats, size_t n);
+void RCP__statsDiscarded(struct RCP__Stats* stats, size_t n);
+void RCP__statsError(struct RCP__Stats* stats, RCP_Error error);
+void RCP__statsClass(struct RCP__Stats* stats, RCP_DeviceClass devclass, size_t len);
+void RCP__statsUnit(struct RCP__Stats* stats, RCP_DeviceClass devclass);
+void RCP__statsSample(struct RCP__Stats* stats, RCP_DeviceClass devclass, uint32_t timestamp, uint8_t ID);
+
+// Round trip latency, see RCP_Latency.h. Writes are noted by whichever thread sends, and answers by the receiving
+// thread. RCP__latencyRecord adds one round trip of ns to the histogram of devclass
+struct RCP__Latency;
+struct RCP__Latency* RCP__latencyCreate(void);
+void RCP__latencyFree(struct RCP__Latency* latency);
+void RCP__latencyWrite(struct RCP__Latency* latency, RCP_DeviceClass devclass, uint8_t ID);
+void RCP__latencyResponse(struct RCP__Latency* latency, RCP_DeviceClass devclass, uint8_t ID);
+void RCP__latencyRecord(struct RCP__Latency* latency, RCP_DeviceClass devclass, uint64_t ns);
+
+// Redlines, see RCP_Limits.h. Checks a reading against the rules for its device and takes the action of any that
+// trip, returning the first error that raised
+RCP_Error RCP__limitsCheck(RCP_Context* ctx, RCP_Limits* limits, RCP_DeviceClass devclass, uint32_t timestamp,
+                           uint8_t ID, const float* data, size_t n);
+
+// Columnar store, see RCP_Store.h. Appended to by the receiving thread
+void RCP__storeAppend(RCP_Store* store, RCP_DeviceClass devclass, uint32_t timestamp, uint8_t ID, const float* data,
+                      size_t n);
+
+// Process a packet that is already known to be length bytes long, such as a capture record, as though ctx had received
+// it, but without the stream parser or any partial packet it holds. A packet whose own length does not match is dropped
+// and counted as discarded, and returns RCP_ERR_MALFORMED_PACKET
+RCP_Error RCP__dispatchWhole(RCP_Context* ctx, const uint8_t* pkt, size_t length);
+
+// RCP_ctx_pollNonBlocking, stopping after maxReads reads of the link even if it has more ready
+RCP_Error RCP__pollTransport(RCP_Context* ctx, size_t maxReads);
+
+struct RCP_Context {
+    // Callbacks provided at creation, and the user pointer handed back to each of them
+    struct RCP_CtxCallbacks callbacks;
+    void* user;
+
+    // Where packets are sent and received bytes read from. The sendData and readData callbacks unless a transport has
+    // been attached with RCP_ctx_setTransport, in which case ioUser is the transport
+    size_t (*sendBytes)(void* user, const void* data, size_t length);
+    size_t (*readBytes)(void* user, void* data, size_t length);
+    void* ioUser;
+
+    // Skips received bytes without keeping them, for dropping packets nobody subscribed to. NULL if the link has no way
+    // to, in which case they are read and thrown away. ioUser is passed to it as well
+    size_t (*skipBytes)(void* user, size_t length);
+
+    // Stores some basic state
+    RCP_Channel channel;
+
+    // Context that packets on the other channel are processed by, see RCP_ctx_setChannelPeer. NULL drops them
+    RCP_Context* channelPeer;
+    RCP_PromptDataType activePromptType;
+
+    // Receive and transmit sides have separate buffers, so a callback run while a received packet is being processed
+    // can send without overwriting the packet. rxBuffer holds the packet being received, and txBuffer the packet
+    // being built by a send function
+    uint8_t* rxBuffer;
+    uint8_t txBuffer[RCP_MAX_TX_PACKET];
+
+    // Outgoing packets queued between RCP_ctx_beginBatch and RCP_ctx_flush. txFlushSize and txDeadlineUs are the
+    // automatic flush thresholds, 0 meaning unused, and txFirstUs is when the oldest queued packet was added
+    int txBatching;
+    uint8_t* txQueue;
+    size_t txLen;
+    size_t txFlushSize;
+    uint32_t txDeadlineUs;
+    uint64_t txFirstUs;
+
+    // Device class and ID of each write in the batch when latency is measured, so its round trip starts when it is
+    // sent. Writes are at least 4 bytes, so a full batch never holds more
+    uint16_t txWrites[RCP_MAX_TX_BATCH / 4];
+    size_t txWriteLen;
+
+    // Raw packet tap, and the user pointer handed to it
+    RCP_PacketTap tap;
+    void* tapUser;
+
+    // Complete packets received, whether or not they were processed. Lets RCP_ctx_pollNonBlocking tell whether a call
+    // finished any
+    uint64_t received;
+
+    // Partial packet state for RCP_ctx_feed. feedHave is how many bytes of the current packet are in rxBuffer, and
+    // feedNeed is the total length of that packet, or 0 if the header has not been completely received yet
+    size_t feedHave;
+    size_t feedNeed;
+
+    // Resync mode, see RCP_setResync. The candidate packet starts rxStart bytes into rxBuffer and feedHave of its bytes
+    // have arrived. feedNeed is unused. discarded counts the bytes dropped while looking for a packet
+    int resync;
+    size_t rxStart;
+    uint64_t discarded;
+
+    // Framing, see RCP_setFraming. frameBuffer is allocated when framing is first turned on. It collects the encoded
+    // bytes of a frame split across calls, and frames are decoded into it. frameHunting is set after a frame too long
+    // to be valid, until its delimiter comes along. txFrame holds the framed form of txBuffer
+    RCP_Framing framing;
+    uint8_t* frameBuffer;
+    size_t frameHave;
+    int frameHunting;
+    uint8_t txFrame[RCP_MAX_TX_FRAME];
+
+    // Subscription filter, see RCP_ctx_subscribe. Allocated the first time it is used, and NULL or with filtering unset
+    // when every packet is wanted
+    struct RCP__Filter* filter;
+
+    // Latest reading table, see RCP_ctx_trackLatest. NULL unless it was asked for
+    struct RCP__Latest* latest;
+
+    // Columnar store readings are appended to, see RCP_ctx_setStore. Not owned by the context
+    RCP_Store* store;
+
+    // Statistics, see RCP_ctx_trackStats. NULL unless they were asked for
+    struct RCP__Stats* stats;
+
+    // Round trip latency of writes, see RCP_ctx_trackLatency. NULL unless it was asked for
+    struct RCP__Latency* latency;
+
+    // Redlines readings are checked against, see RCP_ctx_setLimits. Not owned by the context
+    RCP_Limits* limits;
+
+    // Readings collected by arity while processing an amalgamation unit, for the optional batch callbacks
+    int inAmalg;
+    struct RCP_1F batch1F[RCP_MAX_BATCH];
+    struct RCP_2F batch2F[RCP_MAX_BATCH];
+    struct RCP_3F batch3F[RCP_MAX_BATCH];
+    struct RCP_4F batch4F[RCP_MAX_BATCH];
+    size_t batch1FLen;
+    size_t batch2FLen;
+    size_t batch3FLen;
+    size_t batch4FLen;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RCP_INTERNAL_H
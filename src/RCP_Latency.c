@@ -0,0 +1,158 @@
+#include "RCP_Host/RCP_Latency.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "RCP_Internal.h"
+
+// Bucket layout. Values below 2 * HALF each get a bucket. Above that, each power of two is split into HALF buckets,
+// so a bucket is never wider than 1/HALF of the values in it. Values of 2^(MAX_MSB + 1) or more go in the last bucket
+#define HALF 64
+#define MAX_MSB 40
+#define BUCKETS ((MAX_MSB - 4) * HALF)
+
+struct Histogram {
+    atomic_uint_least64_t count;
+    atomic_uint_least64_t sum;
+    atomic_uint_least64_t min;
+    atomic_uint_least64_t max;
+    atomic_uint_least64_t buckets[BUCKETS];
+};
+
+struct RCP__Latency {
+    // Monotonic time of the oldest unanswered write to each device, or 0 if there is none. Set by whichever thread
+    // sends, and taken by the receiving thread
+    atomic_uint_least64_t pending[RCP_LATENCY_CLASSES][256];
+
+    struct Histogram classes[RCP_LATENCY_CLASSES];
+};
+
+static int writable(RCP_DeviceClass devclass) {
+    return devclass == RCP_DEVCLASS_SIMPLE_ACTUATOR || devclass == RCP_DEVCLASS_STEPPER ||
+           devclass == RCP_DEVCLASS_ANGLED_ACTUATOR || devclass == RCP_DEVCLASS_MOTOR;
+}
+
+static unsigned msb(uint64_t v) {
+    unsigned n = 0;
+    while(v >>= 1) n++;
+    return n;
+}
+
+static size_t bucketOf(uint64_t ns) {
+    if(ns < 2 * HALF) return ns;
+
+    unsigned top = msb(ns);
+    if(top > MAX_MSB) return BUCKETS - 1;
+
+    unsigned shift = top - 6;
+    return (shift + 1) * HALF + (size_t) ((ns >> shift) - HALF);
+}
+
+// The highest value that goes in bucket i
+static uint64_t bucketTop(size_t i) {
+    if(i < 2 * HALF) return i;
+
+    unsigned shift = i / HALF - 1;
+    return (((uint64_t) (i % HALF + HALF + 1)) << shift) - 1;
+}
+
+struct RCP__Latency* RCP__latencyCreate(void) {
+    struct RCP__Latency* l = malloc(sizeof(struct RCP__Latency));
+    if(l == NULL) return NULL;
+
+    for(size_t i = 0; i < RCP_LATENCY_CLASSES; i++) {
+        for(size_t j = 0; j < 256; j++) atomic_init(&l->pending[i][j], 0);
+
+        struct Histogram* h = &l->classes[i];
+        atomic_init(&h->count, 0);
+        atomic_init(&h->sum, 0);
+        atomic_init(&h->min, UINT64_MAX);
+        atomic_init(&h->max, 0);
+        for(size_t j = 0; j < BUCKETS; j++) atomic_init(&h->buckets[j], 0);
+    }
+
+    return l;
+}
+
+void RCP__latencyFree(struct RCP__Latency* latency) { free(latency); }
+
+void RCP__latencyWrite(struct RCP__Latency* latency, RCP_DeviceClass devclass, uint8_t ID) {
+    uint_least64_t none = 0;
+    atomic_compare_exchange_strong_explicit(&latency->pending[devclass][ID], &none, RCP__monotonicNs(),
+                                            memory_order_relaxed, memory_order_relaxed);
+}
+
+void RCP__latencyRecord(struct RCP__Latency* latency, RCP_DeviceClass devclass, uint64_t ns) {
+    struct Histogram* h = &latency->classes[devclass];
+    RCP__BUMP(h->buckets[bucketOf(ns)], 1);
+    RCP__BUMP(h->sum, ns);
+    if(ns < RCP__LOAD(h->min)) atomic_store_explicit(&h->min, ns, memory_order_relaxed);
+    if(ns > RCP__LOAD(h->max)) atomic_store_explicit(&h->max, ns, memory_order_relaxed);
+    RCP__BUMP(h->count, 1);
+}
+
+void RCP__latencyResponse(struct RCP__Latency* latency, RCP_DeviceClass devclass, uint8_t ID) {
+    if((unsigned) devclass >= RCP_LATENCY_CLASSES || RCP__LOAD(latency->pending[devclass][ID]) == 0) return;
+
+    uint64_t sent = atomic_exchange_explicit(&latency->pending[devclass][ID], 0, memory_order_relaxed);
+    if(sent != 0) RCP__latencyRecord(latency, devclass, RCP__monotonicNs() - sent);
+}
+
+// Value at percent through the histogram, or 0 if it is empty
+static uint64_t percentile(const struct Histogram* h, double percent) {
+    uint64_t count = RCP__LOAD(h->count);
+    if(count == 0) return 0;
+
+    if(percent < 0) percent = 0;
+    if(percent > 100) percent = 100;
+
+    // The rank of the value wanted, counting from 1
+    uint64_t rank = (uint64_t) (percent / 100 * (double) count + 0.5);
+    if(rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for(size_t i = 0; i < BUCKETS; i++) {
+        seen += RCP__LOAD(h->buckets[i]);
+        if(seen >= rank) {
+            uint64_t max = RCP__LOAD(h->max);
+            return i == BUCKETS - 1 || bucketTop(i) > max ? max : bucketTop(i);
+        }
+    }
+
+    // The count was bumped after a bucket that was read already
+    return RCP__LOAD(h->max);
+}
+
+RCP_Error RCP_ctx_trackLatency(RCP_Context* ctx) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+    if(ctx->latency != NULL) return RCP_ERR_SUCCESS;
+
+    ctx->latency = RCP__latencyCreate();
+    return ctx->latency == NULL ? RCP_ERR_MEMALLOC : RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_ctx_getLatency(const RCP_Context* ctx, RCP_DeviceClass devclass, struct RCP_LatencySummary* summary) {
+    if(ctx == NULL || ctx->latency == NULL || summary == NULL) return RCP_ERR_INIT;
+    if((unsigned) devclass > 0xFF || !writable(devclass)) return RCP_ERR_INVALID_DEVCLASS;
+
+    const struct Histogram* h = &ctx->latency->classes[devclass];
+    summary->count = RCP__LOAD(h->count);
+    if(summary->count == 0) {
+        *summary = (struct RCP_LatencySummary) {0};
+        return RCP_ERR_SUCCESS;
+    }
+
+    summary->minNs = RCP__LOAD(h->min);
+    summary->maxNs = RCP__LOAD(h->max);
+    summary->meanNs = RCP__LOAD(h->sum) / summary->count;
+    summary->p50Ns = percentile(h, 50);
+    summary->p90Ns = percentile(h, 90);
+    summary->p99Ns = percentile(h, 99);
+    summary->p999Ns = percentile(h, 99.9);
+    return RCP_ERR_SUCCESS;
+}
+
+uint64_t RCP_ctx_latencyPercentile(const RCP_Context* ctx, RCP_DeviceClass devclass, double percent) {
+    if(ctx == NULL || ctx->latency == NULL || (unsigned) devclass > 0xFF || !writable(devclass)) return 0;
+    return percentile(&ctx->latency->classes[devclass], percent);
+}
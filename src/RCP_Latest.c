@@ -0,0 +1,141 @@
+#include "RCP_Host/RCP_Latest.h"
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "RCP_Internal.h"
+
+// One device's entry. seq is odd while the receiving thread is writing it, and readers copy the entry and try again
+// unless seq was even and unchanged around the copy. The fields are atomics only so that copying them during a write
+// is not a data race, it is seq that makes the copy consistent. Each entry has its own cache line, so readers of one
+// device do not disturb writes to its neighbours
+struct Slot {
+    alignas(RCP_CACHE_LINE) atomic_uint seq;
+    atomic_uint_least32_t timestamp;
+    atomic_uint_least32_t data[4];
+    atomic_uint_least64_t hostTimeNs;
+    atomic_uint_least64_t updates;
+};
+
+// Entries for every ID of a class, allocated the first time the class is heard from
+struct Class {
+    struct Slot slots[256];
+};
+
+struct RCP__Latest {
+    struct RCP__Devices* devices;
+};
+
+static void initClass(void* table) {
+    struct Class* c = table;
+    for(size_t i = 0; i < 256; i++) {
+        struct Slot* s = &c->slots[i];
+        atomic_init(&s->seq, 0);
+        atomic_init(&s->timestamp, 0);
+        for(size_t j = 0; j < 4; j++) atomic_init(&s->data[j], 0);
+        atomic_init(&s->hostTimeNs, 0);
+        atomic_init(&s->updates, 0);
+    }
+}
+
+struct RCP__Latest* RCP__latestCreate(void) {
+    struct RCP__Latest* t = malloc(sizeof(struct RCP__Latest));
+    if(t == NULL) return NULL;
+
+    t->devices = RCP__devicesCreate(sizeof(struct Class), initClass);
+    if(t->devices == NULL) {
+        free(t);
+        return NULL;
+    }
+
+    return t;
+}
+
+void RCP__latestFree(struct RCP__Latest* table) {
+    if(table == NULL) return;
+
+    RCP__devicesFree(table->devices, NULL);
+    free(table);
+}
+
+void RCP__latestRecord(struct RCP__Latest* table, RCP_DeviceClass devclass, uint32_t timestamp, uint8_t ID,
+                       const float* data, size_t n) {
+    struct Class* c = RCP__devicesClass(table->devices, devclass);
+    if(c == NULL) return;
+
+    struct Slot* s = &c->slots[ID];
+    unsigned seq = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    uint64_t updates = atomic_load_explicit(&s->updates, memory_order_relaxed);
+
+    atomic_store_explicit(&s->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&s->timestamp, timestamp, memory_order_relaxed);
+    for(size_t i = 0; i < 4; i++) {
+        uint32_t bits = 0;
+        if(i < n) memcpy(&bits, &data[i], sizeof(bits));
+        atomic_store_explicit(&s->data[i], bits, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&s->hostTimeNs, RCP__monotonicNs(), memory_order_relaxed);
+    atomic_store_explicit(&s->updates, updates + 1, memory_order_relaxed);
+    atomic_store_explicit(&s->seq, seq + 2, memory_order_release);
+
+    // A new device is listed once its entry is filled in
+    if(updates == 0) RCP__devicesAdd(table->devices, RCP_FQDN(devclass, ID));
+}
+
+// Copy a device's entry, waiting out any write in progress. Returns 0 if it has never been written
+static int readSlot(const struct RCP__Latest* table, uint16_t fqdn, struct RCP_Latest* latest) {
+    const struct Class* c = RCP__devicesFind(table->devices, fqdn >> 8);
+    if(c == NULL) return 0;
+
+    const struct Slot* s = &c->slots[fqdn & 0xFF];
+    for(;;) {
+        unsigned before = atomic_load_explicit(&s->seq, memory_order_acquire);
+        if(before & 1) continue;
+
+        latest->timestamp = atomic_load_explicit(&s->timestamp, memory_order_relaxed);
+        for(size_t i = 0; i < 4; i++) {
+            uint32_t bits = atomic_load_explicit(&s->data[i], memory_order_relaxed);
+            memcpy(&latest->data[i], &bits, sizeof(bits));
+        }
+
+        latest->hostTimeNs = atomic_load_explicit(&s->hostTimeNs, memory_order_relaxed);
+        latest->updates = atomic_load_explicit(&s->updates, memory_order_relaxed);
+
+        atomic_thread_fence(memory_order_acquire);
+        if(atomic_load_explicit(&s->seq, memory_order_relaxed) == before) break;
+    }
+
+    latest->devclass = fqdn >> 8;
+    latest->ID = fqdn & 0xFF;
+    return latest->updates != 0;
+}
+
+RCP_Error RCP_ctx_trackLatest(RCP_Context* ctx) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+    if(ctx->latest != NULL) return RCP_ERR_SUCCESS;
+
+    ctx->latest = RCP__latestCreate();
+    return ctx->latest == NULL ? RCP_ERR_MEMALLOC : RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_ctx_getLatest(const RCP_Context* ctx, RCP_DeviceClass devclass, uint8_t ID, struct RCP_Latest* latest) {
+    if(ctx == NULL || ctx->latest == NULL || latest == NULL) return RCP_ERR_INIT;
+    if((unsigned) devclass > 0xFF) return RCP_ERR_INVALID_DEVCLASS;
+
+    return readSlot(ctx->latest, RCP_FQDN(devclass, ID), latest) ? RCP_ERR_SUCCESS : RCP_ERR_NO_READING;
+}
+
+size_t RCP_ctx_snapshotLatest(const RCP_Context* ctx, struct RCP_Latest* latest, size_t capacity) {
+    if(ctx == NULL || ctx->latest == NULL) return 0;
+    if(latest == NULL) capacity = 0;
+
+    const uint16_t* order;
+    size_t count = RCP__devicesList(ctx->latest->devices, &order);
+    for(size_t i = 0; i < count && i < capacity; i++) readSlot(ctx->latest, order[i], &latest[i]);
+    return count;
+}
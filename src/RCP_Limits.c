@@ -0,0 +1,239 @@
+#include "RCP_Host/RCP_Limits.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "RCP_Internal.h"
+
+struct Rule {
+    // Position in the rules as they were given
+    size_t index;
+
+    uint8_t channel;
+    uint8_t consecutive;
+    RCP_LimitKind kind;
+    RCP_LimitAction action;
+    float threshold;
+
+    // Only touched by the receiving thread. count is how many readings in a row have broken the rule, and last the
+    // previous reading, for rates
+    uint8_t count;
+    int haveLast;
+    float last;
+    uint32_t lastTimestamp;
+};
+
+// Where a device's rules are in the table
+struct Range {
+    uint32_t start;
+    uint32_t count;
+};
+
+struct RCP_Limits {
+    // Sorted by device, so each device's rules are together
+    struct Rule* rules;
+    size_t n;
+
+    // Ranges for every ID of a class, for classes with rules
+    struct Range* classes[256];
+
+    RCP_LimitTrip onTrip;
+    void* user;
+
+    // By position in the rules as they were given. Set by the receiving thread and cleared by rearming
+    atomic_int* tripped;
+    atomic_uint_least64_t trips;
+};
+
+static int byDevice(const void* a, const void* b) {
+    const struct RCP_LimitRule* const* x = a;
+    const struct RCP_LimitRule* const* y = b;
+    uint16_t fx = (uint16_t) (((*x)->devclass << 8) | (*x)->ID);
+    uint16_t fy = (uint16_t) (((*y)->devclass << 8) | (*y)->ID);
+    if(fx != fy) return fx < fy ? -1 : 1;
+
+    // Rules for the same device are checked in the order they were given
+    return *x < *y ? -1 : *x > *y;
+}
+
+static RCP_Error validate(const struct RCP_LimitRule* rule) {
+    if((unsigned) rule->devclass > 0xFF || !(RCP__devclasses[rule->devclass].flags & RCP_DC_IDENTIFIED))
+        return RCP_ERR_INVALID_DEVCLASS;
+
+    uint8_t arity = RCP__devclasses[rule->devclass].arity;
+    if(rule->channel >= (arity == 0 ? 1 : arity)) return RCP_ERR_INIT;
+    if((unsigned) rule->kind > RCP_LIMIT_RATE_BELOW) return RCP_ERR_INIT;
+    if((unsigned) rule->action > RCP_LIMIT_CALLBACK) return RCP_ERR_INIT;
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_limits_compile(const struct RCP_LimitRule* rules, size_t n, RCP_LimitTrip onTrip, void* user,
+                             RCP_Limits** limits) {
+    if(limits == NULL || (rules == NULL && n != 0) || n > UINT32_MAX) return RCP_ERR_INIT;
+
+    for(size_t i = 0; i < n; i++) {
+        RCP_Error rerrno = validate(&rules[i]);
+        if(rerrno != RCP_ERR_SUCCESS) return rerrno;
+
+        // A callback rule with nothing to call would trip and do nothing
+        if(rules[i].action == RCP_LIMIT_CALLBACK && onTrip == NULL) return RCP_ERR_INIT;
+    }
+
+    RCP_Limits* l = calloc(1, sizeof(RCP_Limits));
+    const struct RCP_LimitRule** sorted = malloc((n == 0 ? 1 : n) * sizeof(*sorted));
+    if(l == NULL || sorted == NULL) goto nomem;
+
+    l->rules = calloc(n == 0 ? 1 : n, sizeof(struct Rule));
+    l->tripped = malloc((n == 0 ? 1 : n) * sizeof(atomic_int));
+    if(l->rules == NULL || l->tripped == NULL) goto nomem;
+
+    for(size_t i = 0; i < n; i++) sorted[i] = &rules[i];
+    qsort(sorted, n, sizeof(*sorted), byDevice);
+
+    for(size_t i = 0; i < n; i++) {
+        const struct RCP_LimitRule* in = sorted[i];
+        struct Rule* r = &l->rules[i];
+        r->index = (size_t) (in - rules);
+        r->channel = in->channel;
+        r->consecutive = in->consecutive == 0 ? 1 : in->consecutive;
+        r->kind = in->kind;
+        r->action = in->action;
+        r->threshold = in->threshold;
+
+        struct Range** ranges = &l->classes[(uint8_t) in->devclass];
+        if(*ranges == NULL) {
+            *ranges = calloc(256, sizeof(struct Range));
+            if(*ranges == NULL) goto nomem;
+        }
+
+        struct Range* range = &(*ranges)[in->ID];
+        if(range->count == 0) range->start = (uint32_t) i;
+        range->count++;
+        atomic_init(&l->tripped[i], 0);
+    }
+
+    l->n = n;
+    l->onTrip = onTrip;
+    l->user = user;
+    atomic_init(&l->trips, 0);
+    free(sorted);
+    *limits = l;
+    return RCP_ERR_SUCCESS;
+
+nomem:
+    free(sorted);
+    RCP_limits_destroy(l);
+    return RCP_ERR_MEMALLOC;
+}
+
+RCP_Error RCP_limits_destroy(RCP_Limits* limits) {
+    if(limits == NULL) return RCP_ERR_INIT;
+
+    for(size_t i = 0; i < 256; i++) free(limits->classes[i]);
+    free(limits->rules);
+    free(limits->tripped);
+    free(limits);
+    return RCP_ERR_SUCCESS;
+}
+
+int RCP_limits_isTripped(const RCP_Limits* limits, size_t rule) {
+    if(limits == NULL || rule >= limits->n) return 0;
+    return atomic_load_explicit(&limits->tripped[rule], memory_order_relaxed);
+}
+
+uint64_t RCP_limits_trips(const RCP_Limits* limits) {
+    return limits == NULL ? 0 : atomic_load_explicit(&limits->trips, memory_order_relaxed);
+}
+
+RCP_Error RCP_limits_rearm(RCP_Limits* limits) {
+    if(limits == NULL) return RCP_ERR_INIT;
+
+    for(size_t i = 0; i < limits->n; i++) atomic_store_explicit(&limits->tripped[i], 0, memory_order_relaxed);
+    return RCP_ERR_SUCCESS;
+}
+
+// Whether the reading value at timestamp breaks r, setting seen to what was compared with the threshold. Rate rules
+// are never broken by a device's first reading, or one that is not newer than the last
+static int broken(struct Rule* r, float value, uint32_t timestamp, float* seen) {
+    *seen = value;
+
+    // NaN compares false with everything, so a sensor that fails that way would otherwise keep resetting the count.
+    // Left out of rates too, so the next good reading is compared with the last good one
+    if(!isfinite(value)) return 1;
+
+    switch(r->kind) {
+    case RCP_LIMIT_ABOVE:
+        return value > r->threshold;
+
+    case RCP_LIMIT_BELOW:
+        return value < r->threshold;
+
+    default: {
+        int32_t ms = (int32_t) (timestamp - r->lastTimestamp);
+        int had = r->haveLast && ms > 0;
+        float last = r->last;
+
+        if(!r->haveLast || ms > 0) {
+            r->last = value;
+            r->lastTimestamp = timestamp;
+            r->haveLast = 1;
+        }
+
+        if(!had) return 0;
+
+        *seen = (value - last) * 1000.0f / (float) ms;
+        return r->kind == RCP_LIMIT_RATE_ABOVE ? *seen > r->threshold : *seen < r->threshold;
+    }
+    }
+}
+
+RCP_Error RCP__limitsCheck(RCP_Context* ctx, RCP_Limits* limits, RCP_DeviceClass devclass, uint32_t timestamp,
+                           uint8_t ID, const float* data, size_t n) {
+    const struct Range* ranges = limits->classes[(uint8_t) devclass];
+    if(ranges == NULL || ranges[ID].count == 0) return RCP_ERR_SUCCESS;
+
+    RCP_Error first = RCP_ERR_SUCCESS;
+    int stopped = 0;
+    struct Rule* end = limits->rules + ranges[ID].start + ranges[ID].count;
+    for(struct Rule* r = limits->rules + ranges[ID].start; r < end; r++) {
+        if(r->channel >= n || atomic_load_explicit(&limits->tripped[r->index], memory_order_relaxed)) continue;
+
+        float seen;
+        if(!broken(r, data[r->channel], timestamp, &seen)) {
+            r->count = 0;
+            continue;
+        }
+
+        if(++r->count < r->consecutive) continue;
+
+        // Tripped. The rule starts over once it is rearmed
+        r->count = 0;
+        r->haveLast = 0;
+        atomic_store_explicit(&limits->tripped[r->index], 1, memory_order_relaxed);
+        RCP__BUMP(limits->trips, 1);
+
+        // However many rules one reading trips, one EStop is enough
+        RCP_Error rerrno = RCP_ERR_SUCCESS;
+        if(r->action == RCP_LIMIT_ESTOP && !stopped) {
+            stopped = 1;
+            rerrno = RCP_ctx_sendEStop(ctx);
+        }
+
+        if(limits->onTrip != NULL) {
+            RCP_Error cerr = limits->onTrip(ctx, limits->user, r->index, seen);
+            if(rerrno == RCP_ERR_SUCCESS) rerrno = cerr;
+        }
+
+        if(first == RCP_ERR_SUCCESS) first = rerrno;
+    }
+
+    return first;
+}
+
+RCP_Error RCP_ctx_setLimits(RCP_Context* ctx, RCP_Limits* limits) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+
+    ctx->limits = limits;
+    return RCP_ERR_SUCCESS;
+}
@@ -0,0 +1,398 @@
+#include "RCP_Host/RCP_Parallel.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "RCP_Host/RCP_Capture.h"
+#include "RCP_Host/RCP_Index.h"
+#include "RCP_Host/RCP_Replay.h"
+#include "RCP_Internal.h"
+
+// Chunks per thread. More chunks than threads evens out chunks that decode slower than others
+#define CHUNKS_PER_THREAD 4
+
+// Readings of one device within a chunk
+struct Part {
+    RCP_DeviceClass devclass;
+    uint8_t ID;
+    uint8_t arity;
+    size_t len;
+    size_t cap;
+    struct RCP_DecodedReading* readings;
+};
+
+struct Chunk {
+    // Records from start up to but not including end
+    uint64_t start;
+    uint64_t end;
+
+    // Where the target clock stood at start, then advanced as the chunk is decoded
+    struct RCP__Timeline timeline;
+
+    // Devices in the order they were first seen, and the one last added to, which is usually the next one too
+    struct Part* parts;
+    size_t len;
+    size_t cap;
+    size_t last;
+
+    RCP_Error decodeError;
+    int failed;
+};
+
+struct Job {
+    const char* path;
+    RCP_Channel channel;
+    struct Chunk* chunks;
+    size_t len;
+    atomic_size_t next;
+};
+
+struct Worker {
+    struct Job* job;
+    struct Chunk* chunk;
+    pthread_t thread;
+    RCP_Error rerrno;
+};
+
+static RCP_Error add(struct Chunk* chunk, RCP_DeviceClass devclass, uint8_t ID, uint8_t arity, uint32_t timestamp,
+                     const float* data) {
+    struct Part* part = NULL;
+    if(chunk->len != 0 && chunk->parts[chunk->last].devclass == devclass && chunk->parts[chunk->last].ID == ID)
+        part = chunk->parts + chunk->last;
+
+    for(size_t i = 0; part == NULL && i < chunk->len; i++) {
+        if(chunk->parts[i].devclass == devclass && chunk->parts[i].ID == ID) {
+            part = chunk->parts + i;
+            chunk->last = i;
+        }
+    }
+
+    if(part == NULL) {
+        if(chunk->len == chunk->cap) {
+            size_t cap = chunk->cap == 0 ? 16 : chunk->cap * 2;
+            struct Part* parts = realloc(chunk->parts, cap * sizeof(struct Part));
+            if(parts == NULL) goto failed;
+
+            chunk->parts = parts;
+            chunk->cap = cap;
+        }
+
+        chunk->last = chunk->len++;
+        part = chunk->parts + chunk->last;
+        *part = (struct Part) {.devclass = devclass, .ID = ID, .arity = arity};
+    }
+
+    if(part->len == part->cap) {
+        size_t cap = part->cap == 0 ? 256 : part->cap * 2;
+        struct RCP_DecodedReading* readings = realloc(part->readings, cap * sizeof(struct RCP_DecodedReading));
+        if(readings == NULL) goto failed;
+
+        part->readings = readings;
+        part->cap = cap;
+    }
+
+    struct RCP_DecodedReading* r = part->readings + part->len++;
+    *r = (struct RCP_DecodedReading) {.targetMs = RCP__timelineAt(&chunk->timeline, timestamp),
+                                      .epoch = chunk->timeline.epoch};
+    memcpy(r->data, data, arity * sizeof(float));
+    return RCP_ERR_SUCCESS;
+
+failed:
+    chunk->failed = 1;
+    return RCP_ERR_MEMALLOC;
+}
+
+static RCP_Error onBool(void* user, struct RCP_BoolData d) {
+    float data = d.data ? 1.0f : 0.0f;
+    return add(((struct Worker*) user)->chunk, RCP_DEVCLASS_BOOL_SENSOR, d.ID, 1, d.timestamp, &data);
+}
+
+static RCP_Error onSimpleActuator(void* user, struct RCP_SimpleActuatorData d) {
+    float data = d.state == RCP_SIMPLE_ACTUATOR_ON ? 1.0f : 0.0f;
+    return add(((struct Worker*) user)->chunk, RCP_DEVCLASS_SIMPLE_ACTUATOR, d.ID, 1, d.timestamp, &data);
+}
+
+static RCP_Error on1F(void* user, struct RCP_1F d) {
+    return add(((struct Worker*) user)->chunk, d.devclass, d.ID, 1, d.timestamp, &d.data);
+}
+
+static RCP_Error on2F(void* user, struct RCP_2F d) {
+    return add(((struct Worker*) user)->chunk, d.devclass, d.ID, 2, d.timestamp, d.data);
+}
+
+static RCP_Error on3F(void* user, struct RCP_3F d) {
+    return add(((struct Worker*) user)->chunk, d.devclass, d.ID, 3, d.timestamp, d.data);
+}
+
+static RCP_Error on4F(void* user, struct RCP_4F d) {
+    return add(((struct Worker*) user)->chunk, d.devclass, d.ID, 4, d.timestamp, d.data);
+}
+
+static size_t noSend(void* user, const void* data, size_t length) {
+    (void) user;
+    (void) data;
+    return length;
+}
+
+static size_t noRead(void* user, void* data, size_t length) {
+    (void) user;
+    (void) data;
+    (void) length;
+    return 0;
+}
+
+static RCP_Error ignoreTest(void* user, struct RCP_TestData d) {
+    (void) user;
+    (void) d;
+    return RCP_ERR_SUCCESS;
+}
+
+static RCP_Error ignorePrompt(void* user, struct RCP_PromptInputRequest r) {
+    (void) user;
+    (void) r;
+    return RCP_ERR_SUCCESS;
+}
+
+static RCP_Error ignoreLog(void* user, struct RCP_TargetLogData d) {
+    (void) user;
+    (void) d;
+    return RCP_ERR_SUCCESS;
+}
+
+// Worker thread. Takes chunks off the job until there are none left, decoding each through its own context
+static void* workerMain(void* arg) {
+    struct Worker* w = arg;
+    struct Job* job = w->job;
+
+    struct RCP_CtxCallbacks callbacks = {.sendData = noSend,
+                                         .readData = noRead,
+                                         .processTestUpdate = ignoreTest,
+                                         .processBoolData = onBool,
+                                         .processSimpleActuatorData = onSimpleActuator,
+                                         .processPromptInput = ignorePrompt,
+                                         .processTargetLog = ignoreLog,
+                                         .processOneFloat = on1F,
+                                         .processTwoFloat = on2F,
+                                         .processThreeFloat = on3F,
+                                         .processFourFloat = on4F};
+
+    RCP_Replay* replay = NULL;
+    w->rerrno = RCP_replay_open(job->path, &replay);
+
+    while(w->rerrno == RCP_ERR_SUCCESS) {
+        size_t i = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+        if(i >= job->len) break;
+
+        // A fresh context per chunk, so nothing a malformed record leaves half parsed carries into the next chunk
+        RCP_Context* ctx = NULL;
+        w->rerrno = RCP_ctx_create(callbacks, w, &ctx);
+        if(w->rerrno != RCP_ERR_SUCCESS) break;
+
+        struct Chunk* chunk = job->chunks + i;
+        w->chunk = chunk;
+        RCP_ctx_setChannel(ctx, job->channel);
+        RCP_replay_seek(replay, chunk->start);
+
+        struct RCP_CaptureRecord record;
+        while(!chunk->failed && RCP_replay_tell(replay) < chunk->end && RCP_replay_next(replay, &record)) {
+            // The other channel may carry another target, whose clock is nothing to do with this one
+            if(record.channel != job->channel) continue;
+
+            uint32_t ts;
+            if(RCP__packetTimestamp(record.pkt, record.length, &ts)) RCP__timelineAdvance(&chunk->timeline, ts);
+
+            RCP_Error rerrno = RCP__dispatchWhole(ctx, record.pkt, record.length);
+            if(chunk->decodeError == RCP_ERR_SUCCESS) chunk->decodeError = rerrno;
+        }
+
+        RCP_ctx_destroy(ctx);
+    }
+
+    if(replay != NULL) RCP_replay_close(replay);
+    return NULL;
+}
+
+// Split the capture at indexed records into chunks of roughly equal size, at most want of them. Chunks after the first
+// start on an index entry of the channel, so where its target clock stood there is known without decoding what came
+// before
+static RCP_Error planChunks(const RCP_Index* index, RCP_Channel channel, uint64_t captureBytes, size_t want,
+                            struct Chunk** chunks, size_t* len) {
+    size_t entries = RCP_index_size(index);
+    const struct RCP_IndexEntry* e = RCP_index_entries(index);
+
+    struct Chunk* c = calloc(entries + 1, sizeof(struct Chunk));
+    if(c == NULL) return RCP_ERR_MEMALLOC;
+
+    uint64_t size = captureBytes / want;
+    size_t n = 1;
+    c[0].start = RCP_CAPTURE_FILE_HEADER_BYTES;
+    RCP__timelineInit(&c[0].timeline);
+
+    for(size_t i = 0; i < entries; i++) {
+        if(n == want || e[i].channel != channel) continue;
+        if(e[i].offset <= c[n - 1].start || e[i].offset - c[n - 1].start < size) continue;
+
+        c[n - 1].end = e[i].offset;
+        c[n].start = e[i].offset;
+        c[n].timeline = (struct RCP__Timeline) {
+            .haveTs = 1, .lastTs = (uint32_t) e[i].targetMs, .wraps = e[i].targetMs >> 32, .epoch = e[i].epoch};
+        n++;
+    }
+
+    c[n - 1].end = UINT64_MAX;
+    *chunks = c;
+    *len = n;
+    return RCP_ERR_SUCCESS;
+}
+
+// Join the parts of every chunk into one series per device. A timestamp that goes backwards is a late reading, a wrap
+// or a new epoch, so apart from late readings target time only ever increases through the capture, and joining the
+// parts in chunk order leaves every series in target time order without sorting
+static RCP_Error merge(const struct Chunk* chunks, size_t len, struct RCP_DecodeResult* result) {
+    // Reading counts and then series positions by device class and ID, which also puts the series in that order
+    size_t* slots = calloc(256 * 256, sizeof(size_t));
+    if(slots == NULL) return RCP_ERR_MEMALLOC;
+
+    size_t devices = 0;
+    for(size_t c = 0; c < len; c++) {
+        for(size_t p = 0; p < chunks[c].len; p++) {
+            const struct Part* part = chunks[c].parts + p;
+            size_t* slot = slots + ((size_t) part->devclass << 8 | part->ID);
+            if(*slot == 0) devices++;
+            *slot += part->len;
+        }
+    }
+
+    result->len = 0;
+    result->series = calloc(devices == 0 ? 1 : devices, sizeof(struct RCP_DecodedSeries));
+    if(result->series == NULL) {
+        free(slots);
+        return RCP_ERR_MEMALLOC;
+    }
+
+    for(size_t s = 0; s < 256 * 256; s++) {
+        if(slots[s] == 0) continue;
+
+        struct RCP_DecodedSeries* series = result->series + result->len;
+        series->devclass = (RCP_DeviceClass) (s >> 8);
+        series->ID = (uint8_t) s;
+        series->readings = malloc(slots[s] * sizeof(struct RCP_DecodedReading));
+        if(series->readings == NULL) {
+            free(slots);
+            return RCP_ERR_MEMALLOC;
+        }
+
+        slots[s] = result->len++;
+    }
+
+    for(size_t c = 0; c < len; c++) {
+        for(size_t p = 0; p < chunks[c].len; p++) {
+            const struct Part* part = chunks[c].parts + p;
+            struct RCP_DecodedSeries* series = result->series + slots[(size_t) part->devclass << 8 | part->ID];
+            series->arity = part->arity;
+            memcpy(series->readings + series->len, part->readings, part->len * sizeof(struct RCP_DecodedReading));
+            series->len += part->len;
+        }
+    }
+
+    free(slots);
+    return RCP_ERR_SUCCESS;
+}
+
+static void freeChunks(struct Chunk* chunks, size_t len) {
+    for(size_t c = 0; c < len; c++) {
+        for(size_t p = 0; p < chunks[c].len; p++) free(chunks[c].parts[p].readings);
+        free(chunks[c].parts);
+    }
+
+    free(chunks);
+}
+
+RCP_Error RCP_decode_parallel(const char* capturePath, RCP_Channel channel, unsigned threads,
+                              struct RCP_DecodeResult** result) {
+    if(capturePath == NULL || result == NULL) return RCP_ERR_INIT;
+    *result = NULL;
+
+    if(threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (unsigned) online : 1;
+    }
+
+    struct stat st;
+    if(stat(capturePath, &st) != 0) return RCP_ERR_IO_FILE;
+
+    RCP_Index* index = NULL;
+    RCP_Error rerrno = RCP_index_open(capturePath, &index);
+    if(rerrno != RCP_ERR_SUCCESS) return rerrno;
+
+    struct Job job = {.path = capturePath, .channel = channel};
+    atomic_init(&job.next, 0);
+    rerrno = planChunks(index, channel, (uint64_t) st.st_size, (size_t) threads * CHUNKS_PER_THREAD, &job.chunks,
+                        &job.len);
+    RCP_index_close(index);
+    if(rerrno != RCP_ERR_SUCCESS) return rerrno;
+
+    if(threads > job.len) threads = (unsigned) job.len;
+    struct Worker* workers = calloc(threads, sizeof(struct Worker));
+    if(workers == NULL) {
+        freeChunks(job.chunks, job.len);
+        return RCP_ERR_MEMALLOC;
+    }
+
+    unsigned started = 0;
+    for(; started < threads; started++) {
+        workers[started].job = &job;
+        if(pthread_create(&workers[started].thread, NULL, workerMain, workers + started) != 0) {
+            rerrno = RCP_ERR_MEMALLOC;
+            break;
+        }
+    }
+
+    // Whatever threads did start still get through every chunk between them
+    if(started == 0) {
+        free(workers);
+        freeChunks(job.chunks, job.len);
+        return rerrno;
+    }
+
+    rerrno = RCP_ERR_SUCCESS;
+    for(unsigned t = 0; t < started; t++) {
+        pthread_join(workers[t].thread, NULL);
+        if(rerrno == RCP_ERR_SUCCESS) rerrno = workers[t].rerrno;
+    }
+
+    free(workers);
+
+    RCP_Error decodeError = RCP_ERR_SUCCESS;
+    for(size_t c = 0; c < job.len; c++) {
+        if(job.chunks[c].failed) rerrno = RCP_ERR_MEMALLOC;
+        if(decodeError == RCP_ERR_SUCCESS) decodeError = job.chunks[c].decodeError;
+    }
+
+    struct RCP_DecodeResult* r = NULL;
+    if(rerrno == RCP_ERR_SUCCESS) {
+        r = calloc(1, sizeof(struct RCP_DecodeResult));
+        rerrno = r == NULL ? RCP_ERR_MEMALLOC : merge(job.chunks, job.len, r);
+    }
+
+    freeChunks(job.chunks, job.len);
+    if(rerrno != RCP_ERR_SUCCESS) {
+        RCP_decode_free(r);
+        return rerrno;
+    }
+
+    *result = r;
+    return decodeError;
+}
+
+void RCP_decode_free(struct RCP_DecodeResult* result) {
+    if(result == NULL) return;
+
+    for(size_t s = 0; s < result->len; s++) free(result->series[s].readings);
+    free(result->series);
+    free(result);
+}
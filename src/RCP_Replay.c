@@ -0,0 +1,151 @@
+#include "RCP_Host/RCP_Replay.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "RCP_Host/RCP_Capture.h"
+#include "RCP_Internal.h"
+
+struct RCP_Replay {
+    const uint8_t* map;
+    size_t size;
+
+    // Offset of the next record
+    size_t pos;
+};
+
+RCP_Error RCP_replay_open(const char* path, RCP_Replay** replay) {
+    if(path == NULL || replay == NULL) return RCP_ERR_INIT;
+    *replay = NULL;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return RCP_ERR_IO_FILE;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return RCP_ERR_IO_FILE;
+    }
+
+    // Also rules out empty files, which can not be mapped
+    if((size_t) st.st_size < RCP_CAPTURE_FILE_HEADER_BYTES) {
+        close(fd);
+        return RCP_ERR_BAD_CAPTURE;
+    }
+
+    // The mapping holds its own reference to the file, so the descriptor is not needed past this point
+    void* map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) return RCP_ERR_IO_FILE;
+
+    const uint8_t* bytes = map;
+    if(memcmp(bytes, RCP_CAPTURE_MAGIC, 8) != 0 || RCP__loadLE(bytes + 8, 4) != RCP_CAPTURE_VERSION) {
+        munmap(map, (size_t) st.st_size);
+        return RCP_ERR_BAD_CAPTURE;
+    }
+
+    // Replays read front to back, so let the kernel read ahead aggressively
+    madvise(map, (size_t) st.st_size, MADV_SEQUENTIAL);
+
+    RCP_Replay* r = malloc(sizeof(RCP_Replay));
+    if(r == NULL) {
+        munmap(map, (size_t) st.st_size);
+        return RCP_ERR_MEMALLOC;
+    }
+
+    r->map = bytes;
+    r->size = (size_t) st.st_size;
+    r->pos = RCP_CAPTURE_FILE_HEADER_BYTES;
+
+    *replay = r;
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_replay_close(RCP_Replay* replay) {
+    if(replay == NULL) return RCP_ERR_INIT;
+
+    munmap((void*) replay->map, replay->size);
+    free(replay);
+    return RCP_ERR_SUCCESS;
+}
+
+int RCP_replay_next(RCP_Replay* replay, struct RCP_CaptureRecord* record) {
+    if(replay == NULL || record == NULL) return 0;
+
+    size_t left = replay->size - replay->pos;
+    if(left < RCP_CAPTURE_RECORD_HEADER_BYTES) return 0;
+
+    const uint8_t* header = replay->map + replay->pos;
+    size_t length = RCP__loadLE(header + 8, 4);
+    if(length == 0 || length > left - RCP_CAPTURE_RECORD_HEADER_BYTES) return 0;
+
+    record->timeNs = RCP__loadLE(header, 8);
+    record->channel = header[12] & RCP_CHANNEL_MASK;
+    record->length = length;
+    record->pkt = header + RCP_CAPTURE_RECORD_HEADER_BYTES;
+
+    replay->pos += RCP_CAPTURE_RECORD_HEADER_BYTES + length;
+    return 1;
+}
+
+void RCP_replay_rewind(RCP_Replay* replay) {
+    if(replay != NULL) replay->pos = RCP_CAPTURE_FILE_HEADER_BYTES;
+}
+
+uint64_t RCP_replay_tell(const RCP_Replay* replay) { return replay == NULL ? 0 : replay->pos; }
+
+RCP_Error RCP_replay_seek(RCP_Replay* replay, uint64_t offset) {
+    if(replay == NULL || offset < RCP_CAPTURE_FILE_HEADER_BYTES || offset > replay->size) return RCP_ERR_INIT;
+
+    replay->pos = offset;
+    return RCP_ERR_SUCCESS;
+}
+
+// Sleep until the monotonic clock reaches deadline
+static void sleepUntil(uint64_t deadline) {
+    struct timespec ts = {.tv_sec = (time_t) (deadline / 1000000000), .tv_nsec = (long) (deadline % 1000000000)};
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+RCP_Error RCP_replay_run(RCP_Replay* replay, RCP_Context* ctx, double speed) {
+    if(replay == NULL || ctx == NULL || speed < 0) return RCP_ERR_INIT;
+
+    // Records are the packets as they were received, so there are no frames to take apart or boundaries to find
+    if(ctx->framing != RCP_FRAMING_NONE || ctx->resync) return RCP_ERR_INIT;
+
+    RCP_Error first = RCP_ERR_SUCCESS;
+
+    // When pacing, record times are mapped onto the clock relative to the first record replayed
+    uint64_t firstRecord = 0;
+    uint64_t start = 0;
+    int started = 0;
+
+    struct RCP_CaptureRecord record;
+    while(RCP_replay_next(replay, &record)) {
+        if(speed > 0) {
+            if(!started) {
+                firstRecord = record.timeNs;
+                start = RCP__monotonicNs();
+                started = 1;
+            }
+
+            // Records are in receive order, but guard against a capture spliced together from separate runs
+            if(record.timeNs > firstRecord) {
+                uint64_t deadline = start + (uint64_t) ((double) (record.timeNs - firstRecord) / speed);
+                if(RCP__monotonicNs() < deadline) sleepUntil(deadline);
+            }
+        }
+
+        // Dispatched straight out of the mapping, once the record is known to hold exactly one packet
+        RCP_Error rerrno = RCP__dispatchWhole(ctx, record.pkt, record.length);
+        if(first == RCP_ERR_SUCCESS) first = rerrno;
+    }
+
+    return first;
+}
@@ -0,0 +1,161 @@
+#include "RCP_Host/RCP_Ring.h"
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "RCP_Internal.h"
+
+// Positions are free running counters that are masked on access, so the full capacity is usable and empty and full
+// are told apart by head - tail. Each side keeps its own counter and a cached copy of the other side's on its own
+// cache line, so the two threads only touch shared lines when the cached copy says the ring is empty or full.
+struct RCP_Ring {
+    // Producer line
+    alignas(RCP_CACHE_LINE) atomic_size_t head;
+    size_t cachedTail;
+
+    // Consumer line
+    alignas(RCP_CACHE_LINE) atomic_size_t tail;
+    size_t cachedHead;
+
+    // Read only after creation
+    alignas(RCP_CACHE_LINE) size_t mask;
+    uint8_t* data;
+};
+
+RCP_Error RCP_ring_create(size_t capacity, RCP_Ring** ring) {
+    if(ring == NULL || capacity == 0 || capacity > (SIZE_MAX >> 1) + 1) return RCP_ERR_INIT;
+    *ring = NULL;
+
+    size_t cap = 1;
+    while(cap < capacity) cap <<= 1;
+
+    RCP_Ring* r = RCP__alignedAlloc(sizeof(RCP_Ring));
+    if(r == NULL) return RCP_ERR_MEMALLOC;
+
+    r->data = RCP__alignedAlloc(cap);
+    if(r->data == NULL) {
+        RCP__alignedFree(r);
+        return RCP_ERR_MEMALLOC;
+    }
+
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    r->cachedTail = 0;
+    r->cachedHead = 0;
+    r->mask = cap - 1;
+
+    *ring = r;
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_ring_destroy(RCP_Ring* ring) {
+    if(ring == NULL) return RCP_ERR_INIT;
+
+    RCP__alignedFree(ring->data);
+    RCP__alignedFree(ring);
+    return RCP_ERR_SUCCESS;
+}
+
+size_t RCP_ring_capacity(const RCP_Ring* ring) { return ring == NULL ? 0 : ring->mask + 1; }
+
+size_t RCP_ring_size(const RCP_Ring* ring) {
+    if(ring == NULL) return 0;
+
+    // Tail first, so that the result never exceeds capacity
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return head - tail;
+}
+
+size_t RCP_ring_write(RCP_Ring* ring, const void* data, size_t length) {
+    if(ring == NULL) return 0;
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t cap = ring->mask + 1;
+
+    // Only look at the consumer's counter when the cached one does not leave enough room
+    if(cap - (head - ring->cachedTail) < length)
+        ring->cachedTail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    size_t space = cap - (head - ring->cachedTail);
+    if(length > space) length = space;
+    if(length == 0) return 0;
+
+    // Copy in at most two pieces, the second one after wrapping to the start
+    size_t start = head & ring->mask;
+    size_t first = cap - start;
+    if(first > length) first = length;
+
+    memcpy(ring->data + start, data, first);
+    memcpy(ring->data, (const uint8_t*) data + first, length - first);
+
+    atomic_store_explicit(&ring->head, head + length, memory_order_release);
+    return length;
+}
+
+size_t RCP_ring_peek(RCP_Ring* ring, const uint8_t** data) {
+    if(ring == NULL) return 0;
+
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if(ring->cachedHead == tail) ring->cachedHead = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    size_t avail = ring->cachedHead - tail;
+    size_t start = tail & ring->mask;
+    size_t contiguous = ring->mask + 1 - start;
+
+    *data = ring->data + start;
+    return avail < contiguous ? avail : contiguous;
+}
+
+void RCP_ring_consume(RCP_Ring* ring, size_t length) {
+    if(ring == NULL) return;
+
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + length, memory_order_release);
+}
+
+size_t RCP_ring_read(RCP_Ring* ring, void* data, size_t length) {
+    if(ring == NULL) return 0;
+
+    size_t done = 0;
+
+    // At most two pieces if the readable bytes wrap around the end
+    while(done < length) {
+        const uint8_t* src;
+        size_t n = RCP_ring_peek(ring, &src);
+        if(n == 0) break;
+        if(n > length - done) n = length - done;
+
+        memcpy((uint8_t*) data + done, src, n);
+        RCP_ring_consume(ring, n);
+        done += n;
+    }
+
+    return done;
+}
+
+RCP_Error RCP_ring_feed(RCP_Ring* ring, RCP_Context* ctx) {
+    if(ring == NULL || ctx == NULL) return RCP_ERR_INIT;
+
+    RCP_Error first = RCP_ERR_SUCCESS;
+
+    // Bounded to one pass over the ring, so a producer that keeps up with the consumer cannot keep it here forever
+    size_t left = RCP_ring_size(ring);
+    while(left > 0) {
+        const uint8_t* src;
+        size_t n = RCP_ring_peek(ring, &src);
+        if(n == 0) break;
+        if(n > left) n = left;
+
+        RCP_Error rerrno = RCP_ctx_feed(ctx, src, n);
+        if(first == RCP_ERR_SUCCESS) first = rerrno;
+
+        RCP_ring_consume(ring, n);
+        left -= n;
+    }
+
+    return first;
+}
@@ -0,0 +1,201 @@
+#include "RCP_Host/RCP_Stats.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "RCP_Host/RCP_Latest.h"
+#include "RCP_Internal.h"
+
+struct Class {
+    atomic_uint_least64_t packets;
+    atomic_uint_least64_t bytes;
+    atomic_uint_least64_t units;
+};
+
+struct Device {
+    atomic_uint_least64_t samples;
+    atomic_uint_least32_t firstTimestamp;
+    atomic_uint_least32_t lastTimestamp;
+};
+
+// Counters for every ID of a class, allocated the first time a reading of the class is decoded
+struct Devices {
+    struct Device devices[256];
+};
+
+struct RCP__Stats {
+    atomic_uint_least64_t compactPackets;
+    atomic_uint_least64_t compactBytes;
+    atomic_uint_least64_t extendedPackets;
+    atomic_uint_least64_t extendedBytes;
+    atomic_uint_least64_t wrongChannel;
+    atomic_uint_least64_t filtered;
+    atomic_uint_least64_t skippedBytes;
+    atomic_uint_least64_t discardedBytes;
+    atomic_uint_least64_t errors[RCP_STATS_ERRORS];
+
+    struct Class classes[256];
+    struct RCP__Devices* devices;
+};
+
+static void initDevices(void* table) {
+    struct Devices* c = table;
+    for(size_t i = 0; i < 256; i++) {
+        atomic_init(&c->devices[i].samples, 0);
+        atomic_init(&c->devices[i].firstTimestamp, 0);
+        atomic_init(&c->devices[i].lastTimestamp, 0);
+    }
+}
+
+struct RCP__Stats* RCP__statsCreate(void) {
+    struct RCP__Stats* s = malloc(sizeof(struct RCP__Stats));
+    if(s == NULL) return NULL;
+
+    s->devices = RCP__devicesCreate(sizeof(struct Devices), initDevices);
+    if(s->devices == NULL) {
+        free(s);
+        return NULL;
+    }
+
+    atomic_init(&s->compactPackets, 0);
+    atomic_init(&s->compactBytes, 0);
+    atomic_init(&s->extendedPackets, 0);
+    atomic_init(&s->extendedBytes, 0);
+    atomic_init(&s->wrongChannel, 0);
+    atomic_init(&s->filtered, 0);
+    atomic_init(&s->skippedBytes, 0);
+    atomic_init(&s->discardedBytes, 0);
+    for(size_t i = 0; i < RCP_STATS_ERRORS; i++) atomic_init(&s->errors[i], 0);
+
+    for(size_t i = 0; i < 256; i++) {
+        atomic_init(&s->classes[i].packets, 0);
+        atomic_init(&s->classes[i].bytes, 0);
+        atomic_init(&s->classes[i].units, 0);
+    }
+
+    return s;
+}
+
+void RCP__statsFree(struct RCP__Stats* stats) {
+    if(stats == NULL) return;
+
+    RCP__devicesFree(stats->devices, NULL);
+    free(stats);
+}
+
+void RCP__statsPacket(struct RCP__Stats* stats, uint8_t header, size_t len) {
+    if(header & RCP_EXTENDED_MASK) {
+        RCP__BUMP(stats->extendedPackets, 1);
+        RCP__BUMP(stats->extendedBytes, len);
+    }
+
+    else {
+        RCP__BUMP(stats->compactPackets, 1);
+        RCP__BUMP(stats->compactBytes, len);
+    }
+}
+
+void RCP__statsDropped(struct RCP__Stats* stats, int wrongChannel) {
+    if(wrongChannel) RCP__BUMP(stats->wrongChannel, 1);
+    else RCP__BUMP(stats->filtered, 1);
+}
+
+void RCP__statsSkipped(struct RCP__Stats* stats, size_t n) { RCP__BUMP(stats->skippedBytes, n); }
+
+void RCP__statsDiscarded(struct RCP__Stats* stats, size_t n) { RCP__BUMP(stats->discardedBytes, n); }
+
+void RCP__statsError(struct RCP__Stats* stats, RCP_Error error) {
+    if((unsigned) error < RCP_STATS_ERRORS) RCP__BUMP(stats->errors[error], 1);
+}
+
+void RCP__statsClass(struct RCP__Stats* stats, RCP_DeviceClass devclass, size_t len) {
+    RCP__BUMP(stats->classes[(uint8_t) devclass].packets, 1);
+    RCP__BUMP(stats->classes[(uint8_t) devclass].bytes, len);
+}
+
+void RCP__statsUnit(struct RCP__Stats* stats, RCP_DeviceClass devclass) {
+    RCP__BUMP(stats->classes[(uint8_t) devclass].units, 1);
+}
+
+void RCP__statsSample(struct RCP__Stats* stats, RCP_DeviceClass devclass, uint32_t timestamp, uint8_t ID) {
+    struct Devices* c = RCP__devicesClass(stats->devices, devclass);
+    if(c == NULL) return;
+
+    struct Device* d = &c->devices[ID];
+    uint64_t samples = RCP__LOAD(d->samples);
+    if(samples == 0) atomic_store_explicit(&d->firstTimestamp, timestamp, memory_order_relaxed);
+    atomic_store_explicit(&d->lastTimestamp, timestamp, memory_order_relaxed);
+    atomic_store_explicit(&d->samples, samples + 1, memory_order_release);
+
+    // A new device is listed once its first reading is counted
+    if(samples == 0) RCP__devicesAdd(stats->devices, RCP_FQDN(devclass, ID));
+}
+
+// Copy a device's counters. Returns 0 if nothing has been decoded from it
+static int readDevice(const struct RCP__Stats* stats, uint16_t fqdn, struct RCP_DeviceStats* out) {
+    const struct Devices* c = RCP__devicesFind(stats->devices, fqdn >> 8);
+    if(c == NULL) return 0;
+
+    const struct Device* d = &c->devices[fqdn & 0xFF];
+    out->devclass = fqdn >> 8;
+    out->ID = fqdn & 0xFF;
+    out->samples = atomic_load_explicit(&d->samples, memory_order_acquire);
+    out->firstTimestamp = RCP__LOAD(d->firstTimestamp);
+    out->lastTimestamp = RCP__LOAD(d->lastTimestamp);
+    return out->samples != 0;
+}
+
+RCP_Error RCP_ctx_trackStats(RCP_Context* ctx) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+    if(ctx->stats != NULL) return RCP_ERR_SUCCESS;
+
+    ctx->stats = RCP__statsCreate();
+    return ctx->stats == NULL ? RCP_ERR_MEMALLOC : RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_ctx_getStats(const RCP_Context* ctx, struct RCP_Stats* stats) {
+    if(ctx == NULL || ctx->stats == NULL || stats == NULL) return RCP_ERR_INIT;
+
+    const struct RCP__Stats* s = ctx->stats;
+    stats->compactPackets = RCP__LOAD(s->compactPackets);
+    stats->compactBytes = RCP__LOAD(s->compactBytes);
+    stats->extendedPackets = RCP__LOAD(s->extendedPackets);
+    stats->extendedBytes = RCP__LOAD(s->extendedBytes);
+    stats->packets = stats->compactPackets + stats->extendedPackets;
+    stats->bytes = stats->compactBytes + stats->extendedBytes;
+    stats->wrongChannel = RCP__LOAD(s->wrongChannel);
+    stats->filtered = RCP__LOAD(s->filtered);
+    stats->skippedBytes = RCP__LOAD(s->skippedBytes);
+    stats->discardedBytes = RCP__LOAD(s->discardedBytes);
+    for(size_t i = 0; i < RCP_STATS_ERRORS; i++) stats->errors[i] = RCP__LOAD(s->errors[i]);
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_ctx_getClassStats(const RCP_Context* ctx, RCP_DeviceClass devclass, struct RCP_ClassStats* stats) {
+    if(ctx == NULL || ctx->stats == NULL || stats == NULL) return RCP_ERR_INIT;
+    if((unsigned) devclass > 0xFF) return RCP_ERR_INVALID_DEVCLASS;
+
+    const struct Class* c = &ctx->stats->classes[devclass];
+    stats->packets = RCP__LOAD(c->packets);
+    stats->bytes = RCP__LOAD(c->bytes);
+    stats->units = RCP__LOAD(c->units);
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_ctx_getDeviceStats(const RCP_Context* ctx, RCP_DeviceClass devclass, uint8_t ID,
+                                 struct RCP_DeviceStats* stats) {
+    if(ctx == NULL || ctx->stats == NULL || stats == NULL) return RCP_ERR_INIT;
+    if((unsigned) devclass > 0xFF) return RCP_ERR_INVALID_DEVCLASS;
+
+    return readDevice(ctx->stats, RCP_FQDN(devclass, ID), stats) ? RCP_ERR_SUCCESS : RCP_ERR_NO_READING;
+}
+
+size_t RCP_ctx_snapshotDeviceStats(const RCP_Context* ctx, struct RCP_DeviceStats* stats, size_t capacity) {
+    if(ctx == NULL || ctx->stats == NULL) return 0;
+    if(stats == NULL) capacity = 0;
+
+    const uint16_t* order;
+    size_t count = RCP__devicesList(ctx->stats->devices, &order);
+    for(size_t i = 0; i < count && i < capacity; i++) readDevice(ctx->stats, order[i], &stats[i]);
+    return count;
+}
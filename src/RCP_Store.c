@@ -0,0 +1,232 @@
+#include "RCP_Host/RCP_Store.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "RCP_Host/RCP_Latest.h"
+#include "RCP_Internal.h"
+
+#define ROUND_LINE(size) (((size) + RCP_CACHE_LINE - 1) & ~(size_t) (RCP_CACHE_LINE - 1))
+
+// One chunk of a series, allocated in one block: this header, then the timestamp column, then each float column, every
+// one starting on its own cache line
+struct Chunk {
+    // The next chunk allocated anywhere in the store, for dropping chunks oldest first
+    struct Chunk* newer;
+    struct Device* device;
+    size_t bytes;
+    size_t len;
+    uint32_t* timestamps;
+    float* columns[4];
+};
+
+struct Device {
+    uint8_t arity;
+    uint64_t dropped;
+
+    // The device's chunks, oldest first, are chunks[head] to chunks[head + count - 1]
+    struct Chunk** chunks;
+    size_t head;
+    size_t count;
+    size_t capacity;
+    size_t len;
+};
+
+struct Class {
+    struct Device devices[256];
+};
+
+struct RCP_Store {
+    size_t chunkSamples;
+    size_t budget;
+    size_t used;
+
+    struct Chunk* oldest;
+    struct Chunk* newest;
+
+    // Each class's devices, the devices in the order they were first seen, and whether each has been
+    struct RCP__Devices* devices;
+    uint8_t seen[256 * 256 / 8];
+};
+
+static size_t chunkBytes(size_t chunkSamples, size_t arity) {
+    return ROUND_LINE(sizeof(struct Chunk)) + (arity + 1) * ROUND_LINE(chunkSamples * sizeof(float));
+}
+
+RCP_Error RCP_store_create(size_t chunkSamples, size_t budgetBytes, RCP_Store** store) {
+    if(store == NULL || chunkSamples == 0 || chunkSamples > SIZE_MAX / 64) return RCP_ERR_INIT;
+    if(budgetBytes < chunkBytes(chunkSamples, 4)) return RCP_ERR_INIT;
+
+    RCP_Store* s = calloc(1, sizeof(RCP_Store));
+    if(s == NULL) return RCP_ERR_MEMALLOC;
+
+    s->devices = RCP__devicesCreate(sizeof(struct Class), NULL);
+    if(s->devices == NULL) {
+        free(s);
+        return RCP_ERR_MEMALLOC;
+    }
+
+    s->chunkSamples = chunkSamples;
+    s->budget = budgetBytes;
+    *store = s;
+    return RCP_ERR_SUCCESS;
+}
+
+static void freeClass(void* table) {
+    struct Class* cls = table;
+    for(size_t i = 0; i < 256; i++) free(cls->devices[i].chunks);
+}
+
+RCP_Error RCP_store_destroy(RCP_Store* store) {
+    if(store == NULL) return RCP_ERR_INIT;
+
+    for(struct Chunk* c = store->oldest; c != NULL;) {
+        struct Chunk* next = c->newer;
+        RCP__alignedFree(c);
+        c = next;
+    }
+
+    RCP__devicesFree(store->devices, freeClass);
+    free(store);
+    return RCP_ERR_SUCCESS;
+}
+
+size_t RCP_store_memory(const RCP_Store* store) { return store == NULL ? 0 : store->used; }
+
+// Free the oldest chunk in the store, which is always the first of its device's
+static void dropOldest(RCP_Store* store) {
+    struct Chunk* c = store->oldest;
+    struct Device* d = c->device;
+
+    d->head++;
+    d->count--;
+    d->len -= c->len;
+    d->dropped += c->len;
+
+    store->oldest = c->newer;
+    if(store->oldest == NULL) store->newest = NULL;
+    store->used -= c->bytes;
+    RCP__alignedFree(c);
+}
+
+// Start a new chunk at the end of d's series. Returns NULL if there was no memory for it
+static struct Chunk* newChunk(RCP_Store* store, struct Device* d) {
+    size_t bytes = chunkBytes(store->chunkSamples, d->arity);
+    while(store->used + bytes > store->budget) dropOldest(store);
+
+    if(d->head + d->count == d->capacity) {
+        if(d->head > 0) {
+            memmove(d->chunks, d->chunks + d->head, d->count * sizeof(struct Chunk*));
+            d->head = 0;
+        }
+        else {
+            size_t capacity = d->capacity == 0 ? 8 : d->capacity * 2;
+            struct Chunk** chunks = realloc(d->chunks, capacity * sizeof(struct Chunk*));
+            if(chunks == NULL) return NULL;
+            d->chunks = chunks;
+            d->capacity = capacity;
+        }
+    }
+
+    struct Chunk* c = RCP__alignedAlloc(bytes);
+    if(c == NULL) return NULL;
+
+    size_t column = ROUND_LINE(store->chunkSamples * sizeof(float));
+    uint8_t* at = (uint8_t*) c + ROUND_LINE(sizeof(struct Chunk));
+    c->newer = NULL;
+    c->device = d;
+    c->bytes = bytes;
+    c->len = 0;
+    c->timestamps = (uint32_t*) at;
+    for(size_t i = 0; i < 4; i++) c->columns[i] = i < d->arity ? (float*) (at + (i + 1) * column) : NULL;
+
+    if(store->newest == NULL) store->oldest = c;
+    else store->newest->newer = c;
+    store->newest = c;
+    store->used += bytes;
+
+    d->chunks[d->head + d->count++] = c;
+    return c;
+}
+
+void RCP__storeAppend(RCP_Store* store, RCP_DeviceClass devclass, uint32_t timestamp, uint8_t ID, const float* data,
+                      size_t n) {
+    struct Class* cls = RCP__devicesClass(store->devices, devclass);
+    if(cls == NULL) return;
+
+    uint16_t fqdn = RCP_FQDN(devclass, ID);
+    struct Device* d = &cls->devices[ID];
+    if(!(store->seen[fqdn / 8] & (1 << (fqdn % 8)))) {
+        store->seen[fqdn / 8] |= 1 << (fqdn % 8);
+        RCP__devicesAdd(store->devices, fqdn);
+        d->arity = (uint8_t) n;
+    }
+
+    struct Chunk* c = d->count == 0 ? NULL : d->chunks[d->head + d->count - 1];
+    if(c == NULL || c->len == store->chunkSamples) c = newChunk(store, d);
+    if(c == NULL) {
+        d->dropped++;
+        return;
+    }
+
+    c->timestamps[c->len] = timestamp;
+    for(size_t i = 0; i < d->arity; i++) c->columns[i][c->len] = i < n ? data[i] : 0;
+    c->len++;
+    d->len++;
+}
+
+size_t RCP_store_devices(const RCP_Store* store, uint16_t* fqdns, size_t capacity) {
+    if(store == NULL) return 0;
+    if(fqdns == NULL) capacity = 0;
+
+    const uint16_t* order;
+    size_t count = RCP__devicesList(store->devices, &order);
+    size_t n = capacity < count ? capacity : count;
+    if(n > 0) memcpy(fqdns, order, n * sizeof(uint16_t));
+    return count;
+}
+
+static const struct Device* findDevice(const RCP_Store* store, RCP_DeviceClass devclass, uint8_t ID) {
+    uint16_t fqdn = RCP_FQDN(devclass, ID);
+    if(!(store->seen[fqdn / 8] & (1 << (fqdn % 8)))) return NULL;
+    const struct Class* cls = RCP__devicesFind(store->devices, devclass);
+    return &cls->devices[ID];
+}
+
+RCP_Error RCP_store_getSeries(const RCP_Store* store, RCP_DeviceClass devclass, uint8_t ID,
+                              struct RCP_StoreSeries* series) {
+    if(store == NULL || series == NULL) return RCP_ERR_INIT;
+    if((unsigned) devclass > 0xFF) return RCP_ERR_INVALID_DEVCLASS;
+
+    const struct Device* d = findDevice(store, devclass, ID);
+    if(d == NULL) return RCP_ERR_NO_READING;
+
+    series->arity = d->arity;
+    series->len = d->len;
+    series->chunks = d->count;
+    series->dropped = d->dropped;
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_store_getChunk(const RCP_Store* store, RCP_DeviceClass devclass, uint8_t ID, size_t index,
+                             struct RCP_StoreChunk* chunk) {
+    if(store == NULL || chunk == NULL) return RCP_ERR_INIT;
+    if((unsigned) devclass > 0xFF) return RCP_ERR_INVALID_DEVCLASS;
+
+    const struct Device* d = findDevice(store, devclass, ID);
+    if(d == NULL) return RCP_ERR_NO_READING;
+    if(index >= d->count) return RCP_ERR_INIT;
+
+    const struct Chunk* c = d->chunks[d->head + index];
+    chunk->len = c->len;
+    chunk->timestamps = c->timestamps;
+    for(size_t i = 0; i < 4; i++) chunk->columns[i] = c->columns[i];
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_ctx_setStore(RCP_Context* ctx, RCP_Store* store) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+
+    ctx->store = store;
+    return RCP_ERR_SUCCESS;
+}
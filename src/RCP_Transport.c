@@ -0,0 +1,493 @@
+#include "RCP_Host/RCP_Transport.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#endif
+
+#include "RCP_Internal.h"
+
+// Keeps a send to a peer that has gone away from raising SIGPIPE, where the platform allows it per call
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+#ifndef SOCK_CLOEXEC
+#define SOCK_CLOEXEC 0
+#endif
+
+static int setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Wrap an open descriptor, which is closed if that fails
+static RCP_Error wrap(int fd, RCP__TransportKind kind, RCP_Transport** transport) {
+    RCP_Transport* t = malloc(sizeof(RCP_Transport));
+    if(t != NULL) t->buffer = malloc(RCP_TRANSPORT_BUFFER);
+    if(t == NULL || t->buffer == NULL) {
+        free(t);
+        close(fd);
+        return RCP_ERR_MEMALLOC;
+    }
+
+    t->fd = fd;
+    t->kind = kind;
+    t->termiosTimed = 0;
+    t->timeoutMs = -1;
+    t->start = 0;
+    t->end = 0;
+    memset(&t->stats, 0, sizeof(t->stats));
+
+    *transport = t;
+    return RCP_ERR_SUCCESS;
+}
+
+// Milliseconds left until deadlineNs, rounded up, for poll. A deadline of 0 means there is none
+static int remainingMs(uint64_t deadlineNs) {
+    if(deadlineNs == 0) return -1;
+
+    uint64_t now = RCP__monotonicNs();
+    if(now >= deadlineNs) return 0;
+
+    uint64_t ms = (deadlineNs - now + 999999) / 1000000;
+    return ms > INT32_MAX ? INT32_MAX : (int) ms;
+}
+
+static uint64_t deadlineFor(const RCP_Transport* t) {
+    return t->timeoutMs < 0 ? 0 : RCP__monotonicNs() + (uint64_t) t->timeoutMs * 1000000;
+}
+
+// Wait until the descriptor is ready for events or the deadline passes. Returns 0 once it is ready
+static int waitFor(const RCP_Transport* t, short events, uint64_t deadlineNs) {
+    for(;;) {
+        int ms = remainingMs(deadlineNs);
+        if(ms == 0) return -1;
+
+        struct pollfd p = {.fd = t->fd, .events = events};
+        int ready = poll(&p, 1, ms);
+        if(ready > 0) return 0;
+        if(ready == 0 || errno != EINTR) return -1;
+    }
+}
+
+// Take in whatever the link has ready, as much as fits in the buffer, waiting until the deadline if nothing has
+// arrived yet. Returns 0 once at least one byte was added
+static int fill(RCP_Transport* t, uint64_t deadlineNs) {
+    // Unread bytes go to the front, so the most room is free for the read. The leftover is less than a packet
+    if(t->start != 0) {
+        memmove(t->buffer, t->buffer + t->start, t->end - t->start);
+        t->end -= t->start;
+        t->start = 0;
+    }
+
+    for(;;) {
+        // Reading before polling costs one system call instead of two whenever bytes are already waiting
+        ssize_t n = read(t->fd, t->buffer + t->end, RCP_TRANSPORT_BUFFER - t->end);
+        t->stats.reads++;
+
+        if(n > 0) {
+            t->end += (size_t) n;
+            t->stats.bytesRead += (uint64_t) n;
+            return 0;
+        }
+
+        // End of a TCP stream, or VTIME ran out with nothing received. A terminal with VMIN and VTIME both 0 reports
+        // nothing waiting this way rather than as EAGAIN, and an empty datagram carries nothing, so both wait on
+        if(n == 0 && (t->kind == RCP__TRANSPORT_TCP || t->termiosTimed)) return -1;
+        if(n < 0 && errno == EINTR) continue;
+
+        // A datagram sent to a closed port comes back as an error on the next receive, but the link is still usable
+        if(n < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+           !(t->kind == RCP__TRANSPORT_UDP && errno == ECONNREFUSED))
+            return -1;
+
+        if(t->termiosTimed) continue;
+        if(waitFor(t, POLLIN, deadlineNs) != 0) return -1;
+    }
+}
+
+// Take in whatever the link has ready without waiting, as much as fits after the bytes already buffered. Returns how
+// many bytes were added, 0 if none were ready, or -1 if the link closed or failed
+static ssize_t fillReady(RCP_Transport* t) {
+    // A terminal timed by VMIN and VTIME is left blocking, so it has to be asked first whether anything is there
+    if(t->termiosTimed) {
+        struct pollfd p = {.fd = t->fd, .events = POLLIN};
+        int ready;
+        do ready = poll(&p, 1, 0);
+        while(ready < 0 && errno == EINTR);
+        if(ready <= 0) return ready;
+    }
+
+    for(;;) {
+        ssize_t n = read(t->fd, t->buffer + t->end, RCP_TRANSPORT_BUFFER - t->end);
+        t->stats.reads++;
+
+        if(n > 0) {
+            t->end += (size_t) n;
+            t->stats.bytesRead += (uint64_t) n;
+            return n;
+        }
+
+        // An empty datagram, or the error from one sent to a closed port, says nothing about what else is waiting
+        if(t->kind == RCP__TRANSPORT_UDP && (n == 0 || errno == ECONNREFUSED)) continue;
+        if(n == 0) return t->kind == RCP__TRANSPORT_TCP ? -1 : 0;
+        if(errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+}
+
+size_t RCP_transport_read(void* transport, void* data, size_t length) {
+    RCP_Transport* t = transport;
+    if(t == NULL || length > RCP_TRANSPORT_BUFFER) return 0;
+
+    // The fast path, and the reason for the buffer: most reads are served without a system call
+    if(t->end - t->start < length) {
+        uint64_t deadlineNs = deadlineFor(t);
+        do {
+            if(fill(t, deadlineNs) != 0) return 0;
+        } while(t->end - t->start < length);
+    }
+
+    memcpy(data, t->buffer + t->start, length);
+    t->start += length;
+    if(t->start == t->end) {
+        t->start = 0;
+        t->end = 0;
+    }
+
+    return length;
+}
+
+size_t RCP_transport_skip(void* transport, size_t length) {
+    RCP_Transport* t = transport;
+    if(t == NULL) return 0;
+
+    // Buffered bytes are dropped where they are. Past those, the link is read a buffer at a time and dropped
+    uint64_t deadlineNs = deadlineFor(t);
+    size_t skipped = 0;
+    for(;;) {
+        size_t take = length - skipped;
+        if(take > t->end - t->start) take = t->end - t->start;
+
+        t->start += take;
+        skipped += take;
+        if(t->start == t->end) {
+            t->start = 0;
+            t->end = 0;
+        }
+
+        if(skipped == length || fill(t, deadlineNs) != 0) return skipped;
+    }
+}
+
+size_t RCP_transport_send(void* transport, const void* data, size_t length) {
+    RCP_Transport* t = transport;
+    if(t == NULL) return 0;
+
+    const uint8_t* bytes = data;
+    size_t sent = 0;
+    uint64_t deadlineNs = deadlineFor(t);
+
+    while(sent < length) {
+        ssize_t n = t->kind == RCP__TRANSPORT_SERIAL ? write(t->fd, bytes + sent, length - sent)
+                                           : send(t->fd, bytes + sent, length - sent, SEND_FLAGS);
+        t->stats.writes++;
+
+        if(n >= 0) {
+            sent += (size_t) n;
+            t->stats.bytesSent += (uint64_t) n;
+
+            // A datagram goes out whole or not at all
+            if(t->kind == RCP__TRANSPORT_UDP) break;
+            continue;
+        }
+
+        if(errno == EINTR) continue;
+        if(errno != EAGAIN && errno != EWOULDBLOCK) break;
+        if(waitFor(t, POLLOUT, deadlineNs) != 0) break;
+    }
+
+    return sent;
+}
+
+static speed_t baudToSpeed(uint32_t baud) {
+    switch(baud) {
+    case 1200: return B1200;
+    case 2400: return B2400;
+    case 4800: return B4800;
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+#ifdef B460800
+    case 460800: return B460800;
+#endif
+#ifdef B921600
+    case 921600: return B921600;
+#endif
+#ifdef B1000000
+    case 1000000: return B1000000;
+#endif
+#ifdef B2000000
+    case 2000000: return B2000000;
+#endif
+#ifdef B3000000
+    case 3000000: return B3000000;
+#endif
+#ifdef B4000000
+    case 4000000: return B4000000;
+#endif
+    default: return B0;
+    }
+}
+
+RCP_Error RCP_transport_openSerial(const char* path, const struct RCP_SerialConfig* config, RCP_Transport** transport) {
+    if(path == NULL || transport == NULL) return RCP_ERR_INIT;
+    *transport = NULL;
+
+    struct RCP_SerialConfig c = {0};
+    if(config != NULL) c = *config;
+
+    speed_t speed = baudToSpeed(c.baud);
+    if(c.baud != 0 && speed == B0) return RCP_ERR_INIT;
+
+    // Opened non-blocking so a port with no carrier does not hold up the open itself
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if(fd < 0) return RCP_ERR_IO_OPEN;
+
+    struct termios tio;
+    if(tcgetattr(fd, &tio) != 0) {
+        close(fd);
+        return RCP_ERR_IO_OPEN;
+    }
+
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(tcflag_t) CSTOPB;
+#ifdef CRTSCTS
+    tio.c_cflag &= ~(tcflag_t) CRTSCTS;
+#endif
+    tio.c_cc[VMIN] = c.vmin;
+    tio.c_cc[VTIME] = c.vtime;
+    if(c.baud != 0) {
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+    }
+
+    int termiosTimed = c.vmin != 0 || c.vtime != 0;
+    int flags = fcntl(fd, F_GETFL);
+    if(tcsetattr(fd, TCSANOW, &tio) != 0 || flags < 0 ||
+       (termiosTimed && fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) != 0)) {
+        close(fd);
+        return RCP_ERR_IO_OPEN;
+    }
+
+#ifdef __linux__
+    if(c.lowLatency) {
+        struct serial_struct serial;
+        if(ioctl(fd, TIOCGSERIAL, &serial) == 0) {
+            serial.flags |= ASYNC_LOW_LATENCY;
+            ioctl(fd, TIOCSSERIAL, &serial);
+        }
+    }
+#endif
+
+    // Whatever was sitting in the port from before it was opened is not part of this session
+    tcflush(fd, TCIFLUSH);
+
+    RCP_Error rerrno = wrap(fd, RCP__TRANSPORT_SERIAL, transport);
+    if(rerrno == RCP_ERR_SUCCESS) (*transport)->termiosTimed = termiosTimed;
+    return rerrno;
+}
+
+// Addresses for host and port of the given socket type. The list must be freed with freeaddrinfo
+static struct addrinfo* resolve(const char* host, uint16_t port, int type) {
+    char service[6];
+    snprintf(service, sizeof(service), "%u", (unsigned) port);
+
+    struct addrinfo hints = {0};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = type;
+    hints.ai_flags = AI_NUMERICSERV;
+
+    struct addrinfo* list = NULL;
+    return getaddrinfo(host, service, &hints, &list) == 0 ? list : NULL;
+}
+
+// Start a non-blocking connect and wait for it to finish. Returns 0 once connected
+static int connectWithin(int fd, const struct addrinfo* a, int timeoutMs) {
+    if(connect(fd, a->ai_addr, a->ai_addrlen) == 0) return 0;
+    if(errno != EINPROGRESS) return -1;
+
+    struct pollfd p = {.fd = fd, .events = POLLOUT};
+    int ready;
+    do ready = poll(&p, 1, timeoutMs);
+    while(ready < 0 && errno == EINTR);
+    if(ready <= 0) return -1;
+
+    int err = 0;
+    socklen_t len = sizeof(err);
+    return getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0 ? 0 : -1;
+}
+
+RCP_Error RCP_transport_openTcp(const char* host, uint16_t port, RCP_Transport** transport) {
+    if(host == NULL || transport == NULL) return RCP_ERR_INIT;
+    *transport = NULL;
+
+    struct addrinfo* list = resolve(host, port, SOCK_STREAM);
+    if(list == NULL) return RCP_ERR_IO_OPEN;
+
+    int fd = -1;
+    for(struct addrinfo* a = list; a != NULL; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+        if(fd < 0) continue;
+        if(setNonBlocking(fd) == 0 && connectWithin(fd, a, RCP_TRANSPORT_CONNECT_MS) == 0) break;
+
+        close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(list);
+    if(fd < 0) return RCP_ERR_IO_OPEN;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+    return wrap(fd, RCP__TRANSPORT_TCP, transport);
+}
+
+// Bind to localPort on every address of the family
+static int bindLocal(int fd, int family, uint16_t localPort) {
+    if(family == AF_INET6) {
+        struct sockaddr_in6 local = {0};
+        local.sin6_family = AF_INET6;
+        local.sin6_addr = in6addr_any;
+        local.sin6_port = htons(localPort);
+        return bind(fd, (const struct sockaddr*) &local, sizeof(local));
+    }
+
+    struct sockaddr_in local = {0};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(localPort);
+    return bind(fd, (const struct sockaddr*) &local, sizeof(local));
+}
+
+RCP_Error RCP_transport_openUdp(const char* host, uint16_t port, uint16_t localPort, RCP_Transport** transport) {
+    if(host == NULL || transport == NULL) return RCP_ERR_INIT;
+    *transport = NULL;
+
+    struct addrinfo* list = resolve(host, port, SOCK_DGRAM);
+    if(list == NULL) return RCP_ERR_IO_OPEN;
+
+    // Connecting a datagram socket only records the peer, which filters what is received and addresses every send
+    int fd = -1;
+    for(struct addrinfo* a = list; a != NULL; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+        if(fd < 0) continue;
+        if(setNonBlocking(fd) == 0 && (localPort == 0 || bindLocal(fd, a->ai_family, localPort) == 0) &&
+           connect(fd, a->ai_addr, a->ai_addrlen) == 0)
+            break;
+
+        close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(list);
+    if(fd < 0) return RCP_ERR_IO_OPEN;
+    return wrap(fd, RCP__TRANSPORT_UDP, transport);
+}
+
+RCP_Error RCP_transport_close(RCP_Transport* transport) {
+    if(transport == NULL) return RCP_ERR_INIT;
+
+    close(transport->fd);
+    free(transport->buffer);
+    free(transport);
+    return RCP_ERR_SUCCESS;
+}
+
+void RCP_transport_setTimeout(RCP_Transport* transport, int timeoutMs) {
+    if(transport != NULL) transport->timeoutMs = timeoutMs < 0 ? -1 : timeoutMs;
+}
+
+int RCP_transport_fd(const RCP_Transport* transport) { return transport == NULL ? -1 : transport->fd; }
+
+RCP_Error RCP_transport_getStats(const RCP_Transport* transport, struct RCP_TransportStats* stats) {
+    if(transport == NULL || stats == NULL) return RCP_ERR_INIT;
+
+    *stats = transport->stats;
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_ctx_setTransport(RCP_Context* ctx, RCP_Transport* transport) {
+    if(ctx == NULL) return RCP_ERR_INIT;
+
+    if(transport == NULL) {
+        ctx->sendBytes = ctx->callbacks.sendData;
+        ctx->readBytes = ctx->callbacks.readData;
+        ctx->skipBytes = ctx->callbacks.skipData;
+        ctx->ioUser = ctx->user;
+    }
+
+    else {
+        ctx->sendBytes = RCP_transport_send;
+        ctx->readBytes = RCP_transport_read;
+        ctx->skipBytes = RCP_transport_skip;
+        ctx->ioUser = transport;
+    }
+
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP__pollTransport(RCP_Context* ctx, size_t maxReads) {
+    if(ctx == NULL || ctx->readBytes != RCP_transport_read) return RCP_ERR_INIT;
+
+    RCP_Transport* t = ctx->ioUser;
+    uint64_t before = ctx->received;
+    RCP_Error first = RCP_ERR_SUCCESS;
+    ssize_t added = 0;
+
+    // Bytes left buffered by earlier blocking reads go first, since the descriptor no longer signals them. Each fill
+    // is handed over whole, and the parser keeps any partial packet itself, so the buffer is empty for the next one
+    for(size_t reads = 0;; reads++) {
+        RCP_Error rerrno = RCP_ctx_feed(ctx, t->buffer + t->start, t->end - t->start);
+        if(first == RCP_ERR_SUCCESS) first = rerrno;
+        t->start = 0;
+        t->end = 0;
+
+        if(reads == maxReads || (added = fillReady(t)) <= 0) break;
+    }
+
+    if(added < 0) return RCP_ERR_IO_RCV;
+    if(first != RCP_ERR_SUCCESS) return first;
+    return ctx->received == before ? RCP_ERR_WOULD_BLOCK : RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_ctx_pollNonBlocking(RCP_Context* ctx) { return RCP__pollTransport(ctx, SIZE_MAX); }
+
+int RCP_ctx_getFd(const RCP_Context* ctx) {
+    if(ctx == NULL || ctx->readBytes != RCP_transport_read) return -1;
+    return RCP_transport_fd(ctx->ioUser);
+}
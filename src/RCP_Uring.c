@@ -0,0 +1,830 @@
+#include "RCP_Host/RCP_Uring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "RCP_Internal.h"
+
+// What a submission was for, kept in the low bits of its user_data under the link it belongs to
+#define OP_RECV 0
+#define OP_SEND 1
+#define OP_CANCEL 2
+#define OP_MASK 3
+
+// How long RCP_uring_destroy waits for completions before trying again a cancel that found the submission queue full
+#define CANCEL_RETRY_MS 10
+
+struct Link {
+    RCP_Uring* ring;
+    uint32_t id;
+    RCP_Context* ctx;
+    RCP_Transport* transport;
+
+    // Counters as they were when the link was added, so its statistics only cover its time on the ring
+    uint64_t receivedBase;
+    uint64_t discardedBase;
+    struct RCP_TransportStats statsBase;
+    uint64_t lastReceiveNs;
+
+    // Kept from the transport, which may be closed once the link is removed while the kernel still has operations
+    int fd;
+    RCP__TransportKind kind;
+    int isSocket;
+
+    // Descriptor flags and terminal settings from before the link was added, put back when it is removed
+    int fdFlags;
+    int restoreTermios;
+    struct termios termios;
+
+    int closed;
+    int removing;
+
+    // Operations the kernel may still complete for the link. A removed link is only freed once none are left
+    int recvArmed;
+    int multishot;
+    int sending;
+    int cancelling;
+
+    // Set when the cancel for a removed link found the submission queue full, until sweep gets it in
+    int cancelPending;
+
+    // The send with the kernel is sendBuf from sendDone up to sendLen. Sends made meanwhile wait in queue
+    uint8_t sendBuf[RCP_URING_SEND_QUEUE];
+    size_t sendLen;
+    size_t sendDone;
+    uint8_t queue[RCP_URING_SEND_QUEUE];
+    size_t queueLen;
+};
+
+struct RCP_Uring {
+    int native;
+
+    // Set while the ring works through its links, in a poll or being destroyed. Submissions made meanwhile, and freeing
+    // removed links, are left for the end
+    int busy;
+
+    struct Link** links;
+    size_t len;
+    size_t cap;
+
+    // For the fallback, one entry per link
+    struct pollfd* pollfds;
+
+    // The link whose bytes are being processed, for RCP_uring_currentLink
+    const struct Link* current;
+
+#ifdef __linux__
+    int fd;
+    unsigned sqEntries;
+    unsigned toSubmit;
+    int sendQueued;
+
+    // Set when a link closes or fails, until the next poll reports it
+    int failed;
+
+    // Completions set aside by progressSends
+    struct io_uring_cqe* backlog;
+    size_t backlogLen;
+    size_t backlogCap;
+
+    void* rings;
+    size_t ringsSize;
+    struct io_uring_sqe* sqes;
+    size_t sqesSize;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqFlags;
+    unsigned* sqArray;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    struct io_uring_cqe* cqes;
+
+    // Receive buffers, and the ring they are handed to the kernel through
+    struct io_uring_buf_ring* bufRing;
+    size_t bufRingSize;
+    uint16_t bufTail;
+    uint8_t* bufs;
+#endif
+};
+
+static int inflight(const struct Link* l) { return l->recvArmed + l->sending + l->cancelling; }
+
+static void sweep(RCP_Uring* r);
+
+// Receive always happens through RCP_uring_poll, so RCP_ctx_poll on a context on the ring reads nothing
+static size_t ringRead(void* user, void* data, size_t length) {
+    (void) user;
+    (void) data;
+    (void) length;
+    return 0;
+}
+
+#ifdef __linux__
+
+// Hand queued submissions to the kernel, and with IORING_ENTER_GETEVENTS in flags wait up to timeoutMs for minComplete
+// completions. Returns -1 only if the ring itself failed
+static int enter(RCP_Uring* r, unsigned flags, unsigned minComplete, int timeoutMs) {
+    struct __kernel_timespec ts = {.tv_sec = timeoutMs / 1000, .tv_nsec = (long long) (timeoutMs % 1000) * 1000000};
+    struct io_uring_getevents_arg arg = {0};
+    arg.sigmask_sz = _NSIG / 8;
+    if(timeoutMs >= 0) arg.ts = (uint64_t) (uintptr_t) &ts;
+
+    for(;;) {
+        int ret = (int) syscall(__NR_io_uring_enter, r->fd, r->toSubmit, minComplete, flags | IORING_ENTER_EXT_ARG,
+                                &arg, sizeof(arg));
+        if(ret >= 0) {
+            r->toSubmit -= (unsigned) ret;
+            return 0;
+        }
+
+        if(errno == ETIME) return 0;
+        if(errno != EINTR) return -1;
+    }
+}
+
+// Next free submission entry, zeroed. The kernel only looks at the queue during io_uring_enter, so the entry can be
+// published before it is filled in. Returns NULL if the queue is full and the kernel will not take any of it
+static struct io_uring_sqe* getSqe(RCP_Uring* r) {
+    unsigned tail = *r->sqTail;
+    if(tail - __atomic_load_n(r->sqHead, __ATOMIC_ACQUIRE) >= r->sqEntries) {
+        enter(r, 0, 0, 0);
+        if(tail - __atomic_load_n(r->sqHead, __ATOMIC_ACQUIRE) >= r->sqEntries) return NULL;
+    }
+
+    unsigned idx = tail & *r->sqMask;
+    struct io_uring_sqe* sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    r->sqArray[idx] = idx;
+    __atomic_store_n(r->sqTail, tail + 1, __ATOMIC_RELEASE);
+    r->toSubmit++;
+    return sqe;
+}
+
+// Give a receive buffer back to the kernel
+static void provideBuffer(RCP_Uring* r, uint16_t bid) {
+    struct io_uring_buf* b = &r->bufRing->bufs[r->bufTail & (RCP_URING_BUFFERS - 1)];
+    b->addr = (uint64_t) (uintptr_t) (r->bufs + (size_t) bid * RCP_URING_BUFFER);
+    b->len = RCP_URING_BUFFER;
+    b->bid = bid;
+    r->bufTail++;
+    __atomic_store_n(&r->bufRing->tail, r->bufTail, __ATOMIC_RELEASE);
+}
+
+// Put a receive in flight, landing in whichever pool buffer the kernel picks. Sockets take a multishot receive, which
+// stays in flight across completions, and anything else a read that has to be re-armed after each one
+static void armRecv(struct Link* l) {
+    struct io_uring_sqe* sqe = getSqe(l->ring);
+    if(sqe == NULL) return;
+
+    sqe->fd = l->fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->user_data = (uint64_t) (uintptr_t) l | OP_RECV;
+
+    if(l->isSocket) {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = l->multishot ? IORING_RECV_MULTISHOT : 0;
+        sqe->len = l->multishot ? 0 : RCP_URING_BUFFER;
+    }
+
+    else {
+        sqe->opcode = IORING_OP_READ;
+        sqe->len = RCP_URING_BUFFER;
+        sqe->off = (uint64_t) -1;
+    }
+
+    l->recvArmed = 1;
+}
+
+// A link closed or failed. Reported by the next poll, unless the link was on its way off the ring anyway
+static void linkFailed(struct Link* l) {
+    if(!l->closed && !l->removing) l->ring->failed = 1;
+    l->closed = 1;
+    l->queueLen = 0;
+}
+
+// Give the kernel the part of the current send it has not taken yet
+static int submitSend(struct Link* l) {
+    struct io_uring_sqe* sqe = getSqe(l->ring);
+    if(sqe == NULL) return -1;
+
+    sqe->opcode = l->isSocket ? IORING_OP_SEND : IORING_OP_WRITE;
+    sqe->fd = l->fd;
+    sqe->addr = (uint64_t) (uintptr_t) (l->sendBuf + l->sendDone);
+    sqe->len = (uint32_t) (l->sendLen - l->sendDone);
+    sqe->user_data = (uint64_t) (uintptr_t) l | OP_SEND;
+    if(l->isSocket) sqe->msg_flags = MSG_NOSIGNAL;
+    else sqe->off = (uint64_t) -1;
+
+    l->sending = 1;
+    l->ring->sendQueued = 1;
+    return 0;
+}
+
+// Everything queued becomes the next send
+static void startSend(struct Link* l) {
+    memcpy(l->sendBuf, l->queue, l->queueLen);
+    l->sendLen = l->queueLen;
+    l->sendDone = 0;
+    l->queueLen = 0;
+    if(submitSend(l) != 0) linkFailed(l);
+}
+
+// Cancel everything in flight on the link's descriptor
+static void cancelAll(struct Link* l) {
+    l->cancelPending = 0;
+    if(l->recvArmed == 0 && l->sending == 0) return;
+
+    struct io_uring_sqe* sqe = getSqe(l->ring);
+    if(sqe == NULL) {
+        l->cancelPending = 1;
+        return;
+    }
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = l->fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = (uint64_t) (uintptr_t) l | OP_CANCEL;
+    l->cancelling = 1;
+}
+
+// Receive completion. Returns the first error a packet raised, and sets completed if any packet was
+static RCP_Error recvDone(struct Link* l, int res, uint32_t flags, int* completed) {
+    RCP_Error rerrno = RCP_ERR_SUCCESS;
+    if(!(flags & IORING_CQE_F_MORE)) l->recvArmed = 0;
+
+    // Decoded straight out of the buffer, which goes back to the pool as soon as the parser is done with it
+    if(flags & IORING_CQE_F_BUFFER) {
+        uint16_t bid = (uint16_t) (flags >> IORING_CQE_BUFFER_SHIFT);
+        if(res > 0 && !l->removing && !l->closed) {
+            l->transport->stats.reads++;
+            l->transport->stats.bytesRead += (uint64_t) res;
+            l->lastReceiveNs = RCP__monotonicNs();
+
+            uint64_t before = l->ctx->received;
+            l->ring->current = l;
+            rerrno = RCP_ctx_feed(l->ctx, l->ring->bufs + (size_t) bid * RCP_URING_BUFFER, (size_t) res);
+            l->ring->current = NULL;
+            if(l->ctx->received != before) *completed = 1;
+        }
+
+        provideBuffer(l->ring, bid);
+    }
+
+    if(res > 0) return rerrno;
+
+    // The end of a TCP stream. A read of nothing on a terminal or an empty datagram carries nothing, and running out of
+    // buffers or being cancelled only mean re-arming, or not if the link is going away
+    if(res == 0) {
+        if(l->kind == RCP__TRANSPORT_TCP) linkFailed(l);
+    }
+
+    // Kernels before 6.0 do not know multishot receives
+    else if(res == -EINVAL && l->multishot) l->multishot = 0;
+
+    else if(res != -ENOBUFS && res != -ECANCELED && res != -EINTR && res != -EAGAIN &&
+            !(l->kind == RCP__TRANSPORT_UDP && res == -ECONNREFUSED))
+        linkFailed(l);
+
+    return rerrno;
+}
+
+static void sendDone(struct Link* l, int res) {
+    l->sending = 0;
+    if(l->removing) return;
+
+    if(res == -EINTR || res == -EAGAIN) res = 0;
+    if(res < 0) {
+        linkFailed(l);
+        return;
+    }
+
+    l->transport->stats.writes++;
+    l->transport->stats.bytesSent += (uint64_t) res;
+
+    // A stream can take only part of a send, in which case the rest goes again
+    l->sendDone += (size_t) res;
+    if(l->sendDone < l->sendLen) {
+        if(submitSend(l) != 0) linkFailed(l);
+    }
+
+    else if(l->queueLen != 0) startSend(l);
+}
+
+// Submit what is queued, then handle the send completions waiting and submit the sends queued behind them, without
+// running any callbacks. Other completions are set aside for the next drain, in order. Sends the kernel finishes on
+// submission, as it usually does for sockets, complete in the same call, so a burst of sends goes out without waiting
+// for a poll
+static void progressSends(RCP_Uring* r) {
+    for(;;) {
+        if(r->toSubmit != 0 && enter(r, 0, 0, 0) != 0) return;
+        r->sendQueued = 0;
+
+        unsigned head = *r->cqHead;
+        while(head != __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe cqe = r->cqes[head & *r->cqMask];
+            if((cqe.user_data & OP_MASK) != OP_SEND) {
+                if(r->backlogLen == r->backlogCap) break;
+                r->backlog[r->backlogLen++] = cqe;
+            }
+
+            else sendDone((struct Link*) (uintptr_t) (cqe.user_data & ~(uint64_t) OP_MASK), cqe.res);
+            __atomic_store_n(r->cqHead, ++head, __ATOMIC_RELEASE);
+        }
+
+        if(!r->sendQueued) return;
+    }
+}
+
+// sendData for a context on the ring. Sends are queued, and go to the kernel straight away unless the ring is being
+// polled, in which case they wait for the end of the pass. A link has one send with the kernel at a time, which keeps
+// them in order, and later ones are queued until it completes
+static size_t ringSend(void* user, const void* data, size_t length) {
+    struct Link* l = user;
+    if(l->closed || l->queueLen + length > RCP_URING_SEND_QUEUE) return 0;
+
+    memcpy(l->queue + l->queueLen, data, length);
+    l->queueLen += length;
+    if(!l->sending) startSend(l);
+    if(!l->ring->busy) progressSends(l->ring);
+    return l->closed ? 0 : length;
+}
+
+// Handle one completion from a drain
+static RCP_Error complete(const struct io_uring_cqe* cqe, int* completed) {
+    struct Link* l = (struct Link*) (uintptr_t) (cqe->user_data & ~(uint64_t) OP_MASK);
+
+    switch(cqe->user_data & OP_MASK) {
+    case OP_RECV: return recvDone(l, cqe->res, cqe->flags, completed);
+    case OP_SEND: sendDone(l, cqe->res); break;
+    default: l->cancelling = 0; break;
+    }
+
+    return RCP_ERR_SUCCESS;
+}
+
+// Handle every completion waiting, those set aside by progressSends first
+static RCP_Error drain(RCP_Uring* r, int* completed) {
+    RCP_Error first = RCP_ERR_SUCCESS;
+
+    // A callback may send, and set more aside, so the backlog is worked through by index
+    for(size_t i = 0; i < r->backlogLen; i++) {
+        RCP_Error rerrno = complete(&r->backlog[i], completed);
+        if(first == RCP_ERR_SUCCESS) first = rerrno;
+    }
+
+    r->backlogLen = 0;
+
+    for(;;) {
+        unsigned head = *r->cqHead;
+        if(head == __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE)) {
+            // Completions that did not fit are held by the kernel until asked for
+            if(!(__atomic_load_n(r->sqFlags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW)) break;
+            enter(r, IORING_ENTER_GETEVENTS, 0, 0);
+            if(head == __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE)) break;
+        }
+
+        // Copied out and released first, since the callbacks run from here may submit more
+        struct io_uring_cqe cqe = r->cqes[head & *r->cqMask];
+        __atomic_store_n(r->cqHead, head + 1, __ATOMIC_RELEASE);
+
+        RCP_Error rerrno = complete(&cqe, completed);
+        if(first == RCP_ERR_SUCCESS) first = rerrno;
+    }
+
+    return first;
+}
+
+static RCP_Error pollNative(RCP_Uring* r, int timeoutMs) {
+    r->busy = 1;
+    r->sendQueued = 0;
+
+    int completed = 0;
+    RCP_Error first = RCP_ERR_SUCCESS;
+
+    // Nothing waits if completions were already set aside
+    unsigned minComplete = timeoutMs == 0 || r->backlogLen != 0 ? 0 : 1;
+    if(enter(r, IORING_ENTER_GETEVENTS, minComplete, timeoutMs) != 0) r->failed = 1;
+    else first = drain(r, &completed);
+    sweep(r);
+
+    // Sends made from callbacks during the pass go out together, with the receives just re-armed
+    if(r->sendQueued) progressSends(r);
+    r->busy = 0;
+
+    int failed = r->failed;
+    r->failed = 0;
+    if(failed) return RCP_ERR_IO_RCV;
+    if(first != RCP_ERR_SUCCESS) return first;
+    return completed ? RCP_ERR_SUCCESS : RCP_ERR_WOULD_BLOCK;
+}
+
+static void unmapRing(RCP_Uring* r) {
+    if(r->bufRing != NULL) munmap(r->bufRing, r->bufRingSize);
+    if(r->sqes != NULL) munmap(r->sqes, r->sqesSize);
+    if(r->rings != NULL) munmap(r->rings, r->ringsSize);
+    if(r->fd >= 0) close(r->fd);
+    free(r->bufs);
+    free(r->backlog);
+}
+
+// Set up the ring, its queues and the receive buffers. Returns 0 on success, and otherwise leaves nothing behind
+static int setupRing(RCP_Uring* r, unsigned entries) {
+    r->fd = -1;
+    r->rings = NULL;
+    r->sqes = NULL;
+    r->bufRing = NULL;
+    r->bufs = NULL;
+    r->backlog = NULL;
+    r->backlogLen = 0;
+    r->toSubmit = 0;
+    r->sendQueued = 0;
+    r->failed = 0;
+    r->bufTail = 0;
+
+    struct io_uring_params p = {0};
+    p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+    p.cq_entries = entries * 4;
+
+    r->fd = (int) syscall(__NR_io_uring_setup, entries, &p);
+    if(r->fd < 0) return -1;
+
+    unsigned needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if((p.features & needed) != needed) goto fail;
+
+    // With a single mmap the submission and completion rings share one mapping, sized for the larger
+    size_t sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->ringsSize = sqSize > cqSize ? sqSize : cqSize;
+    r->rings = mmap(NULL, r->ringsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if(r->rings == MAP_FAILED) {
+        r->rings = NULL;
+        goto fail;
+    }
+
+    r->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if(r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        goto fail;
+    }
+
+    r->backlogCap = p.cq_entries;
+    r->backlog = malloc(r->backlogCap * sizeof(struct io_uring_cqe));
+    if(r->backlog == NULL) goto fail;
+
+    uint8_t* base = r->rings;
+    r->sqEntries = p.sq_entries;
+    r->sqHead = (unsigned*) (base + p.sq_off.head);
+    r->sqTail = (unsigned*) (base + p.sq_off.tail);
+    r->sqMask = (unsigned*) (base + p.sq_off.ring_mask);
+    r->sqFlags = (unsigned*) (base + p.sq_off.flags);
+    r->sqArray = (unsigned*) (base + p.sq_off.array);
+    r->cqHead = (unsigned*) (base + p.cq_off.head);
+    r->cqTail = (unsigned*) (base + p.cq_off.tail);
+    r->cqMask = (unsigned*) (base + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*) (base + p.cq_off.cqes);
+
+    // The buffer ring has to be page aligned, which a mapping of its own always is
+    r->bufRingSize = RCP_URING_BUFFERS * sizeof(struct io_uring_buf);
+    r->bufRing = mmap(NULL, r->bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    r->bufs = malloc((size_t) RCP_URING_BUFFERS * RCP_URING_BUFFER);
+    if(r->bufRing == MAP_FAILED) r->bufRing = NULL;
+    if(r->bufRing == NULL || r->bufs == NULL) goto fail;
+
+    struct io_uring_buf_reg reg = {0};
+    reg.ring_addr = (uint64_t) (uintptr_t) r->bufRing;
+    reg.ring_entries = RCP_URING_BUFFERS;
+    reg.bgid = 0;
+    if(syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) goto fail;
+
+    for(uint16_t bid = 0; bid < RCP_URING_BUFFERS; bid++) provideBuffer(r, bid);
+    return 0;
+
+fail:
+    unmapRing(r);
+    return -1;
+}
+
+#endif
+
+// Re-arm receives that finished, and free removed links the kernel is done with
+static void sweep(RCP_Uring* r) {
+    size_t kept = 0;
+    for(size_t i = 0; i < r->len; i++) {
+        struct Link* l = r->links[i];
+        if(l->removing && inflight(l) == 0) {
+            free(l);
+            continue;
+        }
+
+#ifdef __linux__
+        // Completions handled since the cancel was tried may have made room for it
+        if(r->native && l->cancelPending) cancelAll(l);
+        if(r->native && !l->removing && !l->closed && !l->recvArmed) armRecv(l);
+#endif
+        r->links[kept++] = l;
+    }
+
+    r->len = kept;
+}
+
+static RCP_Error pollFallback(RCP_Uring* r, int timeoutMs) {
+    r->busy = 1;
+    size_t n = 0;
+    for(size_t i = 0; i < r->len; i++) {
+        if(r->links[i]->closed || r->links[i]->removing) continue;
+        r->pollfds[n].fd = r->links[i]->fd;
+        r->pollfds[n].events = POLLIN;
+        r->pollfds[n].revents = 0;
+        n++;
+    }
+
+    int ready = poll(r->pollfds, n, timeoutMs);
+
+    int completed = 0;
+    int failed = ready < 0 && errno != EINTR;
+    RCP_Error first = RCP_ERR_SUCCESS;
+
+    // Links that closed or are being removed were left out, so the descriptors line up with the open links in order.
+    // Each ready link gets one read per pass, so a busy link can not hold up the others. Whatever it has left keeps
+    // its descriptor ready for the next pass
+    size_t at = 0;
+    for(size_t i = 0; i < r->len && ready > 0; i++) {
+        struct Link* l = r->links[i];
+        if(l->closed || l->removing) continue;
+        if(r->pollfds[at++].revents == 0) continue;
+
+        uint64_t bytesBefore = l->transport->stats.bytesRead;
+        r->current = l;
+        RCP_Error rerrno = RCP__pollTransport(l->ctx, 1);
+        r->current = NULL;
+        if(l->transport->stats.bytesRead != bytesBefore) l->lastReceiveNs = RCP__monotonicNs();
+
+        if(rerrno == RCP_ERR_SUCCESS) completed = 1;
+
+        else if(rerrno == RCP_ERR_IO_RCV) {
+            l->closed = 1;
+            failed = 1;
+        }
+
+        else if(rerrno != RCP_ERR_WOULD_BLOCK && first == RCP_ERR_SUCCESS) first = rerrno;
+    }
+
+    r->busy = 0;
+    sweep(r);
+
+    if(failed) return RCP_ERR_IO_RCV;
+    if(first != RCP_ERR_SUCCESS) return first;
+    return completed ? RCP_ERR_SUCCESS : RCP_ERR_WOULD_BLOCK;
+}
+
+RCP_Error RCP_uring_create(unsigned entries, unsigned flags, RCP_Uring** ring) {
+    if(ring == NULL || entries == 0) return RCP_ERR_INIT;
+    *ring = NULL;
+
+    RCP_Uring* r = malloc(sizeof(RCP_Uring));
+    if(r == NULL) return RCP_ERR_MEMALLOC;
+
+    r->native = 0;
+    r->busy = 0;
+    r->links = NULL;
+    r->len = 0;
+    r->cap = 0;
+    r->pollfds = NULL;
+    r->current = NULL;
+
+#ifdef __linux__
+    if(!(flags & RCP_URING_FALLBACK)) r->native = setupRing(r, entries) == 0;
+#else
+    (void) flags;
+#endif
+
+    *ring = r;
+    return RCP_ERR_SUCCESS;
+}
+
+static struct Link* findLink(const RCP_Uring* ring, const RCP_Context* ctx) {
+    for(size_t i = 0; i < ring->len; i++)
+        if(ring->links[i]->ctx == ctx && !ring->links[i]->removing) return ring->links[i];
+    return NULL;
+}
+
+static struct Link* findLinkId(const RCP_Uring* ring, uint32_t linkId) {
+    for(size_t i = 0; i < ring->len; i++)
+        if(ring->links[i]->id == linkId && !ring->links[i]->removing) return ring->links[i];
+    return NULL;
+}
+
+RCP_Error RCP_uring_add(RCP_Uring* ring, uint32_t linkId, RCP_Context* ctx, RCP_Transport* transport) {
+    if(ring == NULL || ctx == NULL || transport == NULL) return RCP_ERR_INIT;
+    if(findLink(ring, ctx) != NULL || findLinkId(ring, linkId) != NULL) return RCP_ERR_INIT;
+
+    if(ring->len == ring->cap) {
+        size_t cap = ring->cap == 0 ? 8 : ring->cap * 2;
+        struct Link** links = realloc(ring->links, cap * sizeof(struct Link*));
+        if(links == NULL) return RCP_ERR_MEMALLOC;
+        ring->links = links;
+
+        struct pollfd* pollfds = realloc(ring->pollfds, cap * sizeof(struct pollfd));
+        if(pollfds == NULL) return RCP_ERR_MEMALLOC;
+        ring->pollfds = pollfds;
+        ring->cap = cap;
+    }
+
+    struct Link* l = malloc(sizeof(struct Link));
+    if(l == NULL) return RCP_ERR_MEMALLOC;
+
+    l->ring = ring;
+    l->id = linkId;
+    l->ctx = ctx;
+    l->transport = transport;
+    l->fd = transport->fd;
+    l->kind = transport->kind;
+    l->closed = 0;
+    l->removing = 0;
+    l->recvArmed = 0;
+    l->multishot = 1;
+    l->sending = 0;
+    l->cancelling = 0;
+    l->cancelPending = 0;
+    l->sendLen = 0;
+    l->sendDone = 0;
+    l->queueLen = 0;
+    l->restoreTermios = 0;
+    l->fdFlags = fcntl(transport->fd, F_GETFL);
+    if(l->fdFlags < 0) {
+        free(l);
+        return RCP_ERR_INIT;
+    }
+
+    struct stat st;
+    l->isSocket = fstat(transport->fd, &st) == 0 && S_ISSOCK(st.st_mode);
+
+    l->receivedBase = ctx->received;
+    l->discardedBase = ctx->discarded;
+    l->statsBase = transport->stats;
+    l->lastReceiveNs = 0;
+
+    // Bytes the transport read ahead before now would otherwise never be seen
+    RCP_ctx_setTransport(ctx, transport);
+    ring->current = l;
+    RCP_ctx_feed(ctx, transport->buffer + transport->start, transport->end - transport->start);
+    ring->current = NULL;
+    transport->start = 0;
+    transport->end = 0;
+
+#ifdef __linux__
+    if(ring->native) {
+        // io_uring hands a non-blocking descriptor's EAGAIN back instead of waiting for data, so the descriptor is
+        // made blocking. A serial port then needs VMIN, or its reads would return empty straight away
+        fcntl(transport->fd, F_SETFL, l->fdFlags & ~O_NONBLOCK);
+        if(transport->kind == RCP__TRANSPORT_SERIAL && !transport->termiosTimed &&
+           tcgetattr(transport->fd, &l->termios) == 0) {
+            struct termios tio = l->termios;
+            tio.c_cc[VMIN] = 1;
+            tio.c_cc[VTIME] = 0;
+            l->restoreTermios = tcsetattr(transport->fd, TCSANOW, &tio) == 0;
+        }
+
+        ctx->sendBytes = ringSend;
+        ctx->readBytes = ringRead;
+        ctx->skipBytes = NULL;
+        ctx->ioUser = l;
+        armRecv(l);
+    }
+#endif
+
+    ring->links[ring->len++] = l;
+    return RCP_ERR_SUCCESS;
+}
+
+// Detach a link from its context and start it leaving the ring
+static void removeLink(RCP_Uring* ring, struct Link* l) {
+    l->removing = 1;
+    RCP_ctx_setTransport(l->ctx, l->transport);
+
+    fcntl(l->fd, F_SETFL, l->fdFlags);
+    if(l->restoreTermios) tcsetattr(l->fd, TCSANOW, &l->termios);
+
+#ifdef __linux__
+    if(ring->native) {
+        cancelAll(l);
+        if(!ring->busy) {
+            enter(ring, 0, 0, 0);
+            sweep(ring);
+        }
+
+        return;
+    }
+#endif
+
+    if(!ring->busy) sweep(ring);
+}
+
+RCP_Error RCP_uring_remove(RCP_Uring* ring, RCP_Context* ctx) {
+    if(ring == NULL) return RCP_ERR_INIT;
+
+    struct Link* l = findLink(ring, ctx);
+    if(l == NULL) return RCP_ERR_INIT;
+
+    removeLink(ring, l);
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_uring_destroy(RCP_Uring* ring) {
+    if(ring == NULL) return RCP_ERR_INIT;
+
+    ring->busy = 1;
+    for(size_t i = 0; i < ring->len; i++)
+        if(!ring->links[i]->removing) removeLink(ring, ring->links[i]);
+    sweep(ring);
+
+#ifdef __linux__
+    // The kernel may still write into links and buffers until everything cancelled has completed. A cancel still
+    // waiting for room may be all that would end an operation, so the wait is cut short to try it again
+    if(ring->native) {
+        int completed = 0;
+        while(ring->len != 0) {
+            int timeoutMs = -1;
+            for(size_t i = 0; i < ring->len; i++)
+                if(ring->links[i]->cancelPending) timeoutMs = CANCEL_RETRY_MS;
+
+            if(enter(ring, IORING_ENTER_GETEVENTS, ring->backlogLen != 0 ? 0 : 1, timeoutMs) != 0) break;
+            drain(ring, &completed);
+            sweep(ring);
+        }
+
+        unmapRing(ring);
+    }
+#endif
+
+    for(size_t i = 0; i < ring->len; i++) free(ring->links[i]);
+    free(ring->links);
+    free(ring->pollfds);
+    free(ring);
+    return RCP_ERR_SUCCESS;
+}
+
+int RCP_uring_isNative(const RCP_Uring* ring) { return ring != NULL && ring->native; }
+
+int RCP_uring_isOpen(const RCP_Uring* ring, const RCP_Context* ctx) {
+    if(ring == NULL) return 0;
+
+    const struct Link* l = findLink(ring, ctx);
+    return l != NULL && !l->closed;
+}
+
+RCP_Context* RCP_uring_getLink(const RCP_Uring* ring, uint32_t linkId) {
+    if(ring == NULL) return NULL;
+
+    const struct Link* l = findLinkId(ring, linkId);
+    return l == NULL ? NULL : l->ctx;
+}
+
+int RCP_uring_currentLink(const RCP_Uring* ring, uint32_t* linkId) {
+    if(ring == NULL || ring->current == NULL) return 0;
+
+    if(linkId != NULL) *linkId = ring->current->id;
+    return 1;
+}
+
+RCP_Error RCP_uring_getStats(const RCP_Uring* ring, uint32_t linkId, struct RCP_UringLinkStats* stats) {
+    if(ring == NULL || stats == NULL) return RCP_ERR_INIT;
+
+    const struct Link* l = findLinkId(ring, linkId);
+    if(l == NULL) return RCP_ERR_INIT;
+
+    stats->packets = l->ctx->received - l->receivedBase;
+    stats->discarded = l->ctx->discarded - l->discardedBase;
+    stats->bytesReceived = l->transport->stats.bytesRead - l->statsBase.bytesRead;
+    stats->bytesSent = l->transport->stats.bytesSent - l->statsBase.bytesSent;
+    stats->lastReceiveNs = l->lastReceiveNs;
+    stats->open = !l->closed;
+    return RCP_ERR_SUCCESS;
+}
+
+RCP_Error RCP_uring_poll(RCP_Uring* ring, int timeoutMs) {
+    if(ring == NULL) return RCP_ERR_INIT;
+
+#ifdef __linux__
+    if(ring->native) return pollNative(ring, timeoutMs);
+#endif
+    return pollFallback(ring, timeoutMs);
+}
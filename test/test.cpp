@@ -1,16 +1,38 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <thread>
 #include <utility>
 
 #include "RingBuffer.h"
+#include "RCP_Host/RCP_Capture.h"
+#include "RCP_Host/RCP_Cobs.h"
 #include "RCP_Host/RCP_Host.h"
+#include "RCP_Host/RCP_Index.h"
+#include "RCP_Host/RCP_Latency.h"
+#include "RCP_Host/RCP_Latest.h"
+#include "RCP_Host/RCP_Limits.h"
+#include "RCP_Host/RCP_Parallel.h"
+#include "RCP_Host/RCP_Replay.h"
+#include "RCP_Host/RCP_Ring.h"
+#include "RCP_Host/RCP_Stats.h"
+#include "RCP_Host/RCP_Store.h"
+#include "RCP_Host/RCP_Transport.h"
+#include "RCP_Host/RCP_Uring.h"
+#include "RCP_Internal.h"
 #include "gtest/gtest.h"
 
 // Exposing some internals for testing purposes
 extern "C" {
 extern RCP_Channel channel;
-extern RCP_PromptDataType activePromptType;
-extern RCP_LibInitData* callbacks;
-extern uint8_t* buffer;
-RCP_Error processIU(RCP_DeviceClass devclass, uint32_t timestamp, uint16_t params, const uint8_t* postTS, size_t* inc);
+extern RCP_Context* globalCtx;
+RCP_Error processIU(RCP_Context* ctx, RCP_DeviceClass devclass, uint32_t timestamp, size_t params,
+                    const uint8_t* postTS, size_t* inc);
 }
 
 // Emtpy stub callbacks for tests that don't need a particular callback
@@ -220,6 +242,12 @@ namespace TEST_Preinit {
 
         TEST_NONINIT_RUN(RCP_shutdown);
         TEST_NONINIT_RUN(RCP_poll);
+        TEST_NONINIT_RUN(RCP_feed, nullptr, 0);
+        TEST_NONINIT_RUN(RCP_setPacketTap, nullptr, nullptr);
+        TEST_NONINIT_RUN(RCP_setResync, 1);
+        TEST_NONINIT_RUN(RCP_setFraming, RCP_FRAMING_COBS);
+        TEST_NONINIT_RUN(RCP_beginBatch, 0, 0);
+        TEST_NONINIT_RUN(RCP_flush);
         TEST_NONINIT_RUN(RCP_sendEStop);
         TEST_NONINIT_RUN(RCP_sendHeartbeat);
         TEST_NONINIT_RUN(RCP_startTest, 0);
@@ -286,10 +314,10 @@ namespace TEST_BadIO {
         TEST_BADIOSEND(RCP_requestGeneralRead, RCP_DEVCLASS_TEST_STATE, 0);
         TEST_BADIOSEND(RCP_requestTareConfiguration, RCP_DEVCLASS_GYROSCOPE, 0, 0, 0);
 
-        activePromptType = RCP_PromptDataType_GONOGO;
+        globalCtx->activePromptType = RCP_PromptDataType_GONOGO;
         TEST_BADIOSEND(RCP_promptRespondGONOGO, RCP_GONOGO_GO);
 
-        activePromptType = RCP_PromptDataType_Float;
+        globalCtx->activePromptType = RCP_PromptDataType_Float;
         TEST_BADIOSEND(RCP_promptRespondFloat, 0);
     }
 
@@ -321,7 +349,7 @@ namespace TEST_RCP_init {
 
 namespace TEST_RCP_errstr {
     TEST(RCPErrstr, RCPErrstrIndexTooLow) { EXPECT_EQ(RCP_errstr(static_cast<RCP_Error>(-1)), nullptr); }
-    TEST(RCPErrstr, RCPErrstrIndexTooHigh) { EXPECT_EQ(RCP_errstr(static_cast<RCP_Error>(9)), nullptr); }
+    TEST(RCPErrstr, RCPErrstrIndexTooHigh) { EXPECT_EQ(RCP_errstr(static_cast<RCP_Error>(16)), nullptr); }
 } // namespace TEST_RCP_errstr
 
 // ------------ SECTION: RCP_setChannel ------------ //
@@ -434,22 +462,52 @@ namespace TEST_processIU {
 
     TEST_F(ProcessIU, NoCrashOnNullInc) {
         uint8_t pkt[2];
-        RCP_Error retval = processIU(RCP_DEVCLASS_TEST_STATE, 0, 0, pkt, nullptr);
+        RCP_Error retval = processIU(globalCtx, RCP_DEVCLASS_TEST_STATE, 0, 0, pkt, nullptr);
         EXPECT_EQ(retval, RCP_ERR_SUCCESS);
     }
 
     TEST_F(ProcessIU, ErrorOnAmalgamate) {
-        RCP_Error retval = processIU(RCP_DEVCLASS_AMALGAMATE, 0, 0, nullptr, nullptr);
+        RCP_Error retval = processIU(globalCtx, RCP_DEVCLASS_AMALGAMATE, 0, 0, nullptr, nullptr);
         EXPECT_EQ(retval, RCP_ERR_AMALG_NESTING);
     }
 
+    TEST_F(ProcessIU, ErrorOnUnknownDevclass) {
+        uint8_t pkt[2] = {};
+        RCP_Error retval = processIU(globalCtx, static_cast<RCP_DeviceClass>(0x85), 0, 2, pkt, nullptr);
+        EXPECT_EQ(retval, RCP_ERR_INVALID_DEVCLASS);
+    }
+
+    TEST_F(ProcessIU, IncFromDevclassTable) {
+        uint8_t pkt[17] = {};
+        size_t inc = 0;
+
+        EXPECT_EQ(processIU(globalCtx, RCP_DEVCLASS_BOOL_SENSOR, 0, 0, pkt, &inc), RCP_ERR_SUCCESS);
+        EXPECT_EQ(inc, 2);
+        EXPECT_EQ(processIU(globalCtx, RCP_DEVCLASS_FLOW_METER, 0, 0, pkt, &inc), RCP_ERR_SUCCESS);
+        EXPECT_EQ(inc, 5);
+        EXPECT_EQ(processIU(globalCtx, RCP_DEVCLASS_POWERMON, 0, 0, pkt, &inc), RCP_ERR_SUCCESS);
+        EXPECT_EQ(inc, 9);
+        EXPECT_EQ(processIU(globalCtx, RCP_DEVCLASS_MAGNETOMETER, 0, 0, pkt, &inc), RCP_ERR_SUCCESS);
+        EXPECT_EQ(inc, 13);
+        EXPECT_EQ(processIU(globalCtx, RCP_DEVCLASS_GPS, 0, 0, pkt, &inc), RCP_ERR_SUCCESS);
+        EXPECT_EQ(inc, 17);
+
+        // Test state is 2 bytes, or 4 with a running test
+        pkt[0] = RCP_TEST_STOPPED;
+        EXPECT_EQ(processIU(globalCtx, RCP_DEVCLASS_TEST_STATE, 0, 0, pkt, &inc), RCP_ERR_SUCCESS);
+        EXPECT_EQ(inc, 2);
+        pkt[0] = RCP_TEST_RUNNING;
+        EXPECT_EQ(processIU(globalCtx, RCP_DEVCLASS_TEST_STATE, 0, 0, pkt, &inc), RCP_ERR_SUCCESS);
+        EXPECT_EQ(inc, 4);
+    }
+
     TEST_F(ProcessIU, PromptRequestAmalged) {
-        RCP_Error retval = processIU(RCP_DEVCLASS_PROMPT, 0, 0, nullptr, nullptr);
+        RCP_Error retval = processIU(globalCtx, RCP_DEVCLASS_PROMPT, 0, 0, nullptr, nullptr);
         EXPECT_EQ(retval, RCP_ERR_AMALG_SUBUNIT);
     }
 
     TEST_F(ProcessIU, TargetLogAmalged) {
-        RCP_Error retval = processIU(RCP_DEVCLASS_TARGET_LOG, 0, 0, nullptr, nullptr);
+        RCP_Error retval = processIU(globalCtx, RCP_DEVCLASS_TARGET_LOG, 0, 0, nullptr, nullptr);
         EXPECT_EQ(retval, RCP_ERR_AMALG_SUBUNIT);
     }
 
@@ -458,7 +516,7 @@ namespace TEST_processIU {
     TEST_F(ProcessIU, PromptRequestReset) {
         uint8_t pkt[] = {RCP_PromptDataType_RESET};
 
-        RCP_Error retval = processIU(RCP_DEVCLASS_PROMPT, 0, 1, pkt, nullptr);
+        RCP_Error retval = processIU(globalCtx, RCP_DEVCLASS_PROMPT, 0, 1, pkt, nullptr);
 
         EXPECT_EQ(retval, RCP_ERR_SUCCESS);
         EXPECT_EQ(RCP_getActivePromptType(), RCP_PromptDataType_RESET);
@@ -473,7 +531,7 @@ namespace TEST_processIU {
         uint8_t pkt[] = {RCP_PromptDataType_Float, HELLOHEX};
         uint16_t pktSize = sizeof(pkt) / sizeof(uint8_t);
 
-        RCP_Error retval = processIU(RCP_DEVCLASS_PROMPT, 0, pktSize, pkt, nullptr);
+        RCP_Error retval = processIU(globalCtx, RCP_DEVCLASS_PROMPT, 0, pktSize, pkt, nullptr);
 
         EXPECT_EQ(retval, RCP_ERR_SUCCESS);
         EXPECT_EQ(RCP_getActivePromptType(), RCP_PromptDataType_Float);
@@ -487,7 +545,7 @@ namespace TEST_processIU {
         uint8_t pkt[] = {RCP_PromptDataType_GONOGO, HELLOHEX};
         uint16_t pktSize = sizeof(pkt) / sizeof(uint8_t);
 
-        RCP_Error retval = processIU(RCP_DEVCLASS_PROMPT, 0, pktSize, pkt, nullptr);
+        RCP_Error retval = processIU(globalCtx, RCP_DEVCLASS_PROMPT, 0, pktSize, pkt, nullptr);
 
         EXPECT_EQ(retval, RCP_ERR_SUCCESS);
         EXPECT_EQ(RCP_getActivePromptType(), RCP_PromptDataType_GONOGO);
@@ -504,7 +562,7 @@ namespace TEST_processIU {
         const EnvInfo& envInfo = GetParam();
 
         RCP_Error retval =
-            processIU(envInfo.devclass, envInfo.timestamp, envInfo.pkt.size(), envInfo.pkt.data(), nullptr);
+            processIU(globalCtx, envInfo.devclass, envInfo.timestamp, envInfo.pkt.size(), envInfo.pkt.data(), nullptr);
 
         EXPECT_EQ(retval, RCP_ERR_SUCCESS);
         // Here we don't use the overloaded equality operators since otherwise googletest wont show which fields were
@@ -1013,18 +1071,76 @@ namespace TEST_RCP_poll {
         EXPECT_EQ(hostData.testData, RCP_TestData{});
     }
 
-#define CHECKVALS(val) EXPECT_EQ(hostData.val, envInfo.endState.val)
-#define CHECKBOOL(val) EXPECT_EQ(static_cast<bool>(hostData.val), static_cast<bool>(envInfo.endState.val))
+    TEST_F(RCPPoll, FeedManyPacketsOneCall) {
+        const uint8_t bytes[] = {0x00, // Zero length packet
+                                 0x06, RCP_DEVCLASS_BOOL_SENSOR, HFLOATARR(TS1), 0x03, 0x01,
+                                 0x40, 0x00, 0x08, RCP_DEVCLASS_LOAD_CELL, HFLOATARR(TS2), 0x07, HFLOATARR(HPI),
+                                 // Start of a packet that is finished in the next call
+                                 0x06, RCP_DEVCLASS_SIMPLE_ACTUATOR, HFLOATARR(TS1)};
+        const uint8_t rest[] = {0x02, RCP_SIMPLE_ACTUATOR_ON};
+
+        EXPECT_EQ(RCP_feed(bytes, sizeof(bytes)), RCP_ERR_SUCCESS);
+        EXPECT_EQ(hostData.boolData, (RCP_BoolData{.timestamp = TS1, .ID = 3, .data = 1}));
+        EXPECT_EQ(hostData.f1, (RCP_1F{.devclass = RCP_DEVCLASS_LOAD_CELL, .timestamp = TS2, .ID = 7, .data = PI}));
+        EXPECT_EQ(hostData.sactData, RCP_SimpleActuatorData{});
+
+        EXPECT_EQ(RCP_feed(rest, sizeof(rest)), RCP_ERR_SUCCESS);
+        EXPECT_EQ(hostData.sactData,
+                  (RCP_SimpleActuatorData{.timestamp = TS1, .ID = 2, .state = RCP_SIMPLE_ACTUATOR_ON}));
+    }
 
-    TEST_P(RCPPoll, GeneralTests) {
-        const EnvInfo& envInfo = GetParam();
-        for(const uint8_t& b : envInfo.pkt) pkt.push(b);
+    TEST_F(RCPPoll, FeedSplitExtendedHeader) {
+        const uint8_t bytes[] = {0x40, 0x00, 0x08, RCP_DEVCLASS_TARGET_LOG, HFLOATARR(TS2), HELLOHEX};
 
-        RCP_Error retval = RCP_poll();
+        EXPECT_EQ(RCP_feed(bytes, 2), RCP_ERR_SUCCESS);
+        EXPECT_TRUE(hostData.log.empty());
+        EXPECT_EQ(RCP_feed(bytes + 2, sizeof(bytes) - 2), RCP_ERR_SUCCESS);
+        EXPECT_EQ(hostData.logtimestamp, TS2);
+        EXPECT_EQ(hostData.log, STR_HELLO);
+    }
 
-        EXPECT_EQ(retval, RCP_ERR_SUCCESS);
-        EXPECT_TRUE(pkt.isEmpty());
+    TEST_F(RCPPoll, FeedContinuesPastError) {
+        // Amalgamation unit holding a subunit that can't be amalgamated, then a bool reading
+        const uint8_t bytes[] = {0x0A, RCP_DEVCLASS_AMALGAMATE, 0x00, 0x00, 0x00, 0x00,
+                                 RCP_DEVCLASS_TARGET_LOG, HELLOHEX,
+                                 0x06, RCP_DEVCLASS_BOOL_SENSOR, HFLOATARR(TS1), 0x03, 0x01};
+
+        EXPECT_EQ(RCP_feed(bytes, sizeof(bytes)), RCP_ERR_AMALG_SUBUNIT);
+        EXPECT_TRUE(hostData.log.empty());
+        EXPECT_EQ(hostData.boolData, (RCP_BoolData{.timestamp = TS1, .ID = 3, .data = 1}));
+    }
+
+    // Malformed packets are fed from the heap, sized exactly, so reading past them is caught under a sanitizer
+    TEST_F(RCPPoll, FeedShortPacket) {
+        const std::vector<uint8_t> bytes = {0x01, RCP_DEVCLASS_PRESSURE_TRANSDUCER, 0x00};
+
+        EXPECT_EQ(RCP_feed(bytes.data(), bytes.size()), RCP_ERR_MALFORMED_PACKET);
+        EXPECT_EQ(hostData.f1, RCP_1F{});
+    }
+
+    TEST_F(RCPPoll, FeedSubunitPastEnd) {
+        // The GPS subunit has its class byte but none of its parameters
+        const std::vector<uint8_t> bytes = {0x08, RCP_DEVCLASS_AMALGAMATE, HFLOATARR(TS1),
+                                            RCP_DEVCLASS_BOOL_SENSOR, 0x03, 0x01, RCP_DEVCLASS_GPS};
+
+        EXPECT_EQ(RCP_feed(bytes.data(), bytes.size()), RCP_ERR_MALFORMED_PACKET);
+        EXPECT_EQ(hostData.boolData, (RCP_BoolData{.timestamp = TS1, .ID = 3, .data = 1}));
+        EXPECT_EQ(hostData.f4, RCP_4F{});
+    }
+
+    TEST_F(RCPPoll, FeedShortTargetLog) {
+        const std::vector<uint8_t> bytes = {0x02, RCP_DEVCLASS_TARGET_LOG, 'h', 'i'};
+
+        EXPECT_EQ(RCP_feed(bytes.data(), bytes.size()), RCP_ERR_MALFORMED_PACKET);
+        EXPECT_TRUE(hostData.log.empty());
+        EXPECT_EQ(hostData.logtimestamp, 0);
+    }
+
+#define CHECKVALS(val) EXPECT_EQ(hostData.val, envInfo.endState.val)
+#define CHECKBOOL(val) EXPECT_EQ(static_cast<bool>(hostData.val), static_cast<bool>(envInfo.endState.val))
 
+    // Shared by the poll and feed tests, which should end up in the same state for the same bytes
+    static void expectEndState(const HostData& hostData, const EnvInfo& envInfo) {
         // Here we don't use the overloaded equality operators since otherwise googletest wont show which fields were
         // mismatched
 
@@ -1086,6 +1202,34 @@ namespace TEST_RCP_poll {
         CHECKVALS(f4.data[3]);
     }
 
+    TEST_P(RCPPoll, GeneralTests) {
+        const EnvInfo& envInfo = GetParam();
+        for(const uint8_t& b : envInfo.pkt) pkt.push(b);
+
+        RCP_Error retval = RCP_poll();
+
+        EXPECT_EQ(retval, RCP_ERR_SUCCESS);
+        EXPECT_TRUE(pkt.isEmpty());
+        expectEndState(hostData, envInfo);
+    }
+
+    TEST_P(RCPPoll, FeedWholePacket) {
+        const EnvInfo& envInfo = GetParam();
+
+        RCP_Error retval = RCP_feed(envInfo.pkt.data(), envInfo.pkt.size());
+
+        EXPECT_EQ(retval, RCP_ERR_SUCCESS);
+        expectEndState(hostData, envInfo);
+    }
+
+    TEST_P(RCPPoll, FeedBytewise) {
+        const EnvInfo& envInfo = GetParam();
+
+        for(const uint8_t& b : envInfo.pkt) EXPECT_EQ(RCP_feed(&b, 1), RCP_ERR_SUCCESS);
+
+        expectEndState(hostData, envInfo);
+    }
+
 #undef CHECKVALS
 #undef CHECKBOOL
 
@@ -1333,6 +1477,10 @@ namespace TEST_RCP_Senders {
 
         retval = RCP_requestGeneralRead(RCP_DEVCLASS_AMALGAMATE, 0);
         EXPECT_EQ(retval, RCP_ERR_INVALID_DEVCLASS);
+
+        // Classes not defined by the spec
+        retval = RCP_requestGeneralRead(static_cast<RCP_DeviceClass>(0x85), 0);
+        EXPECT_EQ(retval, RCP_ERR_INVALID_DEVCLASS);
     }
 
     TEST_F(RCPSenders, RejectTaresForInvalidDevclasses) {
@@ -1362,12 +1510,15 @@ namespace TEST_RCP_Senders {
 
         retval = RCP_requestTareConfiguration(RCP_DEVCLASS_AMALGAMATE, 0, 0, 0);
         EXPECT_EQ(retval, RCP_ERR_INVALID_DEVCLASS);
+
+        retval = RCP_requestTareConfiguration(static_cast<RCP_DeviceClass>(0x85), 0, 0, 0);
+        EXPECT_EQ(retval, RCP_ERR_INVALID_DEVCLASS);
     }
 
     TEST_F(RCPSenders, PromptResponseFloat) {
         const std::vector<uint8_t> endState = {0x04, RCP_DEVCLASS_PROMPT, HFLOATARR(HPI)};
 
-        activePromptType = RCP_PromptDataType_Float;
+        globalCtx->activePromptType = RCP_PromptDataType_Float;
         RCP_Error retval = RCP_promptRespondFloat(PI);
 
         EXPECT_EQ(retval, RCP_ERR_SUCCESS);
@@ -1381,7 +1532,7 @@ namespace TEST_RCP_Senders {
     TEST_F(RCPSenders, PromptResponseGNG) {
         const std::vector<uint8_t> endState = {0x01, RCP_DEVCLASS_PROMPT, RCP_GONOGO_GO};
 
-        activePromptType = RCP_PromptDataType_GONOGO;
+        globalCtx->activePromptType = RCP_PromptDataType_GONOGO;
         RCP_Error retval = RCP_promptRespondGONOGO(RCP_GONOGO_GO);
 
         EXPECT_EQ(retval, RCP_ERR_SUCCESS);
@@ -1497,3 +1648,3302 @@ namespace TEST_RCP_Senders {
 
     INSTANTIATE_TEST_SUITE_P(CheckOutputs, RCPSenders, testing::ValuesIn(PTESTS_SENDERS), envToName);
 } // namespace TEST_RCP_Senders
+
+// ------------ SECTION: Transmit batching ------------ //
+
+namespace TEST_RCP_TxBatch {
+    class RCPTxBatch : public testing::Test {
+        static RCPTxBatch* ctx;
+
+        static size_t sendData(const void* data, size_t len) {
+            const auto* pkt = static_cast<const uint8_t*>(data);
+            ctx->sends.emplace_back(pkt, pkt + len);
+            return len;
+        }
+
+        static RCP_LibInitData RCPTxBatchCallbacks;
+
+    public:
+        // One entry per sendData call
+        std::vector<std::vector<uint8_t>> sends;
+
+        RCPTxBatch() {
+            ctx = this;
+            RCP_init(RCPTxBatchCallbacks);
+        }
+
+        ~RCPTxBatch() override {
+            RCP_shutdown();
+            ctx = nullptr;
+        }
+    };
+
+    RCPTxBatch* RCPTxBatch::ctx;
+    RCP_LibInitData RCPTxBatch::RCPTxBatchCallbacks = {.sendData = sendData,
+                                                       .readData = RCV_STUB,
+                                                       .processTestUpdate = TEST_STUB,
+                                                       .processBoolData = BOOL_STUB,
+                                                       .processSimpleActuatorData = SACT_STUB,
+                                                       .processPromptInput = PROMPT_STUB,
+                                                       .processTargetLog = LOG_STUB,
+                                                       .processOneFloat = F1_STUB,
+                                                       .processTwoFloat = F2_STUB,
+                                                       .processThreeFloat = F3_STUB,
+                                                       .processFourFloat = F4_STUB};
+
+    TEST_F(RCPTxBatch, QueuedUntilFlush) {
+        ASSERT_EQ(RCP_beginBatch(0, 0), RCP_ERR_SUCCESS);
+        RCP_sendSimpleActuatorWrite(1, RCP_SIMPLE_ACTUATOR_ON);
+        RCP_sendSimpleActuatorWrite(2, RCP_SIMPLE_ACTUATOR_OFF);
+        RCP_sendMotorWrite(3, PI);
+        EXPECT_TRUE(sends.empty());
+
+        EXPECT_EQ(RCP_flush(), RCP_ERR_SUCCESS);
+        ASSERT_EQ(sends.size(), 1);
+        std::vector<uint8_t> expected = {0x02, RCP_DEVCLASS_SIMPLE_ACTUATOR, 1, RCP_SIMPLE_ACTUATOR_ON,
+                                         0x02, RCP_DEVCLASS_SIMPLE_ACTUATOR, 2, RCP_SIMPLE_ACTUATOR_OFF,
+                                         0x05, RCP_DEVCLASS_MOTOR,           3, HFLOATARR(HPI)};
+        EXPECT_EQ(sends[0], expected);
+
+        // Flushing ends the batch, so later packets go out on their own
+        RCP_sendHeartbeat();
+        EXPECT_EQ(sends.size(), 2);
+        EXPECT_EQ(RCP_flush(), RCP_ERR_SUCCESS);
+        EXPECT_EQ(sends.size(), 2);
+    }
+
+    TEST_F(RCPTxBatch, FlushAtSize) {
+        RCP_beginBatch(8, 0);
+        RCP_sendSimpleActuatorWrite(1, RCP_SIMPLE_ACTUATOR_ON);
+        EXPECT_TRUE(sends.empty());
+        RCP_sendSimpleActuatorWrite(2, RCP_SIMPLE_ACTUATOR_ON);
+        ASSERT_EQ(sends.size(), 1);
+        EXPECT_EQ(sends[0].size(), 8);
+
+        RCP_sendSimpleActuatorWrite(3, RCP_SIMPLE_ACTUATOR_ON);
+        EXPECT_EQ(sends.size(), 1);
+        RCP_flush();
+        EXPECT_EQ(sends.size(), 2);
+        EXPECT_EQ(sends[1].size(), 4);
+    }
+
+    TEST_F(RCPTxBatch, NeverExceedsBuffer) {
+        RCP_beginBatch(0, 0);
+        for(int i = 0; i < 100; i++) RCP_sendStepperWrite(i, RCP_STEPPER_SPEED_CONTROL, PI);
+        RCP_flush();
+
+        size_t total = 0;
+        for(const auto& send : sends) {
+            EXPECT_LE(send.size(), RCP_MAX_TX_BATCH);
+            EXPECT_EQ(send.size() % 8, 0) << "Packet split across sends";
+            total += send.size();
+        }
+
+        EXPECT_EQ(total, 800);
+    }
+
+    TEST_F(RCPTxBatch, FlushAtDeadline) {
+        RCP_beginBatch(0, 1000);
+        RCP_sendSimpleActuatorWrite(1, RCP_SIMPLE_ACTUATOR_ON);
+        EXPECT_TRUE(sends.empty());
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        RCP_feed(nullptr, 0);
+        ASSERT_EQ(sends.size(), 1);
+        EXPECT_EQ(sends[0].size(), 4);
+    }
+
+    TEST_F(RCPTxBatch, EStopNotHeld) {
+        RCP_beginBatch(0, 0);
+        RCP_sendSimpleActuatorWrite(1, RCP_SIMPLE_ACTUATOR_ON);
+        RCP_sendEStop();
+
+        ASSERT_EQ(sends.size(), 1);
+        std::vector<uint8_t> expected = {0x02, RCP_DEVCLASS_SIMPLE_ACTUATOR, 1, RCP_SIMPLE_ACTUATOR_ON, 0x00};
+        EXPECT_EQ(sends[0], expected);
+    }
+} // namespace TEST_RCP_TxBatch
+
+// ------------ SECTION: Context API ------------ //
+
+namespace TEST_RCP_Context {
+    // Per link state, reached through the user pointer instead of a static fixture pointer
+    struct Link {
+        std::vector<uint8_t> sent;
+        std::vector<RCP_1F> f1s;
+        RCP_PromptDataType ptype = RCP_PromptDataType_RESET;
+
+        // Each batch callback invocation, and the timestamp it came with
+        std::vector<std::vector<RCP_1F>> f1Batches;
+        std::vector<std::vector<RCP_3F>> f3Batches;
+        std::vector<uint32_t> batchTimestamps;
+        int bools = 0;
+
+        // Bytes for RCP_ctx_poll to read, in order
+        std::vector<uint8_t> rx;
+        size_t rxPos = 0;
+
+        // Bytes passed over through skipData, and how many calls that took
+        size_t skipped = 0;
+        int skips = 0;
+    };
+
+    static size_t sendData(void* user, const void* data, size_t len) {
+        const auto* pkt = static_cast<const uint8_t*>(data);
+        static_cast<Link*>(user)->sent.insert(static_cast<Link*>(user)->sent.end(), pkt, pkt + len);
+        return len;
+    }
+
+    static size_t readData(void* user, void* data, size_t len) {
+        Link* link = static_cast<Link*>(user);
+        size_t n = std::min(len, link->rx.size() - link->rxPos);
+        memcpy(data, link->rx.data() + link->rxPos, n);
+        link->rxPos += n;
+        return n;
+    }
+
+    static size_t skipData(void* user, size_t len) {
+        Link* link = static_cast<Link*>(user);
+        size_t n = std::min(len, link->rx.size() - link->rxPos);
+        link->rxPos += n;
+        link->skipped += n;
+        link->skips++;
+        return n;
+    }
+
+    static RCP_Error testUpdate(void*, RCP_TestData) { return RCP_ERR_SUCCESS; }
+    static RCP_Error sactUpdate(void*, RCP_SimpleActuatorData) { return RCP_ERR_SUCCESS; }
+    static RCP_Error logUpdate(void*, RCP_TargetLogData) { return RCP_ERR_SUCCESS; }
+    static RCP_Error F2(void*, RCP_2F) { return RCP_ERR_SUCCESS; }
+    static RCP_Error F3(void*, RCP_3F) { return RCP_ERR_SUCCESS; }
+    static RCP_Error F4(void*, RCP_4F) { return RCP_ERR_SUCCESS; }
+
+    static RCP_Error promptRequest(void* user, RCP_PromptInputRequest pir) {
+        static_cast<Link*>(user)->ptype = pir.type;
+        return RCP_ERR_SUCCESS;
+    }
+
+    static RCP_Error F1(void* user, RCP_1F f1) {
+        static_cast<Link*>(user)->f1s.push_back(f1);
+        return RCP_ERR_SUCCESS;
+    }
+
+    static RCP_Error boolUpdate(void* user, RCP_BoolData) {
+        static_cast<Link*>(user)->bools++;
+        return RCP_ERR_SUCCESS;
+    }
+
+    static RCP_Error F1Batch(void* user, const RCP_1F* items, size_t n, uint32_t timestamp) {
+        static_cast<Link*>(user)->f1Batches.emplace_back(items, items + n);
+        static_cast<Link*>(user)->batchTimestamps.push_back(timestamp);
+        return RCP_ERR_SUCCESS;
+    }
+
+    static RCP_Error F3Batch(void* user, const RCP_3F* items, size_t n, uint32_t timestamp) {
+        static_cast<Link*>(user)->f3Batches.emplace_back(items, items + n);
+        static_cast<Link*>(user)->batchTimestamps.push_back(timestamp);
+        return RCP_ERR_SUCCESS;
+    }
+
+    static const RCP_CtxCallbacks LINK_CALLBACKS = {.sendData = sendData,
+                                                    .readData = readData,
+                                                    .processTestUpdate = testUpdate,
+                                                    .processBoolData = boolUpdate,
+                                                    .processSimpleActuatorData = sactUpdate,
+                                                    .processPromptInput = promptRequest,
+                                                    .processTargetLog = logUpdate,
+                                                    .processOneFloat = F1,
+                                                    .processTwoFloat = F2,
+                                                    .processThreeFloat = F3,
+                                                    .processFourFloat = F4};
+
+    class RCPContext : public testing::Test {
+    protected:
+        Link linkA;
+        Link linkB;
+        RCP_Context* ctxA = nullptr;
+        RCP_Context* ctxB = nullptr;
+
+        RCPContext() {
+            RCP_ctx_create(LINK_CALLBACKS, &linkA, &ctxA);
+            RCP_ctx_create(LINK_CALLBACKS, &linkB, &ctxB);
+        }
+
+        ~RCPContext() override {
+            RCP_ctx_destroy(ctxA);
+            RCP_ctx_destroy(ctxB);
+        }
+    };
+
+#define TEST_NULLCTX_RUN(function, ...)                                                                                \
+    EXPECT_EQ(function(nullptr __VA_OPT__(, ) __VA_ARGS__), RCP_ERR_INIT) << #function " accepts a null context"
+
+    TEST(RCPContextNull, NullContext) {
+        TEST_NULLCTX_RUN(RCP_ctx_destroy);
+        TEST_NULLCTX_RUN(RCP_ctx_poll);
+        TEST_NULLCTX_RUN(RCP_ctx_feed, nullptr, 0);
+        TEST_NULLCTX_RUN(RCP_ctx_sendEStop);
+        TEST_NULLCTX_RUN(RCP_ctx_sendHeartbeat);
+        TEST_NULLCTX_RUN(RCP_ctx_startTest, 0);
+        TEST_NULLCTX_RUN(RCP_ctx_stopTest);
+        TEST_NULLCTX_RUN(RCP_ctx_pauseUnpauseTest);
+        TEST_NULLCTX_RUN(RCP_ctx_deviceReset);
+        TEST_NULLCTX_RUN(RCP_ctx_deviceTimeReset);
+        TEST_NULLCTX_RUN(RCP_ctx_setDataStreaming, false);
+        TEST_NULLCTX_RUN(RCP_ctx_setHeartbeatTime, 0);
+        TEST_NULLCTX_RUN(RCP_ctx_requestTestState);
+        TEST_NULLCTX_RUN(RCP_ctx_sendSimpleActuatorWrite, 0, RCP_SIMPLE_ACTUATOR_TOGGLE);
+        TEST_NULLCTX_RUN(RCP_ctx_sendStepperWrite, 0, RCP_STEPPER_SPEED_CONTROL, 0);
+        TEST_NULLCTX_RUN(RCP_ctx_sendAngledActuatorWrite, 0, 0);
+        TEST_NULLCTX_RUN(RCP_ctx_sendMotorWrite, 0, 0);
+        TEST_NULLCTX_RUN(RCP_ctx_requestGeneralRead, RCP_DEVCLASS_TEST_STATE, 0);
+        TEST_NULLCTX_RUN(RCP_ctx_requestTareConfiguration, RCP_DEVCLASS_GYROSCOPE, 0, 0, 0);
+        TEST_NULLCTX_RUN(RCP_ctx_promptRespondGONOGO, RCP_GONOGO_GO);
+        TEST_NULLCTX_RUN(RCP_ctx_promptRespondFloat, 0);
+        EXPECT_EQ(RCP_ctx_create(LINK_CALLBACKS, nullptr, nullptr), RCP_ERR_INIT);
+    }
+
+#undef TEST_NULLCTX_RUN
+
+    TEST_F(RCPContext, UserPointerReturned) {
+        EXPECT_EQ(RCP_ctx_getUser(ctxA), &linkA);
+        EXPECT_EQ(RCP_ctx_getUser(ctxB), &linkB);
+    }
+
+    TEST_F(RCPContext, IndependentState) {
+        RCP_ctx_setChannel(ctxB, RCP_CH_ONE);
+        EXPECT_EQ(RCP_ctx_getChannel(ctxA), RCP_CH_ZERO);
+        EXPECT_EQ(RCP_ctx_getChannel(ctxB), RCP_CH_ONE);
+
+        // The same stream fed to both contexts, with a reading on each channel and a prompt on channel zero
+        const uint8_t bytes[] = {0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x01, HFLOATARR(HPI),
+                                 RCP_CH_ONE | 0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS2), 0x02, HFLOATARR(HPI2),
+                                 0x06, RCP_DEVCLASS_PROMPT, RCP_PromptDataType_GONOGO, HELLOHEX};
+
+        EXPECT_EQ(RCP_ctx_feed(ctxA, bytes, sizeof(bytes)), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ctx_feed(ctxB, bytes, sizeof(bytes)), RCP_ERR_SUCCESS);
+
+        ASSERT_EQ(linkA.f1s.size(), 1);
+        EXPECT_EQ(linkA.f1s[0], (RCP_1F{.devclass = RCP_DEVCLASS_TEMPERATURE, .timestamp = TS1, .ID = 1, .data = PI}));
+        ASSERT_EQ(linkB.f1s.size(), 1);
+        EXPECT_EQ(linkB.f1s[0], (RCP_1F{.devclass = RCP_DEVCLASS_TEMPERATURE, .timestamp = TS2, .ID = 2, .data = PI2}));
+
+        EXPECT_EQ(RCP_ctx_getActivePromptType(ctxA), RCP_PromptDataType_GONOGO);
+        EXPECT_EQ(RCP_ctx_getActivePromptType(ctxB), RCP_PromptDataType_RESET);
+        EXPECT_EQ(linkA.ptype, RCP_PromptDataType_GONOGO);
+
+        EXPECT_EQ(RCP_ctx_promptRespondGONOGO(ctxA, RCP_GONOGO_GO), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ctx_promptRespondGONOGO(ctxB, RCP_GONOGO_GO), RCP_ERR_NO_ACTIVE_PROMPT);
+        EXPECT_EQ(RCP_ctx_sendSimpleActuatorWrite(ctxB, 5, RCP_SIMPLE_ACTUATOR_ON), RCP_ERR_SUCCESS);
+
+        EXPECT_EQ(linkA.sent, (std::vector<uint8_t>{0x01, RCP_DEVCLASS_PROMPT, RCP_GONOGO_GO}));
+        EXPECT_EQ(linkB.sent,
+                  (std::vector<uint8_t>{RCP_CH_ONE | 0x02, RCP_DEVCLASS_SIMPLE_ACTUATOR, 5, RCP_SIMPLE_ACTUATOR_ON}));
+    }
+
+    TEST_F(RCPContext, ChannelPeer) {
+        RCP_ctx_setChannel(ctxB, RCP_CH_ONE);
+        ASSERT_EQ(RCP_ctx_setChannelPeer(ctxA, ctxB), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ctx_getChannelPeer(ctxA), ctxB);
+
+        // One stream with both stands on it, read once through A, polled and fed
+        const uint8_t bytes[] = {0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x01, HFLOATARR(HPI),
+                                 RCP_CH_ONE | 0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS2), 0x02, HFLOATARR(HPI2),
+                                 RCP_CH_ONE | 0x06, RCP_DEVCLASS_PROMPT, RCP_PromptDataType_GONOGO, HELLOHEX};
+        linkA.rx.assign(bytes, bytes + 11);
+        EXPECT_EQ(RCP_ctx_poll(ctxA), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ctx_feed(ctxA, bytes + 11, sizeof(bytes) - 11), RCP_ERR_SUCCESS);
+
+        ASSERT_EQ(linkA.f1s.size(), 1);
+        EXPECT_EQ(linkA.f1s[0], (RCP_1F{.devclass = RCP_DEVCLASS_TEMPERATURE, .timestamp = TS1, .ID = 1, .data = PI}));
+        ASSERT_EQ(linkB.f1s.size(), 1);
+        EXPECT_EQ(linkB.f1s[0], (RCP_1F{.devclass = RCP_DEVCLASS_TEMPERATURE, .timestamp = TS2, .ID = 2, .data = PI2}));
+        EXPECT_EQ(RCP_ctx_getActivePromptType(ctxA), RCP_PromptDataType_RESET);
+        EXPECT_EQ(RCP_ctx_getActivePromptType(ctxB), RCP_PromptDataType_GONOGO);
+        EXPECT_EQ(linkB.ptype, RCP_PromptDataType_GONOGO);
+
+        // A peer on the same channel gets nothing, and without a peer the other channel is dropped as before
+        RCP_ctx_setChannel(ctxB, RCP_CH_ZERO);
+        EXPECT_EQ(RCP_ctx_feed(ctxA, bytes + 11, 11), RCP_ERR_SUCCESS);
+        RCP_ctx_setChannel(ctxB, RCP_CH_ONE);
+        ASSERT_EQ(RCP_ctx_setChannelPeer(ctxA, nullptr), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ctx_feed(ctxA, bytes + 11, 11), RCP_ERR_SUCCESS);
+        EXPECT_EQ(linkA.f1s.size(), 1);
+        EXPECT_EQ(linkB.f1s.size(), 1);
+
+        EXPECT_EQ(RCP_ctx_setChannelPeer(ctxA, ctxA), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_setChannelPeer(nullptr, ctxB), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_getChannelPeer(nullptr), nullptr);
+    }
+
+    TEST_F(RCPContext, SubscriptionFilter) {
+        RCP_CtxCallbacks cbks = LINK_CALLBACKS;
+        cbks.skipData = skipData;
+        Link link;
+        RCP_Context* ctx = nullptr;
+        ASSERT_EQ(RCP_ctx_create(cbks, &link, &ctx), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_subscribe(ctx, RCP_DEVCLASS_TEMPERATURE, 2), RCP_ERR_SUCCESS);
+
+        // A reading from another temperature sensor, one from the sensor subscribed to, a bool sensor, a reading on the
+        // other channel, and an amalgamation unit with a reading from each of three sensors
+        link.rx = {0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x01, HFLOATARR(HPI),
+                   0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x02, HFLOATARR(HPI),
+                   0x06, RCP_DEVCLASS_BOOL_SENSOR, HFLOATARR(TS2), 0x02, 0x01,
+                   RCP_CH_ONE | 0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x02, HFLOATARR(HPI),
+                   0x16, RCP_DEVCLASS_AMALGAMATE, HFLOATARR(TS2),
+                   RCP_DEVCLASS_TEMPERATURE, 0x01, HFLOATARR(HPI3),
+                   RCP_DEVCLASS_TEMPERATURE, 0x02, HFLOATARR(HPI2),
+                   RCP_DEVCLASS_TEMPERATURE, 0x03, HFLOATARR(HPI4)};
+        for(int i = 0; i < 5; i++) ASSERT_EQ(RCP_ctx_poll(ctx), RCP_ERR_SUCCESS) << "packet " << i;
+        EXPECT_EQ(link.rxPos, link.rx.size());
+
+        std::vector<RCP_1F> expected = {
+            {.devclass = RCP_DEVCLASS_TEMPERATURE, .timestamp = TS1, .ID = 2, .data = PI},
+            {.devclass = RCP_DEVCLASS_TEMPERATURE, .timestamp = TS2, .ID = 2, .data = PI2}};
+        EXPECT_EQ(link.f1s, expected);
+        EXPECT_EQ(link.bools, 0);
+
+        // The bool reading was passed over after its class byte, and the other channel after its header
+        EXPECT_EQ(link.skips, 2);
+        EXPECT_EQ(link.skipped, 6 + 10);
+
+        // Feeding filters the same way
+        link.f1s.clear();
+        EXPECT_EQ(RCP_ctx_feed(ctx, link.rx.data(), link.rx.size()), RCP_ERR_SUCCESS);
+        EXPECT_EQ(link.f1s, expected);
+
+        // Starting from everything and dropping a class
+        ASSERT_EQ(RCP_ctx_subscribeAll(ctx), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_unsubscribe(ctx, RCP_DEVCLASS_TEMPERATURE, RCP_ANY_ID), RCP_ERR_SUCCESS);
+        link.f1s.clear();
+        EXPECT_EQ(RCP_ctx_feed(ctx, link.rx.data(), link.rx.size()), RCP_ERR_SUCCESS);
+        EXPECT_TRUE(link.f1s.empty());
+        EXPECT_EQ(link.bools, 1);
+
+        // A tap sees every packet, so nothing is skipped unread
+        int tapped = 0;
+        ASSERT_EQ(RCP_ctx_setPacketTap(ctx, [](void* user, const uint8_t*, size_t) { ++*static_cast<int*>(user); },
+                                       &tapped),
+                  RCP_ERR_SUCCESS);
+        link.rxPos = 0;
+        link.skips = 0;
+        for(int i = 0; i < 5; i++) ASSERT_EQ(RCP_ctx_poll(ctx), RCP_ERR_SUCCESS) << "packet " << i;
+        EXPECT_EQ(link.skips, 0);
+        EXPECT_EQ(tapped, 5);
+        EXPECT_EQ(link.bools, 2);
+
+        ASSERT_EQ(RCP_ctx_subscribeAll(ctx), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ctx_feed(ctx, link.rx.data(), 11), RCP_ERR_SUCCESS);
+        EXPECT_EQ(link.f1s.size(), 1);
+
+        EXPECT_EQ(RCP_ctx_subscribe(ctx, RCP_DEVCLASS_TEMPERATURE, 256), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_subscribe(ctx, RCP_DEVCLASS_AMALGAMATE, RCP_ANY_ID), RCP_ERR_INVALID_DEVCLASS);
+        EXPECT_EQ(RCP_ctx_unsubscribe(ctx, static_cast<RCP_DeviceClass>(0x7F), RCP_ANY_ID), RCP_ERR_INVALID_DEVCLASS);
+        EXPECT_EQ(RCP_ctx_subscribe(nullptr, RCP_DEVCLASS_TEMPERATURE, 1), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_subscribeAll(nullptr), RCP_ERR_INIT);
+        RCP_ctx_destroy(ctx);
+    }
+
+    TEST_F(RCPContext, SkipWithoutCallback) {
+        // The other channel is read and thrown away when there is no skipData
+        linkA.rx = {RCP_CH_ONE | 0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x02, HFLOATARR(HPI),
+                    0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x01, HFLOATARR(HPI)};
+        EXPECT_EQ(RCP_ctx_poll(ctxA), RCP_ERR_SUCCESS);
+        EXPECT_TRUE(linkA.f1s.empty());
+        EXPECT_EQ(RCP_ctx_poll(ctxA), RCP_ERR_SUCCESS);
+        ASSERT_EQ(linkA.f1s.size(), 1);
+        EXPECT_EQ(linkA.f1s[0].ID, 1);
+        EXPECT_EQ(RCP_ctx_poll(ctxA), RCP_ERR_IO_RCV);
+    }
+
+    class RCPBatch : public testing::Test {
+    protected:
+        Link link;
+        RCP_Context* ctx = nullptr;
+
+        RCPBatch() {
+            RCP_CtxCallbacks cbks = LINK_CALLBACKS;
+            cbks.processOneFloatBatch = F1Batch;
+            cbks.processThreeFloatBatch = F3Batch;
+            RCP_ctx_create(cbks, &link, &ctx);
+        }
+
+        ~RCPBatch() override { RCP_ctx_destroy(ctx); }
+    };
+
+    TEST_F(RCPBatch, AmalgamationUnitBatchedByArity) {
+        // clang-format off
+        const uint8_t bytes[] = {0x27, RCP_DEVCLASS_AMALGAMATE, HFLOATARR(TS1),
+            RCP_DEVCLASS_PRESSURE_TRANSDUCER, 0x01, HFLOATARR(HPI),
+            RCP_DEVCLASS_ACCELEROMETER, 0x02, HFLOATARR(HPI), HFLOATARR(HPI2), HFLOATARR(HPI3),
+            RCP_DEVCLASS_BOOL_SENSOR, 0x03, 0x01,
+            RCP_DEVCLASS_TEMPERATURE, 0x04, HFLOATARR(HPI2),
+            RCP_DEVCLASS_PRESSURE_TRANSDUCER, 0x05, HFLOATARR(HPI3)};
+        // clang-format on
+
+        EXPECT_EQ(RCP_ctx_feed(ctx, bytes, sizeof(bytes)), RCP_ERR_SUCCESS);
+
+        // Singles are not used for batched arities, but other classes and arities without batch callbacks still are
+        EXPECT_TRUE(link.f1s.empty());
+        EXPECT_EQ(link.bools, 1);
+
+        ASSERT_EQ(link.f1Batches.size(), 1);
+        ASSERT_EQ(link.f1Batches[0].size(), 3);
+        EXPECT_EQ(link.f1Batches[0][0],
+                  (RCP_1F{.devclass = RCP_DEVCLASS_PRESSURE_TRANSDUCER, .timestamp = TS1, .ID = 1, .data = PI}));
+        EXPECT_EQ(link.f1Batches[0][1],
+                  (RCP_1F{.devclass = RCP_DEVCLASS_TEMPERATURE, .timestamp = TS1, .ID = 4, .data = PI2}));
+        EXPECT_EQ(link.f1Batches[0][2],
+                  (RCP_1F{.devclass = RCP_DEVCLASS_PRESSURE_TRANSDUCER, .timestamp = TS1, .ID = 5, .data = PI3}));
+
+        ASSERT_EQ(link.f3Batches.size(), 1);
+        ASSERT_EQ(link.f3Batches[0].size(), 1);
+        EXPECT_EQ(link.f3Batches[0][0],
+                  (RCP_3F{.devclass = RCP_DEVCLASS_ACCELEROMETER, .timestamp = TS1, .ID = 2, .data = {PI, PI2, PI3}}));
+
+        EXPECT_EQ(link.batchTimestamps, (std::vector<uint32_t>{TS1, TS1}));
+    }
+
+    TEST_F(RCPBatch, LargeUnitSplitAtCapacity) {
+        constexpr size_t count = RCP_MAX_BATCH + 10;
+        std::vector<uint8_t> bytes = {RCP_EXTENDED_MASK, 0, 0, RCP_DEVCLASS_AMALGAMATE, HFLOATARR(TS2)};
+        for(size_t i = 0; i < count; i++) {
+            bytes.insert(bytes.end(), {RCP_DEVCLASS_LOAD_CELL, static_cast<uint8_t>(i), HFLOATARR(HPI)});
+        }
+
+        size_t params = bytes.size() - 4;
+        bytes[1] = (params - 1) >> 8;
+        bytes[2] = (params - 1) & 0xFF;
+
+        EXPECT_EQ(RCP_ctx_feed(ctx, bytes.data(), bytes.size()), RCP_ERR_SUCCESS);
+
+        ASSERT_EQ(link.f1Batches.size(), 2);
+        EXPECT_EQ(link.f1Batches[0].size(), RCP_MAX_BATCH);
+        EXPECT_EQ(link.f1Batches[1].size(), count - RCP_MAX_BATCH);
+        EXPECT_EQ(link.f1Batches[1].back().ID, count - 1);
+    }
+
+    TEST_F(RCPBatch, SingleReadingsNotBatched) {
+        const uint8_t bytes[] = {0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x01, HFLOATARR(HPI)};
+
+        EXPECT_EQ(RCP_ctx_feed(ctx, bytes, sizeof(bytes)), RCP_ERR_SUCCESS);
+        EXPECT_EQ(link.f1s.size(), 1);
+        EXPECT_TRUE(link.f1Batches.empty());
+    }
+
+    // Readings are acted on straight from the callback while the amalgamation unit they came in is still being walked
+    struct Reflex {
+        std::vector<uint8_t> in;
+        size_t pos = 0;
+        RCP_Context* ctx = nullptr;
+        std::vector<RCP_1F> f1s;
+        std::vector<uint8_t> sent;
+    };
+
+    TEST(RCPContextReflex, SendFromCallback) {
+        Reflex reflex;
+        RCP_CtxCallbacks cbks = LINK_CALLBACKS;
+        cbks.sendData = [](void* user, const void* data, size_t len) {
+            const auto* pkt = static_cast<const uint8_t*>(data);
+            static_cast<Reflex*>(user)->sent.insert(static_cast<Reflex*>(user)->sent.end(), pkt, pkt + len);
+            return len;
+        };
+        cbks.readData = [](void* user, void* data, size_t len) {
+            auto* r = static_cast<Reflex*>(user);
+            len = std::min(len, r->in.size() - r->pos);
+            memcpy(data, r->in.data() + r->pos, len);
+            r->pos += len;
+            return len;
+        };
+        cbks.processOneFloat = [](void* user, RCP_1F d) {
+            auto* r = static_cast<Reflex*>(user);
+            r->f1s.push_back(d);
+            if(d.data > PI2) return RCP_ctx_sendStepperWrite(r->ctx, d.ID, RCP_STEPPER_SPEED_CONTROL, 0);
+            return RCP_ERR_SUCCESS;
+        };
+
+        ASSERT_EQ(RCP_ctx_create(cbks, &reflex, &reflex.ctx), RCP_ERR_SUCCESS);
+
+        // The first and last readings are high enough to trigger a send
+        reflex.in = {0x16, RCP_DEVCLASS_AMALGAMATE, HFLOATARR(TS1),
+                     RCP_DEVCLASS_TEMPERATURE, 0x01, HFLOATARR(HPI3),
+                     RCP_DEVCLASS_TEMPERATURE, 0x02, HFLOATARR(HPI),
+                     RCP_DEVCLASS_TEMPERATURE, 0x03, HFLOATARR(HPI4)};
+
+        EXPECT_EQ(RCP_ctx_poll(reflex.ctx), RCP_ERR_SUCCESS);
+
+        std::vector<RCP_1F> expectedReadings = {
+            {.devclass = RCP_DEVCLASS_TEMPERATURE, .timestamp = TS1, .ID = 1, .data = PI3},
+            {.devclass = RCP_DEVCLASS_TEMPERATURE, .timestamp = TS1, .ID = 2, .data = PI},
+            {.devclass = RCP_DEVCLASS_TEMPERATURE, .timestamp = TS1, .ID = 3, .data = PI4}};
+        EXPECT_EQ(reflex.f1s, expectedReadings);
+
+        std::vector<uint8_t> expectedSent = {0x06, RCP_DEVCLASS_STEPPER, 1, RCP_STEPPER_SPEED_CONTROL, 0, 0, 0, 0,
+                                             0x06, RCP_DEVCLASS_STEPPER, 3, RCP_STEPPER_SPEED_CONTROL, 0, 0, 0, 0};
+        EXPECT_EQ(reflex.sent, expectedSent);
+
+        RCP_ctx_destroy(reflex.ctx);
+    }
+} // namespace TEST_RCP_Context
+
+// ------------ SECTION: RCP_Latest ------------ //
+
+namespace TEST_RCP_Latest {
+    class RCPLatest : public testing::Test {
+    protected:
+        TEST_RCP_Context::Link link;
+        RCP_Context* ctx = nullptr;
+
+        RCPLatest() {
+            RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &link, &ctx);
+            RCP_ctx_trackLatest(ctx);
+        }
+
+        ~RCPLatest() override { RCP_ctx_destroy(ctx); }
+
+        // A three float reading with every value and the timestamp set to i, so a torn read would show
+        static std::vector<uint8_t> accel(uint8_t ID, uint32_t i) {
+            float v = static_cast<float>(i);
+            std::vector<uint8_t> pkt = {0x11, RCP_DEVCLASS_ACCELEROMETER, HFLOATARR(i), ID};
+            pkt.resize(19);
+            for(int j = 0; j < 3; j++) memcpy(pkt.data() + 7 + 4 * j, &v, 4);
+            return pkt;
+        }
+    };
+
+    TEST_F(RCPLatest, Records) {
+        const uint8_t bytes[] = {0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x01, HFLOATARR(HPI),
+                                 0x06, RCP_DEVCLASS_BOOL_SENSOR, HFLOATARR(TS1), 0x07, 0x01,
+                                 0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS2), 0x01, HFLOATARR(HPI),
+                                 0x13, RCP_DEVCLASS_AMALGAMATE, HFLOATARR(TS2),
+                                 RCP_DEVCLASS_TEMPERATURE, 0x02, HFLOATARR(HPI),
+                                 RCP_DEVCLASS_SIMPLE_ACTUATOR, 0x03, RCP_SIMPLE_ACTUATOR_ON,
+                                 RCP_DEVCLASS_TEMPERATURE, 0x01, HFLOATARR(HPI),
+                                 0x06, RCP_DEVCLASS_TEST_STATE, HFLOATARR(TS1), RCP_TEST_STOPPED, 0x00};
+        ASSERT_EQ(RCP_ctx_feed(ctx, bytes, sizeof(bytes)), RCP_ERR_SUCCESS);
+
+        RCP_Latest latest;
+        ASSERT_EQ(RCP_ctx_getLatest(ctx, RCP_DEVCLASS_TEMPERATURE, 1, &latest), RCP_ERR_SUCCESS);
+        EXPECT_EQ(latest.devclass, RCP_DEVCLASS_TEMPERATURE);
+        EXPECT_EQ(latest.ID, 1);
+        EXPECT_EQ(latest.timestamp, TS2);
+        EXPECT_EQ(latest.updates, 3);
+        EXPECT_FLOAT_EQ(latest.data[0], PI);
+        EXPECT_EQ(latest.data[1], 0);
+        EXPECT_GT(latest.hostTimeNs, 0);
+
+        ASSERT_EQ(RCP_ctx_getLatest(ctx, RCP_DEVCLASS_BOOL_SENSOR, 7, &latest), RCP_ERR_SUCCESS);
+        EXPECT_EQ(latest.data[0], 1);
+        ASSERT_EQ(RCP_ctx_getLatest(ctx, RCP_DEVCLASS_SIMPLE_ACTUATOR, 3, &latest), RCP_ERR_SUCCESS);
+        EXPECT_EQ(latest.data[0], 1);
+        EXPECT_EQ(latest.timestamp, TS2);
+
+        EXPECT_EQ(RCP_ctx_getLatest(ctx, RCP_DEVCLASS_TEMPERATURE, 9, &latest), RCP_ERR_NO_READING);
+        EXPECT_EQ(RCP_ctx_getLatest(ctx, RCP_DEVCLASS_GPS, 1, &latest), RCP_ERR_NO_READING);
+        EXPECT_EQ(RCP_ctx_getLatest(ctx, RCP_DEVCLASS_TEST_STATE, 0, &latest), RCP_ERR_NO_READING);
+
+        // Every device, in the order they were first heard from
+        RCP_Latest all[8];
+        ASSERT_EQ(RCP_ctx_snapshotLatest(ctx, all, 8), 4);
+        std::vector<uint16_t> fqdns;
+        for(int i = 0; i < 4; i++) fqdns.push_back(RCP_FQDN(all[i].devclass, all[i].ID));
+        EXPECT_EQ(fqdns, (std::vector<uint16_t>{RCP_FQDN(RCP_DEVCLASS_TEMPERATURE, 1),
+                                                RCP_FQDN(RCP_DEVCLASS_BOOL_SENSOR, 7),
+                                                RCP_FQDN(RCP_DEVCLASS_TEMPERATURE, 2),
+                                                RCP_FQDN(RCP_DEVCLASS_SIMPLE_ACTUATOR, 3)}));
+        EXPECT_EQ(all[0].updates, 3);
+        EXPECT_EQ(RCP_ctx_snapshotLatest(ctx, all, 1), 4);
+        EXPECT_EQ(RCP_ctx_snapshotLatest(ctx, nullptr, 8), 4);
+
+        // Callbacks still see every reading
+        EXPECT_EQ(link.f1s.size(), 4);
+    }
+
+    TEST_F(RCPLatest, FilteredNotRecorded) {
+        ASSERT_EQ(RCP_ctx_subscribe(ctx, RCP_DEVCLASS_TEMPERATURE, 2), RCP_ERR_SUCCESS);
+        const uint8_t bytes[] = {0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x01, HFLOATARR(HPI),
+                                 0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x02, HFLOATARR(HPI)};
+        ASSERT_EQ(RCP_ctx_feed(ctx, bytes, sizeof(bytes)), RCP_ERR_SUCCESS);
+
+        RCP_Latest latest;
+        EXPECT_EQ(RCP_ctx_getLatest(ctx, RCP_DEVCLASS_TEMPERATURE, 1, &latest), RCP_ERR_NO_READING);
+        EXPECT_EQ(RCP_ctx_getLatest(ctx, RCP_DEVCLASS_TEMPERATURE, 2, &latest), RCP_ERR_SUCCESS);
+    }
+
+    TEST_F(RCPLatest, ConcurrentReaders) {
+        constexpr uint32_t UPDATES = 200000;
+        std::atomic<bool> done = false;
+        std::atomic<int> torn = 0;
+
+        // Readers spin on two devices while the decoding thread rewrites them, and never see a mixed up reading
+        auto reader = [&]() {
+            RCP_Latest latest;
+            RCP_Latest all[2];
+            uint32_t last = 0;
+            while(!done.load()) {
+                if(RCP_ctx_getLatest(ctx, RCP_DEVCLASS_ACCELEROMETER, 1, &latest) == RCP_ERR_SUCCESS) {
+                    float v = static_cast<float>(latest.timestamp);
+                    if(latest.data[0] != v || latest.data[1] != v || latest.data[2] != v) torn++;
+                    if(latest.timestamp < last || latest.updates != latest.timestamp + 1) torn++;
+                    last = latest.timestamp;
+                }
+
+                size_t n = RCP_ctx_snapshotLatest(ctx, all, 2);
+                for(size_t i = 0; i < n && i < 2; i++)
+                    if(all[i].data[0] != static_cast<float>(all[i].timestamp) || all[i].data[2] != all[i].data[0])
+                        torn++;
+            }
+        };
+
+        std::thread readers[3] = {std::thread(reader), std::thread(reader), std::thread(reader)};
+        for(uint32_t i = 0; i < UPDATES; i++) {
+            std::vector<uint8_t> pkt = accel(1 + i % 2, i / 2);
+            ASSERT_EQ(RCP_ctx_feed(ctx, pkt.data(), pkt.size()), RCP_ERR_SUCCESS);
+        }
+
+        done = true;
+        for(auto& t : readers) t.join();
+        EXPECT_EQ(torn.load(), 0);
+
+        RCP_Latest latest;
+        ASSERT_EQ(RCP_ctx_getLatest(ctx, RCP_DEVCLASS_ACCELEROMETER, 2, &latest), RCP_ERR_SUCCESS);
+        EXPECT_EQ(latest.updates, UPDATES / 2);
+        EXPECT_EQ(latest.data[1], static_cast<float>(UPDATES / 2 - 1));
+    }
+
+    TEST(RCPLatestErrors, Errors) {
+        RCP_Context* ctx = nullptr;
+        ASSERT_EQ(RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, nullptr, &ctx), RCP_ERR_SUCCESS);
+
+        RCP_Latest latest;
+        EXPECT_EQ(RCP_ctx_getLatest(ctx, RCP_DEVCLASS_TEMPERATURE, 1, &latest), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_snapshotLatest(ctx, &latest, 1), 0);
+        ASSERT_EQ(RCP_ctx_trackLatest(ctx), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_trackLatest(ctx), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ctx_getLatest(ctx, RCP_DEVCLASS_TEMPERATURE, 1, nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_snapshotLatest(ctx, &latest, 1), 0);
+        EXPECT_EQ(RCP_ctx_trackLatest(nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_getLatest(nullptr, RCP_DEVCLASS_TEMPERATURE, 1, &latest), RCP_ERR_INIT);
+        RCP_ctx_destroy(ctx);
+    }
+} // namespace TEST_RCP_Latest
+
+// ------------ SECTION: RCP_Store ------------ //
+
+namespace TEST_RCP_Store {
+    class RCPStore : public testing::Test {
+    protected:
+        TEST_RCP_Context::Link link;
+        RCP_Context* ctx = nullptr;
+        RCP_Store* store = nullptr;
+
+        void make(size_t chunkSamples, size_t budgetBytes) {
+            ASSERT_EQ(RCP_store_create(chunkSamples, budgetBytes, &store), RCP_ERR_SUCCESS);
+            ASSERT_EQ(RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &link, &ctx), RCP_ERR_SUCCESS);
+            ASSERT_EQ(RCP_ctx_setStore(ctx, store), RCP_ERR_SUCCESS);
+        }
+
+        ~RCPStore() override {
+            RCP_ctx_destroy(ctx);
+            RCP_store_destroy(store);
+        }
+
+        void temperature(uint8_t ID, uint32_t timestamp, float value) {
+            uint8_t pkt[] = {0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(timestamp), ID, 0, 0, 0, 0};
+            memcpy(pkt + 7, &value, 4);
+            ASSERT_EQ(RCP_ctx_feed(ctx, pkt, sizeof(pkt)), RCP_ERR_SUCCESS);
+        }
+    };
+
+    TEST_F(RCPStore, Columns) {
+        make(4, 1 << 16);
+        const uint8_t bytes[] = {0x0D, RCP_DEVCLASS_POWERMON, HFLOATARR(TS1), 0x02, HFLOATARR(HPI), HFLOATARR(HPI),
+                                 0x06, RCP_DEVCLASS_BOOL_SENSOR, HFLOATARR(TS1), 0x07, 0x01,
+                                 0x0D, RCP_DEVCLASS_POWERMON, HFLOATARR(TS2), 0x02, HFLOATARR(HPI), HFLOATARR(HPI),
+                                 0x06, RCP_DEVCLASS_BOOL_SENSOR, HFLOATARR(TS2), 0x07, 0x00};
+        ASSERT_EQ(RCP_ctx_feed(ctx, bytes, sizeof(bytes)), RCP_ERR_SUCCESS);
+        for(uint32_t i = 0; i < 10; i++) temperature(1, i, static_cast<float>(i) / 2);
+
+        uint16_t fqdns[4];
+        ASSERT_EQ(RCP_store_devices(store, fqdns, 4), 3);
+        EXPECT_EQ(fqdns[0], RCP_FQDN(RCP_DEVCLASS_POWERMON, 2));
+        EXPECT_EQ(fqdns[1], RCP_FQDN(RCP_DEVCLASS_BOOL_SENSOR, 7));
+        EXPECT_EQ(fqdns[2], RCP_FQDN(RCP_DEVCLASS_TEMPERATURE, 1));
+        EXPECT_EQ(RCP_store_devices(store, nullptr, 0), 3);
+
+        RCP_StoreSeries series;
+        ASSERT_EQ(RCP_store_getSeries(store, RCP_DEVCLASS_POWERMON, 2, &series), RCP_ERR_SUCCESS);
+        EXPECT_EQ(series.arity, 2);
+        EXPECT_EQ(series.len, 2);
+        EXPECT_EQ(series.chunks, 1);
+
+        RCP_StoreChunk chunk;
+        ASSERT_EQ(RCP_store_getChunk(store, RCP_DEVCLASS_POWERMON, 2, 0, &chunk), RCP_ERR_SUCCESS);
+        EXPECT_EQ(chunk.len, 2);
+        EXPECT_EQ(chunk.timestamps[0], TS1);
+        EXPECT_EQ(chunk.timestamps[1], TS2);
+        EXPECT_FLOAT_EQ(chunk.columns[1][1], PI);
+        EXPECT_EQ(chunk.columns[2], nullptr);
+
+        ASSERT_EQ(RCP_store_getChunk(store, RCP_DEVCLASS_BOOL_SENSOR, 7, 0, &chunk), RCP_ERR_SUCCESS);
+        EXPECT_EQ(chunk.columns[0][0], 1);
+        EXPECT_EQ(chunk.columns[0][1], 0);
+
+        // Ten readings in chunks of four, each column contiguous and aligned for SIMD
+        ASSERT_EQ(RCP_store_getSeries(store, RCP_DEVCLASS_TEMPERATURE, 1, &series), RCP_ERR_SUCCESS);
+        EXPECT_EQ(series.len, 10);
+        EXPECT_EQ(series.chunks, 3);
+        EXPECT_EQ(series.dropped, 0);
+        uint32_t next = 0;
+        for(size_t i = 0; i < series.chunks; i++) {
+            ASSERT_EQ(RCP_store_getChunk(store, RCP_DEVCLASS_TEMPERATURE, 1, i, &chunk), RCP_ERR_SUCCESS);
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(chunk.columns[0]) % 64, 0);
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(chunk.timestamps) % 64, 0);
+            for(size_t j = 0; j < chunk.len; j++, next++) {
+                EXPECT_EQ(chunk.timestamps[j], next);
+                EXPECT_EQ(chunk.columns[0][j], static_cast<float>(next) / 2);
+            }
+        }
+        EXPECT_EQ(next, 10);
+        EXPECT_EQ(RCP_store_getChunk(store, RCP_DEVCLASS_TEMPERATURE, 1, 3, &chunk), RCP_ERR_INIT);
+
+        // Callbacks still see every reading
+        EXPECT_EQ(link.f1s.size(), 10);
+    }
+
+    TEST_F(RCPStore, Budget) {
+        constexpr size_t BUDGET = 2048;
+        make(16, BUDGET);
+        for(uint32_t i = 0; i < 1000; i++) {
+            temperature(static_cast<uint8_t>(1 + i % 2), i, static_cast<float>(i));
+            ASSERT_LE(RCP_store_memory(store), BUDGET);
+        }
+
+        // The oldest chunks went first, and what is left of each series runs up to the latest reading
+        for(uint8_t ID = 1; ID <= 2; ID++) {
+            RCP_StoreSeries series;
+            ASSERT_EQ(RCP_store_getSeries(store, RCP_DEVCLASS_TEMPERATURE, ID, &series), RCP_ERR_SUCCESS);
+            EXPECT_GT(series.dropped, 0);
+            EXPECT_EQ(series.len + series.dropped, 500);
+            EXPECT_EQ(series.len % 16, 500 % 16);
+
+            uint32_t next = 2 * static_cast<uint32_t>(series.dropped) + ID - 1;
+            for(size_t i = 0; i < series.chunks; i++) {
+                RCP_StoreChunk chunk;
+                ASSERT_EQ(RCP_store_getChunk(store, RCP_DEVCLASS_TEMPERATURE, ID, i, &chunk), RCP_ERR_SUCCESS);
+                for(size_t j = 0; j < chunk.len; j++, next += 2) EXPECT_EQ(chunk.timestamps[j], next);
+            }
+            EXPECT_EQ(next, 1000 + ID - 1);
+        }
+    }
+
+    TEST_F(RCPStore, FilteredAndDetached) {
+        make(8, 1 << 16);
+        ASSERT_EQ(RCP_ctx_subscribe(ctx, RCP_DEVCLASS_TEMPERATURE, 2), RCP_ERR_SUCCESS);
+        temperature(1, 0, 1);
+        temperature(2, 0, 1);
+        ASSERT_EQ(RCP_ctx_setStore(ctx, nullptr), RCP_ERR_SUCCESS);
+        temperature(2, 1, 1);
+
+        RCP_StoreSeries series;
+        EXPECT_EQ(RCP_store_getSeries(store, RCP_DEVCLASS_TEMPERATURE, 1, &series), RCP_ERR_NO_READING);
+        ASSERT_EQ(RCP_store_getSeries(store, RCP_DEVCLASS_TEMPERATURE, 2, &series), RCP_ERR_SUCCESS);
+        EXPECT_EQ(series.len, 1);
+    }
+
+    TEST(RCPStoreErrors, Errors) {
+        RCP_Store* store = nullptr;
+        EXPECT_EQ(RCP_store_create(0, 1 << 16, &store), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_store_create(1024, 1024, &store), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_store_create(16, 1 << 16, nullptr), RCP_ERR_INIT);
+        ASSERT_EQ(RCP_store_create(16, 1 << 16, &store), RCP_ERR_SUCCESS);
+
+        RCP_StoreSeries series;
+        RCP_StoreChunk chunk;
+        EXPECT_EQ(RCP_store_getSeries(store, RCP_DEVCLASS_TEMPERATURE, 1, &series), RCP_ERR_NO_READING);
+        EXPECT_EQ(RCP_store_getSeries(store, RCP_DEVCLASS_TEMPERATURE, 1, nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_store_getChunk(store, RCP_DEVCLASS_TEMPERATURE, 1, 0, &chunk), RCP_ERR_NO_READING);
+        EXPECT_EQ(RCP_store_getSeries(nullptr, RCP_DEVCLASS_TEMPERATURE, 1, &series), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_store_memory(store), 0);
+        EXPECT_EQ(RCP_ctx_setStore(nullptr, store), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_store_destroy(store), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_store_destroy(nullptr), RCP_ERR_INIT);
+    }
+} // namespace TEST_RCP_Store
+
+// ------------ SECTION: RCP_Stats ------------ //
+
+namespace TEST_RCP_Stats {
+    class RCPStats : public testing::Test {
+    protected:
+        TEST_RCP_Context::Link link;
+        RCP_Context* ctx = nullptr;
+
+        RCPStats() {
+            RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &link, &ctx);
+            RCP_ctx_trackStats(ctx);
+        }
+
+        ~RCPStats() override { RCP_ctx_destroy(ctx); }
+    };
+
+    TEST_F(RCPStats, Counts) {
+        ASSERT_EQ(RCP_ctx_subscribe(ctx, RCP_DEVCLASS_TEMPERATURE, RCP_ANY_ID), RCP_ERR_SUCCESS);
+        const uint8_t bytes[] = {0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x01, HFLOATARR(HPI),
+                                 RCP_CH_ONE | 0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x01, HFLOATARR(HPI),
+                                 0x06, RCP_DEVCLASS_BOOL_SENSOR, HFLOATARR(TS1), 0x07, 0x01,
+                                 0x0A, RCP_DEVCLASS_AMALGAMATE, HFLOATARR(TS2),
+                                 RCP_DEVCLASS_TEMPERATURE, 0x01, HFLOATARR(HPI),
+                                 0x40, 0x00, 0x06, RCP_DEVCLASS_TARGET_LOG, HFLOATARR(TS2), 'a', 'b', 'c',
+                                 0x05, RCP_DEVCLASS_AMALGAMATE, HFLOATARR(TS2), RCP_DEVCLASS_PROMPT};
+        EXPECT_EQ(RCP_ctx_feed(ctx, bytes, sizeof(bytes)), RCP_ERR_AMALG_SUBUNIT);
+
+        RCP_Stats stats;
+        ASSERT_EQ(RCP_ctx_getStats(ctx, &stats), RCP_ERR_SUCCESS);
+        EXPECT_EQ(stats.packets, 6);
+        EXPECT_EQ(stats.bytes, sizeof(bytes));
+        EXPECT_EQ(stats.compactPackets, 5);
+        EXPECT_EQ(stats.extendedPackets, 1);
+        EXPECT_EQ(stats.extendedBytes, 11);
+        EXPECT_EQ(stats.wrongChannel, 1);
+        EXPECT_EQ(stats.filtered, 2);
+        EXPECT_EQ(stats.skippedBytes, 0);
+        EXPECT_EQ(stats.errors[RCP_ERR_AMALG_SUBUNIT], 1);
+        EXPECT_EQ(stats.errors[RCP_ERR_SUCCESS], 0);
+
+        RCP_ClassStats cls;
+        ASSERT_EQ(RCP_ctx_getClassStats(ctx, RCP_DEVCLASS_TEMPERATURE, &cls), RCP_ERR_SUCCESS);
+        EXPECT_EQ(cls.packets, 1);
+        EXPECT_EQ(cls.bytes, 11);
+        EXPECT_EQ(cls.units, 2);
+        ASSERT_EQ(RCP_ctx_getClassStats(ctx, RCP_DEVCLASS_AMALGAMATE, &cls), RCP_ERR_SUCCESS);
+        EXPECT_EQ(cls.packets, 2);
+        EXPECT_EQ(cls.units, 0);
+        ASSERT_EQ(RCP_ctx_getClassStats(ctx, RCP_DEVCLASS_BOOL_SENSOR, &cls), RCP_ERR_SUCCESS);
+        EXPECT_EQ(cls.packets, 0);
+
+        RCP_DeviceStats dev;
+        ASSERT_EQ(RCP_ctx_getDeviceStats(ctx, RCP_DEVCLASS_TEMPERATURE, 1, &dev), RCP_ERR_SUCCESS);
+        EXPECT_EQ(dev.samples, 2);
+        EXPECT_EQ(dev.firstTimestamp, TS1);
+        EXPECT_EQ(dev.lastTimestamp, TS2);
+        EXPECT_EQ(RCP_ctx_getDeviceStats(ctx, RCP_DEVCLASS_BOOL_SENSOR, 7, &dev), RCP_ERR_NO_READING);
+
+        RCP_DeviceStats all[2];
+        ASSERT_EQ(RCP_ctx_snapshotDeviceStats(ctx, all, 2), 1);
+        EXPECT_EQ(all[0].devclass, RCP_DEVCLASS_TEMPERATURE);
+        EXPECT_EQ(all[0].ID, 1);
+    }
+
+    TEST_F(RCPStats, SkippedAndDiscarded) {
+        // Polling skips what the filter drops without reading it
+        ASSERT_EQ(RCP_ctx_subscribe(ctx, RCP_DEVCLASS_BOOL_SENSOR, RCP_ANY_ID), RCP_ERR_SUCCESS);
+        link.rx = {0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x01, HFLOATARR(HPI),
+                   RCP_CH_ONE | 0x06, RCP_DEVCLASS_BOOL_SENSOR, HFLOATARR(TS1), 0x07, 0x01};
+        EXPECT_EQ(RCP_ctx_poll(ctx), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ctx_poll(ctx), RCP_ERR_SUCCESS);
+
+        RCP_Stats stats;
+        ASSERT_EQ(RCP_ctx_getStats(ctx, &stats), RCP_ERR_SUCCESS);
+        EXPECT_EQ(stats.packets, 2);
+        EXPECT_EQ(stats.bytes, 19);
+        EXPECT_EQ(stats.filtered, 1);
+        EXPECT_EQ(stats.wrongChannel, 1);
+        EXPECT_EQ(stats.skippedBytes, 9 + 7);
+
+        // Bytes resync throws away looking for a packet
+        ASSERT_EQ(RCP_ctx_setResync(ctx, 1), RCP_ERR_SUCCESS);
+        const uint8_t junk[] = {0x3F, 0xFF, 0x06, RCP_DEVCLASS_BOOL_SENSOR, HFLOATARR(TS1), 0x07, 0x01};
+        EXPECT_EQ(RCP_ctx_feed(ctx, junk, sizeof(junk)), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_getStats(ctx, &stats), RCP_ERR_SUCCESS);
+        EXPECT_EQ(stats.discardedBytes, RCP_ctx_getDiscarded(ctx));
+        EXPECT_EQ(stats.discardedBytes, 2);
+        EXPECT_EQ(stats.packets, 3);
+    }
+
+    TEST(RCPStatsErrors, Errors) {
+        RCP_Context* ctx = nullptr;
+        ASSERT_EQ(RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, nullptr, &ctx), RCP_ERR_SUCCESS);
+
+        RCP_Stats stats;
+        RCP_ClassStats cls;
+        RCP_DeviceStats dev;
+        EXPECT_EQ(RCP_ctx_getStats(ctx, &stats), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_getClassStats(ctx, RCP_DEVCLASS_TEMPERATURE, &cls), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_getDeviceStats(ctx, RCP_DEVCLASS_TEMPERATURE, 1, &dev), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_snapshotDeviceStats(ctx, &dev, 1), 0);
+        ASSERT_EQ(RCP_ctx_trackStats(ctx), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_trackStats(ctx), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ctx_getStats(ctx, nullptr), RCP_ERR_INIT);
+        ASSERT_EQ(RCP_ctx_getStats(ctx, &stats), RCP_ERR_SUCCESS);
+        EXPECT_EQ(stats.packets, 0);
+        EXPECT_EQ(RCP_ctx_trackStats(nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_getStats(nullptr, &stats), RCP_ERR_INIT);
+        RCP_ctx_destroy(ctx);
+    }
+} // namespace TEST_RCP_Stats
+
+// ------------ SECTION: RCP_Latency ------------ //
+
+namespace TEST_RCP_Latency {
+    class RCPLatency : public testing::Test {
+    protected:
+        TEST_RCP_Context::Link link;
+        RCP_Context* ctx = nullptr;
+
+        RCPLatency() {
+            RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &link, &ctx);
+            RCP_ctx_trackLatency(ctx);
+        }
+
+        ~RCPLatency() override { RCP_ctx_destroy(ctx); }
+
+        void motor(uint8_t ID) {
+            const uint8_t pkt[] = {0x09, RCP_DEVCLASS_MOTOR, HFLOATARR(TS1), ID, HFLOATARR(HPI)};
+            ASSERT_EQ(RCP_ctx_feed(ctx, pkt, sizeof(pkt)), RCP_ERR_SUCCESS);
+        }
+    };
+
+    TEST_F(RCPLatency, RoundTrips) {
+        ASSERT_EQ(RCP_ctx_sendMotorWrite(ctx, 3, 1.0f), RCP_ERR_SUCCESS);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+        // Another device answering does not end the round trip
+        motor(4);
+        motor(3);
+
+        RCP_LatencySummary summary;
+        ASSERT_EQ(RCP_ctx_getLatency(ctx, RCP_DEVCLASS_MOTOR, &summary), RCP_ERR_SUCCESS);
+        EXPECT_EQ(summary.count, 1);
+        EXPECT_GE(summary.minNs, 2000000);
+        EXPECT_EQ(summary.minNs, summary.maxNs);
+        EXPECT_GE(summary.p50Ns, summary.minNs);
+
+        // Readings with no write outstanding are not round trips, and a write repeated before the answer is timed once
+        motor(3);
+        ASSERT_EQ(RCP_ctx_sendMotorWrite(ctx, 3, 2.0f), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_sendMotorWrite(ctx, 3, 3.0f), RCP_ERR_SUCCESS);
+        motor(3);
+        motor(3);
+        ASSERT_EQ(RCP_ctx_getLatency(ctx, RCP_DEVCLASS_MOTOR, &summary), RCP_ERR_SUCCESS);
+        EXPECT_EQ(summary.count, 2);
+
+        // Each class has its own histogram
+        ASSERT_EQ(RCP_ctx_sendSimpleActuatorWrite(ctx, 1, RCP_SIMPLE_ACTUATOR_ON), RCP_ERR_SUCCESS);
+        const uint8_t sact[] = {0x06, RCP_DEVCLASS_SIMPLE_ACTUATOR, HFLOATARR(TS1), 0x01, RCP_SIMPLE_ACTUATOR_ON};
+        ASSERT_EQ(RCP_ctx_feed(ctx, sact, sizeof(sact)), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_getLatency(ctx, RCP_DEVCLASS_SIMPLE_ACTUATOR, &summary), RCP_ERR_SUCCESS);
+        EXPECT_EQ(summary.count, 1);
+        ASSERT_EQ(RCP_ctx_getLatency(ctx, RCP_DEVCLASS_STEPPER, &summary), RCP_ERR_SUCCESS);
+        EXPECT_EQ(summary.count, 0);
+        EXPECT_EQ(summary.p99Ns, 0);
+    }
+
+    TEST_F(RCPLatency, BatchedWritesTimedWhenSent) {
+        ASSERT_EQ(RCP_ctx_beginBatch(ctx, 0, 0), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_sendMotorWrite(ctx, 3, 1.0f), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_sendSimpleActuatorWrite(ctx, 1, RCP_SIMPLE_ACTUATOR_ON), RCP_ERR_SUCCESS);
+
+        // An answer while the write is still queued is not its answer
+        motor(3);
+        RCP_LatencySummary summary;
+        ASSERT_EQ(RCP_ctx_getLatency(ctx, RCP_DEVCLASS_MOTOR, &summary), RCP_ERR_SUCCESS);
+        EXPECT_EQ(summary.count, 0);
+
+        // The time spent queued is not part of the round trip
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ASSERT_EQ(RCP_ctx_flush(ctx), RCP_ERR_SUCCESS);
+        motor(3);
+        ASSERT_EQ(RCP_ctx_getLatency(ctx, RCP_DEVCLASS_MOTOR, &summary), RCP_ERR_SUCCESS);
+        EXPECT_EQ(summary.count, 1);
+        EXPECT_LT(summary.maxNs, 40'000'000);
+
+        const uint8_t sact[] = {0x06, RCP_DEVCLASS_SIMPLE_ACTUATOR, HFLOATARR(TS1), 0x01, RCP_SIMPLE_ACTUATOR_ON};
+        ASSERT_EQ(RCP_ctx_feed(ctx, sact, sizeof(sact)), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_getLatency(ctx, RCP_DEVCLASS_SIMPLE_ACTUATOR, &summary), RCP_ERR_SUCCESS);
+        EXPECT_EQ(summary.count, 1);
+    }
+
+    TEST_F(RCPLatency, Percentiles) {
+        for(uint64_t ns = 1; ns <= 100000; ns++) RCP__latencyRecord(ctx->latency, RCP_DEVCLASS_STEPPER, ns);
+
+        // Never under the true value, and never over it by more than the bucket width
+        RCP_LatencySummary summary;
+        ASSERT_EQ(RCP_ctx_getLatency(ctx, RCP_DEVCLASS_STEPPER, &summary), RCP_ERR_SUCCESS);
+        EXPECT_EQ(summary.count, 100000);
+        EXPECT_EQ(summary.minNs, 1);
+        EXPECT_EQ(summary.maxNs, 100000);
+        EXPECT_EQ(summary.meanNs, 50000);
+        const std::pair<uint64_t, uint64_t> expected[] = {{summary.p50Ns, 50000},
+                                                          {summary.p90Ns, 90000},
+                                                          {summary.p99Ns, 99000},
+                                                          {summary.p999Ns, 99900}};
+        for(const auto& [got, want] : expected) {
+            EXPECT_GE(got, want);
+            EXPECT_LE(got, want + want / 64);
+        }
+
+        EXPECT_EQ(RCP_ctx_latencyPercentile(ctx, RCP_DEVCLASS_STEPPER, 0), 1);
+        EXPECT_EQ(RCP_ctx_latencyPercentile(ctx, RCP_DEVCLASS_STEPPER, 100), 100000);
+        EXPECT_EQ(RCP_ctx_latencyPercentile(ctx, RCP_DEVCLASS_STEPPER, 0.05), 50);
+
+        // Values past the top of the range still report as themselves at the maximum
+        RCP__latencyRecord(ctx->latency, RCP_DEVCLASS_MOTOR, 1ull << 50);
+        EXPECT_EQ(RCP_ctx_latencyPercentile(ctx, RCP_DEVCLASS_MOTOR, 50), 1ull << 50);
+    }
+
+    TEST(RCPLatencyErrors, Errors) {
+        RCP_Context* ctx = nullptr;
+        ASSERT_EQ(RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, nullptr, &ctx), RCP_ERR_SUCCESS);
+
+        RCP_LatencySummary summary;
+        EXPECT_EQ(RCP_ctx_getLatency(ctx, RCP_DEVCLASS_MOTOR, &summary), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_latencyPercentile(ctx, RCP_DEVCLASS_MOTOR, 50), 0);
+        ASSERT_EQ(RCP_ctx_trackLatency(ctx), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_trackLatency(ctx), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ctx_getLatency(ctx, RCP_DEVCLASS_TEMPERATURE, &summary), RCP_ERR_INVALID_DEVCLASS);
+        EXPECT_EQ(RCP_ctx_getLatency(ctx, RCP_DEVCLASS_TEST_STATE, &summary), RCP_ERR_INVALID_DEVCLASS);
+        EXPECT_EQ(RCP_ctx_getLatency(ctx, RCP_DEVCLASS_MOTOR, nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_latencyPercentile(ctx, RCP_DEVCLASS_TEMPERATURE, 50), 0);
+        EXPECT_EQ(RCP_ctx_trackLatency(nullptr), RCP_ERR_INIT);
+        RCP_ctx_destroy(ctx);
+    }
+} // namespace TEST_RCP_Latency
+
+// ------------ SECTION: RCP_Limits ------------ //
+
+namespace TEST_RCP_Limits {
+    struct Trip {
+        size_t rule;
+        float value;
+    };
+
+    struct Trips {
+        std::vector<Trip> trips;
+        RCP_Error result = RCP_ERR_SUCCESS;
+    };
+
+    static RCP_Error onTrip(RCP_Context*, void* user, size_t rule, float value) {
+        static_cast<Trips*>(user)->trips.push_back({rule, value});
+        return static_cast<Trips*>(user)->result;
+    }
+
+    class RCPLimits : public testing::Test {
+    protected:
+        TEST_RCP_Context::Link link;
+        RCP_Context* ctx = nullptr;
+        RCP_Limits* limits = nullptr;
+        Trips trips;
+
+        void compile(const std::vector<RCP_LimitRule>& rules) {
+            ASSERT_EQ(RCP_limits_compile(rules.data(), rules.size(), onTrip, &trips, &limits), RCP_ERR_SUCCESS);
+            ASSERT_EQ(RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &link, &ctx), RCP_ERR_SUCCESS);
+            ASSERT_EQ(RCP_ctx_setLimits(ctx, limits), RCP_ERR_SUCCESS);
+        }
+
+        ~RCPLimits() override {
+            RCP_ctx_destroy(ctx);
+            RCP_limits_destroy(limits);
+        }
+
+        RCP_Error reading(RCP_DeviceClass devclass, uint8_t ID, uint32_t timestamp, float value) {
+            uint8_t pkt[] = {0x09, static_cast<uint8_t>(devclass), HFLOATARR(timestamp), ID, 0, 0, 0, 0};
+            memcpy(pkt + 7, &value, 4);
+            return RCP_ctx_feed(ctx, pkt, sizeof(pkt));
+        }
+
+        size_t estops() const { return std::count(link.sent.begin(), link.sent.end(), RCP_CH_ZERO | 0x00); }
+    };
+
+    TEST_F(RCPLimits, ConsecutiveReadings) {
+        compile({{.devclass = RCP_DEVCLASS_PRESSURE_TRANSDUCER, .ID = 3, .channel = 0, .kind = RCP_LIMIT_ABOVE,
+                  .threshold = 850, .consecutive = 3, .action = RCP_LIMIT_ESTOP}});
+
+        // Broken twice, then fine, which starts the count over
+        for(float v : {849.0f, 851.0f, 852.0f, 849.0f, 851.0f, 852.0f})
+            ASSERT_EQ(reading(RCP_DEVCLASS_PRESSURE_TRANSDUCER, 3, TS1, v), RCP_ERR_SUCCESS);
+        ASSERT_EQ(reading(RCP_DEVCLASS_PRESSURE_TRANSDUCER, 2, TS1, 900), RCP_ERR_SUCCESS);
+        EXPECT_TRUE(link.sent.empty());
+        EXPECT_FALSE(RCP_limits_isTripped(limits, 0));
+
+        ASSERT_EQ(reading(RCP_DEVCLASS_PRESSURE_TRANSDUCER, 3, TS1, 853), RCP_ERR_SUCCESS);
+        EXPECT_EQ(link.sent, std::vector<uint8_t>{RCP_CH_ZERO | 0x00});
+        EXPECT_TRUE(RCP_limits_isTripped(limits, 0));
+        EXPECT_EQ(RCP_limits_trips(limits), 1);
+        ASSERT_EQ(trips.trips.size(), 1);
+        EXPECT_EQ(trips.trips[0].value, 853);
+
+        // The reading still reaches its callback
+        EXPECT_EQ(link.f1s.size(), 8);
+
+        // Tripped rules stay quiet until they are rearmed, and then need the full run of readings again
+        for(int i = 0; i < 5; i++) ASSERT_EQ(reading(RCP_DEVCLASS_PRESSURE_TRANSDUCER, 3, TS1, 900), RCP_ERR_SUCCESS);
+        EXPECT_EQ(estops(), 1);
+        ASSERT_EQ(RCP_limits_rearm(limits), RCP_ERR_SUCCESS);
+        EXPECT_FALSE(RCP_limits_isTripped(limits, 0));
+        for(int i = 0; i < 3; i++) ASSERT_EQ(reading(RCP_DEVCLASS_PRESSURE_TRANSDUCER, 3, TS1, 900), RCP_ERR_SUCCESS);
+        EXPECT_EQ(estops(), 2);
+        EXPECT_EQ(RCP_limits_trips(limits), 2);
+    }
+
+    TEST_F(RCPLimits, RateOfRise) {
+        compile({{.devclass = RCP_DEVCLASS_TEMPERATURE, .ID = 1, .channel = 0, .kind = RCP_LIMIT_RATE_ABOVE,
+                  .threshold = 10, .consecutive = 1, .action = RCP_LIMIT_CALLBACK},
+                 {.devclass = RCP_DEVCLASS_TEMPERATURE, .ID = 1, .channel = 0, .kind = RCP_LIMIT_RATE_BELOW,
+                  .threshold = -10, .consecutive = 1, .action = RCP_LIMIT_CALLBACK}});
+
+        // 5 per second, then a reading with the same timestamp that says nothing about the rate, then 20 per second
+        ASSERT_EQ(reading(RCP_DEVCLASS_TEMPERATURE, 1, 0, 0), RCP_ERR_SUCCESS);
+        ASSERT_EQ(reading(RCP_DEVCLASS_TEMPERATURE, 1, 1000, 5), RCP_ERR_SUCCESS);
+        ASSERT_EQ(reading(RCP_DEVCLASS_TEMPERATURE, 1, 1000, 50), RCP_ERR_SUCCESS);
+        EXPECT_TRUE(trips.trips.empty());
+        ASSERT_EQ(reading(RCP_DEVCLASS_TEMPERATURE, 1, 1500, 15), RCP_ERR_SUCCESS);
+        ASSERT_EQ(trips.trips.size(), 1);
+        EXPECT_EQ(trips.trips[0].rule, 0);
+        EXPECT_FLOAT_EQ(trips.trips[0].value, 20);
+
+        // Falling fast trips the other rule. Neither sends an EStop
+        ASSERT_EQ(reading(RCP_DEVCLASS_TEMPERATURE, 1, 1600, 5), RCP_ERR_SUCCESS);
+        ASSERT_EQ(trips.trips.size(), 2);
+        EXPECT_EQ(trips.trips[1].rule, 1);
+        EXPECT_FLOAT_EQ(trips.trips[1].value, -100);
+        EXPECT_TRUE(link.sent.empty());
+    }
+
+    TEST_F(RCPLimits, NonFiniteReadings) {
+        compile({{.devclass = RCP_DEVCLASS_PRESSURE_TRANSDUCER, .ID = 3, .channel = 0, .kind = RCP_LIMIT_ABOVE,
+                  .threshold = 850, .consecutive = 3, .action = RCP_LIMIT_CALLBACK},
+                 {.devclass = RCP_DEVCLASS_TEMPERATURE, .ID = 1, .channel = 0, .kind = RCP_LIMIT_BELOW,
+                  .threshold = 0, .consecutive = 1, .action = RCP_LIMIT_CALLBACK},
+                 {.devclass = RCP_DEVCLASS_LOAD_CELL, .ID = 2, .channel = 0, .kind = RCP_LIMIT_RATE_ABOVE,
+                  .threshold = 10, .consecutive = 2, .action = RCP_LIMIT_CALLBACK}});
+
+        // A NaN in the middle of a run continues it rather than starting over
+        ASSERT_EQ(reading(RCP_DEVCLASS_PRESSURE_TRANSDUCER, 3, TS1, 900), RCP_ERR_SUCCESS);
+        ASSERT_EQ(reading(RCP_DEVCLASS_PRESSURE_TRANSDUCER, 3, TS1, NAN), RCP_ERR_SUCCESS);
+        EXPECT_FALSE(RCP_limits_isTripped(limits, 0));
+        ASSERT_EQ(reading(RCP_DEVCLASS_PRESSURE_TRANSDUCER, 3, TS1, 900), RCP_ERR_SUCCESS);
+        EXPECT_TRUE(RCP_limits_isTripped(limits, 0));
+
+        ASSERT_EQ(reading(RCP_DEVCLASS_TEMPERATURE, 1, TS1, INFINITY), RCP_ERR_SUCCESS);
+        EXPECT_TRUE(RCP_limits_isTripped(limits, 1));
+
+        // Rate rules count them too, and the rate after is from the last finite reading
+        ASSERT_EQ(reading(RCP_DEVCLASS_LOAD_CELL, 2, 1000, 0), RCP_ERR_SUCCESS);
+        ASSERT_EQ(reading(RCP_DEVCLASS_LOAD_CELL, 2, 2000, NAN), RCP_ERR_SUCCESS);
+        EXPECT_FALSE(RCP_limits_isTripped(limits, 2));
+        ASSERT_EQ(reading(RCP_DEVCLASS_LOAD_CELL, 2, 3000, 1), RCP_ERR_SUCCESS);
+        EXPECT_FALSE(RCP_limits_isTripped(limits, 2));
+        ASSERT_EQ(reading(RCP_DEVCLASS_LOAD_CELL, 2, 4000, NAN), RCP_ERR_SUCCESS);
+        ASSERT_EQ(reading(RCP_DEVCLASS_LOAD_CELL, 2, 5000, NAN), RCP_ERR_SUCCESS);
+        EXPECT_TRUE(RCP_limits_isTripped(limits, 2));
+
+        ASSERT_EQ(trips.trips.size(), 3);
+        EXPECT_EQ(trips.trips[0].value, 900);
+        EXPECT_EQ(trips.trips[1].value, INFINITY);
+        EXPECT_TRUE(std::isnan(trips.trips[2].value));
+    }
+
+    TEST_F(RCPLimits, AmalgamatedFrame) {
+        compile({{.devclass = RCP_DEVCLASS_BOOL_SENSOR, .ID = 7, .channel = 0, .kind = RCP_LIMIT_ABOVE,
+                  .threshold = 0.5f, .consecutive = 1, .action = RCP_LIMIT_ESTOP},
+                 {.devclass = RCP_DEVCLASS_POWERMON, .ID = 2, .channel = 1, .kind = RCP_LIMIT_BELOW,
+                  .threshold = 0, .consecutive = 1, .action = RCP_LIMIT_ESTOP},
+                 {.devclass = RCP_DEVCLASS_POWERMON, .ID = 2, .channel = 0, .kind = RCP_LIMIT_BELOW,
+                  .threshold = 0, .consecutive = 1, .action = RCP_LIMIT_ESTOP}});
+
+        // Both power monitor rules trip on one reading, which sends one EStop, and the bool sensor another
+        constexpr uint32_t NEG_HPI = 0xda0f49c0;
+        trips.result = RCP_ERR_IO_SEND;
+        const uint8_t bytes[] = {0x11, RCP_DEVCLASS_AMALGAMATE, HFLOATARR(TS1),
+                                 RCP_DEVCLASS_BOOL_SENSOR, 0x07, 0x01,
+                                 RCP_DEVCLASS_POWERMON, 0x02, HFLOATARR(NEG_HPI), HFLOATARR(NEG_HPI)};
+        EXPECT_EQ(RCP_ctx_feed(ctx, bytes, sizeof(bytes)), RCP_ERR_IO_SEND);
+        EXPECT_EQ(estops(), 2);
+        ASSERT_EQ(trips.trips.size(), 3);
+        EXPECT_EQ(trips.trips[0].rule, 0);
+        EXPECT_EQ(trips.trips[1].rule, 1);
+        EXPECT_EQ(trips.trips[2].rule, 2);
+
+        // The trip callback's error is returned, but only after the bool reading was delivered and the rest of the
+        // unit decoded
+        EXPECT_EQ(link.bools, 1);
+
+        // Tripped rules are not checked again
+        trips.result = RCP_ERR_SUCCESS;
+        EXPECT_EQ(RCP_ctx_feed(ctx, bytes, sizeof(bytes)), RCP_ERR_SUCCESS);
+        EXPECT_EQ(estops(), 2);
+        EXPECT_EQ(trips.trips.size(), 3);
+        EXPECT_EQ(link.bools, 2);
+    }
+
+    TEST(RCPLimitsErrors, Errors) {
+        RCP_Limits* limits = nullptr;
+        RCP_LimitRule rule = {.devclass = RCP_DEVCLASS_TEST_STATE, .ID = 0, .channel = 0, .kind = RCP_LIMIT_ABOVE,
+                              .threshold = 0, .consecutive = 1, .action = RCP_LIMIT_ESTOP};
+        EXPECT_EQ(RCP_limits_compile(&rule, 1, nullptr, nullptr, &limits), RCP_ERR_INVALID_DEVCLASS);
+        rule.devclass = RCP_DEVCLASS_TEMPERATURE;
+        rule.channel = 1;
+        EXPECT_EQ(RCP_limits_compile(&rule, 1, nullptr, nullptr, &limits), RCP_ERR_INIT);
+        rule.devclass = RCP_DEVCLASS_GPS;
+        rule.channel = 3;
+        rule.kind = static_cast<RCP_LimitKind>(9);
+        EXPECT_EQ(RCP_limits_compile(&rule, 1, nullptr, nullptr, &limits), RCP_ERR_INIT);
+        rule.kind = RCP_LIMIT_BELOW;
+        EXPECT_EQ(RCP_limits_compile(&rule, 1, nullptr, nullptr, nullptr), RCP_ERR_INIT);
+
+        // A callback rule needs a callback
+        rule.action = RCP_LIMIT_CALLBACK;
+        EXPECT_EQ(RCP_limits_compile(&rule, 1, nullptr, nullptr, &limits), RCP_ERR_INIT);
+        ASSERT_EQ(RCP_limits_compile(&rule, 1, TEST_RCP_Limits::onTrip, nullptr, &limits), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_limits_destroy(limits), RCP_ERR_SUCCESS);
+        rule.action = RCP_LIMIT_ESTOP;
+        EXPECT_EQ(RCP_limits_compile(nullptr, 1, nullptr, nullptr, &limits), RCP_ERR_INIT);
+        ASSERT_EQ(RCP_limits_compile(&rule, 1, nullptr, nullptr, &limits), RCP_ERR_SUCCESS);
+
+        EXPECT_FALSE(RCP_limits_isTripped(limits, 1));
+        EXPECT_EQ(RCP_limits_trips(nullptr), 0);
+        EXPECT_EQ(RCP_limits_rearm(nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_setLimits(nullptr, limits), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_limits_destroy(limits), RCP_ERR_SUCCESS);
+
+        ASSERT_EQ(RCP_limits_compile(nullptr, 0, nullptr, nullptr, &limits), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_limits_destroy(limits), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_limits_destroy(nullptr), RCP_ERR_INIT);
+    }
+} // namespace TEST_RCP_Limits
+
+// ------------ SECTION: Resync ------------ //
+
+namespace TEST_RCP_Resync {
+    class RCPResync : public testing::Test {
+    protected:
+        TEST_RCP_Context::Link link;
+        RCP_Context* ctx = nullptr;
+
+        RCPResync() {
+            RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &link, &ctx);
+            RCP_ctx_setResync(ctx, 1);
+        }
+
+        ~RCPResync() override { RCP_ctx_destroy(ctx); }
+
+        static std::vector<uint8_t> reading(uint8_t ID) {
+            float value = ID * 0.5f;
+            std::vector<uint8_t> pkt = {0x09, RCP_DEVCLASS_TEMPERATURE, 0x00, 0x01, 0x00, ID, ID};
+            pkt.resize(11);
+            memcpy(pkt.data() + 7, &value, 4);
+            return pkt;
+        }
+
+        // Readings 0 to 99, with one byte of reading 50 lost
+        static std::vector<uint8_t> glitched() {
+            std::vector<uint8_t> stream;
+            for(uint8_t i = 0; i < 100; i++) {
+                std::vector<uint8_t> pkt = reading(i);
+                if(i == 50) pkt.erase(pkt.begin() + 6);
+                stream.insert(stream.end(), pkt.begin(), pkt.end());
+            }
+
+            return stream;
+        }
+
+        // Readings either side of the glitch come through intact, and at most the two it touched are lost or garbled
+        void checkRecovered() const {
+            ASSERT_GE(link.f1s.size(), 98);
+            ASSERT_LE(link.f1s.size(), 100);
+
+            for(uint8_t i = 0; i < 50; i++) EXPECT_EQ(link.f1s[i].ID, i);
+            for(uint8_t i = 52; i < 100; i++) {
+                const RCP_1F& f1 = link.f1s[link.f1s.size() - 100 + i];
+                EXPECT_EQ(f1.ID, i);
+                EXPECT_EQ(f1.timestamp, 0x00010000u | i);
+                EXPECT_FLOAT_EQ(f1.data, i * 0.5f);
+            }
+
+            EXPECT_GT(RCP_ctx_getDiscarded(ctx), 0);
+        }
+    };
+
+    TEST_F(RCPResync, FeedRecoversFromLostByte) {
+        std::vector<uint8_t> stream = glitched();
+        EXPECT_EQ(RCP_ctx_feed(ctx, stream.data(), stream.size()), RCP_ERR_SUCCESS);
+        checkRecovered();
+    }
+
+    // Any split of the stream across calls gives the same result
+    TEST_F(RCPResync, FeedSplitAnywhere) {
+        std::vector<uint8_t> stream = glitched();
+        EXPECT_EQ(RCP_ctx_feed(ctx, stream.data(), stream.size()), RCP_ERR_SUCCESS);
+        std::vector<RCP_1F> whole = link.f1s;
+        uint64_t discarded = RCP_ctx_getDiscarded(ctx);
+
+        for(size_t chunk : {1, 2, 3, 7, 64}) {
+            RCP_ctx_destroy(ctx);
+            link.f1s.clear();
+            RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &link, &ctx);
+            RCP_ctx_setResync(ctx, 1);
+
+            for(size_t i = 0; i < stream.size(); i += chunk)
+                RCP_ctx_feed(ctx, stream.data() + i, std::min(chunk, stream.size() - i));
+
+            ASSERT_EQ(link.f1s.size(), whole.size()) << "chunk " << chunk;
+            for(size_t i = 0; i < whole.size(); i++) EXPECT_EQ(link.f1s[i].ID, whole[i].ID);
+            EXPECT_EQ(RCP_ctx_getDiscarded(ctx), discarded);
+        }
+    }
+
+    TEST_F(RCPResync, PollRecoversFromLostByte) {
+        link.rx = glitched();
+        while(RCP_ctx_poll(ctx) == RCP_ERR_SUCCESS);
+        EXPECT_EQ(link.rxPos, link.rx.size());
+        checkRecovered();
+    }
+
+    // A bogus extended length is rejected from the class byte, without waiting on the bytes it claims
+    TEST_F(RCPResync, BogusExtendedLength) {
+        std::vector<uint8_t> pkt = reading(7);
+        link.rx = {0x40, 0xFF, 0xFF, RCP_DEVCLASS_TEMPERATURE};
+        link.rx.insert(link.rx.end(), pkt.begin(), pkt.end());
+
+        EXPECT_EQ(RCP_ctx_poll(ctx), RCP_ERR_SUCCESS);
+        ASSERT_EQ(link.f1s.size(), 1);
+        EXPECT_EQ(link.f1s[0].ID, 7);
+        EXPECT_EQ(RCP_ctx_getDiscarded(ctx), 4);
+        EXPECT_EQ(link.rxPos, link.rx.size());
+
+        // Without resync the same bytes have the parser try to read the claimed length
+        TEST_RCP_Context::Link plain;
+        plain.rx = link.rx;
+        RCP_Context* plainCtx = nullptr;
+        RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &plain, &plainCtx);
+        EXPECT_EQ(RCP_ctx_poll(plainCtx), RCP_ERR_IO_RCV);
+        EXPECT_TRUE(plain.f1s.empty());
+        RCP_ctx_destroy(plainCtx);
+    }
+
+    TEST_F(RCPResync, AmalgamationMustBeFilled) {
+        // A 1F subunit followed by the class byte of another that does not fit
+        const uint8_t bad[] = {0x0B, RCP_DEVCLASS_AMALGAMATE, HFLOATARR(TS1), RCP_DEVCLASS_TEMPERATURE, 0x01,
+                               HFLOATARR(HPI), RCP_DEVCLASS_TEMPERATURE};
+        const uint8_t good[] = {0x0D, RCP_DEVCLASS_AMALGAMATE, HFLOATARR(TS1), RCP_DEVCLASS_TEMPERATURE, 0x01,
+                                HFLOATARR(HPI), RCP_DEVCLASS_BOOL_SENSOR, 0x02, 0x80};
+
+        // The tail of the bad unit starts a candidate that only fails once bytes past the good unit arrive, so a
+        // reading follows to settle it
+        std::vector<uint8_t> stream(bad, bad + sizeof(bad));
+        stream.insert(stream.end(), good, good + sizeof(good));
+        std::vector<uint8_t> after = reading(9);
+        stream.insert(stream.end(), after.begin(), after.end());
+
+        EXPECT_EQ(RCP_ctx_feed(ctx, stream.data(), stream.size()), RCP_ERR_SUCCESS);
+        ASSERT_EQ(link.f1s.size(), 2);
+        EXPECT_FLOAT_EQ(link.f1s[0].data, PI);
+        EXPECT_EQ(link.f1s[1].ID, 9);
+        EXPECT_EQ(link.bools, 1);
+        EXPECT_EQ(RCP_ctx_getDiscarded(ctx), sizeof(bad));
+    }
+
+    // Zero length packets, test state in either size, and prompts are all fine as they are
+    TEST_F(RCPResync, VariableSizes) {
+        const uint8_t stream[] = {0x00,
+                                  0x08,
+                                  RCP_DEVCLASS_TEST_STATE,
+                                  HFLOATARR(TS1),
+                                  RCP_TEST_RUNNING,
+                                  0x00,
+                                  0x01,
+                                  0x02,
+                                  0x06,
+                                  RCP_DEVCLASS_TEST_STATE,
+                                  HFLOATARR(TS1),
+                                  RCP_TEST_STOPPED,
+                                  0x00,
+                                  0x03,
+                                  RCP_DEVCLASS_PROMPT,
+                                  RCP_PromptDataType_Float,
+                                  'a',
+                                  'b'};
+
+        EXPECT_EQ(RCP_ctx_feed(ctx, stream, sizeof(stream)), RCP_ERR_SUCCESS);
+        EXPECT_EQ(link.ptype, RCP_PromptDataType_Float);
+        EXPECT_EQ(RCP_ctx_getDiscarded(ctx), 0);
+    }
+} // namespace TEST_RCP_Resync
+
+// ------------ SECTION: COBS framing ------------ //
+
+namespace TEST_RCP_Cobs {
+    static std::vector<uint8_t> encode(const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> out(RCP_COBS_MAX_ENCODED(data.size()));
+        out.resize(RCP_cobs_encode(data.data(), data.size(), out.data()));
+        return out;
+    }
+
+    static std::vector<uint8_t> decode(const std::vector<uint8_t>& frame) {
+        std::vector<uint8_t> out(frame.size());
+        size_t len = 0;
+        EXPECT_EQ(RCP_cobs_decode(frame.data(), frame.size(), out.data(), &len), RCP_ERR_SUCCESS);
+        out.resize(len);
+        return out;
+    }
+
+    TEST(RCPCobs, KnownEncodings) {
+        using Bytes = std::vector<uint8_t>;
+        EXPECT_EQ(encode({}), Bytes({0x01}));
+        EXPECT_EQ(encode({0x00}), Bytes({0x01, 0x01}));
+        EXPECT_EQ(encode({0x00, 0x00}), Bytes({0x01, 0x01, 0x01}));
+        EXPECT_EQ(encode({0x11, 0x22, 0x00, 0x33}), Bytes({0x03, 0x11, 0x22, 0x02, 0x33}));
+        EXPECT_EQ(encode({0x11, 0x00, 0x00, 0x00}), Bytes({0x02, 0x11, 0x01, 0x01, 0x01}));
+
+        // Runs of nonzero bytes are split every 254
+        Bytes run(254);
+        for(size_t i = 0; i < run.size(); i++) run[i] = static_cast<uint8_t>(i + 1);
+        Bytes encoded = encode(run);
+        ASSERT_EQ(encoded.size(), 256);
+        EXPECT_EQ(encoded.front(), 0xFF);
+        EXPECT_EQ(encoded.back(), 0x01);
+    }
+
+    TEST(RCPCobs, RoundTrip) {
+        // Lengths around the block size, with no zeros, all zeros, and a mix
+        for(size_t n : {0, 1, 2, 253, 254, 255, 256, 507, 508, 509, 1000, 65540}) {
+            for(int fill = 0; fill < 3; fill++) {
+                std::vector<uint8_t> data(n);
+                for(size_t i = 0; i < n; i++) {
+                    if(fill == 1) data[i] = static_cast<uint8_t>(i % 255 + 1);
+                    if(fill == 2) data[i] = static_cast<uint8_t>(i * 7);
+                }
+
+                std::vector<uint8_t> encoded = encode(data);
+                EXPECT_LE(encoded.size(), RCP_COBS_MAX_ENCODED(n));
+                EXPECT_EQ(RCP_cobs_findDelimiter(encoded.data(), encoded.size()), encoded.size()) << n;
+                EXPECT_EQ(decode(encoded), data) << n << " bytes, fill " << fill;
+
+                // In place
+                size_t len = 0;
+                ASSERT_EQ(RCP_cobs_decode(encoded.data(), encoded.size(), encoded.data(), &len), RCP_ERR_SUCCESS);
+                EXPECT_TRUE(std::equal(data.begin(), data.end(), encoded.begin()) && len == n);
+            }
+        }
+    }
+
+    TEST(RCPCobs, TruncatedFrame) {
+        const uint8_t frame[] = {0x05, 0x11, 0x22};
+        uint8_t out[sizeof(frame)];
+        size_t len = 0;
+        EXPECT_EQ(RCP_cobs_decode(frame, sizeof(frame), out, &len), RCP_ERR_BAD_FRAME);
+    }
+
+    // Every position and length, so each vector width and the tails past it are covered
+    TEST(RCPCobs, FindDelimiter) {
+        std::vector<uint8_t> bytes(300, 0xAA);
+        for(size_t n = 0; n <= bytes.size(); n++) EXPECT_EQ(RCP_cobs_findDelimiter(bytes.data(), n), n);
+
+        for(size_t zero = 0; zero < bytes.size(); zero++) {
+            bytes[zero] = 0;
+            for(size_t start : {0, 1, 15}) {
+                if(start > zero) continue;
+                EXPECT_EQ(RCP_cobs_findDelimiter(bytes.data() + start, bytes.size() - start), zero - start);
+            }
+
+            bytes[zero] = 0xAA;
+        }
+
+        // Only the first of several counts
+        bytes[100] = 0;
+        bytes[40] = 0;
+        EXPECT_EQ(RCP_cobs_findDelimiter(bytes.data(), bytes.size()), 40);
+    }
+
+    TEST(RCPCobs, Crc16) {
+        const char check[] = "123456789";
+        EXPECT_EQ(RCP_crc16(reinterpret_cast<const uint8_t*>(check), 9), 0x29B1);
+        EXPECT_EQ(RCP_crc16(nullptr, 0), 0xFFFF);
+    }
+
+    class RCPFraming : public testing::TestWithParam<RCP_Framing> {
+    protected:
+        TEST_RCP_Context::Link link;
+        RCP_Context* ctx = nullptr;
+
+        RCPFraming() {
+            RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &link, &ctx);
+            RCP_ctx_setFraming(ctx, GetParam());
+        }
+
+        ~RCPFraming() override { RCP_ctx_destroy(ctx); }
+
+        static std::vector<uint8_t> reading(uint8_t ID) {
+            return {0x09, RCP_DEVCLASS_TEMPERATURE, 0x00, 0x00, 0x00, ID, ID, HFLOATARR(HPI)};
+        }
+
+        // The frame of a packet as the target would send it
+        static std::vector<uint8_t> frame(std::vector<uint8_t> pkt) {
+            if(GetParam() == RCP_FRAMING_COBS_CRC16) {
+                uint16_t crc = RCP_crc16(pkt.data(), pkt.size());
+                pkt.push_back(static_cast<uint8_t>(crc >> 8));
+                pkt.push_back(static_cast<uint8_t>(crc));
+            }
+
+            std::vector<uint8_t> out = encode(pkt);
+            out.push_back(0);
+            return out;
+        }
+    };
+
+    // Many frames at once, and the same stream split every possible way into two calls
+    TEST_P(RCPFraming, Feed) {
+        std::vector<uint8_t> stream;
+        for(uint8_t i = 0; i < 50; i++) {
+            std::vector<uint8_t> f = frame(reading(i));
+            stream.insert(stream.end(), f.begin(), f.end());
+        }
+
+        EXPECT_EQ(RCP_ctx_feed(ctx, stream.data(), stream.size()), RCP_ERR_SUCCESS);
+        ASSERT_EQ(link.f1s.size(), 50);
+        for(uint8_t i = 0; i < 50; i++) {
+            EXPECT_EQ(link.f1s[i].ID, i);
+            EXPECT_FLOAT_EQ(link.f1s[i].data, PI);
+        }
+
+        for(size_t split = 0; split <= 40; split++) {
+            link.f1s.clear();
+            EXPECT_EQ(RCP_ctx_feed(ctx, stream.data(), split), RCP_ERR_SUCCESS);
+            EXPECT_EQ(RCP_ctx_feed(ctx, stream.data() + split, stream.size() - split), RCP_ERR_SUCCESS);
+            EXPECT_EQ(link.f1s.size(), 50) << "split at " << split;
+        }
+
+        EXPECT_EQ(RCP_ctx_getDiscarded(ctx), 0);
+    }
+
+    TEST_P(RCPFraming, Poll) {
+        for(uint8_t i = 0; i < 3; i++) {
+            std::vector<uint8_t> f = frame(reading(i));
+            link.rx.push_back(0);
+            link.rx.insert(link.rx.end(), f.begin(), f.end());
+        }
+
+        for(uint8_t i = 0; i < 3; i++) EXPECT_EQ(RCP_ctx_poll(ctx), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ctx_poll(ctx), RCP_ERR_IO_RCV);
+        ASSERT_EQ(link.f1s.size(), 3);
+        EXPECT_EQ(link.f1s[2].ID, 2);
+    }
+
+    // A damaged frame is dropped on its own, and the frames around it are unaffected
+    TEST_P(RCPFraming, BadFrames) {
+        std::vector<uint8_t> before = frame(reading(1));
+        std::vector<uint8_t> damaged = frame(reading(2));
+        std::vector<uint8_t> after = frame(reading(3));
+
+        // Without a CRC only a damaged length shows, with one any damaged byte does
+        damaged[GetParam() == RCP_FRAMING_COBS_CRC16 ? 8 : 1] ^= 0x04;
+
+        std::vector<uint8_t> stream = before;
+        stream.insert(stream.end(), damaged.begin(), damaged.end());
+        stream.insert(stream.end(), after.begin(), after.end());
+
+        EXPECT_EQ(RCP_ctx_feed(ctx, stream.data(), stream.size()), RCP_ERR_BAD_FRAME);
+        ASSERT_EQ(link.f1s.size(), 2);
+        EXPECT_EQ(link.f1s[0].ID, 1);
+        EXPECT_EQ(link.f1s[1].ID, 3);
+        EXPECT_EQ(RCP_ctx_getDiscarded(ctx), damaged.size());
+
+        // A frame longer than any packet is dropped as it arrives, however long it runs
+        std::vector<uint8_t> junk(RCP_MAX_RX_FRAME + 100, 0x55);
+        EXPECT_EQ(RCP_ctx_feed(ctx, junk.data(), junk.size()), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ctx_feed(ctx, junk.data(), junk.size()), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ctx_feed(ctx, after.data(), after.size()), RCP_ERR_BAD_FRAME);
+        EXPECT_EQ(RCP_ctx_getDiscarded(ctx), damaged.size() + 2 * junk.size() + after.size());
+        EXPECT_EQ(RCP_ctx_feed(ctx, after.data(), after.size()), RCP_ERR_SUCCESS);
+        EXPECT_EQ(link.f1s.size(), 3);
+    }
+
+    // Sends come out as frames that decode back to the packets an unframed link sends
+    TEST_P(RCPFraming, Send) {
+        TEST_RCP_Context::Link plain;
+        RCP_Context* plainCtx = nullptr;
+        RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &plain, &plainCtx);
+
+        for(RCP_Context* c : {ctx, plainCtx}) {
+            RCP_ctx_sendStepperWrite(c, 3, RCP_STEPPER_SPEED_CONTROL, 0.0f);
+            RCP_ctx_beginBatch(c, 0, 0);
+            RCP_ctx_sendHeartbeat(c);
+            RCP_ctx_sendSimpleActuatorWrite(c, 0, RCP_SIMPLE_ACTUATOR_OFF);
+            RCP_ctx_flush(c);
+        }
+
+        std::vector<uint8_t> unframed;
+        const uint8_t* p = link.sent.data();
+        size_t left = link.sent.size();
+        while(left > 0) {
+            size_t end = RCP_cobs_findDelimiter(p, left);
+            ASSERT_LT(end, left);
+
+            std::vector<uint8_t> pkt = decode({p, p + end});
+            if(GetParam() == RCP_FRAMING_COBS_CRC16) {
+                ASSERT_GE(pkt.size(), 2);
+                uint16_t crc = RCP_crc16(pkt.data(), pkt.size() - 2);
+                EXPECT_EQ(pkt[pkt.size() - 2], crc >> 8);
+                EXPECT_EQ(pkt[pkt.size() - 1], crc & 0xFF);
+                pkt.resize(pkt.size() - 2);
+            }
+
+            unframed.insert(unframed.end(), pkt.begin(), pkt.end());
+            p += end + 1;
+            left -= end + 1;
+        }
+
+        EXPECT_EQ(unframed, plain.sent);
+        RCP_ctx_destroy(plainCtx);
+    }
+
+    INSTANTIATE_TEST_SUITE_P(Framing, RCPFraming, testing::Values(RCP_FRAMING_COBS, RCP_FRAMING_COBS_CRC16));
+} // namespace TEST_RCP_Cobs
+
+// ------------ SECTION: RCP_Ring ------------ //
+
+namespace TEST_RCP_Ring {
+    class RCPRing : public testing::Test {
+    protected:
+        RCP_Ring* ring = nullptr;
+
+        RCPRing() { RCP_ring_create(16, &ring); }
+        ~RCPRing() override { RCP_ring_destroy(ring); }
+    };
+
+    TEST(RCPRingCreate, CapacityRoundedToPowerOfTwo) {
+        RCP_Ring* ring = nullptr;
+        ASSERT_EQ(RCP_ring_create(100, &ring), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ring_capacity(ring), 128);
+        EXPECT_EQ(RCP_ring_size(ring), 0);
+        RCP_ring_destroy(ring);
+
+        EXPECT_EQ(RCP_ring_create(0, &ring), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ring_create(16, nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ring_destroy(nullptr), RCP_ERR_INIT);
+    }
+
+    TEST_F(RCPRing, WriteUntilFull) {
+        uint8_t in[20];
+        for(size_t i = 0; i < sizeof(in); i++) in[i] = i;
+
+        EXPECT_EQ(RCP_ring_write(ring, in, sizeof(in)), 16);
+        EXPECT_EQ(RCP_ring_size(ring), 16);
+        EXPECT_EQ(RCP_ring_write(ring, in, 1), 0);
+
+        uint8_t out[20] = {};
+        EXPECT_EQ(RCP_ring_read(ring, out, sizeof(out)), 16);
+        for(size_t i = 0; i < 16; i++) EXPECT_EQ(out[i], i);
+        EXPECT_EQ(RCP_ring_read(ring, out, sizeof(out)), 0);
+    }
+
+    TEST_F(RCPRing, Wraparound) {
+        uint8_t in[12];
+        uint8_t out[12];
+        for(size_t i = 0; i < sizeof(in); i++) in[i] = 0xA0 + i;
+
+        // Move the positions most of the way through the buffer so the next write is split in two
+        ASSERT_EQ(RCP_ring_write(ring, in, 10), 10);
+        ASSERT_EQ(RCP_ring_read(ring, out, 10), 10);
+
+        EXPECT_EQ(RCP_ring_write(ring, in, sizeof(in)), sizeof(in));
+
+        const uint8_t* span = nullptr;
+        EXPECT_EQ(RCP_ring_peek(ring, &span), 6);
+        EXPECT_EQ(span[0], 0xA0);
+        RCP_ring_consume(ring, 6);
+        EXPECT_EQ(RCP_ring_peek(ring, &span), 6);
+        EXPECT_EQ(span[0], 0xA6);
+
+        EXPECT_EQ(RCP_ring_read(ring, out, sizeof(out)), 6);
+        EXPECT_EQ(out[5], 0xAB);
+    }
+
+    TEST_F(RCPRing, FeedContext) {
+        std::vector<RCP_1F> readings;
+        RCP_CtxCallbacks cbks = {};
+        cbks.processOneFloat = [](void* user, RCP_1F d) {
+            static_cast<std::vector<RCP_1F>*>(user)->push_back(d);
+            return RCP_ERR_SUCCESS;
+        };
+
+        RCP_Context* ctx = nullptr;
+        ASSERT_EQ(RCP_ctx_create(cbks, &readings, &ctx), RCP_ERR_SUCCESS);
+
+        const uint8_t pkt[] = {0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x01, HFLOATARR(HPI)};
+
+        // Offset the ring so the second packet wraps around the end of the buffer
+        ASSERT_EQ(RCP_ring_write(ring, pkt, 5), 5);
+        RCP_ring_consume(ring, 5);
+
+        ASSERT_EQ(RCP_ring_write(ring, pkt, sizeof(pkt)), sizeof(pkt));
+        EXPECT_EQ(RCP_ring_feed(ring, ctx), RCP_ERR_SUCCESS);
+        EXPECT_EQ(readings.size(), 1);
+
+        ASSERT_EQ(RCP_ring_write(ring, pkt, sizeof(pkt)), sizeof(pkt));
+        EXPECT_EQ(RCP_ring_feed(ring, ctx), RCP_ERR_SUCCESS);
+        ASSERT_EQ(readings.size(), 2);
+        EXPECT_EQ(readings[1], (RCP_1F{.devclass = RCP_DEVCLASS_TEMPERATURE, .timestamp = TS1, .ID = 1, .data = PI}));
+        EXPECT_EQ(RCP_ring_size(ring), 0);
+
+        RCP_ctx_destroy(ctx);
+    }
+
+    TEST_F(RCPRing, FeedMalformedPacket) {
+        std::vector<RCP_1F> readings;
+        RCP_CtxCallbacks cbks = {};
+        cbks.processOneFloat = [](void* user, RCP_1F d) {
+            static_cast<std::vector<RCP_1F>*>(user)->push_back(d);
+            return RCP_ERR_SUCCESS;
+        };
+
+        RCP_Context* ctx = nullptr;
+        ASSERT_EQ(RCP_ctx_create(cbks, &readings, &ctx), RCP_ERR_SUCCESS);
+
+        // A pressure reading cut off after its ID, in the last bytes of the ring's buffer, so it is fed in place right
+        // against the end of the buffer
+        const uint8_t bad[] = {0x01, RCP_DEVCLASS_PRESSURE_TRANSDUCER, 0x00};
+        const uint8_t pkt[] = {0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x01, HFLOATARR(HPI)};
+        const uint8_t filler[13] = {};
+        ASSERT_EQ(RCP_ring_write(ring, filler, sizeof(filler)), sizeof(filler));
+        RCP_ring_consume(ring, sizeof(filler));
+
+        ASSERT_EQ(RCP_ring_write(ring, bad, sizeof(bad)), sizeof(bad));
+        EXPECT_EQ(RCP_ring_feed(ring, ctx), RCP_ERR_MALFORMED_PACKET);
+        EXPECT_TRUE(readings.empty());
+        EXPECT_EQ(RCP_ring_size(ring), 0);
+
+        // The stream carries on with the next packet
+        ASSERT_EQ(RCP_ring_write(ring, pkt, sizeof(pkt)), sizeof(pkt));
+        EXPECT_EQ(RCP_ring_feed(ring, ctx), RCP_ERR_SUCCESS);
+        EXPECT_EQ(readings.size(), 1);
+
+        RCP_ctx_destroy(ctx);
+    }
+
+    // One thread writes a counting pattern in odd sized chunks while another reads it back in different odd sized
+    // chunks. Any lost, duplicated or reordered byte breaks the pattern.
+    TEST(RCPRingThreads, ProducerConsumer) {
+        constexpr size_t total = 1 << 22;
+        RCP_Ring* ring = nullptr;
+        ASSERT_EQ(RCP_ring_create(4096, &ring), RCP_ERR_SUCCESS);
+
+        std::thread producer([ring] {
+            uint8_t chunk[777];
+            size_t sent = 0;
+            while(sent < total) {
+                size_t n = std::min(sizeof(chunk), total - sent);
+                for(size_t i = 0; i < n; i++) chunk[i] = static_cast<uint8_t>((sent + i) * 7);
+
+                size_t done = 0;
+                while(done < n) {
+                    size_t w = RCP_ring_write(ring, chunk + done, n - done);
+                    if(w == 0) std::this_thread::yield();
+                    done += w;
+                }
+                sent += n;
+            }
+        });
+
+        uint8_t chunk[1000];
+        size_t received = 0;
+        size_t mismatches = 0;
+        while(received < total) {
+            size_t n = RCP_ring_read(ring, chunk, sizeof(chunk));
+            if(n == 0) std::this_thread::yield();
+            for(size_t i = 0; i < n; i++) {
+                if(chunk[i] != static_cast<uint8_t>((received + i) * 7)) mismatches++;
+            }
+            received += n;
+        }
+
+        producer.join();
+        EXPECT_EQ(mismatches, 0);
+        EXPECT_EQ(RCP_ring_size(ring), 0);
+        RCP_ring_destroy(ring);
+    }
+} // namespace TEST_RCP_Ring
+
+// ------------ SECTION: Capture recorder ------------ //
+
+#ifndef _WIN32
+namespace TEST_RCP_Capture {
+    class RCPCapture : public testing::Test {
+    protected:
+        std::filesystem::path path;
+
+        RCPCapture() {
+            path = std::filesystem::temp_directory_path() /
+                (std::string("rcp-") + testing::UnitTest::GetInstance()->current_test_info()->name() + ".cap");
+        }
+
+        ~RCPCapture() override {
+            std::filesystem::remove(path);
+            std::filesystem::remove(path.string() + RCP_INDEX_SUFFIX);
+        }
+
+        std::vector<uint8_t> contents() const {
+            std::ifstream in(path, std::ios::binary);
+            return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        }
+    };
+
+    static uint64_t le(const uint8_t* bytes, int n) {
+        uint64_t value = 0;
+        for(int i = n - 1; i >= 0; i--) value = (value << 8) | bytes[i];
+        return value;
+    }
+
+    TEST_F(RCPCapture, OpenErrors) {
+        RCP_Capture* cap = nullptr;
+        EXPECT_EQ(RCP_capture_open(nullptr, 0, &cap), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_capture_open(path.c_str(), 0, nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_capture_open("/nonexistent/dir/capture.cap", 0, &cap), RCP_ERR_IO_FILE);
+        EXPECT_EQ(cap, nullptr);
+        EXPECT_EQ(RCP_capture_close(nullptr), RCP_ERR_INIT);
+    }
+
+    TEST_F(RCPCapture, RecordsEveryReceivedPacket) {
+        RCP_Capture* cap = nullptr;
+        ASSERT_EQ(RCP_capture_open(path.c_str(), 0, &cap), RCP_ERR_SUCCESS);
+
+        RCP_Context* ctx = nullptr;
+        TEST_RCP_Context::Link link;
+        ASSERT_EQ(RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &link, &ctx), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_setPacketTap(ctx, RCP_capture_tap, cap), RCP_ERR_SUCCESS);
+
+        // A reading on this link's channel, one on the other channel, and a zero length packet, fed in pieces
+        const std::vector<uint8_t> pkts[] = {{0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), 0x01, HFLOATARR(HPI)},
+                                             {RCP_CH_ONE | 0x06, RCP_DEVCLASS_BOOL_SENSOR, HFLOATARR(TS2), 0x02, 0x01},
+                                             {0x00}};
+        std::vector<uint8_t> stream;
+        for(const auto& pkt : pkts) stream.insert(stream.end(), pkt.begin(), pkt.end());
+        EXPECT_EQ(RCP_ctx_feed(ctx, stream.data(), 7), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_ctx_feed(ctx, stream.data() + 7, stream.size() - 7), RCP_ERR_SUCCESS);
+
+        RCP_CaptureStats stats{};
+        EXPECT_EQ(RCP_capture_getStats(cap, &stats), RCP_ERR_SUCCESS);
+        EXPECT_EQ(stats.packets, 3);
+        EXPECT_EQ(stats.bytes, 3 * RCP_CAPTURE_RECORD_HEADER_BYTES + stream.size());
+
+        RCP_ctx_destroy(ctx);
+        ASSERT_EQ(RCP_capture_close(cap), RCP_ERR_SUCCESS);
+
+        std::vector<uint8_t> file = contents();
+        ASSERT_EQ(file.size(), RCP_CAPTURE_FILE_HEADER_BYTES + stats.bytes);
+        EXPECT_EQ(memcmp(file.data(), RCP_CAPTURE_MAGIC, 8), 0);
+        EXPECT_EQ(le(file.data() + 8, 4), RCP_CAPTURE_VERSION);
+
+        const uint8_t* record = file.data() + RCP_CAPTURE_FILE_HEADER_BYTES;
+        uint64_t lastTime = 0;
+        for(const auto& pkt : pkts) {
+            uint64_t time = le(record, 8);
+            EXPECT_GE(time, lastTime);
+            lastTime = time;
+
+            ASSERT_EQ(le(record + 8, 4), pkt.size());
+            EXPECT_EQ(record[12], pkt[0] & RCP_CHANNEL_MASK);
+            EXPECT_EQ(std::vector<uint8_t>(record + RCP_CAPTURE_RECORD_HEADER_BYTES,
+                                           record + RCP_CAPTURE_RECORD_HEADER_BYTES + pkt.size()),
+                      pkt);
+            record += RCP_CAPTURE_RECORD_HEADER_BYTES + pkt.size();
+        }
+    }
+
+    // A buffer much smaller than what is recorded can not keep up, so packets are dropped rather than the recording
+    // thread waiting on the writer. Those recorded must still be whole, in order, and indexed
+    TEST_F(RCPCapture, DropsWhenBufferFills) {
+        RCP_Capture* cap = nullptr;
+        ASSERT_EQ(RCP_capture_open(path.c_str(), 4096, &cap), RCP_ERR_SUCCESS);
+
+        constexpr size_t count = 5000;
+        std::vector<uint8_t> pkt(1000);
+        pkt[0] = RCP_EXTENDED_MASK;
+        for(size_t i = 0; i < count; i++) {
+            pkt[4] = static_cast<uint8_t>(i);
+            pkt[5] = static_cast<uint8_t>(i >> 8);
+            RCP_capture_tap(cap, pkt.data(), pkt.size());
+        }
+
+        RCP_CaptureStats stats{};
+        RCP_capture_getStats(cap, &stats);
+        EXPECT_EQ(stats.packets + stats.dropped, count);
+        EXPECT_GT(stats.dropped, 0);
+        EXPECT_EQ(stats.bytes, stats.packets * (RCP_CAPTURE_RECORD_HEADER_BYTES + pkt.size()));
+        ASSERT_EQ(RCP_capture_close(cap), RCP_ERR_SUCCESS);
+
+        std::vector<uint8_t> file = contents();
+        ASSERT_EQ(file.size(), RCP_CAPTURE_FILE_HEADER_BYTES + stats.bytes);
+
+        size_t outOfOrder = 0;
+        uint64_t last = 0;
+        for(size_t i = 0; i < stats.packets; i++) {
+            const uint8_t* record =
+                file.data() + RCP_CAPTURE_FILE_HEADER_BYTES + i * (RCP_CAPTURE_RECORD_HEADER_BYTES + pkt.size());
+            uint64_t seq = le(record + RCP_CAPTURE_RECORD_HEADER_BYTES + 4, 2);
+            if(le(record + 8, 4) != pkt.size() || (i != 0 && seq <= last)) outOfOrder++;
+            last = seq;
+        }
+
+        EXPECT_EQ(outOfOrder, 0);
+
+        // The writer thread's index matches one built from the file
+        std::string sidecar = path.string() + RCP_INDEX_SUFFIX;
+        RCP_Index* recorded = nullptr;
+        ASSERT_EQ(RCP_index_open(path.c_str(), &recorded), RCP_ERR_SUCCESS);
+        std::filesystem::remove(sidecar);
+        RCP_Index* built = nullptr;
+        ASSERT_EQ(RCP_index_open(path.c_str(), &built), RCP_ERR_SUCCESS);
+
+        ASSERT_EQ(RCP_index_size(recorded), RCP_index_size(built));
+        for(size_t i = 0; i < RCP_index_size(built); i++)
+            EXPECT_EQ(RCP_index_entries(recorded)[i].offset, RCP_index_entries(built)[i].offset);
+
+        RCP_index_close(recorded);
+        RCP_index_close(built);
+    }
+} // namespace TEST_RCP_Capture
+
+// ------------ SECTION: Capture replay ------------ //
+
+namespace TEST_RCP_Replay {
+    class RCPReplay : public TEST_RCP_Capture::RCPCapture {
+    protected:
+        RCP_Context* ctx = nullptr;
+        TEST_RCP_Context::Link link;
+
+        RCPReplay() { RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &link, &ctx); }
+        ~RCPReplay() override { RCP_ctx_destroy(ctx); }
+
+        // Write a capture by hand, so the receive times are known
+        void writeCapture(const std::vector<std::pair<uint64_t, std::vector<uint8_t>>>& records) const {
+            std::vector<uint8_t> file(RCP_CAPTURE_FILE_HEADER_BYTES);
+            memcpy(file.data(), RCP_CAPTURE_MAGIC, 8);
+            RCP__storeLE(file.data() + 8, RCP_CAPTURE_VERSION, 4);
+
+            for(const auto& [time, pkt] : records) {
+                uint8_t header[RCP_CAPTURE_RECORD_HEADER_BYTES] = {};
+                RCP__storeLE(header, time, 8);
+                RCP__storeLE(header + 8, pkt.size(), 4);
+                header[12] = pkt[0] & RCP_CHANNEL_MASK;
+                file.insert(file.end(), header, header + sizeof(header));
+                file.insert(file.end(), pkt.begin(), pkt.end());
+            }
+
+            std::ofstream out(path, std::ios::binary);
+            out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+        }
+
+        static std::vector<uint8_t> reading(uint8_t ID) {
+            return {0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), ID, HFLOATARR(HPI)};
+        }
+    };
+
+    TEST_F(RCPReplay, OpenErrors) {
+        RCP_Replay* replay = nullptr;
+        EXPECT_EQ(RCP_replay_open(nullptr, &replay), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_replay_open(path.c_str(), &replay), RCP_ERR_IO_FILE);
+
+        std::ofstream(path, std::ios::binary) << "NOTACAPTUREFILE!";
+        EXPECT_EQ(RCP_replay_open(path.c_str(), &replay), RCP_ERR_BAD_CAPTURE);
+
+        std::ofstream(path, std::ios::binary) << "RCP";
+        EXPECT_EQ(RCP_replay_open(path.c_str(), &replay), RCP_ERR_BAD_CAPTURE);
+        EXPECT_EQ(replay, nullptr);
+    }
+
+    // Packets recorded from one link come back out of a replay into another
+    TEST_F(RCPReplay, RoundTripThroughRecorder) {
+        RCP_Capture* cap = nullptr;
+        ASSERT_EQ(RCP_capture_open(path.c_str(), 0, &cap), RCP_ERR_SUCCESS);
+        for(uint8_t i = 0; i < 100; i++) RCP_capture_tap(cap, reading(i).data(), reading(i).size());
+        ASSERT_EQ(RCP_capture_close(cap), RCP_ERR_SUCCESS);
+
+        RCP_Replay* replay = nullptr;
+        ASSERT_EQ(RCP_replay_open(path.c_str(), &replay), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_replay_run(replay, ctx, 0), RCP_ERR_SUCCESS);
+
+        ASSERT_EQ(link.f1s.size(), 100);
+        for(uint8_t i = 0; i < 100; i++) EXPECT_EQ(link.f1s[i].ID, i);
+
+        // Running again replays nothing until rewound
+        EXPECT_EQ(RCP_replay_run(replay, ctx, 0), RCP_ERR_SUCCESS);
+        EXPECT_EQ(link.f1s.size(), 100);
+        RCP_replay_rewind(replay);
+        EXPECT_EQ(RCP_replay_run(replay, ctx, 0), RCP_ERR_SUCCESS);
+        EXPECT_EQ(link.f1s.size(), 200);
+
+        RCP_replay_close(replay);
+    }
+
+    TEST_F(RCPReplay, RecordsPointIntoFile) {
+        writeCapture({{1000, reading(1)}, {2000, {RCP_CH_ONE | 0x00}}});
+
+        RCP_Replay* replay = nullptr;
+        ASSERT_EQ(RCP_replay_open(path.c_str(), &replay), RCP_ERR_SUCCESS);
+
+        RCP_CaptureRecord record{};
+        ASSERT_TRUE(RCP_replay_next(replay, &record));
+        EXPECT_EQ(record.timeNs, 1000);
+        EXPECT_EQ(record.channel, RCP_CH_ZERO);
+        EXPECT_EQ(std::vector<uint8_t>(record.pkt, record.pkt + record.length), reading(1));
+
+        ASSERT_TRUE(RCP_replay_next(replay, &record));
+        EXPECT_EQ(record.timeNs, 2000);
+        EXPECT_EQ(record.channel, RCP_CH_ONE);
+        EXPECT_EQ(record.length, 1);
+
+        EXPECT_FALSE(RCP_replay_next(replay, &record));
+        RCP_replay_close(replay);
+    }
+
+    TEST_F(RCPReplay, TruncatedRecordIgnored) {
+        writeCapture({{1000, reading(1)}, {2000, reading(2)}});
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+
+        RCP_Replay* replay = nullptr;
+        ASSERT_EQ(RCP_replay_open(path.c_str(), &replay), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_replay_run(replay, ctx, 0), RCP_ERR_SUCCESS);
+        EXPECT_EQ(link.f1s.size(), 1);
+        RCP_replay_close(replay);
+    }
+
+    TEST_F(RCPReplay, MalformedRecordsSkipped) {
+        // A record holding the start of a packet, one holding two packets, and one holding a packet too short for its
+        // class, between good readings. None of them may leave anything behind for the records after
+        std::vector<uint8_t> cut = reading(2);
+        cut.resize(5);
+        std::vector<uint8_t> two = reading(3);
+        two.insert(two.end(), {0x00});
+        writeCapture({{1000, reading(1)},
+                      {2000, cut},
+                      {3000, two},
+                      {4000, {0x01, RCP_DEVCLASS_TEMPERATURE, 0x04}},
+                      {5000, reading(5)}});
+
+        RCP_Replay* replay = nullptr;
+        ASSERT_EQ(RCP_replay_open(path.c_str(), &replay), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_replay_run(replay, ctx, 0), RCP_ERR_MALFORMED_PACKET);
+        ASSERT_EQ(link.f1s.size(), 2);
+        EXPECT_EQ(link.f1s[0].ID, 1);
+        EXPECT_EQ(link.f1s[1].ID, 5);
+        EXPECT_EQ(RCP_ctx_getDiscarded(ctx), cut.size() + two.size());
+
+        // Framing and resync mode have nothing to do in a capture
+        RCP_replay_rewind(replay);
+        ASSERT_EQ(RCP_ctx_setResync(ctx, 1), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_replay_run(replay, ctx, 0), RCP_ERR_INIT);
+        ASSERT_EQ(RCP_ctx_setResync(ctx, 0), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_setFraming(ctx, RCP_FRAMING_COBS), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_replay_run(replay, ctx, 0), RCP_ERR_INIT);
+        EXPECT_EQ(link.f1s.size(), 2);
+
+        RCP_replay_close(replay);
+    }
+
+    TEST_F(RCPReplay, Pacing) {
+        // Packets 40ms apart in the original capture
+        writeCapture({{5'000'000'000, reading(1)}, {5'040'000'000, reading(2)}, {5'080'000'000, reading(3)}});
+
+        RCP_Replay* replay = nullptr;
+        ASSERT_EQ(RCP_replay_open(path.c_str(), &replay), RCP_ERR_SUCCESS);
+
+        auto timed = [&](double speed) {
+            RCP_replay_rewind(replay);
+            auto start = std::chrono::steady_clock::now();
+            EXPECT_EQ(RCP_replay_run(replay, ctx, speed), RCP_ERR_SUCCESS);
+            return std::chrono::steady_clock::now() - start;
+        };
+
+        EXPECT_GE(timed(1), std::chrono::milliseconds(80));
+        EXPECT_GE(timed(4), std::chrono::milliseconds(20));
+        EXPECT_LT(timed(0), std::chrono::milliseconds(20));
+        EXPECT_EQ(link.f1s.size(), 9);
+
+        EXPECT_EQ(RCP_replay_run(replay, ctx, -1), RCP_ERR_INIT);
+        RCP_replay_close(replay);
+    }
+} // namespace TEST_RCP_Replay
+
+// ------------ SECTION: Capture index ------------ //
+
+namespace TEST_RCP_Index {
+    class RCPIndex : public TEST_RCP_Replay::RCPReplay {
+    protected:
+        static constexpr size_t RECORD = RCP_CAPTURE_RECORD_HEADER_BYTES + 11;
+
+        std::filesystem::path sidecar;
+        std::vector<std::pair<uint64_t, std::vector<uint8_t>>> records;
+
+        RCPIndex() { sidecar = path.string() + RCP_INDEX_SUFFIX; }
+
+        static std::vector<uint8_t> stamped(uint32_t ts) {
+            return {0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(ts), 0x01, HFLOATARR(HPI)};
+        }
+
+        static uint64_t offsetOf(size_t record) { return RCP_CAPTURE_FILE_HEADER_BYTES + record * RECORD; }
+
+        // 20000 readings 1ms apart. The target clock wraps after 5000, and restarts from zero after 12000
+        void writeTimeline() {
+            for(size_t i = 0; i < 20000; i++) {
+                uint32_t ts = i < 12000 ? UINT32_MAX - 4999 + i : i - 12000;
+                records.emplace_back(1'000'000 * (i + 1), stamped(ts));
+            }
+
+            writeCapture(records);
+        }
+    };
+
+    TEST_F(RCPIndex, BuiltWhenMissing) {
+        writeTimeline();
+        ASSERT_FALSE(std::filesystem::exists(sidecar));
+
+        RCP_Index* index = nullptr;
+        ASSERT_EQ(RCP_index_open(path.c_str(), &index), RCP_ERR_SUCCESS);
+        EXPECT_TRUE(std::filesystem::exists(sidecar));
+
+        EXPECT_EQ(RCP_index_epochs(index, RCP_CH_ZERO), 2);
+        size_t n = RCP_index_size(index);
+        const RCP_IndexEntry* entries = RCP_index_entries(index);
+
+        // Sparse, but no gaps bigger than the stride within an epoch
+        EXPECT_LT(n, 20);
+        EXPECT_EQ(entries[0].offset, offsetOf(0));
+        for(size_t i = 1; i < n; i++) {
+            EXPECT_GT(entries[i].offset, entries[i - 1].offset);
+            EXPECT_LE(entries[i].offset - entries[i - 1].offset, RCP_INDEX_STRIDE + RECORD);
+        }
+
+        // The wrap continues the timeline, and the restart begins a new epoch at the exact record
+        for(size_t i = 0; i < n; i++) {
+            size_t record = (entries[i].offset - RCP_CAPTURE_FILE_HEADER_BYTES) / RECORD;
+            EXPECT_EQ(entries[i].hostTimeNs, 1'000'000 * (record + 1));
+            EXPECT_EQ(entries[i].epoch, record < 12000 ? 0 : 1);
+            EXPECT_EQ(entries[i].targetMs, record < 12000 ? uint64_t(UINT32_MAX) - 4999 + record : record - 12000);
+        }
+
+        bool restartIndexed = false;
+        for(size_t i = 0; i < n; i++) restartIndexed |= entries[i].offset == offsetOf(12000);
+        EXPECT_TRUE(restartIndexed);
+
+        RCP_index_close(index);
+    }
+
+    TEST_F(RCPIndex, SeekThenScan) {
+        writeTimeline();
+
+        RCP_Index* index = nullptr;
+        RCP_Replay* replay = nullptr;
+        ASSERT_EQ(RCP_index_open(path.c_str(), &index), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_replay_open(path.c_str(), &replay), RCP_ERR_SUCCESS);
+
+        // Find a record by host time and target time in both epochs, and check a short scan from the entry reaches it
+        auto reaches = [&](uint64_t offset, size_t target) {
+            EXPECT_LE(offset, offsetOf(target));
+            EXPECT_LE(offsetOf(target) - offset, RCP_INDEX_STRIDE + RECORD);
+
+            EXPECT_EQ(RCP_replay_seek(replay, offset), RCP_ERR_SUCCESS);
+            RCP_CaptureRecord record{};
+            while(RCP_replay_tell(replay) < offsetOf(target)) RCP_replay_next(replay, &record);
+            EXPECT_TRUE(RCP_replay_next(replay, &record));
+            EXPECT_EQ(record.timeNs, records[target].first);
+        };
+
+        uint64_t offset = 0;
+        for(size_t target : {0, 1, 4999, 5000, 9876, 11999, 12000, 19999}) {
+            ASSERT_EQ(RCP_index_findHostTime(index, records[target].first, &offset), RCP_ERR_SUCCESS);
+            reaches(offset, target);
+
+            uint32_t epoch = target < 12000 ? 0 : 1;
+            uint64_t targetMs = target < 12000 ? uint64_t(UINT32_MAX) - 4999 + target : target - 12000;
+            ASSERT_EQ(RCP_index_findTargetTime(index, RCP_CH_ZERO, epoch, targetMs, &offset), RCP_ERR_SUCCESS);
+            reaches(offset, target);
+        }
+
+        // Before the start of the capture or of an epoch
+        EXPECT_EQ(RCP_index_findHostTime(index, 0, &offset), RCP_ERR_SUCCESS);
+        EXPECT_EQ(offset, offsetOf(0));
+        EXPECT_EQ(RCP_index_findTargetTime(index, RCP_CH_ZERO, 0, 0, &offset), RCP_ERR_SUCCESS);
+        EXPECT_EQ(offset, offsetOf(0));
+        EXPECT_EQ(RCP_index_findTargetTime(index, RCP_CH_ZERO, 2, 0, &offset), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_index_findTargetTime(index, RCP_CH_ONE, 0, 0, &offset), RCP_ERR_INIT);
+
+        RCP_replay_close(replay);
+        RCP_index_close(index);
+    }
+
+    TEST_F(RCPIndex, StaleSidecarRebuilt) {
+        writeTimeline();
+        RCP_Index* index = nullptr;
+        ASSERT_EQ(RCP_index_open(path.c_str(), &index), RCP_ERR_SUCCESS);
+        size_t before = RCP_index_size(index);
+        RCP_index_close(index);
+
+        // Another restart added to the capture, which has to show up as a new epoch
+        records.emplace_back(records.back().first + 1, stamped(0));
+        writeCapture(records);
+
+        ASSERT_EQ(RCP_index_open(path.c_str(), &index), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_index_size(index), before + 1);
+        EXPECT_EQ(RCP_index_epochs(index, RCP_CH_ZERO), 3);
+        RCP_index_close(index);
+    }
+
+    // The recorder's index should match one built from the finished capture
+    TEST_F(RCPIndex, WrittenByRecorder) {
+        RCP_Capture* cap = nullptr;
+        ASSERT_EQ(RCP_capture_open(path.c_str(), 0, &cap), RCP_ERR_SUCCESS);
+        for(uint32_t i = 0; i < 10000; i++) {
+            std::vector<uint8_t> pkt = stamped(i < 6000 ? i : i - 6000);
+            RCP_capture_tap(cap, pkt.data(), pkt.size());
+        }
+
+        ASSERT_EQ(RCP_capture_close(cap), RCP_ERR_SUCCESS);
+        ASSERT_TRUE(std::filesystem::exists(sidecar));
+
+        RCP_Index* recorded = nullptr;
+        ASSERT_EQ(RCP_index_open(path.c_str(), &recorded), RCP_ERR_SUCCESS);
+
+        std::filesystem::remove(sidecar);
+        RCP_Index* built = nullptr;
+        ASSERT_EQ(RCP_index_open(path.c_str(), &built), RCP_ERR_SUCCESS);
+
+        ASSERT_EQ(RCP_index_size(recorded), RCP_index_size(built));
+        EXPECT_EQ(RCP_index_epochs(recorded, RCP_CH_ZERO), 2);
+        for(size_t i = 0; i < RCP_index_size(built); i++) {
+            const RCP_IndexEntry& a = RCP_index_entries(recorded)[i];
+            const RCP_IndexEntry& b = RCP_index_entries(built)[i];
+            EXPECT_EQ(std::tie(a.offset, a.hostTimeNs, a.targetMs, a.epoch, a.channel),
+                      std::tie(b.offset, b.hostTimeNs, b.targetMs, b.epoch, b.channel));
+        }
+
+        RCP_index_close(recorded);
+        RCP_index_close(built);
+    }
+
+    TEST_F(RCPIndex, ChannelsAndLateReadings) {
+        // The target on channel zero has readings arriving 20ms late, one of them from before its clock wraps after
+        // it has. The target on channel one has a clock of its own, which restarts halfway
+        for(size_t i = 0; i < 20000; i++) {
+            uint32_t ts = UINT32_MAX - 4999 + i;
+            if(i % 7 == 3) ts -= 20;
+            records.emplace_back(1'000'000 * (i + 1), stamped(ts));
+
+            if(i % 2 == 0) {
+                std::vector<uint8_t> pkt = stamped(i < 10000 ? 100'000 + i : i - 10000);
+                pkt[0] |= RCP_CH_ONE;
+                records.emplace_back(1'000'000 * (i + 1) + 500, pkt);
+            }
+        }
+
+        writeCapture(records);
+
+        RCP_Index* index = nullptr;
+        RCP_Replay* replay = nullptr;
+        ASSERT_EQ(RCP_index_open(path.c_str(), &index), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_replay_open(path.c_str(), &replay), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_index_epochs(index, RCP_CH_ZERO), 1);
+        EXPECT_EQ(RCP_index_epochs(index, RCP_CH_ONE), 2);
+
+        // Every entry is on a reading of its own channel that arrived on time, and gives its continued target time
+        const RCP_IndexEntry* entries = RCP_index_entries(index);
+        size_t ones = 0;
+        for(size_t i = 0; i < RCP_index_size(index); i++) {
+            RCP_CaptureRecord record{};
+            ASSERT_EQ(RCP_replay_seek(replay, entries[i].offset), RCP_ERR_SUCCESS);
+            ASSERT_TRUE(RCP_replay_next(replay, &record));
+            EXPECT_EQ(record.channel, entries[i].channel);
+
+            size_t reading = record.timeNs / 1'000'000 - 1;
+            if(entries[i].channel == RCP_CH_ONE) {
+                ones++;
+                EXPECT_EQ(entries[i].epoch, reading < 10000 ? 0 : 1);
+                EXPECT_EQ(entries[i].targetMs, reading < 10000 ? 100'000 + reading : reading - 10000);
+            }
+
+            else {
+                EXPECT_NE(reading % 7, 3);
+                EXPECT_EQ(entries[i].epoch, 0);
+                EXPECT_EQ(entries[i].targetMs, uint64_t(UINT32_MAX) - 4999 + reading);
+            }
+        }
+
+        EXPECT_GT(ones, 1);
+
+        // Target times on channel one are its own
+        uint64_t offset = 0;
+        ASSERT_EQ(RCP_index_findTargetTime(index, RCP_CH_ONE, 1, 4000, &offset), RCP_ERR_SUCCESS);
+        RCP_CaptureRecord record{};
+        ASSERT_EQ(RCP_replay_seek(replay, offset), RCP_ERR_SUCCESS);
+        ASSERT_TRUE(RCP_replay_next(replay, &record));
+        EXPECT_EQ(record.channel, RCP_CH_ONE);
+        EXPECT_GE(record.timeNs / 1'000'000 - 1, 10000);
+        EXPECT_LE(record.timeNs / 1'000'000 - 1, 14000);
+
+        RCP_replay_close(replay);
+        RCP_index_close(index);
+    }
+
+    TEST(RCPTimeline, LateReadingsAndRestarts) {
+        RCP__Timeline timeline;
+        RCP__timelineInit(&timeline);
+
+        // A reading a little late changes nothing
+        EXPECT_FALSE(RCP__timelineAdvance(&timeline, 10000));
+        EXPECT_FALSE(RCP__timelineAdvance(&timeline, 9990));
+        EXPECT_EQ(RCP__timelineMs(&timeline), 10000);
+        EXPECT_EQ(RCP__timelineAt(&timeline, 9990), 9990);
+
+        // Nor does one from before a wrap arriving after it, or one near zero just after it
+        RCP__timelineInit(&timeline);
+        EXPECT_FALSE(RCP__timelineAdvance(&timeline, UINT32_MAX - 5));
+        EXPECT_FALSE(RCP__timelineAdvance(&timeline, 5));
+        EXPECT_FALSE(RCP__timelineAdvance(&timeline, UINT32_MAX - 2));
+        EXPECT_EQ(RCP__timelineMs(&timeline), (uint64_t(1) << 32) + 5);
+        EXPECT_EQ(RCP__timelineAt(&timeline, UINT32_MAX - 2), uint64_t(UINT32_MAX) - 2);
+        EXPECT_FALSE(RCP__timelineAdvance(&timeline, 3));
+        EXPECT_EQ(timeline.epoch, 0);
+
+        // A drop of more than the jitter, or to near zero, is a restart
+        EXPECT_FALSE(RCP__timelineAdvance(&timeline, 10000));
+        EXPECT_TRUE(RCP__timelineAdvance(&timeline, 3));
+        EXPECT_FALSE(RCP__timelineAdvance(&timeline, 500));
+        EXPECT_TRUE(RCP__timelineAdvance(&timeline, 20));
+        EXPECT_FALSE(RCP__timelineAdvance(&timeline, 10000));
+        EXPECT_TRUE(RCP__timelineAdvance(&timeline, 10000 - RCP__TIMELINE_JITTER_MS - 1));
+        EXPECT_EQ(timeline.epoch, 3);
+        EXPECT_EQ(timeline.wraps, 0);
+    }
+} // namespace TEST_RCP_Index
+
+// ------------ SECTION: Parallel decode ------------ //
+
+namespace TEST_RCP_Parallel {
+    using Reading = std::tuple<uint32_t, uint64_t, std::vector<float>>;
+
+    class RCPParallel : public TEST_RCP_Replay::RCPReplay {
+    protected:
+        std::vector<std::pair<uint64_t, std::vector<uint8_t>>> records;
+        std::map<std::pair<int, int>, std::vector<Reading>> expected;
+
+        static void put(std::vector<uint8_t>& pkt, float value) {
+            uint8_t bytes[4];
+            memcpy(bytes, &value, 4);
+            pkt.insert(pkt.end(), bytes, bytes + 4);
+        }
+
+        static void put(std::vector<uint8_t>& pkt, uint32_t ts) { pkt.insert(pkt.end(), {HFLOATARR(ts)}); }
+
+        // 30000 packets of every kind collected, spread over several devices. The target clock wraps after 7000 and
+        // restarts after 18000, and every 100th packet is repeated on another channel
+        void writeMixed() {
+            for(uint32_t i = 0; i < 30000; i++) {
+                uint32_t ts = i < 18000 ? UINT32_MAX - 6999 + i : i - 18000;
+                uint32_t epoch = i < 18000 ? 0 : 1;
+                uint64_t ms = i < 18000 ? uint64_t(UINT32_MAX) - 6999 + i : i - 18000;
+                float f = static_cast<float>(i);
+
+                std::vector<uint8_t> pkt;
+                switch(i % 6) {
+                case 0:
+                case 1:
+                case 2:
+                    pkt = {0x09, RCP_DEVCLASS_TEMPERATURE};
+                    put(pkt, ts);
+                    pkt.push_back(static_cast<uint8_t>(i % 6));
+                    put(pkt, f);
+                    expected[{RCP_DEVCLASS_TEMPERATURE, i % 6}].emplace_back(epoch, ms, std::vector{f});
+                    break;
+
+                case 3:
+                    pkt = {0x11, RCP_DEVCLASS_ACCELEROMETER};
+                    put(pkt, ts);
+                    pkt.push_back(1);
+                    put(pkt, f);
+                    put(pkt, f + 1);
+                    put(pkt, f + 2);
+                    expected[{RCP_DEVCLASS_ACCELEROMETER, 1}].emplace_back(epoch, ms, std::vector{f, f + 1, f + 2});
+                    break;
+
+                case 4: {
+                    bool sensor = i % 12 == 4;
+                    bool on = i % 24 < 12;
+                    auto devclass = sensor ? RCP_DEVCLASS_BOOL_SENSOR : RCP_DEVCLASS_SIMPLE_ACTUATOR;
+                    pkt = {0x06, static_cast<uint8_t>(devclass)};
+                    put(pkt, ts);
+                    pkt.insert(pkt.end(), {2, static_cast<uint8_t>(on ? 0x80 : 0x00)});
+
+                    // Bool data and actuator states are both kept as 0 or 1
+                    float value = on ? 1.0f : 0.0f;
+                    expected[{devclass, 2}].emplace_back(epoch, ms, std::vector{value});
+                    break;
+                }
+
+                default:
+                    pkt = {0x14, RCP_DEVCLASS_AMALGAMATE};
+                    put(pkt, ts);
+                    pkt.insert(pkt.end(), {RCP_DEVCLASS_TEMPERATURE, 7});
+                    put(pkt, f);
+                    pkt.insert(pkt.end(), {RCP_DEVCLASS_POWERMON, 1});
+                    put(pkt, f);
+                    put(pkt, -f);
+                    expected[{RCP_DEVCLASS_TEMPERATURE, 7}].emplace_back(epoch, ms, std::vector{f});
+                    expected[{RCP_DEVCLASS_POWERMON, 1}].emplace_back(epoch, ms, std::vector{f, -f});
+                    break;
+                }
+
+                records.emplace_back(1'000'000 * (i + 1), pkt);
+                if(i % 100 == 0) {
+                    pkt[0] |= RCP_CH_ONE;
+                    records.emplace_back(1'000'000 * (i + 1), pkt);
+                }
+            }
+
+            writeCapture(records);
+        }
+
+        void check(const RCP_DecodeResult* result) {
+            ASSERT_NE(result, nullptr);
+            ASSERT_EQ(result->len, expected.size());
+
+            // The map is ordered the same way as the result
+            size_t s = 0;
+            for(const auto& [device, readings] : expected) {
+                const RCP_DecodedSeries& series = result->series[s++];
+                EXPECT_EQ(series.devclass, device.first);
+                EXPECT_EQ(series.ID, device.second);
+                EXPECT_EQ(series.arity, std::get<2>(readings[0]).size());
+                ASSERT_EQ(series.len, readings.size());
+
+                for(size_t i = 0; i < series.len; i++) {
+                    const RCP_DecodedReading& r = series.readings[i];
+                    std::vector<float> data(r.data, r.data + series.arity);
+                    ASSERT_EQ(Reading(r.epoch, r.targetMs, data), readings[i]) << "reading " << i;
+                }
+            }
+        }
+    };
+
+    TEST_F(RCPParallel, MatchesCapture) {
+        writeMixed();
+
+        for(unsigned threads : {1u, 3u, 8u, 0u}) {
+            RCP_DecodeResult* result = nullptr;
+            ASSERT_EQ(RCP_decode_parallel(path.c_str(), RCP_CH_ZERO, threads, &result), RCP_ERR_SUCCESS);
+            check(result);
+            RCP_decode_free(result);
+        }
+    }
+
+    TEST_F(RCPParallel, OtherChannel) {
+        writeMixed();
+
+        RCP_DecodeResult* result = nullptr;
+        ASSERT_EQ(RCP_decode_parallel(path.c_str(), RCP_CH_ONE, 4, &result), RCP_ERR_SUCCESS);
+
+        size_t total = 0;
+        for(size_t s = 0; s < result->len; s++) total += result->series[s].len;
+        // One reading from each repeated packet, none of which land on an amalgamation unit
+        EXPECT_EQ(total, 300);
+        RCP_decode_free(result);
+    }
+
+    TEST_F(RCPParallel, OtherTargetIgnored) {
+        // A second target on channel one, whose clock restarts every few readings and is far behind channel zero's
+        for(uint32_t i = 0; i < 20000; i++) {
+            std::vector<uint8_t> pkt = {0x09, RCP_DEVCLASS_TEMPERATURE};
+            put(pkt, 1'000'000 + i);
+            pkt.push_back(1);
+            put(pkt, static_cast<float>(i));
+            records.emplace_back(1'000'000 * (i + 1), pkt);
+
+            pkt = {RCP_CH_ONE | 0x09, RCP_DEVCLASS_TEMPERATURE};
+            put(pkt, i % 5 * 2000);
+            pkt.push_back(1);
+            put(pkt, -1.0f);
+            records.emplace_back(1'000'000 * (i + 1) + 500, pkt);
+        }
+
+        writeCapture(records);
+
+        RCP_DecodeResult* result = nullptr;
+        ASSERT_EQ(RCP_decode_parallel(path.c_str(), RCP_CH_ZERO, 4, &result), RCP_ERR_SUCCESS);
+        ASSERT_EQ(result->len, 1);
+        ASSERT_EQ(result->series[0].len, 20000);
+        for(size_t i = 0; i < 20000; i++) {
+            const RCP_DecodedReading& r = result->series[0].readings[i];
+            ASSERT_EQ(std::tuple(r.epoch, r.targetMs, r.data[0]), std::tuple(0u, 1'000'000 + i, static_cast<float>(i)));
+        }
+
+        RCP_decode_free(result);
+    }
+
+    TEST_F(RCPParallel, Errors) {
+        RCP_DecodeResult* result = nullptr;
+        EXPECT_EQ(RCP_decode_parallel(nullptr, RCP_CH_ZERO, 1, &result), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_decode_parallel(path.c_str(), RCP_CH_ZERO, 1, nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_decode_parallel(path.c_str(), RCP_CH_ZERO, 1, &result), RCP_ERR_IO_FILE);
+        EXPECT_EQ(result, nullptr);
+
+        // A capture with no packets decodes to nothing
+        writeCapture({});
+        ASSERT_EQ(RCP_decode_parallel(path.c_str(), RCP_CH_ZERO, 4, &result), RCP_ERR_SUCCESS);
+        EXPECT_EQ(result->len, 0);
+        RCP_decode_free(result);
+    }
+} // namespace TEST_RCP_Parallel
+#endif
+
+// ------------ SECTION: Transports ------------ //
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+namespace TEST_RCP_Transport {
+    // Temperature readings with IDs 0 to n - 1, back to back
+    static std::vector<uint8_t> readings(int n) {
+        std::vector<uint8_t> stream;
+        for(int i = 0; i < n; i++)
+            stream.insert(stream.end(),
+                          {0x09, RCP_DEVCLASS_TEMPERATURE, HFLOATARR(TS1), static_cast<uint8_t>(i), HFLOATARR(HPI)});
+        return stream;
+    }
+
+    static void writeAll(int fd, const std::vector<uint8_t>& bytes) {
+        ASSERT_EQ(write(fd, bytes.data(), bytes.size()), static_cast<ssize_t>(bytes.size()));
+    }
+
+    // Bytes that arrive on fd, until none have for a short while
+    static std::vector<uint8_t> drain(int fd) {
+        std::vector<uint8_t> bytes;
+        pollfd p = {.fd = fd, .events = POLLIN, .revents = 0};
+        uint8_t buf[256];
+        ssize_t n;
+        while(poll(&p, 1, 50) > 0 && (n = read(fd, buf, sizeof(buf))) > 0) bytes.insert(bytes.end(), buf, buf + n);
+        return bytes;
+    }
+
+    static uint16_t localPort(int fd) {
+        sockaddr_in addr{};
+        socklen_t len = sizeof(addr);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        return ntohs(addr.sin_port);
+    }
+
+    // A socket of the type bound to an unused loopback port
+    static int loopbackSocket(int type) {
+        int fd = socket(AF_INET, type, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        return fd;
+    }
+
+    class RCPTransport : public testing::Test {
+    protected:
+        TEST_RCP_Context::Link link;
+        RCP_Context* ctx = nullptr;
+        RCP_Transport* transport = nullptr;
+
+        RCPTransport() { RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &link, &ctx); }
+
+        ~RCPTransport() override {
+            RCP_ctx_destroy(ctx);
+            RCP_transport_close(transport);
+        }
+
+        void pollAll(int n) {
+            for(int i = 0; i < n; i++) ASSERT_EQ(RCP_ctx_poll(ctx), RCP_ERR_SUCCESS) << "packet " << i;
+            ASSERT_EQ(link.f1s.size(), n);
+            for(int i = 0; i < n; i++) EXPECT_EQ(link.f1s[i].ID, i);
+        }
+    };
+
+    // The master side of a pseudo-terminal stands in for the target, and the transport opens the slave side
+    class RCPSerial : public RCPTransport {
+    protected:
+        int master = -1;
+        std::string slave;
+
+        RCPSerial() {
+            master = posix_openpt(O_RDWR | O_NOCTTY);
+            if(master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0) slave = ptsname(master);
+        }
+
+        ~RCPSerial() override {
+            RCP_transport_close(transport);
+            transport = nullptr;
+            if(master >= 0) close(master);
+        }
+    };
+
+    TEST_F(RCPSerial, BufferedReads) {
+        ASSERT_FALSE(slave.empty());
+        RCP_SerialConfig config = {.baud = 115200, .vmin = 0, .vtime = 0, .lowLatency = 1};
+        ASSERT_EQ(RCP_transport_openSerial(slave.c_str(), &config, &transport), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_setTransport(ctx, transport), RCP_ERR_SUCCESS);
+
+        writeAll(master, readings(50));
+        pollAll(50);
+
+        // Two reads per packet through the callbacks, but the transport needs only a few to take them all in
+        RCP_TransportStats stats;
+        ASSERT_EQ(RCP_transport_getStats(transport, &stats), RCP_ERR_SUCCESS);
+        EXPECT_EQ(stats.bytesRead, 50 * 11);
+        EXPECT_LT(stats.reads, 10);
+        EXPECT_TRUE(link.rx.empty());
+
+        ASSERT_EQ(RCP_ctx_sendEStop(ctx), RCP_ERR_SUCCESS);
+        EXPECT_EQ(drain(master), std::vector<uint8_t>{0x00});
+        EXPECT_TRUE(link.sent.empty());
+
+        // Detached, the context is back on its callbacks
+        ASSERT_EQ(RCP_ctx_setTransport(ctx, nullptr), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_sendEStop(ctx), RCP_ERR_SUCCESS);
+        EXPECT_EQ(link.sent, std::vector<uint8_t>{0x00});
+    }
+
+    TEST_F(RCPSerial, TimeoutKeepsPartialData) {
+        ASSERT_FALSE(slave.empty());
+        ASSERT_EQ(RCP_transport_openSerial(slave.c_str(), nullptr, &transport), RCP_ERR_SUCCESS);
+        RCP_transport_setTimeout(transport, 20);
+
+        std::vector<uint8_t> pkt = readings(1);
+        writeAll(master, {pkt.begin(), pkt.begin() + 4});
+
+        uint8_t got[11];
+        auto start = std::chrono::steady_clock::now();
+        EXPECT_EQ(RCP_transport_read(transport, got, sizeof(got)), 0);
+        EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+        writeAll(master, {pkt.begin() + 4, pkt.end()});
+        ASSERT_EQ(RCP_transport_read(transport, got, sizeof(got)), sizeof(got));
+        EXPECT_EQ(std::vector<uint8_t>(got, got + sizeof(got)), pkt);
+
+        // Nothing to read and no waiting allowed
+        RCP_transport_setTimeout(transport, 0);
+        EXPECT_EQ(RCP_transport_read(transport, got, 1), 0);
+    }
+
+    TEST_F(RCPSerial, TermiosTimedReads) {
+        ASSERT_FALSE(slave.empty());
+        RCP_SerialConfig config = {.baud = 0, .vmin = 0, .vtime = 1, .lowLatency = 0};
+        ASSERT_EQ(RCP_transport_openSerial(slave.c_str(), &config, &transport), RCP_ERR_SUCCESS);
+
+        // VTIME decides how long an idle read waits, whatever the transport timeout
+        uint8_t byte;
+        auto start = std::chrono::steady_clock::now();
+        EXPECT_EQ(RCP_transport_read(transport, &byte, 1), 0);
+        EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(90));
+
+        ASSERT_EQ(RCP_ctx_setTransport(ctx, transport), RCP_ERR_SUCCESS);
+        writeAll(master, readings(5));
+        pollAll(5);
+    }
+
+    TEST_F(RCPTransport, Tcp) {
+        int listener = loopbackSocket(SOCK_STREAM);
+        ASSERT_EQ(listen(listener, 1), 0);
+        ASSERT_EQ(RCP_transport_openTcp("127.0.0.1", localPort(listener), &transport), RCP_ERR_SUCCESS);
+        int target = accept(listener, nullptr, nullptr);
+        ASSERT_GE(target, 0);
+        ASSERT_EQ(RCP_ctx_setTransport(ctx, transport), RCP_ERR_SUCCESS);
+
+        // Split mid packet across two writes
+        std::vector<uint8_t> stream = readings(20);
+        writeAll(target, {stream.begin(), stream.begin() + 105});
+        writeAll(target, {stream.begin() + 105, stream.end()});
+        pollAll(20);
+
+        ASSERT_EQ(RCP_ctx_sendEStop(ctx), RCP_ERR_SUCCESS);
+        EXPECT_EQ(drain(target), std::vector<uint8_t>{0x00});
+
+        // Once the target hangs up, reads fail rather than wait
+        close(target);
+        EXPECT_EQ(RCP_ctx_poll(ctx), RCP_ERR_IO_RCV);
+        close(listener);
+    }
+
+    TEST_F(RCPTransport, MalformedPacket) {
+        int listener = loopbackSocket(SOCK_STREAM);
+        ASSERT_EQ(listen(listener, 1), 0);
+        ASSERT_EQ(RCP_transport_openTcp("127.0.0.1", localPort(listener), &transport), RCP_ERR_SUCCESS);
+        int target = accept(listener, nullptr, nullptr);
+        ASSERT_GE(target, 0);
+        ASSERT_EQ(RCP_ctx_setTransport(ctx, transport), RCP_ERR_SUCCESS);
+
+        // A temperature reading cut off after its ID, read ahead into the transport buffer along with the readings
+        std::vector<uint8_t> stream = {0x01, RCP_DEVCLASS_TEMPERATURE, 0x00};
+        std::vector<uint8_t> good = readings(2);
+        stream.insert(stream.end(), good.begin(), good.end());
+        writeAll(target, stream);
+
+        EXPECT_EQ(RCP_ctx_poll(ctx), RCP_ERR_MALFORMED_PACKET);
+        EXPECT_TRUE(link.f1s.empty());
+        pollAll(2);
+
+        close(target);
+        close(listener);
+    }
+
+    TEST_F(RCPTransport, SkipsUnwanted) {
+        int listener = loopbackSocket(SOCK_STREAM);
+        ASSERT_EQ(listen(listener, 1), 0);
+        ASSERT_EQ(RCP_transport_openTcp("127.0.0.1", localPort(listener), &transport), RCP_ERR_SUCCESS);
+        int target = accept(listener, nullptr, nullptr);
+        ASSERT_GE(target, 0);
+        ASSERT_EQ(RCP_ctx_setTransport(ctx, transport), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_unsubscribe(ctx, RCP_DEVCLASS_TARGET_LOG, RCP_ANY_ID), RCP_ERR_SUCCESS);
+
+        // Readings with a log far bigger than the read ahead in the middle, which is dropped without being read in
+        std::vector<uint8_t> stream = readings(10);
+        std::vector<uint8_t> log = {RCP_EXTENDED_MASK, 0xFF, 0xFF - 4, RCP_DEVCLASS_TARGET_LOG};
+        log.resize(0xFFFF + 1, 'x');
+        stream.insert(stream.begin() + 55, log.begin(), log.end());
+        writeAll(target, stream);
+
+        for(int i = 0; i < 11; i++) ASSERT_EQ(RCP_ctx_poll(ctx), RCP_ERR_SUCCESS) << "packet " << i;
+        ASSERT_EQ(link.f1s.size(), 10);
+        for(int i = 0; i < 10; i++) EXPECT_EQ(link.f1s[i].ID, i);
+
+        // A read cut short by the link closing skips only what there was
+        uint8_t two[2] = {0, 0};
+        writeAll(target, {two, two + 2});
+        close(target);
+        EXPECT_EQ(RCP_transport_skip(transport, 3), 2);
+        EXPECT_EQ(RCP_transport_skip(nullptr, 1), 0);
+        close(listener);
+    }
+
+    TEST_F(RCPTransport, Udp) {
+        int target = loopbackSocket(SOCK_DGRAM);
+        ASSERT_EQ(RCP_transport_openUdp("127.0.0.1", localPort(target), 0, &transport), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_setTransport(ctx, transport), RCP_ERR_SUCCESS);
+
+        sockaddr_in host{};
+        host.sin_family = AF_INET;
+        host.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        host.sin_port = htons(localPort(RCP_transport_fd(transport)));
+
+        // Each datagram holds several packets
+        std::vector<uint8_t> stream = readings(12);
+        for(size_t at = 0; at < stream.size(); at += 44)
+            ASSERT_EQ(sendto(target, stream.data() + at, 44, 0, reinterpret_cast<sockaddr*>(&host), sizeof(host)), 44);
+        pollAll(12);
+
+        // Every send is its own datagram
+        ASSERT_EQ(RCP_ctx_sendEStop(ctx), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_sendEStop(ctx), RCP_ERR_SUCCESS);
+        uint8_t buf[16];
+        EXPECT_EQ(recv(target, buf, sizeof(buf), 0), 1);
+        EXPECT_EQ(recv(target, buf, sizeof(buf), 0), 1);
+        close(target);
+    }
+
+    TEST_F(RCPTransport, Errors) {
+        EXPECT_EQ(RCP_transport_openSerial(nullptr, nullptr, &transport), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_transport_openSerial("/dev/null", nullptr, nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_transport_openSerial("/nonexistent/tty", nullptr, &transport), RCP_ERR_IO_OPEN);
+
+        // Not a terminal
+        EXPECT_EQ(RCP_transport_openSerial("/dev/null", nullptr, &transport), RCP_ERR_IO_OPEN);
+
+        RCP_SerialConfig config = {.baud = 12345, .vmin = 0, .vtime = 0, .lowLatency = 0};
+        EXPECT_EQ(RCP_transport_openSerial("/dev/null", &config, &transport), RCP_ERR_INIT);
+        EXPECT_EQ(transport, nullptr);
+
+        // A port nothing listens on
+        int unused = loopbackSocket(SOCK_STREAM);
+        uint16_t port = localPort(unused);
+        close(unused);
+        EXPECT_EQ(RCP_transport_openTcp("127.0.0.1", port, &transport), RCP_ERR_IO_OPEN);
+        EXPECT_EQ(RCP_transport_openTcp(nullptr, port, &transport), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_transport_openUdp(nullptr, port, 0, &transport), RCP_ERR_INIT);
+        EXPECT_EQ(transport, nullptr);
+
+        EXPECT_EQ(RCP_transport_close(nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_transport_read(nullptr, nullptr, 1), 0);
+        EXPECT_EQ(RCP_transport_send(nullptr, nullptr, 1), 0);
+        EXPECT_EQ(RCP_transport_fd(nullptr), -1);
+        EXPECT_EQ(RCP_ctx_setTransport(nullptr, nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_setTransport(nullptr), RCP_ERR_INIT);
+    }
+
+    TEST_F(RCPTransport, NonBlockingTcp) {
+        int listener = loopbackSocket(SOCK_STREAM);
+        ASSERT_EQ(listen(listener, 1), 0);
+        ASSERT_EQ(RCP_transport_openTcp("127.0.0.1", localPort(listener), &transport), RCP_ERR_SUCCESS);
+        int target = accept(listener, nullptr, nullptr);
+        ASSERT_GE(target, 0);
+
+        EXPECT_EQ(RCP_ctx_getFd(ctx), -1);
+        EXPECT_EQ(RCP_ctx_pollNonBlocking(ctx), RCP_ERR_INIT);
+        ASSERT_EQ(RCP_ctx_setTransport(ctx, transport), RCP_ERR_SUCCESS);
+        int fd = RCP_ctx_getFd(ctx);
+        EXPECT_EQ(fd, RCP_transport_fd(transport));
+
+        // Nothing sent yet, and a poll must not wait for it
+        auto start = std::chrono::steady_clock::now();
+        EXPECT_EQ(RCP_ctx_pollNonBlocking(ctx), RCP_ERR_WOULD_BLOCK);
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+        std::vector<uint8_t> stream = readings(3);
+        writeAll(target, {stream.begin(), stream.begin() + 5});
+        pollfd p = {.fd = fd, .events = POLLIN, .revents = 0};
+        ASSERT_EQ(poll(&p, 1, 1000), 1);
+        EXPECT_EQ(RCP_ctx_pollNonBlocking(ctx), RCP_ERR_WOULD_BLOCK);
+        EXPECT_TRUE(link.f1s.empty());
+
+        // The partial packet is finished along with everything behind it
+        writeAll(target, {stream.begin() + 5, stream.end()});
+        ASSERT_EQ(poll(&p, 1, 1000), 1);
+        EXPECT_EQ(RCP_ctx_pollNonBlocking(ctx), RCP_ERR_SUCCESS);
+        ASSERT_EQ(link.f1s.size(), 3);
+        for(int i = 0; i < 3; i++) EXPECT_EQ(link.f1s[i].ID, i);
+        EXPECT_EQ(RCP_ctx_pollNonBlocking(ctx), RCP_ERR_WOULD_BLOCK);
+
+        close(target);
+        ASSERT_EQ(poll(&p, 1, 1000), 1);
+        EXPECT_EQ(RCP_ctx_pollNonBlocking(ctx), RCP_ERR_IO_RCV);
+        close(listener);
+    }
+
+    TEST_F(RCPTransport, NonBlockingMalformedPacket) {
+        int listener = loopbackSocket(SOCK_STREAM);
+        ASSERT_EQ(listen(listener, 1), 0);
+        ASSERT_EQ(RCP_transport_openTcp("127.0.0.1", localPort(listener), &transport), RCP_ERR_SUCCESS);
+        int target = accept(listener, nullptr, nullptr);
+        ASSERT_GE(target, 0);
+        ASSERT_EQ(RCP_ctx_setTransport(ctx, transport), RCP_ERR_SUCCESS);
+
+        // The fill is fed in place, and ends in an amalgamation unit whose last subunit is only a class byte
+        std::vector<uint8_t> stream = readings(2);
+        stream.insert(stream.end(), {0x05, RCP_DEVCLASS_AMALGAMATE, HFLOATARR(TS1), RCP_DEVCLASS_GPS});
+        writeAll(target, stream);
+
+        pollfd p = {.fd = RCP_ctx_getFd(ctx), .events = POLLIN, .revents = 0};
+        ASSERT_EQ(poll(&p, 1, 1000), 1);
+        EXPECT_EQ(RCP_ctx_pollNonBlocking(ctx), RCP_ERR_MALFORMED_PACKET);
+        ASSERT_EQ(link.f1s.size(), 2);
+        for(int i = 0; i < 2; i++) EXPECT_EQ(link.f1s[i].ID, i);
+        EXPECT_EQ(RCP_ctx_pollNonBlocking(ctx), RCP_ERR_WOULD_BLOCK);
+
+        close(target);
+        close(listener);
+    }
+
+#ifdef __linux__
+    // Several links in one edge-triggered epoll set, serviced from a single thread
+    TEST(RCPNonBlocking, EpollManyLinks) {
+        constexpr int LINKS = 4;
+        int listener = loopbackSocket(SOCK_STREAM);
+        ASSERT_EQ(listen(listener, LINKS), 0);
+
+        TEST_RCP_Context::Link links[LINKS];
+        RCP_Context* ctxs[LINKS];
+        RCP_Transport* transports[LINKS];
+        int targets[LINKS];
+        int ep = epoll_create1(0);
+        ASSERT_GE(ep, 0);
+
+        for(int i = 0; i < LINKS; i++) {
+            ASSERT_EQ(RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &links[i], &ctxs[i]), RCP_ERR_SUCCESS);
+            ASSERT_EQ(RCP_transport_openTcp("127.0.0.1", localPort(listener), &transports[i]), RCP_ERR_SUCCESS);
+            targets[i] = accept(listener, nullptr, nullptr);
+            ASSERT_GE(targets[i], 0);
+            ASSERT_EQ(RCP_ctx_setTransport(ctxs[i], transports[i]), RCP_ERR_SUCCESS);
+
+            epoll_event ev = {.events = EPOLLIN | EPOLLET, .data = {.ptr = ctxs[i]}};
+            ASSERT_EQ(epoll_ctl(ep, EPOLL_CTL_ADD, RCP_ctx_getFd(ctxs[i]), &ev), 0);
+        }
+
+        // Link i gets i + 1 packets in pieces of 7 bytes
+        for(int i = 0; i < LINKS; i++) {
+            std::vector<uint8_t> stream = readings(i + 1);
+            for(size_t at = 0; at < stream.size(); at += 7)
+                writeAll(targets[i], {stream.begin() + at, stream.begin() + std::min(at + 7, stream.size())});
+        }
+
+        size_t total = 0;
+        for(int round = 0; round < 100 && total < LINKS * (LINKS + 1) / 2; round++) {
+            epoll_event events[LINKS];
+            int n = epoll_wait(ep, events, LINKS, 100);
+            for(int e = 0; e < n; e++) {
+                RCP_Error rerrno = RCP_ctx_pollNonBlocking(static_cast<RCP_Context*>(events[e].data.ptr));
+                EXPECT_TRUE(rerrno == RCP_ERR_SUCCESS || rerrno == RCP_ERR_WOULD_BLOCK);
+            }
+
+            total = 0;
+            for(auto& l : links) total += l.f1s.size();
+        }
+
+        for(int i = 0; i < LINKS; i++) {
+            EXPECT_EQ(links[i].f1s.size(), i + 1) << "link " << i;
+            RCP_ctx_destroy(ctxs[i]);
+            RCP_transport_close(transports[i]);
+            close(targets[i]);
+        }
+
+        close(ep);
+        close(listener);
+    }
+#endif
+
+    TEST_F(RCPSerial, NonBlockingTermiosTimed) {
+        ASSERT_FALSE(slave.empty());
+        RCP_SerialConfig config = {.baud = 0, .vmin = 1, .vtime = 0, .lowLatency = 0};
+        ASSERT_EQ(RCP_transport_openSerial(slave.c_str(), &config, &transport), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_ctx_setTransport(ctx, transport), RCP_ERR_SUCCESS);
+
+        // VMIN 1 would block a plain read forever
+        EXPECT_EQ(RCP_ctx_pollNonBlocking(ctx), RCP_ERR_WOULD_BLOCK);
+
+        // Bytes already taken in by a blocking read are not lost to the non-blocking path
+        std::vector<uint8_t> stream = readings(2);
+        writeAll(master, stream);
+        uint8_t first[11];
+        ASSERT_EQ(RCP_transport_read(transport, first, sizeof(first)), sizeof(first));
+        writeAll(master, readings(4));
+        pollfd p = {.fd = RCP_ctx_getFd(ctx), .events = POLLIN, .revents = 0};
+        ASSERT_EQ(poll(&p, 1, 1000), 1);
+
+        ASSERT_EQ(RCP_ctx_pollNonBlocking(ctx), RCP_ERR_SUCCESS);
+        ASSERT_EQ(link.f1s.size(), 5);
+        EXPECT_EQ(link.f1s[0].ID, 1);
+        for(int i = 0; i < 4; i++) EXPECT_EQ(link.f1s[i + 1].ID, i);
+    }
+} // namespace TEST_RCP_Transport
+#endif
+
+// ------------ SECTION: RCP_Uring ------------ //
+
+#ifndef _WIN32
+namespace TEST_RCP_Uring {
+    using TEST_RCP_Transport::drain;
+    using TEST_RCP_Transport::localPort;
+    using TEST_RCP_Transport::loopbackSocket;
+    using TEST_RCP_Transport::readings;
+    using TEST_RCP_Transport::writeAll;
+
+    // A link whose readings are answered with a heartbeat, sent from inside the callback
+    struct Echo {
+        TEST_RCP_Context::Link link;
+        RCP_Context* ctx = nullptr;
+        RCP_Transport* transport = nullptr;
+        int target = -1;
+
+        // The ring the link is on, and the link each reading was reported as coming from
+        const RCP_Uring* ring = nullptr;
+        std::vector<uint32_t> linkIds;
+    };
+
+    static RCP_Error echoF1(void* user, RCP_1F f1) {
+        Echo* echo = static_cast<Echo*>(user);
+        echo->link.f1s.push_back(f1);
+
+        uint32_t linkId = 0;
+        if(RCP_uring_currentLink(echo->ring, &linkId)) echo->linkIds.push_back(linkId);
+        return RCP_ctx_sendHeartbeat(echo->ctx);
+    }
+
+    // Run with io_uring, where the kernel has it, and with the poll(2) fallback
+    class RCPUring : public testing::TestWithParam<unsigned> {
+    protected:
+        RCP_Uring* ring = nullptr;
+        int listener = -1;
+
+        RCPUring() {
+            RCP_uring_create(32, GetParam(), &ring);
+            listener = loopbackSocket(SOCK_STREAM);
+            listen(listener, 8);
+        }
+
+        ~RCPUring() override {
+            RCP_uring_destroy(ring);
+            close(listener);
+        }
+
+        void connectEcho(Echo& echo, uint32_t linkId) {
+            RCP_CtxCallbacks callbacks = TEST_RCP_Context::LINK_CALLBACKS;
+            callbacks.processOneFloat = echoF1;
+            ASSERT_EQ(RCP_ctx_create(callbacks, &echo, &echo.ctx), RCP_ERR_SUCCESS);
+            ASSERT_EQ(RCP_transport_openTcp("127.0.0.1", localPort(listener), &echo.transport), RCP_ERR_SUCCESS);
+            echo.target = accept(listener, nullptr, nullptr);
+            ASSERT_GE(echo.target, 0);
+            ASSERT_EQ(RCP_uring_add(ring, linkId, echo.ctx, echo.transport), RCP_ERR_SUCCESS);
+            echo.ring = ring;
+        }
+
+        void release(Echo& echo) {
+            if(ring != nullptr) RCP_uring_remove(ring, echo.ctx);
+            RCP_ctx_destroy(echo.ctx);
+            RCP_transport_close(echo.transport);
+            close(echo.target);
+        }
+
+        // Poll until want packets have arrived across the links, or give up
+        void pollFor(size_t want, const std::vector<Echo*>& echoes) {
+            for(int i = 0; i < 200; i++) {
+                size_t have = 0;
+                for(Echo* e : echoes) have += e->link.f1s.size();
+                if(have >= want) return;
+
+                RCP_Error rerrno = RCP_uring_poll(ring, 20);
+                ASSERT_TRUE(rerrno == RCP_ERR_SUCCESS || rerrno == RCP_ERR_WOULD_BLOCK) << RCP_errstr(rerrno);
+            }
+        }
+    };
+
+    TEST_P(RCPUring, Mode) {
+        ASSERT_NE(ring, nullptr);
+        if(GetParam() & RCP_URING_FALLBACK) EXPECT_FALSE(RCP_uring_isNative(ring));
+#ifdef __linux__
+        else if(!RCP_uring_isNative(ring)) GTEST_SKIP() << "io_uring not available";
+#endif
+        EXPECT_EQ(RCP_uring_poll(ring, 0), RCP_ERR_WOULD_BLOCK);
+    }
+
+    TEST_P(RCPUring, ManyLinks) {
+        constexpr int LINKS = 3;
+        Echo echoes[LINKS];
+        for(int i = 0; i < LINKS; i++) connectEcho(echoes[i], i);
+
+        // Link i gets 5 * (i + 1) packets in pieces of 13 bytes
+        for(int i = 0; i < LINKS; i++) {
+            std::vector<uint8_t> stream = readings(5 * (i + 1));
+            for(size_t at = 0; at < stream.size(); at += 13)
+                writeAll(echoes[i].target, {stream.begin() + at, stream.begin() + std::min(at + 13, stream.size())});
+        }
+
+        pollFor(5 + 10 + 15, {&echoes[0], &echoes[1], &echoes[2]});
+        for(int i = 0; i < LINKS; i++) {
+            ASSERT_EQ(echoes[i].link.f1s.size(), 5 * (i + 1)) << "link " << i;
+            for(int j = 0; j < 5 * (i + 1); j++) EXPECT_EQ(echoes[i].link.f1s[j].ID, j);
+
+            // Every reading was answered, in one stream of heartbeats
+            std::vector<uint8_t> expected;
+            for(int j = 0; j < 5 * (i + 1); j++) expected.insert(expected.end(), {0x01, RCP_DEVCLASS_TEST_STATE, 0xFF});
+            EXPECT_EQ(drain(echoes[i].target), expected) << "link " << i;
+            EXPECT_TRUE(RCP_uring_isOpen(ring, echoes[i].ctx));
+        }
+
+        // Sends made outside a poll go out straight away
+        ASSERT_EQ(RCP_ctx_sendEStop(echoes[1].ctx), RCP_ERR_SUCCESS);
+        EXPECT_EQ(drain(echoes[1].target), std::vector<uint8_t>{0x00});
+        EXPECT_EQ(RCP_uring_poll(ring, 0), RCP_ERR_WOULD_BLOCK);
+
+        for(auto& e : echoes) release(e);
+    }
+
+    TEST_P(RCPUring, SerialAndUdp) {
+        int master = posix_openpt(O_RDWR | O_NOCTTY);
+        ASSERT_GE(master, 0);
+        ASSERT_EQ(grantpt(master), 0);
+        ASSERT_EQ(unlockpt(master), 0);
+
+        Echo serial;
+        RCP_CtxCallbacks callbacks = TEST_RCP_Context::LINK_CALLBACKS;
+        callbacks.processOneFloat = echoF1;
+        ASSERT_EQ(RCP_ctx_create(callbacks, &serial, &serial.ctx), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_transport_openSerial(ptsname(master), nullptr, &serial.transport), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_uring_add(ring, 1, serial.ctx, serial.transport), RCP_ERR_SUCCESS);
+
+        Echo udp;
+        int target = loopbackSocket(SOCK_DGRAM);
+        ASSERT_EQ(RCP_ctx_create(callbacks, &udp, &udp.ctx), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_transport_openUdp("127.0.0.1", localPort(target), 0, &udp.transport), RCP_ERR_SUCCESS);
+        ASSERT_EQ(RCP_uring_add(ring, 2, udp.ctx, udp.transport), RCP_ERR_SUCCESS);
+
+        sockaddr_in host{};
+        host.sin_family = AF_INET;
+        host.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        host.sin_port = htons(localPort(RCP_transport_fd(udp.transport)));
+
+        writeAll(master, readings(6));
+        std::vector<uint8_t> stream = readings(4);
+        ASSERT_EQ(sendto(target, stream.data(), stream.size(), 0, reinterpret_cast<sockaddr*>(&host), sizeof(host)),
+                  static_cast<ssize_t>(stream.size()));
+
+        pollFor(10, {&serial, &udp});
+        EXPECT_EQ(serial.link.f1s.size(), 6);
+        EXPECT_EQ(udp.link.f1s.size(), 4);
+        EXPECT_EQ(drain(master).size(), 6 * 3);
+        EXPECT_EQ(drain(target).size(), 4 * 3);
+
+        // Taken off the ring, the serial port is back to non-blocking and its own transport
+        int flags = fcntl(RCP_transport_fd(serial.transport), F_GETFL);
+        ASSERT_EQ(RCP_uring_remove(ring, serial.ctx), RCP_ERR_SUCCESS);
+        EXPECT_FALSE(RCP_uring_isOpen(ring, serial.ctx));
+        EXPECT_EQ(RCP_uring_remove(ring, serial.ctx), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_ctx_getFd(serial.ctx), RCP_transport_fd(serial.transport));
+        EXPECT_TRUE(fcntl(RCP_transport_fd(serial.transport), F_GETFL) & O_NONBLOCK);
+        EXPECT_EQ(flags & O_NONBLOCK, RCP_uring_isNative(ring) ? 0 : O_NONBLOCK);
+
+        writeAll(master, readings(2));
+        pollfd p = {.fd = RCP_ctx_getFd(serial.ctx), .events = POLLIN, .revents = 0};
+        ASSERT_EQ(poll(&p, 1, 1000), 1);
+        EXPECT_EQ(RCP_ctx_pollNonBlocking(serial.ctx), RCP_ERR_SUCCESS);
+        EXPECT_EQ(serial.link.f1s.size(), 8);
+
+        release(serial);
+        release(udp);
+        close(master);
+        close(target);
+    }
+
+    TEST_P(RCPUring, LinkCloses) {
+        Echo a, b;
+        connectEcho(a, 1);
+        connectEcho(b, 2);
+
+        close(a.target);
+        a.target = -1;
+        RCP_Error rerrno = RCP_ERR_WOULD_BLOCK;
+        for(int i = 0; i < 50 && rerrno == RCP_ERR_WOULD_BLOCK; i++) rerrno = RCP_uring_poll(ring, 20);
+        EXPECT_EQ(rerrno, RCP_ERR_IO_RCV);
+        EXPECT_FALSE(RCP_uring_isOpen(ring, a.ctx));
+        EXPECT_TRUE(RCP_uring_isOpen(ring, b.ctx));
+
+        // The other link carries on
+        writeAll(b.target, readings(2));
+        pollFor(2, {&b});
+        EXPECT_EQ(b.link.f1s.size(), 2);
+
+        // Destroying the ring takes the links off it
+        RCP_uring_destroy(ring);
+        ring = nullptr;
+        EXPECT_EQ(RCP_ctx_getFd(b.ctx), RCP_transport_fd(b.transport));
+
+        release(a);
+        release(b);
+    }
+
+    TEST_P(RCPUring, MalformedPacket) {
+        Echo echo;
+        connectEcho(echo, 1);
+
+        // A target log too short for its timestamp, decoded in place from a pool buffer, between two readings
+        std::vector<uint8_t> stream = readings(1);
+        stream.insert(stream.end(), {0x02, RCP_DEVCLASS_TARGET_LOG, 'h', 'i'});
+        stream.insert(stream.end(), stream.begin(), stream.begin() + 11);
+        writeAll(echo.target, stream);
+
+        RCP_Error seen = RCP_ERR_SUCCESS;
+        for(int i = 0; i < 100 && echo.link.f1s.size() < 2; i++) {
+            RCP_Error rerrno = RCP_uring_poll(ring, 20);
+            if(rerrno != RCP_ERR_SUCCESS && rerrno != RCP_ERR_WOULD_BLOCK) seen = rerrno;
+        }
+
+        EXPECT_EQ(seen, RCP_ERR_MALFORMED_PACKET);
+        EXPECT_EQ(echo.link.f1s.size(), 2);
+        EXPECT_TRUE(RCP_uring_isOpen(ring, echo.ctx));
+
+        release(echo);
+    }
+
+    TEST_P(RCPUring, LinkIdsAndStats) {
+        constexpr int LINKS = 3;
+        Echo echoes[LINKS];
+        for(int i = 0; i < LINKS; i++) connectEcho(echoes[i], 100 + i);
+
+        // Links keep their own channel
+        RCP_ctx_setChannel(echoes[2].ctx, RCP_CH_ONE);
+
+        for(int i = 0; i < LINKS; i++) {
+            std::vector<uint8_t> stream = readings(i + 1);
+            if(i == 2)
+                for(size_t at = 0; at < stream.size(); at += 11) stream[at] |= RCP_CH_ONE;
+            writeAll(echoes[i].target, stream);
+        }
+        pollFor(1 + 2 + 3, {&echoes[0], &echoes[1], &echoes[2]});
+        EXPECT_FALSE(RCP_uring_currentLink(ring, nullptr));
+
+        for(int i = 0; i < LINKS; i++) {
+            EXPECT_EQ(RCP_uring_getLink(ring, 100 + i), echoes[i].ctx);
+            EXPECT_EQ(echoes[i].linkIds, std::vector<uint32_t>(i + 1, 100 + i)) << "link " << i;
+
+            RCP_UringLinkStats stats;
+            ASSERT_EQ(RCP_uring_getStats(ring, 100 + i, &stats), RCP_ERR_SUCCESS);
+            EXPECT_EQ(stats.packets, i + 1);
+            EXPECT_EQ(stats.bytesReceived, (i + 1) * 11);
+            EXPECT_EQ(stats.bytesSent, (i + 1) * 3);
+            EXPECT_EQ(stats.discarded, 0);
+            EXPECT_GT(stats.lastReceiveNs, 0);
+            EXPECT_TRUE(stats.open);
+        }
+
+        std::vector<uint8_t> heartbeats = drain(echoes[2].target);
+        ASSERT_EQ(heartbeats.size(), 3 * 3);
+        for(size_t at = 0; at < heartbeats.size(); at += 3) EXPECT_EQ(heartbeats[at], 0x81);
+        drain(echoes[0].target);
+        drain(echoes[1].target);
+
+        // A link with a lot waiting does not keep a quiet one waiting until it is done
+        writeAll(echoes[0].target, readings(1000));
+        writeAll(echoes[1].target, readings(1));
+        for(int i = 0; i < 100 && echoes[1].link.f1s.size() == 2; i++) {
+            RCP_Error rerrno = RCP_uring_poll(ring, 20);
+            ASSERT_TRUE(rerrno == RCP_ERR_SUCCESS || rerrno == RCP_ERR_WOULD_BLOCK) << RCP_errstr(rerrno);
+        }
+        EXPECT_EQ(echoes[1].link.f1s.size(), 3);
+
+        // Removing a link frees its ID
+        RCP_uring_remove(ring, echoes[0].ctx);
+        EXPECT_EQ(RCP_uring_getLink(ring, 100), nullptr);
+        EXPECT_EQ(RCP_uring_add(ring, 100, echoes[0].ctx, echoes[0].transport), RCP_ERR_SUCCESS);
+
+        for(auto& e : echoes) release(e);
+    }
+
+    TEST_P(RCPUring, Errors) {
+        Echo echo;
+        connectEcho(echo, 1);
+        EXPECT_EQ(RCP_uring_add(ring, 2, echo.ctx, echo.transport), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_uring_add(ring, 2, nullptr, echo.transport), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_uring_add(ring, 2, echo.ctx, nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_uring_add(nullptr, 2, echo.ctx, echo.transport), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_uring_remove(ring, nullptr), RCP_ERR_INIT);
+
+        // Link IDs are unique on a ring
+        RCP_Context* other = nullptr;
+        ASSERT_EQ(RCP_ctx_create(TEST_RCP_Context::LINK_CALLBACKS, &echo, &other), RCP_ERR_SUCCESS);
+        EXPECT_EQ(RCP_uring_add(ring, 1, other, echo.transport), RCP_ERR_INIT);
+        RCP_ctx_destroy(other);
+
+        RCP_UringLinkStats stats;
+        EXPECT_EQ(RCP_uring_getStats(ring, 2, &stats), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_uring_getStats(ring, 1, nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_uring_getStats(nullptr, 1, &stats), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_uring_getLink(nullptr, 1), nullptr);
+        EXPECT_FALSE(RCP_uring_currentLink(nullptr, nullptr));
+
+        // A context on the ring is only received from through it
+        if(RCP_uring_isNative(ring)) EXPECT_EQ(RCP_ctx_poll(echo.ctx), RCP_ERR_IO_RCV);
+        release(echo);
+
+        RCP_Uring* otherRing = nullptr;
+        EXPECT_EQ(RCP_uring_create(0, 0, &otherRing), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_uring_create(8, 0, nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_uring_destroy(nullptr), RCP_ERR_INIT);
+        EXPECT_EQ(RCP_uring_poll(nullptr, 0), RCP_ERR_INIT);
+        EXPECT_FALSE(RCP_uring_isNative(nullptr));
+        EXPECT_FALSE(RCP_uring_isOpen(nullptr, nullptr));
+    }
+
+    INSTANTIATE_TEST_SUITE_P(Uring, RCPUring, testing::Values(0u, static_cast<unsigned>(RCP_URING_FALLBACK)),
+                             [](const testing::TestParamInfo<unsigned>& info) {
+                                 return info.param & RCP_URING_FALLBACK ? "Fallback" : "Native";
+                             });
+} // namespace TEST_RCP_Uring
+#endif